@@ -4,179 +4,655 @@
 
 #ifndef AAUDIORECORDER_AAUDIORECORDER_H
 #define AAUDIORECORDER_AAUDIORECORDER_H
-#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <iosfwd>
+#include <memory>
+#include <string>
 #include <thread>
+#include <vector>
 #include <aaudio/AAudio.h>
-#include <android/log.h>
 
 #include "modules/audio_processing/include/audio_processing.h"
 
-#include "lwrb.h"
-
-
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, "NDKRecorder", __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, "NDKRecorder", __VA_ARGS__)
-
-//10ms
-#define BUFFER_SIZE 960 * 10
+#include "AllocGuard.h"
+#include "ApmConfig.h"
+#include "ApmControl.h"
+#include "AsyncFileSink.h"
+#include "AudioFramePool.h"
+#include "DeepFilterModels.h"
+#include "DeepFilterPipeline.h"
+#include "DeepFilterProcessing.h"
+#include "DelayEstimator.h"
+#include "FrameSignal.h"
+#include "MappedAudioFile.h"
+#include "PcmConvert.h"
+#include "QualityGovernor.h"
+#include "RecorderLog.h"
+#include "SpscFrameRing.h"
+
+
+// ring buffer 容量（帧），2 的幂，48kHz 下约 170ms
+#define RING_FRAMES 8192
+
+#if defined(AUDIO_PROCESSING_STALL_MS) && !defined(AUDIO_PROCESSING_STALL_EVERY)
+#define AUDIO_PROCESSING_STALL_EVERY 500
+#endif
+
+// APM 处理使用的采样格式
+enum class SampleFormat {
+    Float,  // int16 -> float -> ProcessStream(float) -> int16
+    Int16,  // 交织 int16 直接送入 ProcessStream(int16)，不做格式转换
+};
 
 class CallbackPCMRecorder {
 public:
     CallbackPCMRecorder() : stream(nullptr), builder(nullptr) {
-        lwrb_init(&audio_rb, audio_rb_data, BUFFER_SIZE);
+        // 镜像映射失败时 ring buffer 退回普通内存，帧视图可能分成两段
+        if (!audio_rb.isMirrored()) {
+            LOGE("Mirrored ring buffer unavailable, fallback to linear storage");
+        }
+    }
 
+    // 只能在 start() 之前设置
+    void setSampleFormat(SampleFormat format) {
+        sampleFormat = format;
     }
 
+    /**
+     * 送入播放(远端)参考信号，交织 int16，可在任意一个播放线程上调用（单生产者）
+     * timestampNs 为这批数据第一帧的播放时间 (steady_clock)，与采集时间一起给出延迟估计的初值
+     * 设置了 setRenderSourceFile() 时参考信号由处理线程直接从文件读取，这里不写入任何数据
+     * \return          实际写入的帧数，参考 ring buffer 满时丢弃多余部分
+     */
+    size_t pushRenderAudio(const int16_t* data, int32_t numFrames, int64_t timestampNs) {
+        if (renderFromFile.load(std::memory_order_relaxed)) return 0;
+
+        int64_t mark[2] = {(int64_t) renderFramesPushed, timestampNs};
+        render_ts.write(mark, 1);
+
+        size_t written = render_rb.write(data, numFrames);
+        renderFramesPushed += written;
+        if (written < (size_t) numFrames) {
+            renderDroppedSamples.fetch_add(numFrames - written, std::memory_order_relaxed);
+        }
+        return written;
+    }
+
+    /**
+     * 使用本地 PCM / WAV 文件作为远端参考，每处理一帧采集数据读取一帧，只能在 start() 之前设置。
+     * 文件帧由处理线程直接送入 ProcessReverseStream，不经过 render_rb，
+     * 录制结束之前 pushRenderAudio() 不接受数据，render_rb 始终只有播放线程一个生产者
+     */
+    bool setRenderSourceFile(const char* path) {
+        if (!openMapped(renderSourceFile, path)) {
+            LOGE("Failed to open render source file");
+            return false;
+        }
+        renderFromFile.store(true, std::memory_order_relaxed);
+        return true;
+    }
+
+    enum class DeepFilterMode {
+        Inline,         // 作为 APM 采集链路的最后一级，在处理线程上运行
+        Pipelined,      // 在单独的线程上运行，附加固定 DEEP_FILTER_PIPELINE_DEPTH 帧延迟
+    };
+
+    // 在 start() / apmHandlePcm() 之前设置；离线处理总是使用 Inline
+    void setDeepFilterModel(const char* path, float attenLimDb, DeepFilterMode mode = DeepFilterMode::Inline) {
+        deepFilterModelPath = path != nullptr ? path : "";
+        deepFilterAttenLimDb = attenLimDb;
+        deepFilterPipeline.setAttenLimDb(attenLimDb);
+        deepFilterMode = mode;
+        if (deepFilterModels != nullptr && !deepFilterModelPath.empty()) {
+            deepFilterModels->preload(deepFilterModelPath.c_str());
+        }
+    }
+
+    /**
+     * 设置后模型由 models 在后台加载，start() 只取就绪的状态，不会等待 df_create；
+     * 模型还没有就绪时本次录制只做 APM。models 的生命周期由调用方管理，需要长于 recorder
+     */
+    void setDeepFilterModels(DeepFilterModelManager* models) {
+        deepFilterModels = models;
+        if (deepFilterModels != nullptr && !deepFilterModelPath.empty()) {
+            deepFilterModels->preload(deepFilterModelPath.c_str());
+        }
+    }
+
+    /**
+     * 任意线程调用，下一帧生效。内联 DF 随 APM 重建而释放，它的参数经 ApmControl 的队列
+     * 在处理线程上修改，并保留到之后的 start()；流水线 DF 的参数由 DeepFilterPipeline 保存，
+     * 在 DF 线程上应用。命令队列满时返回 false
+     */
+    bool setDeepFilterAttenLim(float db) {
+        deepFilterPipeline.setAttenLimDb(db);
+        return apmControl.deepFilter(ApmControl::kDfAttenLimDb, db);
+    }
+
+    bool setDeepFilterPostFilterBeta(float beta) {
+        deepFilterPipeline.setPostFilterBeta(beta);
+        return apmControl.deepFilter(ApmControl::kDfPostFilterBeta, beta);
+    }
+
+    // 静音和干净语音段跳过 DF 推理，可以在 start() 之前或运行中切换
+    bool setDeepFilterGating(bool enable) {
+        deepFilterGating = enable;
+        deepFilterPipeline.setGating(enable);
+        return apmControl.deepFilter(ApmControl::kDfGating, enable ? 1.f : 0.f);
+    }
+
+    // 临时让 DF 走旁路，任意线程调用
+    bool setDeepFilterSuspended(bool suspend) {
+        deepFilterPipeline.setSuspended(suspend);
+        return apmControl.deepFilter(ApmControl::kDfSuspended, suspend ? 1.f : 0.f);
+    }
+
+    // 处理跟不上时由 QualityGovernor 逐级降低质量，默认开启；在 start() 之前设置
+    void setQualityGovernor(bool enable) { qualityGovernorEnabled = enable; }
+
+    // 用本地的 STFT / ERB / DF 引擎驱动 df_process_frame_raw，config 需要与模型一致；在模型加载之前设置
+    void setDeepFilterSpectral(bool enable, const DeepFilterSpectralConfig& config = DeepFilterSpectralConfig()) {
+        deepFilterSpectral = enable;
+        deepFilterSpectralConfig = config;
+    }
+
+    /**
+     * 运行中修改 APM 配置或发送 RuntimeSetting (capture pre / post gain、fixed post gain 等)，不需要重新 start()。
+     * 任意线程调用，处理线程在下一帧之前应用；修改会保留到之后的 start() / apmHandlePcm()。
+     * 命令队列满时返回 false
+     */
+    bool updateApmConfig(const ApmConfigDelta& delta) { return apmControl.update(delta); }
+    bool setApmRuntimeSetting(webrtc::AudioProcessing::RuntimeSetting setting) { return apmControl.post(setting); }
+
+    bool setCapturePreGain(float gain) {
+        return apmControl.post(webrtc::AudioProcessing::RuntimeSetting::CreateCapturePreGain(gain));
+    }
+
+    bool setCapturePostGain(float gain) {
+        return apmControl.post(webrtc::AudioProcessing::RuntimeSetting::CreateCapturePostGain(gain));
+    }
+
+    bool setCaptureFixedPostGain(float gainDb) {
+        return apmControl.post(webrtc::AudioProcessing::RuntimeSetting::CreateCaptureFixedPostGain(gainDb));
+    }
+
+    /**
+     * 启动录制，互不依赖的准备工作并行进行：
+     *   - 文件线程: 打开输出 / 原始 PCM 文件 (含 fallocate 预留)
+     *   - APM 线程: AudioProcessingBuilder::Create()，Inline 模式同时加载 DF 模型
+     *   - DF 线程: Pipelined 模式加载模型并启动 DF 流水线
+     *   - 调用线程: 创建并打开 AAudio 流
+     * 全部完成、处理线程启动之后才 requestStart，第一个回调到来时消费者已经就绪。
+     * 第一帧处理完成时输出启动时间线
+     */
     bool start(const char* source, const char* filename) {
-        rtcFile.open(filename, std::ios::binary);
-        sourceFile.open(source, std::ios::binary);
-        if (!rtcFile.is_open()) {
+        int64_t begin = nowNs();
+        pendingStartNs.store(begin, std::memory_order_relaxed);
+        startup = StartupTimeline{};
+        startup.beginNs = begin;
+
+        const bool pipelined = usePipelinedDeepFilter();
+        std::thread deepFilterTask;
+        if (pipelined) {
+            deepFilterTask = std::thread([this, filename] {
+                deepFilterPipeline.start(createDeepFilterStream(), filename, WavFormat{SAMPLE_RATE, CHANNELS, 16},
+                                         FRAME_SIZE, DEEP_FILTER_PIPELINE_DEPTH);
+                startup.deepFilterNs = nowNs() - startup.beginNs;
+            });
+        }
+        std::thread apmTask([this, pipelined] {
+            createApm(!pipelined);
+            startup.apmNs = nowNs() - startup.beginNs;
+        });
+        std::thread fileTask([this, source, filename, pipelined] {
+            if (!pipelined) openSink(rtcFile, filename);
+            openSink(sourceFile, source);
+            startup.filesNs = nowNs() - startup.beginNs;
+        });
+
+        bool streamOpened = openStream();
+        startup.streamOpenNs = nowNs() - begin;
+
+        fileTask.join();
+        apmTask.join();
+        if (deepFilterTask.joinable()) deepFilterTask.join();
+
+        // 流水线没有启动 (模型没有就绪) 时退回直接写文件
+        if (pipelined && !deepFilterPipeline.isRunning()) {
+            openSink(rtcFile, filename);
+        }
+        if (!rtcFile.is_open() && !deepFilterPipeline.isRunning()) {
             LOGE("Failed to open output file");
-            return false;
+            return abortStart();
         }
 
         if (!sourceFile.is_open()) {
             LOGE("Failed to open sourceFile file");
-            return false;
+            return abortStart();
         }
 
-        aaudio_result_t result = AAudio_createStreamBuilder(&builder);
+        if (!streamOpened) {
+            return abortStart();
+        }
+
+        delayEstimator.start(apm);
+        if (qualityGovernorEnabled) {
+            QualityGovernor::DeepFilterSwitch dfSwitch;
+            if (inlineDeepFilter || deepFilterPipeline.isRunning()) {
+                dfSwitch = [this](bool off) { return setDeepFilterGovernorOff(off); };
+            }
+            qualityGovernor.start(&apmControl, std::move(dfSwitch));
+        }
+
+        LOGI("webrtc audio processing module create complete, pcm convert backend %s", pcmConvertBackend());
+
+        processNsTotal = 0;
+        processNsMax = 0;
+        processingStartNs = nowNs();
+
+        // 丢弃上一次录制残留的参考信号，保证和采集帧对齐
+        renderFramesConsumed += render_rb.skip(render_rb.availableFrames());
+
+        running = true;
+        handlerThread = std::thread(&CallbackPCMRecorder::handlerLoop, this);
+
+        // 消费者全部就绪之后再启动设备
+        firstCallbackNs.store(0, std::memory_order_relaxed);
+        deviceStartNs.store(nowNs(), std::memory_order_relaxed);
+        aaudio_result_t result = AAudioStream_requestStart(stream);
         if (result != AAUDIO_OK) {
-            LOGE("Failed to create stream builder");
-            return false;
+            LOGE("Failed to start stream");
+            return abortStart();
         }
 
-        AAudioStreamBuilder_setDirection(builder, AAUDIO_DIRECTION_INPUT);
-        AAudioStreamBuilder_setSampleRate(builder, SAMPLE_RATE);
-        AAudioStreamBuilder_setChannelCount(builder, CHANNELS);
-        AAudioStreamBuilder_setFormat(builder, AAUDIO_FORMAT_PCM_I16);
-        AAudioStreamBuilder_setSharingMode(builder, AAUDIO_SHARING_MODE_SHARED);
+        LOGI("Callback PCM recording started");
 
-        // 设置回调
-        AAudioStreamBuilder_setDataCallback(builder, dataCallback, this);
-        AAudioStreamBuilder_setErrorCallback(builder, errorCallback, this);
+        return true;
+    }
 
-        result = AAudioStreamBuilder_openStream(builder, &stream);
+    /**
+     * 暂停采集: 只停止 AAudio 流 (输入流不支持 requestPause)，流本身保持打开。
+     * 处理线程、APM、DF 和输出文件都保留，AEC / AGC / NS / DF 的自适应状态不需要重新收敛；
+     * 暂停期间处理线程挂起在 FrameSignal 上，ring 中剩余的整帧照常处理完
+     */
+    bool pause() {
+        if (!running || stream == nullptr || paused) return false;
+        paused = true;
+        aaudio_result_t result = AAudioStream_requestStop(stream);
         if (result != AAUDIO_OK) {
-            LOGE("Failed to open stream");
+            LOGE("Failed to pause stream");
+            paused = false;
             return false;
         }
+        LOGI("Callback PCM recording paused");
+        return true;
+    }
 
-        result = AAudioStream_requestStart(stream);
+    // 重新启动同一个流，第一个回调的数据凑满一帧后立即处理
+    bool resume() {
+        if (!running || stream == nullptr || !paused) return false;
+        // 暂停期间积压的参考信号已经过时，由处理线程在下一帧之前丢弃
+        renderResync = true;
+        pendingResumeNs.store(nowNs(), std::memory_order_relaxed);
+        aaudio_result_t result = AAudioStream_requestStart(stream);
         if (result != AAUDIO_OK) {
-            LOGE("Failed to start stream");
+            LOGE("Failed to resume stream");
+            pendingResumeNs.store(0, std::memory_order_relaxed);
             return false;
         }
+        paused = false;
+        LOGI("Callback PCM recording resumed");
+        return true;
+    }
 
-        LOGI("Callback PCM recording started");
+    void handlerLoop() {
+        uint64_t processedFrames = 0;
+        bool allocGuardArmed = false;
+        catchUpStartNs = 0;
+        catchUpCount = 0;
+        catchUpMaxNs = 0;
+        startLatencyNs = 0;
+        resumeCount = 0;
+        resumeLatencyTotalNs = 0;
+        resumeLatencyMaxNs = 0;
 
-        webrtc::AudioProcessing::Config config;
+        while (running) {
+            // 等待环形缓冲区有足够数据，单生产者单消费者 ring buffer 本身是无锁的；暂停时没有数据，放宽超时
+            bool ready = frameSignal.wait([&] {
+                return !running || audio_rb.availableFrames() >= (size_t) FRAME_SIZE;
+            }, paused ? PAUSED_WAIT_TIMEOUT_MS : WAIT_TIMEOUT_MS);
 
+            if (!running) break;
+            if (!ready) continue;
 
-        //高通滤波
-        config.high_pass_filter.enabled = true;
+            if (renderResync.load(std::memory_order_relaxed) && renderResync.exchange(false)) {
+                renderFramesConsumed += render_rb.skip(render_rb.availableFrames());
+            }
 
-        // 配置 AEC、NS、AGC 等
-        config.echo_canceller.enabled = true;
-        config.noise_suppression.enabled = true;
-        config.noise_suppression.level = webrtc::AudioProcessing::Config::NoiseSuppression::kHigh;
-        config.gain_controller2.enabled = true;
+#if defined(AUDIO_PROCESSING_STALL_MS)
+            // 模拟调度抖动，验证积压能被追上 (看 caught up 日志)
+            if (processedFrames > 0 && processedFrames % AUDIO_PROCESSING_STALL_EVERY == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(AUDIO_PROCESSING_STALL_MS));
+            }
+#endif
+
+            // 积压了多帧时一次取走一批，不再每帧唤醒一次
+            size_t backlog = audio_rb.availableFrames() / FRAME_SIZE;
+            trackCatchUp(backlog);
+            if (backlog >= 2) {
+                processedFrames += processCatchUp(std::min(backlog, CATCH_UP_MAX_FRAMES));
+                noteFirstOutput();
+                if (!allocGuardArmed && processedFrames >= ALLOC_GUARD_WARMUP_FRAMES) {
+                    AllocGuard::arm();
+                    allocGuardArmed = true;
+                }
+                continue;
+            }
 
-        webrtc::AudioProcessingBuilder builder;
+            // 直接在环形缓冲区上取一帧视图，不拷贝
+            PcmFrameView view;
+            if (!audio_rb.acquire(FRAME_SIZE, view)) continue;
+
+            // 输入/输出帧都从预分配的帧池借用，稳态下不触碰堆
+            PooledFrame input(framePool);
+            PooledFrame output(framePool);
+            if (!input || !output) {
+                LOGE("Audio frame pool exhausted, dropping frame");
+                audio_rb.release(view);
+                continue;
+            }
 
-        builder.SetConfig(config);
+            // 写入原始 PCM 文件
+            if (sourceFile.is_open()) {
+                view.forEach([&](const int16_t* data, size_t samples, size_t) {
+                    sourceFile.write(reinterpret_cast<const char*>(data), samples * sizeof(int16_t));
+                });
+            }
 
-        apm = builder.Create();
+            int64_t begin = nowNs();
+            bool reconfigured = apmControl.apply(apm.get()) > 0;
 
-        LOGI("webrtc audio processing module create complete");
+            // 参考信号和采集帧一一对应，先送入 ProcessReverseStream
+            uint64_t renderBefore = renderFramesConsumed;
+            processRender(captureTimestampAt(audio_rb.readPosition()));
+            view.forEach([&](const int16_t* data, size_t samples, size_t) {
+                delayEstimator.pushCapture(data, samples / CHANNELS, CHANNELS);
+            });
 
-        running = true;
-        handlerThread = std::thread(&CallbackPCMRecorder::handlerLoop, this);
+            int result;
+            if (sampleFormat == SampleFormat::Int16) {
+                // 镜像 ring buffer 下一帧总是连续的，直接把 ring 中的数据交给 APM
+                const int16_t* src = view.count == 1 ? view.spans[0].data : gatherFrame(view, input.get());
+                result = processFrameS16(src, output.get());
+                audio_rb.release(view);
+            } else {
+                // 转换为 float 数据
+                loadFrame(view, input.get());
 
-        return true;
+                // 原始数据和 float 输入都已经用完，释放 ring buffer 空间
+                audio_rb.release(view);
+
+                result = processFrame(input.get(), output.get());
+            }
+            int64_t elapsed = nowNs() - begin;
+            recordProcessTime(elapsed);
+            apmControl.recordFrame(elapsed, reconfigured);
+            qualityGovernor.recordFrame(elapsed, audio_rb.availableFrames() / FRAME_SIZE,
+                                        renderFramesConsumed != renderBefore);
+
+            if (result == 0) {
+                writeOutput(output->interleaved(), 1);
+                noteFirstOutput();
+            }
+
+            // 预热结束后开始统计处理线程上的堆分配
+            if (++processedFrames >= ALLOC_GUARD_WARMUP_FRAMES && !allocGuardArmed) {
+                AllocGuard::arm();
+                allocGuardArmed = true;
+            }
+        }
+
+        AllocGuard::disarm();
+        if (catchUpCount > 0) {
+            LOGI("Caught up %llu backlogs, longest drain %.1f ms",
+                 (unsigned long long) catchUpCount, catchUpMaxNs / 1e6);
+        }
+        if (resumeCount > 0) {
+            LOGI("Time to first output: start %.1f ms, resume avg %.1f ms / max %.1f ms over %llu resumes",
+                 startLatencyNs / 1e6, resumeLatencyTotalNs / 1e6 / resumeCount, resumeLatencyMaxNs / 1e6,
+                 (unsigned long long) resumeCount);
+        }
+        LOGI("Processing thread exited after %llu frames, heap allocations after warm-up %llu",
+             (unsigned long long) processedFrames, (unsigned long long) AllocGuard::count());
+        LOGI("Render frames processed %llu, dropped samples %llu",
+             (unsigned long long) (renderFramesConsumed / FRAME_SIZE),
+             (unsigned long long) renderDroppedSamples.load());
+        if (processedFrames > 0) {
+            LOGI("%s path process time per frame: avg %lld us, max %lld us, APM stage %.0f%% busy",
+                 sampleFormat == SampleFormat::Int16 ? "int16" : "float",
+                 (long long) (processNsTotal / processedFrames / 1000), (long long) (processNsMax / 1000),
+                 100.0 * processNsTotal / std::max<int64_t>(1, nowNs() - processingStartNs));
+        }
     }
 
-    void handlerLoop() {
-        std::vector<int16_t> pcm(FRAME_SIZE);  // 每次处理 480 帧
-        std::unique_ptr<float[]> inputChannel(new float[FRAME_SIZE]);
-        std::unique_ptr<float[]> outputChannel(new float[FRAME_SIZE]);
+    void stop() {
+        shutdown();
 
-        while (running) {
-            std::unique_lock<std::mutex> lock(mutex);
+        LOGI("dataCallback count %llu, worst-case %lld us, dropped samples %llu",
+             (unsigned long long) callbackCount.load(),
+             (long long) (callbackMaxNs.load() / 1000),
+             (unsigned long long) droppedSamples.load());
 
-            // 等待环形缓冲区有足够数据
-            rb_cv.wait(lock, [&] {
-                return !running || lwrb_get_full(&audio_rb) >= FRAME_SIZE * sizeof(int16_t);
-            });
+        LOGI("Callback PCM recording stopped");
+    }
 
-            if (!running) break;
+    // 析构函数也要确保线程已经退出
+    ~CallbackPCMRecorder() {
+        stop();
+    }
 
-            // 从环形缓冲区读取数据
-            size_t bytes_to_read = FRAME_SIZE * sizeof(int16_t);
-            size_t actually_read = lwrb_read(&audio_rb, (uint8_t*)pcm.data(), bytes_to_read);
+    const int FRAME_SIZE = 480;  // 每次读取 480 帧
+    const int SAMPLE_SIZE = 2;   // 每帧 16-bit = 2 字节
 
-            lock.unlock();
+    void apmHandlePcm(const char * str) {
+        apmHandlePcm(str, nullptr);
+    }
 
-            // 写入原始 PCM 文件
-            if (sourceFile.is_open()) {
-                sourceFile.write(reinterpret_cast<const char*>(pcm.data()), bytes_to_read);
-            }
+    // 离线处理近端 PCM / WAV，far 不为空时同时读取成对的远端参考驱动 AEC
+    void apmHandlePcm(const char * str, const char * far) {
 
-            // 转换为 float 数据
-            std::unique_ptr<float[]> inputChannel(new float[480]);
-            std::unique_ptr<float[]> outputChannel(new float[480]);
+        // 输入文件整体映射，循环里只访问内存，不再有 read 系统调用
+        MappedAudioFile pcm_file;
+        if (!openMapped(pcm_file, str)) {
+            return;
+        }
 
-            for (int i = 0; i < 480; ++i) {
-                inputChannel[i] = pcm[i] / 32767.0f;
-            }
+        if (far != nullptr && !setRenderSourceFile(far)) {
+            return;
+        }
 
-            // 创建 WebRTC APM 配置
-            webrtc::StreamConfig inputConfig(48000, 1);  // 采样率48000Hz，单通道
-            webrtc::StreamConfig outputConfig(48000, 1);
+        if (!apm) {
+            createApm(!deepFilterPipeline.isRunning());
+        }
 
-            // 调用 WebRTC APM 进行音频处理
-            float* inputPointer = inputChannel.get();
-            float* outputPointer = outputChannel.get();
+        // 有参考信号且没有在实时录制时，离线处理也做延迟估计
+        bool ownsDelayEstimator = far != nullptr && !running;
+        if (ownsDelayEstimator) {
+            delayEstimator.start(apm);
+        }
 
-            int result = apm->ProcessStream(
-                &inputPointer,  // 输入指针
-                inputConfig,
-                outputConfig,
-                &outputPointer  // 输出指针
-            );
+        PooledFrame input(framePool);
+        PooledFrame output(framePool);
+        if (!input || !output) {
+            LOGE("Audio frame pool exhausted");
+            return;
+        }
 
-            if (result == 0) {
-                LOGI("Audio processing success!");
-
-                // 转换 float -> int16
-                std::vector<int16_t> processedPCM(FRAME_SIZE);
-                for (int i = 0; i < FRAME_SIZE; ++i) {
-                    processedPCM[i] = static_cast<int16_t>(
-                        std::clamp(outputPointer[i] * 32768.0f, -32768.0f, 32767.0f)
-                    );
-                }
+        // 每次取 480 帧的视图，末尾不足一帧的部分丢弃
+        PcmFrameView view;
+        while (pcm_file.next(FRAME_SIZE, view)) {
+            const int16_t* src = view.spans[0].data;
 
-                // 写入文件
-                if (rtcFile.is_open()) {
-                    rtcFile.write(reinterpret_cast<const char*>(processedPCM.data()), FRAME_SIZE * sizeof(int16_t));
-                }
+            apmControl.apply(apm.get());
+            // 离线处理没有采集时间
+            processRender(0);
+            delayEstimator.pushCapture(src, FRAME_SIZE, CHANNELS);
+
+            int result;
+            if (sampleFormat == SampleFormat::Int16) {
+                result = processFrameS16(src, output.get());
             } else {
-                LOGI("Audio processing failure!");
+                // 转换为 float 数据
+                deinterleaveS16ToFloat(src, input->samplesPerChannel, input->channels, input->planar());
+                result = processFrame(input.get(), output.get());
             }
+
+            if (result == 0) {
+                writeOutput(output->interleaved(), 1);
+            }
+        }
+
+        if (ownsDelayEstimator) {
+            delayEstimator.stop();
         }
+        if (rtcFile.is_open()) rtcFile.close();
+        closeRenderSourceFile();
     }
 
-    void stop() {
+private:
+    AAudioStream* stream;
+    AAudioStreamBuilder* builder;
+    // 文件写入都交给独立的写入线程，处理线程只做内存拷贝
+    AsyncFileWriter fileWriter;
+    AsyncFileSink rtcFile{fileWriter};
+    AsyncFileSink sourceFile{fileWriter};
+
+    rtc::scoped_refptr<webrtc::AudioProcessing> apm;
+
+    std::string deepFilterModelPath;
+    float deepFilterAttenLimDb = 100.f;
+    bool inlineDeepFilter = false;      // 当前 APM 带有 DF 后处理，由创建 APM 的线程写
+    DeepFilterMode deepFilterMode = DeepFilterMode::Inline;
+    bool deepFilterGating = false;
+    bool deepFilterSpectral = false;
+    DeepFilterSpectralConfig deepFilterSpectralConfig;
+    DeepFilterModelManager* deepFilterModels = nullptr;
+    DeepFilterPipeline deepFilterPipeline;
+
+    static constexpr int SAMPLE_RATE = 48000;
+    static constexpr int CHANNELS = 1;
+    static constexpr int WAIT_TIMEOUT_MS = 20;
+    static constexpr int PAUSED_WAIT_TIMEOUT_MS = 1000;
+
+    static constexpr int FRAME_POOL_SIZE = 8;
+    static constexpr uint64_t ALLOC_GUARD_WARMUP_FRAMES = 100;  // 1s
+    static constexpr size_t RENDER_MAX_BACKLOG_FRAMES = 5;       // 参考信号最多积压 5 帧(50ms)
+    static constexpr size_t DEEP_FILTER_PIPELINE_DEPTH = 2;      // 流水线模式 DF 线程最多落后 2 帧(20ms)
+    static constexpr size_t CATCH_UP_MAX_FRAMES = 8;             // 追赶模式一批最多 8 帧(80ms)
+    static constexpr size_t CATCH_UP_REPORT_FRAMES = 4;          // 积压达到 4 帧时统计追赶耗时
+
+    // Ring buffer
+    SpscFrameRing<int16_t, CHANNELS, RING_FRAMES> audio_rb;
+
+    // 采集时间戳标记 {audio_rb 写下标, 回调时间}，回调每次写入后记一条
+    SpscFrameRing<int64_t, 2, 64> capture_ts;
+    int64_t captureMarkPosition = 0;
+    int64_t captureMarkTimestampNs = 0;
+
+    // 远端参考信号及其时间戳标记 {帧位置, 时间戳}
+    SpscFrameRing<int16_t, CHANNELS, RING_FRAMES> render_rb;
+    SpscFrameRing<int64_t, 2, 64> render_ts;
+    uint64_t renderFramesPushed = 0;     // 只由播放线程写
+    uint64_t renderFramesConsumed = 0;   // 只由处理线程写
+    int64_t renderMarkPosition = 0;
+    int64_t renderMarkTimestampNs = 0;   // 0 表示还没有收到过时间戳
+    std::atomic<uint64_t> renderDroppedSamples{0};
+    MappedAudioFile renderSourceFile;    // 只由处理线程读取
+    std::atomic<bool> renderFromFile{false};
+
+    // 参考信号 -> 采集信号的延迟估计，结果通过 set_stream_delay_ms 交给 AEC
+    DelayEstimator delayEstimator{SAMPLE_RATE};
+
+    // 控制线程和 QualityGovernor 的配置修改，处理线程在帧之间应用；要先于 qualityGovernor 构造
+    ApmControl apmControl;
+    // 每帧预算 10ms
+    QualityGovernor qualityGovernor{1000000000LL * FRAME_SIZE / SAMPLE_RATE};
+    bool qualityGovernorEnabled = true;
+
+    // 10ms 流配置和对应的预分配帧池
+    webrtc::StreamConfig streamConfig{SAMPLE_RATE, CHANNELS};
+    AudioFramePool framePool{streamConfig, FRAME_POOL_SIZE};
+
+    std::atomic<bool> running{false};
+    std::atomic<bool> paused{false};
+    std::atomic<bool> renderResync{false};
+    std::thread handlerThread;
+
+    FrameSignal frameSignal;
+
+    SampleFormat sampleFormat = SampleFormat::Float;
+
+    // 追赶模式的整批缓冲，只由处理线程使用
+    std::vector<int16_t> catchUpInput = std::vector<int16_t>(CATCH_UP_MAX_FRAMES * FRAME_SIZE * CHANNELS);
+    std::vector<float> catchUpFloat = std::vector<float>(CATCH_UP_MAX_FRAMES * FRAME_SIZE * CHANNELS);
+    std::vector<int16_t> catchUpOutput = std::vector<int16_t>(CATCH_UP_MAX_FRAMES * FRAME_SIZE * CHANNELS);
+    int64_t catchUpStartNs = 0;
+    size_t catchUpPeakFrames = 0;
+    uint64_t catchUpCount = 0;
+    int64_t catchUpMaxNs = 0;
+
+    // start() 各项准备工作完成的时间 (相对 beginNs)，处理线程启动之前写好
+    struct StartupTimeline {
+        int64_t beginNs = 0;
+        int64_t filesNs = 0;
+        int64_t streamOpenNs = 0;
+        int64_t apmNs = 0;
+        int64_t deepFilterNs = 0;
+    };
+    StartupTimeline startup;
+    std::atomic<int64_t> deviceStartNs{0};
+    std::atomic<int64_t> firstCallbackNs{0};
+
+    // start() / resume() 请求的时间，处理线程第一次写出后清零
+    std::atomic<int64_t> pendingStartNs{0};
+    std::atomic<int64_t> pendingResumeNs{0};
+    int64_t startLatencyNs = 0;
+    uint64_t resumeCount = 0;
+    int64_t resumeLatencyTotalNs = 0;
+    int64_t resumeLatencyMaxNs = 0;
+
+    // 每帧 APM 处理耗时，只由处理线程写入
+    int64_t processNsTotal = 0;
+    int64_t processNsMax = 0;
+    int64_t processingStartNs = 0;
+
+    // dataCallback 统计，只由回调线程写入
+    std::atomic<int64_t> callbackMaxNs{0};
+    std::atomic<uint64_t> callbackCount{0};
+    std::atomic<uint64_t> droppedSamples{0};
+
+    /**
+     * 停止 start() 启动过的所有线程并关闭流和文件，已经退出或者从未启动的部分直接跳过。
+     * stop() 和 start() 的失败路径共用
+     */
+    void shutdown() {
         running = false;
+        paused = false;
 
         // 通知线程退出
-        rb_cv.notify_all();
+        frameSignal.wakeAll();
 
         // 等待线程退出
         if (handlerThread.joinable()) {
             handlerThread.join();
         }
+        delayEstimator.stop();
+        qualityGovernor.stop();
+        apmControl.report();
+        deepFilterPipeline.stop();
 
         if (stream) {
             AAudioStream_requestStop(stream);
@@ -189,131 +665,410 @@ public:
         }
         if (sourceFile.is_open()) sourceFile.close();
         if (rtcFile.is_open()) rtcFile.close();
+        closeRenderSourceFile();
+        fileWriter.stop();
+    }
 
-        LOGI("Callback PCM recording stopped");
+    // start() 唯一的失败出口：回收已经启动的线程、打开的流和文件，recorder 回到可以再次 start() 的状态
+    bool abortStart() {
+        shutdown();
+        pendingStartNs.store(0, std::memory_order_relaxed);
+        LOGE("Callback PCM recording failed to start");
+        return false;
     }
 
-    // 析构函数也要确保线程已经退出
-    ~CallbackPCMRecorder() {
-        stop();
+    void closeRenderSourceFile() {
+        if (renderSourceFile.is_open()) renderSourceFile.close();
+        renderFromFile.store(false, std::memory_order_relaxed);
     }
 
-    const int FRAME_SIZE = 480;  // 每次读取 480 帧
-    const int SAMPLE_SIZE = 2;   // 每帧 16-bit = 2 字节
+    // 按扩展名选择容器: .wav 写 WAV/RF64，.flac 在写入线程上压缩，其余保持裸 PCM
+    bool openSink(AsyncFileSink& sink, const char* path) {
+        return sink.openByExtension(path, WavFormat{SAMPLE_RATE, CHANNELS, 16});
+    }
 
-    void apmHandlePcm(const char * str) {
+    // 映射离线输入文件，WAV 的格式必须与处理流一致，其它文件按裸 PCM 处理
+    bool openMapped(MappedAudioFile& file, const char* path) {
+        if (!file.open(path, WavFormat{SAMPLE_RATE, CHANNELS, 16})) {
+            return false;
+        }
+        const WavFormat& format = file.format();
+        if (format.sampleRate != SAMPLE_RATE || format.channels != CHANNELS) {
+            LOGE("%s is %u Hz / %u channels, expected %d Hz / %d channels",
+                 path, format.sampleRate, format.channels, SAMPLE_RATE, CHANNELS);
+            file.close();
+            return false;
+        }
+        LOGI("Mapped %s: %llu frames", path, (unsigned long long) file.totalFrames());
+        return true;
+    }
 
-        // 缓冲区：每次读取 480 帧 PCM 数据
-        std::vector<int16_t> pcm_buffer(FRAME_SIZE);
+    // QualityGovernor 的 DF 这一级，只在 governor 线程上调用；和用户的 setDeepFilterSuspended 分开记录，互不覆盖
+    bool setDeepFilterGovernorOff(bool off) {
+        deepFilterPipeline.setGovernorOff(off);
+        return apmControl.deepFilter(ApmControl::kDfGovernorOff, off ? 1.f : 0.f);
+    }
 
-        // 打开 PCM 文件
-        std::ifstream pcm_file(str, std::ios::binary);
-        if (!pcm_file.is_open()) {
-            return;
+    std::unique_ptr<DeepFilterStream> createDeepFilterStream() {
+        const DeepFilterSpectralConfig* spectral = deepFilterSpectral ? &deepFilterSpectralConfig : nullptr;
+        std::unique_ptr<DeepFilterStream> df;
+        if (deepFilterModels != nullptr) {
+            DFState* state = deepFilterModels->acquire(deepFilterModelPath.c_str(), deepFilterAttenLimDb);
+            if (state != nullptr) df = DeepFilterStream::create(state, deepFilterAttenLimDb, spectral);
+        } else {
+            df = DeepFilterStream::create(deepFilterModelPath.c_str(), deepFilterAttenLimDb, spectral);
         }
+        if (df) df->setGating(deepFilterGating);
+        return df;
+    }
 
-        // 读取文件并处理
-        while (true) {
-            // 从 PCM 文件中读取 480 帧（960 字节）数据
-            pcm_file.read(reinterpret_cast<char*>(pcm_buffer.data()), FRAME_SIZE * SAMPLE_SIZE);
-            if (pcm_file.gcount() == 0) {
-                break;  // 文件结束
-            }
+    // 打开 AAudio 输入流，不启动
+    bool openStream() {
+        aaudio_result_t result = AAudio_createStreamBuilder(&builder);
+        if (result != AAUDIO_OK) {
+            LOGE("Failed to create stream builder");
+            return false;
+        }
 
-            // 确保读取到的数据大小为 480 帧
-            if (pcm_file.gcount() != FRAME_SIZE * SAMPLE_SIZE) {
-                break;
-            }
+        AAudioStreamBuilder_setDirection(builder, AAUDIO_DIRECTION_INPUT);
+        AAudioStreamBuilder_setSampleRate(builder, SAMPLE_RATE);
+        AAudioStreamBuilder_setChannelCount(builder, CHANNELS);
+        AAudioStreamBuilder_setFormat(builder, AAUDIO_FORMAT_PCM_I16);
+        AAudioStreamBuilder_setSharingMode(builder, AAUDIO_SHARING_MODE_SHARED);
 
-            // 转换为 float 数据
-            std::unique_ptr<float[]> inputChannel(new float[960]);
-            std::unique_ptr<float[]> outputChannel(new float[960]);
+        // 设置回调
+        AAudioStreamBuilder_setDataCallback(builder, dataCallback, this);
+        AAudioStreamBuilder_setErrorCallback(builder, errorCallback, this);
 
-            for (int i = 0; i < 960; ++i) {
-                inputChannel[i] = pcm_buffer[i] / 32767.0f;
-            }
+        result = AAudioStreamBuilder_openStream(builder, &stream);
+        if (result != AAUDIO_OK) {
+            LOGE("Failed to open stream");
+            return false;
+        }
+        return true;
+    }
 
-            // 创建 WebRTC APM 配置
-            webrtc::StreamConfig inputConfig(48000, 1);  // 采样率48000Hz，单通道
-            webrtc::StreamConfig outputConfig(48000, 1);
+    // withDeepFilter 为 true 且设置了模型时，DF 作为 APM 采集链路的最后一级
+    void createApm(bool withDeepFilter) {
+        std::unique_ptr<DeepFilterProcessing> processing;
+        if (withDeepFilter && !deepFilterModelPath.empty()) {
+            auto df = createDeepFilterStream();
+            if (df) processing = std::make_unique<DeepFilterProcessing>(std::move(df));
+        }
+        // 所有权交给 APM，指针只交给 ApmControl，由处理线程调整参数
+        DeepFilterProcessing* deepFilter = processing.get();
+        inlineDeepFilter = deepFilter != nullptr;
+        apm = createDefaultApm(std::move(processing));
+        // 带上之前通过 updateApmConfig / RuntimeSetting / DF setter 做的修改
+        apmControl.attach(apm.get(), deepFilter);
+    }
 
-            // 调用 WebRTC APM 进行音频处理
-            float* inputPointer = inputChannel.get();
-            float* outputPointer = outputChannel.get();
+    bool usePipelinedDeepFilter() const {
+        return !deepFilterModelPath.empty() && deepFilterMode == DeepFilterMode::Pipelined;
+    }
 
-            int result = apm->ProcessStream(
-                &inputPointer,  // 输入指针
-                inputConfig,
-                outputConfig,
-                &outputPointer  // 输出指针
-            );
+    // APM 输出的连续 frames 帧: 流水线模式逐帧交给 DF 线程，否则一次写入文件
+    void writeOutput(const int16_t* pcm, size_t frames) {
+        const size_t samples = FRAME_SIZE * CHANNELS;
+        if (deepFilterPipeline.isRunning()) {
+            for (size_t i = 0; i < frames; ++i) {
+                deepFilterPipeline.push(pcm + i * samples);
+            }
+        } else if (rtcFile.is_open() && frames > 0) {
+            rtcFile.write(reinterpret_cast<const char*>(pcm), frames * samples * sizeof(int16_t));
+        }
+    }
 
-            if (result == 0) {
+    /**
+     * 追赶模式: 一次从 ring 中取 frames 帧
+     * 整批做 int16 -> float 转换，逐帧处理参考信号和 ProcessStream，整批转换回 int16 并写入一次。
+     * 失败的帧和单帧路径一样不写出，后面的帧前移保持连续。返回消费的帧数
+     */
+    size_t processCatchUp(size_t frames) {
+        PcmFrameView view;
+        if (!audio_rb.acquire(frames * FRAME_SIZE, view)) return 0;
+
+        if (sourceFile.is_open()) {
+            view.forEach([&](const int16_t* data, size_t samples, size_t) {
+                sourceFile.write(reinterpret_cast<const char*>(data), samples * sizeof(int16_t));
+            });
+        }
 
-               LOGI("Audio processing success!");
-                LOGI("Audio processing success!");
+        const size_t samples = FRAME_SIZE * CHANNELS;
+        int64_t batchBegin = nowNs();
 
-                // 转换 float -> int16
-                std::vector<int16_t> processedPCM(FRAME_SIZE);
-                for (int i = 0; i < FRAME_SIZE; ++i) {
-                    processedPCM[i] = static_cast<int16_t>(
-                        std::clamp(outputPointer[i] * 32768.0f, -32768.0f, 32767.0f)
-                    );
-                }
+        // 非镜像 ring 回绕时先拼成连续的一段
+        const int16_t* src = view.spans[0].data;
+        if (view.count != 1) {
+            view.forEach([&](const int16_t* data, size_t n, size_t offset) {
+                std::copy(data, data + n, catchUpInput.data() + offset);
+            });
+            src = catchUpInput.data();
+        }
 
-                // 写入文件
-                if (rtcFile.is_open()) {
-                    rtcFile.write(reinterpret_cast<const char*>(processedPCM.data()), FRAME_SIZE * sizeof(int16_t));
+        // 每帧的平面 float 依次放在 catchUpFloat 中，单声道时就是整批连续的一段
+        if (sampleFormat == SampleFormat::Float) {
+            if (CHANNELS == 1) {
+                convertS16ToFloat(src, catchUpFloat.data(), frames * samples);
+            } else {
+                for (size_t i = 0; i < frames; ++i) {
+                    float* dst[AudioFramePool::kMaxChannels];
+                    catchUpChannels(i, dst);
+                    deinterleaveS16ToFloat(src + i * samples, FRAME_SIZE, CHANNELS, dst);
                 }
+            }
+        }
+        int64_t convertNs = (nowNs() - batchBegin) / (int64_t) frames;
+
+        size_t done = 0;
+        for (size_t i = 0; i < frames; ++i) {
+            int64_t begin = nowNs();
+            bool reconfigured = apmControl.apply(apm.get()) > 0;
+            const int16_t* in = src + i * samples;
+
+            uint64_t renderBefore = renderFramesConsumed;
+            processRender(captureTimestampAt(audio_rb.readPosition() + i * FRAME_SIZE));
+            delayEstimator.pushCapture(in, FRAME_SIZE, CHANNELS);
+            applyStreamDelay();
+
+            int result;
+            if (sampleFormat == SampleFormat::Int16) {
+                result = apm->ProcessStream(in, streamConfig, streamConfig, catchUpOutput.data() + done * samples);
+            } else {
+                float* input[AudioFramePool::kMaxChannels];
+                float* output[AudioFramePool::kMaxChannels];
+                catchUpChannels(i, input);
+                catchUpChannels(done, output);
+                result = apm->ProcessStream(input, streamConfig, streamConfig, output);
+            }
+            if (result == 0) {
+                ++done;
             } else {
                 LOGI("Audio processing failure!");
             }
+
+            int64_t elapsed = nowNs() - begin + convertNs;
+            recordProcessTime(elapsed);
+            apmControl.recordFrame(elapsed, reconfigured);
+            // 本批已处理但还没释放的帧不算积压
+            qualityGovernor.recordFrame(elapsed, audio_rb.availableFrames() / FRAME_SIZE - (i + 1),
+                                        renderFramesConsumed != renderBefore);
         }
+        audio_rb.release(view);
 
-        if (rtcFile.is_open()) rtcFile.close();
+        if (sampleFormat == SampleFormat::Float && done > 0) {
+            if (CHANNELS == 1) {
+                convertFloatToS16(catchUpFloat.data(), catchUpOutput.data(), done * samples);
+            } else {
+                for (size_t i = 0; i < done; ++i) {
+                    float* channels[AudioFramePool::kMaxChannels];
+                    catchUpChannels(i, channels);
+                    interleaveFloatToS16(channels, FRAME_SIZE, CHANNELS, catchUpOutput.data() + i * samples);
+                }
+            }
+        }
+        writeOutput(catchUpOutput.data(), done);
+        return frames;
     }
 
-private:
-    AAudioStream* stream;
-    AAudioStreamBuilder* builder;
-    std::ofstream rtcFile;
-    std::ofstream sourceFile;
+    // start() / resume() 之后第一次写出时记录等待时间
+    void noteFirstOutput() {
+        if (pendingStartNs.load(std::memory_order_relaxed) != 0) {
+            int64_t requested = pendingStartNs.exchange(0, std::memory_order_relaxed);
+            if (requested != 0) {
+                startLatencyNs = nowNs() - requested;
+                logStartupTimeline();
+            }
+        }
+        if (pendingResumeNs.load(std::memory_order_relaxed) != 0) {
+            int64_t requested = pendingResumeNs.exchange(0, std::memory_order_relaxed);
+            if (requested != 0) {
+                int64_t elapsed = nowNs() - requested;
+                ++resumeCount;
+                resumeLatencyTotalNs += elapsed;
+                resumeLatencyMaxNs = std::max(resumeLatencyMaxNs, elapsed);
+                LOGI("First output %.1f ms after resume (start took %.1f ms)", elapsed / 1e6, startLatencyNs / 1e6);
+            }
+        }
+    }
 
-    rtc::scoped_refptr<webrtc::AudioProcessing> apm;
+    // 各项都从 start() 开始计时，串行估计是它们之和，也就是不并行时 requestStart 之前的时间
+    void logStartupTimeline() {
+        int64_t firstCallback = firstCallbackNs.load(std::memory_order_relaxed);
+        int64_t serial = startup.filesNs + startup.streamOpenNs + startup.apmNs + startup.deepFilterNs;
+        LOGI("Startup timeline: files %.1f ms, stream open %.1f ms, APM%s %.1f ms, DF pipeline %.1f ms, "
+             "device start %.1f ms, first callback %.1f ms, first processed frame %.1f ms "
+             "(serial setup would take %.1f ms)",
+             startup.filesNs / 1e6, startup.streamOpenNs / 1e6, inlineDeepFilter ? " + inline DF" : "",
+             startup.apmNs / 1e6, startup.deepFilterNs / 1e6,
+             (deviceStartNs.load(std::memory_order_relaxed) - startup.beginNs) / 1e6,
+             firstCallback != 0 ? (firstCallback - startup.beginNs) / 1e6 : -1.0,
+             startLatencyNs / 1e6, serial / 1e6);
+    }
 
-    // Ring buffer
-    lwrb_t audio_rb;
-    uint8_t audio_rb_data[BUFFER_SIZE];
+    void catchUpChannels(size_t frame, float** channels) {
+        for (size_t ch = 0; ch < CHANNELS; ++ch) {
+            channels[ch] = catchUpFloat.data() + (frame * CHANNELS + ch) * FRAME_SIZE;
+        }
+    }
 
-    std::atomic<bool> running{false};
-    std::thread handlerThread;
+    // 积压超过 CATCH_UP_REPORT_FRAMES 时开始计时，回到一帧以内时报告追赶耗时
+    void trackCatchUp(size_t backlog) {
+        if (catchUpStartNs == 0) {
+            if (backlog >= CATCH_UP_REPORT_FRAMES) {
+                catchUpStartNs = nowNs();
+                catchUpPeakFrames = backlog;
+            }
+            return;
+        }
+        catchUpPeakFrames = std::max(catchUpPeakFrames, backlog);
+        if (backlog <= 1) {
+            int64_t elapsed = nowNs() - catchUpStartNs;
+            catchUpMaxNs = std::max(catchUpMaxNs, elapsed);
+            ++catchUpCount;
+            catchUpStartNs = 0;
+            LOGI("Caught up a backlog of %zu frames in %.1f ms", catchUpPeakFrames, elapsed / 1e6);
+        }
+    }
+
+    /**
+     * 与采集帧同步处理远端参考信号
+     * 正常情况下每个采集帧对应一个参考帧；参考信号积压超过 RENDER_MAX_BACKLOG_FRAMES 时一次追上。
+     * captureNs 是当前采集帧的采集时间，为 0 时 (离线处理) 不做基于时间戳的延迟估计
+     */
+    void processRender(int64_t captureNs) {
+        PooledFrame scratch(framePool);
+        PooledFrame reverse(framePool);
+        if (!scratch || !reverse) return;
+
+        // 文件参考信号不经过 render_rb，也没有播放时间
+        if (renderSourceFile.is_open()) {
+            PcmFrameView fileView;
+            if (renderSourceFile.next(FRAME_SIZE, fileView)) {
+                processReverseFrame(fileView.spans[0].data, reverse.get());
+                renderFramesConsumed += FRAME_SIZE;
+            }
+            return;
+        }
 
-    std::mutex mutex;
-    std::condition_variable rb_cv;
+        size_t pending = render_rb.availableFrames() / FRAME_SIZE;
+        if (pending == 0) return;
+        size_t frames = pending > RENDER_MAX_BACKLOG_FRAMES ? pending - RENDER_MAX_BACKLOG_FRAMES + 1 : 1;
 
-    static constexpr int SAMPLE_RATE = 48000;
-    static constexpr int CHANNELS = 1;
+        int64_t renderNs = 0;
+        for (size_t i = 0; i < frames; ++i) {
+            PcmFrameView view;
+            if (!render_rb.acquire(FRAME_SIZE, view)) break;
 
-    void writeAudioDataToFile(float * output_pointer, int32_t numFrames) {
-        if (!rtcFile.is_open()) {
-            LOGE("Output file is not open.");
-            return;
+            const int16_t* src = view.count == 1 ? view.spans[0].data : gatherFrame(view, scratch.get());
+            processReverseFrame(src, reverse.get());
+            render_rb.release(view);
+
+            renderNs = renderTimestampAt(renderFramesConsumed);
+            renderFramesConsumed += FRAME_SIZE;
+        }
+
+        // 与当前采集帧配对的参考帧在 renderNs 播放，它的回声出现在 renderNs 采集的帧里，
+        // 也就是 renderNs - captureNs 之后才交给 ProcessStream
+        if (captureNs > 0 && renderMarkTimestampNs != 0) {
+            delayEstimator.pushTimestampDelay((int) ((renderNs - captureNs) / 1000000));
         }
+    }
+
+    void processReverseFrame(const int16_t* src, AudioFrame* reverse) {
+        int result = apm->ProcessReverseStream(src, streamConfig, streamConfig, reverse->interleaved());
+        delayEstimator.pushRender(src, FRAME_SIZE, CHANNELS);
+        if (result != 0) {
+            LOGI("Audio reverse processing failure!");
+        }
+    }
+
+    // 根据最近的时间戳标记推算 position 处参考帧的播放时间
+    int64_t renderTimestampAt(uint64_t position) {
+        return timestampAt(render_ts, position, renderMarkPosition, renderMarkTimestampNs);
+    }
+
+    /**
+     * 推算 audio_rb 中 position 处采集帧的采集时间，还没有标记时返回 0。
+     * 标记取的是回调到达的时间，比真实的采集时间晚一个设备缓冲，这个固定偏差留给 GCC-PHAT 修正
+     */
+    int64_t captureTimestampAt(uint64_t position) {
+        int64_t ns = timestampAt(capture_ts, position, captureMarkPosition, captureMarkTimestampNs);
+        return captureMarkTimestampNs != 0 ? ns : 0;
+    }
+
+    // 消费 position 之前的所有标记，从最后一个标记按采样率外推
+    static int64_t timestampAt(SpscFrameRing<int64_t, 2, 64>& marks, uint64_t position,
+                               int64_t& markPosition, int64_t& markTimestampNs) {
+        FrameView<int64_t> mark;
+        while (marks.acquire(1, mark) && (uint64_t) mark.spans[0].data[0] <= position) {
+            markPosition = mark.spans[0].data[0];
+            markTimestampNs = mark.spans[0].data[1];
+            marks.release(mark);
+        }
+        return markTimestampNs + ((int64_t) position - markPosition) * 1000000000LL / SAMPLE_RATE;
+    }
+
+    // ring buffer 视图 -> 平面 float 帧
+    static void loadFrame(const PcmFrameView& view, AudioFrame* frame) {
+        view.forEach([&](const int16_t* data, size_t samples, size_t offset) {
+            float* dst[AudioFramePool::kMaxChannels];
+            for (size_t ch = 0; ch < frame->channels; ++ch) {
+                dst[ch] = frame->channel(ch) + offset / frame->channels;
+            }
+            deinterleaveS16ToFloat(data, samples / frame->channels, frame->channels, dst);
+        });
+    }
+
+    // APM 处理一帧 float，成功时同时填好 output 的 int16 视图
+    int processFrame(AudioFrame* input, AudioFrame* output) {
+        applyStreamDelay();
+        int result = apm->ProcessStream(input->planar(), streamConfig, streamConfig, output->planar());
+        if (result != 0) {
+            LOGI("Audio processing failure!");
+            return result;
+        }
+
+        // 转换 float -> int16
+        interleaveFloatToS16(output->planar(), output->samplesPerChannel, output->channels,
+                             output->interleaved());
+        return result;
+    }
 
-        // 创建一个 int16_t 数组来存储转换后的数据
-        std::vector<int16_t> pcmBuffer(numFrames);
+    // APM 直接处理交织 int16，输出写入 output 的 int16 视图
+    int processFrameS16(const int16_t* src, AudioFrame* output) {
+        applyStreamDelay();
+        int result = apm->ProcessStream(src, streamConfig, streamConfig, output->interleaved());
+        if (result != 0) {
+            LOGI("Audio processing failure!");
+        }
+        return result;
+    }
 
-        // 将 float 数据转换为 int16_t 格式
-        for (int32_t i = 0; i < numFrames; ++i) {
-            pcmBuffer[i] = static_cast<int16_t>(std::clamp(output_pointer[i] * 32768.0f, -32768.0f, 32767.0f));
+    // 每次 ProcessStream 之前设置一次，估计值只是一个原子读，不会阻塞处理线程
+    void applyStreamDelay() {
+        int delay = delayEstimator.delayMs();
+        if (delay >= 0) {
+            apm->set_stream_delay_ms(delay);
         }
+    }
 
-        // LOGI("Writing %d frames to file, current file size: %d bytes", numFrames, rtcFile.tellp());
+    // 回绕的帧拼接到 frame 的 int16 视图中
+    static const int16_t* gatherFrame(const PcmFrameView& view, AudioFrame* frame) {
+        view.forEach([&](const int16_t* data, size_t samples, size_t offset) {
+            std::copy(data, data + samples, frame->interleaved() + offset);
+        });
+        return frame->interleaved();
+    }
 
-        // 一次性写入文件
-        rtcFile.write(reinterpret_cast<char*>(pcmBuffer.data()), numFrames * sizeof(int16_t));
+    void recordProcessTime(int64_t elapsed) {
+        processNsTotal += elapsed;
+        if (elapsed > processNsMax) processNsMax = elapsed;
+    }
 
-        // LOGI("Processed audio data written to file. %d", numFrames);
+    static int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
     }
 
     static aaudio_data_callback_result_t dataCallback(
@@ -322,23 +1077,33 @@ private:
     void* audioData,
     int32_t numFrames
 ) {
-        LOGI("dataCallback invoke audio nums %d", numFrames);
+        // 回调线程是实时线程：这里不打日志、不加锁、不分配内存
+        int64_t begin = nowNs();
         auto* recorder = static_cast<CallbackPCMRecorder*>(userData);
+        if (recorder->firstCallbackNs.load(std::memory_order_relaxed) == 0) {
+            recorder->firstCallbackNs.store(begin, std::memory_order_relaxed);
+        }
 
         auto *in = static_cast<int16_t *>(audioData);
-        size_t free_space = lwrb_get_free(&recorder->audio_rb) / sizeof(int16_t);
-        size_t to_write = numFrames;
+        size_t written = recorder->audio_rb.write(in, numFrames);
 
-        if (to_write > free_space) {
-            to_write = free_space;
-            LOGE("Ring buffer overflow, dropping audio data free_space %zu", free_space);
+        if (written < (size_t) numFrames) {
+            // 溢出只计数，由 stop() 汇报
+            recorder->droppedSamples.fetch_add(numFrames - written, std::memory_order_relaxed);
         }
 
-        LOGI("Ring buffer, to write audio data to_write %zu", to_write);
+        if (written > 0) {
+            // 最后写入的一帧大约就是此刻采集到的
+            int64_t mark[2] = {(int64_t) recorder->audio_rb.writePosition(), begin};
+            recorder->capture_ts.write(mark, 1);
+            recorder->frameSignal.publish(RING_FRAMES - recorder->audio_rb.freeFrames(),
+                                          recorder->FRAME_SIZE);
+        }
 
-        if (to_write > 0) {
-            lwrb_write(&recorder->audio_rb, (uint8_t *) in, to_write * sizeof(int16_t));
-            recorder->rb_cv.notify_one();
+        int64_t elapsed = nowNs() - begin;
+        recorder->callbackCount.fetch_add(1, std::memory_order_relaxed);
+        if (elapsed > recorder->callbackMaxNs.load(std::memory_order_relaxed)) {
+            recorder->callbackMaxNs.store(elapsed, std::memory_order_relaxed);
         }
 
         return AAUDIO_CALLBACK_RESULT_CONTINUE;
@@ -353,84 +1118,6 @@ private:
         LOGE("AAudio error: %d", error);
     }
 
-
-    // 处理音频数据的线程
-    void processAudio() {
-        // while (true) {
-        //
-        //     LOGI("processAudio invoke...");
-        //
-        //     std::unique_lock<std::mutex> lock(mutex);
-        //
-        //     cv.wait(lock, [this]() { return !ringBuffer->empty(); });
-        //
-        //     int16_t inputBuffer[480];
-        //     if (!ringBuffer->pop(inputBuffer, 480)) {
-        //         LOGI("Audio processing pop failure!");
-        //         continue;
-        //     }
-        //
-        //     rtcFile.write(reinterpret_cast<const char*>(inputBuffer), 480 * sizeof(int16_t));
-        //
-        //     // // 转换为 float 数据
-        //     // std::unique_ptr<float[]> inputChannel(new float[480]);
-        //     // std::unique_ptr<float[]> outputChannel(new float[480]);
-        //     //
-        //     // for (int i = 0; i < 480; ++i) {
-        //     //     inputChannel[i] = inputBuffer[i] / 32767.0f;
-        //     // }
-        //     //
-        //     // // 创建 WebRTC APM 配置
-        //     // webrtc::StreamConfig inputConfig(48000, 1);  // 采样率48000Hz，单通道
-        //     // webrtc::StreamConfig outputConfig(48000, 1);
-        //     //
-        //     // // 调用 WebRTC APM 进行音频处理
-        //     // float* inputPointer = inputChannel.get();
-        //     // float* outputPointer = outputChannel.get();
-        //     //
-        //     // int result = apm->ProcessStream(
-        //     //     &inputPointer,  // 输入指针
-        //     //     inputConfig,
-        //     //     outputConfig,
-        //     //     &outputPointer  // 输出指针
-        //     // );
-        //     //
-        //     // if (result == 0) {
-        //     //
-        //     //    LOGI("Audio processing success!, space is %lu", ringBuffer->availableSpace());
-        //     //     writeAudioDataToFile(outputPointer, 480);
-        //     // } else {
-        //     //     LOGI("Audio processing failure!");
-        //     // }
-        //
-        //
-        // }
-
-        const size_t FRAMES_PER_PROCESS = 480;
-        int16_t processBuffer[FRAMES_PER_PROCESS];
-
-        LOGI("Process thread started.");
-
-        while (running) {
-            std::unique_lock<std::mutex> lock(mutex);
-
-
-            lock.unlock();
-
-            // ================== 这里是你真正的处理逻辑 ==================
-            // 例如写入文件（当前示例）
-            rtcFile.write(reinterpret_cast<const char*>(processBuffer),
-                             FRAMES_PER_PROCESS * sizeof(int16_t));
-
-            // 或者替换成你的编码器、上传、网络发送等：
-            // encoder.encode(processBuffer, FRAMES_PER_PROCESS);
-            // uploadNetwork(processBuffer, FRAMES_PER_PROCESS);
-            // =================================================================
-        }
-
-        LOGI("Process thread exited.");
-    }
-
 };
 
 #endif //AAUDIORECORDER_AAUDIORECORDER_H
\ No newline at end of file
@@ -0,0 +1,197 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include "AllocGuard.h"
+
+#if defined(AUDIO_ALLOC_GUARD)
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <dlfcn.h>
+
+#include "RecorderLog.h"
+
+namespace {
+
+// malloc 里读这个标志；initial-exec 保证访问 TLS 时不会再走 __tls_get_addr 分配
+__attribute__((tls_model("initial-exec"))) thread_local bool armed = false;
+std::atomic<uint64_t> allocations{0};
+
+void onAllocate(std::size_t size) {
+    if (!armed) return;
+    allocations.fetch_add(1, std::memory_order_relaxed);
+#if defined(AUDIO_ALLOC_GUARD_ABORT)
+    armed = false;
+    LOGE("heap allocation of %zu bytes on armed processing thread", size);
+    std::abort();
+#else
+    (void) size;
+#endif
+}
+
+// libc 里真正的分配函数，第一次分配时用 dlsym(RTLD_NEXT) 查找
+struct LibcAllocator {
+    void* (*malloc)(std::size_t);
+    void* (*calloc)(std::size_t, std::size_t);
+    void* (*realloc)(void*, std::size_t);
+    void (*free)(void*);
+    int (*posixMemalign)(void**, std::size_t, std::size_t);
+    void* (*alignedAlloc)(std::size_t, std::size_t);
+    void* (*memalign)(std::size_t, std::size_t);
+};
+
+LibcAllocator libcAllocator{};
+std::atomic<int> libcState{0};  // 0 未查找，1 查找中，2 可用
+
+// dlsym 自己可能调用 calloc/malloc，查找期间的分配从这块静态内存里切，永不释放
+constexpr std::size_t BOOTSTRAP_BYTES = 16 * 1024;
+constexpr std::size_t BOOTSTRAP_HEADER = 16;  // 记录块大小，realloc 搬家时要用
+alignas(16) unsigned char bootstrap[BOOTSTRAP_BYTES];
+std::atomic<std::size_t> bootstrapUsed{0};
+
+bool fromBootstrap(const void* p) {
+    auto* b = static_cast<const unsigned char*>(p);
+    return b >= bootstrap && b < bootstrap + BOOTSTRAP_BYTES;
+}
+
+void* bootstrapAllocate(std::size_t size) {
+    std::size_t bytes = BOOTSTRAP_HEADER + ((size + 15) & ~static_cast<std::size_t>(15));
+    std::size_t offset = bootstrapUsed.fetch_add(bytes, std::memory_order_relaxed);
+    if (offset + bytes > BOOTSTRAP_BYTES) std::abort();
+    std::memcpy(bootstrap + offset, &size, sizeof(size));
+    return bootstrap + offset + BOOTSTRAP_HEADER;
+}
+
+std::size_t bootstrapSize(const void* p) {
+    std::size_t size;
+    std::memcpy(&size, static_cast<const unsigned char*>(p) - BOOTSTRAP_HEADER, sizeof(size));
+    return size;
+}
+
+template <typename Fn>
+void resolve(Fn& fn, const char* name) {
+    fn = reinterpret_cast<Fn>(dlsym(RTLD_NEXT, name));
+}
+
+// 返回 nullptr 表示正在查找，调用方改用 bootstrap
+const LibcAllocator* libc() {
+    if (libcState.load(std::memory_order_acquire) == 2) return &libcAllocator;
+    int expected = 0;
+    if (!libcState.compare_exchange_strong(expected, 1, std::memory_order_acq_rel)) {
+        if (expected == 1) return nullptr;
+        return &libcAllocator;
+    }
+    resolve(libcAllocator.malloc, "malloc");
+    resolve(libcAllocator.calloc, "calloc");
+    resolve(libcAllocator.realloc, "realloc");
+    resolve(libcAllocator.free, "free");
+    resolve(libcAllocator.posixMemalign, "posix_memalign");
+    resolve(libcAllocator.alignedAlloc, "aligned_alloc");
+    resolve(libcAllocator.memalign, "memalign");
+    if (libcAllocator.malloc == nullptr || libcAllocator.calloc == nullptr ||
+        libcAllocator.realloc == nullptr || libcAllocator.free == nullptr) {
+        std::abort();
+    }
+    libcState.store(2, std::memory_order_release);
+    return &libcAllocator;
+}
+
+// 在其他线程起来之前就查好，之后的分配都不经过 bootstrap
+__attribute__((constructor)) void resolveLibcEarly() { libc(); }
+
+void* allocate(std::size_t size) {
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void* allocateAligned(std::size_t size, std::align_val_t alignment) {
+    void* p = nullptr;
+    auto align = static_cast<std::size_t>(alignment);
+    if (align < sizeof(void*)) align = sizeof(void*);
+    if (posix_memalign(&p, align, size == 0 ? 1 : size) != 0) throw std::bad_alloc();
+    return p;
+}
+
+} // namespace
+
+void AllocGuard::arm() { armed = true; }
+
+void AllocGuard::disarm() { armed = false; }
+
+uint64_t AllocGuard::count() { return allocations.load(std::memory_order_relaxed); }
+
+// C 分配接口：libdf 的 Rust 分配器、webrtc 和 libc++ 最终都走这里
+extern "C" {
+
+void* malloc(std::size_t size) {
+    onAllocate(size);
+    const LibcAllocator* real = libc();
+    return real != nullptr ? real->malloc(size) : bootstrapAllocate(size);
+}
+
+void* calloc(std::size_t count, std::size_t size) {
+    onAllocate(count * size);
+    const LibcAllocator* real = libc();
+    if (real != nullptr) return real->calloc(count, size);
+    // bootstrap 是静态内存，从未被用过的部分本来就是 0
+    return bootstrapAllocate(count * size);
+}
+
+void* realloc(void* p, std::size_t size) {
+    onAllocate(size);
+    const LibcAllocator* real = libc();
+    if (p == nullptr || !fromBootstrap(p)) {
+        return real != nullptr ? real->realloc(p, size) : bootstrapAllocate(size);
+    }
+    void* moved = real != nullptr ? real->malloc(size) : bootstrapAllocate(size);
+    if (moved != nullptr) std::memcpy(moved, p, std::min(size, bootstrapSize(p)));
+    return moved;
+}
+
+void free(void* p) {
+    if (p == nullptr || fromBootstrap(p)) return;
+    libc()->free(p);
+}
+
+int posix_memalign(void** out, std::size_t alignment, std::size_t size) {
+    onAllocate(size);
+    return libc()->posixMemalign(out, alignment, size);
+}
+
+void* aligned_alloc(std::size_t alignment, std::size_t size) {
+    onAllocate(size);
+    return libc()->alignedAlloc(alignment, size);
+}
+
+void* memalign(std::size_t alignment, std::size_t size) {
+    onAllocate(size);
+    return libc()->memalign(alignment, size);
+}
+
+} // extern "C"
+
+// operator new 转到上面的 malloc / posix_memalign 计数，不重复计数
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return malloc(size == 0 ? 1 : size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return malloc(size == 0 ? 1 : size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, std::size_t) noexcept { free(p); }
+void operator delete[](void* p, std::size_t) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { free(p); }
+
+#endif // AUDIO_ALLOC_GUARD
@@ -0,0 +1,37 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_ALLOCGUARD_H
+#define AAUDIORECORDER_ALLOCGUARD_H
+
+#include <cstdint>
+
+/**
+ * 处理线程堆分配检测（调试用）
+ *
+ * 编译时定义 AUDIO_ALLOC_GUARD 后替换全局 operator new，并在可执行文件里定义
+ * malloc / calloc / realloc / free / posix_memalign / aligned_alloc / memalign，
+ * 经 dlsym(RTLD_NEXT) 转给 libc：libdf 的 Rust 分配器和 webrtc 的分配也会被看到。
+ * 当前线程调用 arm() 之后发生的每一次堆分配都会被计数，
+ * 再定义 AUDIO_ALLOC_GUARD_ABORT 时直接 abort，便于定位。
+ * libc 内部直接绑定的分配 (例如 stdio 的缓冲区) 和 mmap 不经过这里，不计数。
+ * 未定义 AUDIO_ALLOC_GUARD 时所有接口都是空操作。
+ */
+class AllocGuard {
+public:
+#if defined(AUDIO_ALLOC_GUARD)
+    // 预热结束后在处理线程上调用，开始统计
+    static void arm();
+    // 停止统计当前线程
+    static void disarm();
+    // 所有线程在 arm 状态下发生的分配次数
+    static uint64_t count();
+#else
+    static void arm() {}
+    static void disarm() {}
+    static uint64_t count() { return 0; }
+#endif
+};
+
+#endif //AAUDIORECORDER_ALLOCGUARD_H
@@ -0,0 +1,34 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include "ApmAudioBuffer.h"
+
+namespace webrtc {
+
+/**
+ * libwebrtc_audio_processing.so 导出的两个拷贝函数。调用时 StreamConfig 必须与 AudioBuffer 的
+ * 输入/输出配置一致，处理速率等于流速率时不做重采样，float 在 [-1, 1] 与 APM 内部的 S16 幅度之间转换。
+ *
+ * 只对应 webRtcApm/lib 里的 webrtc-audio-processing 2.1 (SONAME libwebrtc-audio-processing-2.so)：
+ *   webrtc::AudioBuffer::CopyFrom(float const* const*, webrtc::StreamConfig const&)
+ *   webrtc::AudioBuffer::CopyTo(webrtc::StreamConfig const&, float* const*)
+ * 顶层 CMakeLists 在配置时用 nm 检查这两个符号，升级库后对不上会直接报错。
+ * 这个声明只能出现在这一个翻译单元里，其它代码通过 ApmAudioBuffer.h 的 C 接口调用。
+ */
+class AudioBuffer {
+public:
+    void CopyFrom(const float* const* data, const StreamConfig& stream_config);
+    void CopyTo(const StreamConfig& stream_config, float* const* data);
+};
+
+} // namespace webrtc
+
+void apm_audio_buffer_copy_to(webrtc::AudioBuffer* audio, const webrtc::StreamConfig* config, float* const* data) {
+    audio->CopyTo(*config, data);
+}
+
+void apm_audio_buffer_copy_from(webrtc::AudioBuffer* audio, const float* const* data,
+                                const webrtc::StreamConfig* config) {
+    audio->CopyFrom(data, *config);
+}
@@ -0,0 +1,25 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_APMAUDIOBUFFER_H
+#define AAUDIORECORDER_APMAUDIOBUFFER_H
+
+#include "modules/audio_processing/include/audio_processing.h"
+
+/**
+ * webrtc::AudioBuffer 的浮点拷贝接口 (CustomProcessing::Process 拿到的缓冲)
+ *
+ * 安装的头文件里只有 AudioBuffer 的前置声明。类的部分声明只放在 ApmAudioBuffer.cpp 里，
+ * 对外只有这两个 C 链接的函数，其它翻译单元看到的始终是不完整类型。
+ * config 必须与 AudioBuffer 的输入/输出配置一致，float 在 [-1, 1]。
+ */
+extern "C" {
+
+void apm_audio_buffer_copy_to(webrtc::AudioBuffer* audio, const webrtc::StreamConfig* config, float* const* data);
+void apm_audio_buffer_copy_from(webrtc::AudioBuffer* audio, const float* const* data,
+                                const webrtc::StreamConfig* config);
+
+}
+
+#endif //AAUDIORECORDER_APMAUDIOBUFFER_H
@@ -0,0 +1,42 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_APMCONFIG_H
+#define AAUDIORECORDER_APMCONFIG_H
+
+#include <memory>
+#include <utility>
+
+#include "modules/audio_processing/include/audio_processing.h"
+
+// 录音和离线处理共用的 APM 配置，保证两条路径的处理结果一致
+inline webrtc::AudioProcessing::Config defaultApmConfig() {
+    webrtc::AudioProcessing::Config config;
+
+    //高通滤波
+    config.high_pass_filter.enabled = true;
+
+    // 配置 AEC、NS、AGC 等
+    config.echo_canceller.enabled = true;
+    config.noise_suppression.enabled = true;
+    config.noise_suppression.level = webrtc::AudioProcessing::Config::NoiseSuppression::kHigh;
+    config.gain_controller2.enabled = true;
+
+    return config;
+}
+
+// capturePostProcessing 不为空时安装在采集链路的最后 (例如 DeepFilterProcessing)
+inline rtc::scoped_refptr<webrtc::AudioProcessing> createDefaultApm(
+        std::unique_ptr<webrtc::CustomProcessing> capturePostProcessing = nullptr) {
+    webrtc::AudioProcessingBuilder builder;
+
+    builder.SetConfig(defaultApmConfig());
+    if (capturePostProcessing) {
+        builder.SetCapturePostProcessing(std::move(capturePostProcessing));
+    }
+
+    return builder.Create();
+}
+
+#endif //AAUDIORECORDER_APMCONFIG_H
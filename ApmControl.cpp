@@ -0,0 +1,228 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include "ApmControl.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "ApmConfig.h"
+#include "DeepFilterProcessing.h"
+#include "RecorderLog.h"
+
+namespace {
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+void ApmConfigDelta::applyTo(Config& config) const {
+    if (fields & kHighPassFilter) {
+        config.high_pass_filter.enabled = highPassFilter;
+    }
+    if (fields & kEchoCanceller) {
+        config.echo_canceller.enabled = echoCanceller;
+        config.echo_canceller.mobile_mode = echoMobileMode;
+    }
+    if (fields & kNoiseSuppression) {
+        config.noise_suppression.enabled = noiseSuppression;
+        config.noise_suppression.level = noiseLevel;
+    }
+    if (fields & kGainController2) {
+        config.gain_controller2.enabled = gainController2;
+    }
+    if (fields & kAdaptiveDigital) {
+        config.gain_controller2.adaptive_digital.enabled = adaptiveDigital;
+    }
+    if (fields & kFixedDigitalGain) {
+        config.gain_controller2.fixed_digital.gain_db = fixedDigitalGainDb;
+    }
+    if (fields & kCaptureLevelAdjustment) {
+        config.capture_level_adjustment.enabled = captureLevelAdjustment;
+    }
+}
+
+ApmControl::ApmControl() : config(defaultApmConfig()) {}
+
+bool ApmControl::update(const ApmConfigDelta& delta) {
+    Command command;
+    command.type = Command::Type::Config;
+    command.delta = delta;
+    if (queue.push(command)) return true;
+    rejected.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool ApmControl::post(RuntimeSetting setting) {
+    Command command;
+    command.type = Command::Type::Runtime;
+    command.setting = setting;
+    if (queue.push(command)) return true;
+    rejected.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool ApmControl::degrade(uint32_t flags) {
+    Command command;
+    command.type = Command::Type::Degrade;
+    command.degrade = flags;
+    if (queue.push(command)) return true;
+    rejected.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool ApmControl::deepFilter(DeepFilterParam param, float value) {
+    Command command;
+    command.type = Command::Type::DeepFilter;
+    command.dfParam = param;
+    command.dfValue = value;
+    if (queue.push(command)) return true;
+    rejected.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void ApmControl::attach(webrtc::AudioProcessing* apm, DeepFilterProcessing* deepFilter) {
+    degradeFlags = 0;
+    df = deepFilter;
+    if (customized) {
+        apm->ApplyConfig(effectiveConfig());
+    }
+    applyDeepFilter(dfParams);
+    apply(apm);
+}
+
+void ApmControl::applyDeepFilter(uint32_t params) {
+    if (df == nullptr) return;
+    if (params & kDfAttenLimDb) df->setAttenLimDb(dfAttenLimDb);
+    if (params & kDfPostFilterBeta) df->setPostFilterBeta(dfPostFilterBeta);
+    if (params & kDfGating) df->setGating(dfGating);
+    if (params & (kDfSuspended | kDfGovernorOff)) df->setSuspended(dfSuspended || dfGovernorOff);
+}
+
+webrtc::AudioProcessing::Config ApmControl::effectiveConfig() const {
+    webrtc::AudioProcessing::Config effective = config;
+    if ((degradeFlags & kNsModerate) &&
+        effective.noise_suppression.level > webrtc::AudioProcessing::Config::NoiseSuppression::kModerate) {
+        effective.noise_suppression.level = webrtc::AudioProcessing::Config::NoiseSuppression::kModerate;
+    }
+    if (degradeFlags & kAecOff) {
+        effective.echo_canceller.enabled = false;
+    }
+    if (degradeFlags & kRate32k) {
+        effective.pipeline.maximum_internal_processing_rate = 32000;
+    }
+    return effective;
+}
+
+bool ApmControl::trackRuntimeSetting(const RuntimeSetting& setting) {
+    float value = 0.f;
+    switch (setting.type()) {
+        case RuntimeSetting::Type::kCapturePreGain:
+            setting.GetFloat(&value);
+            config.capture_level_adjustment.pre_gain_factor = value;
+            break;
+        case RuntimeSetting::Type::kCapturePostGain:
+            setting.GetFloat(&value);
+            config.capture_level_adjustment.post_gain_factor = value;
+            break;
+        case RuntimeSetting::Type::kCaptureFixedPostGain:
+            setting.GetFloat(&value);
+            config.gain_controller2.fixed_digital.gain_db = value;
+            customized = true;
+            return false;
+        default:
+            return false;
+    }
+    customized = true;
+    // 没有 capture_level_adjustment 时增益设置会被 APM 忽略，打开它并把增益带进配置
+    if (!config.capture_level_adjustment.enabled) {
+        config.capture_level_adjustment.enabled = true;
+        return true;
+    }
+    return false;
+}
+
+size_t ApmControl::apply(webrtc::AudioProcessing* apm) {
+    // 一次最多取 kQueueCapacity 条，控制线程持续写入时也不会一直占着这一帧
+    Command command;
+    size_t count = 0;
+    size_t settings = 0;
+    bool configChanged = false;
+    while (count < kQueueCapacity && queue.pop(command)) {
+        ++count;
+        switch (command.type) {
+            case Command::Type::Config:
+                command.delta.applyTo(config);
+                customized = true;
+                configChanged = true;
+                break;
+            case Command::Type::Runtime:
+                configChanged |= trackRuntimeSetting(command.setting);
+                pending[settings++] = command.setting;
+                break;
+            case Command::Type::Degrade:
+                configChanged |= command.degrade != degradeFlags;
+                degradeFlags = command.degrade;
+                break;
+            case Command::Type::DeepFilter:
+                switch (command.dfParam) {
+                    case kDfAttenLimDb: dfAttenLimDb = command.dfValue; break;
+                    case kDfPostFilterBeta: dfPostFilterBeta = command.dfValue; break;
+                    case kDfGating: dfGating = command.dfValue != 0.f; break;
+                    case kDfSuspended: dfSuspended = command.dfValue != 0.f; break;
+                    case kDfGovernorOff: dfGovernorOff = command.dfValue != 0.f; break;
+                }
+                dfParams |= command.dfParam;
+                applyDeepFilter(command.dfParam);
+                break;
+        }
+    }
+    if (count == 0) return 0;
+    commands += count;
+
+    if (configChanged) {
+        int64_t begin = nowNs();
+        apm->ApplyConfig(effectiveConfig());
+        int64_t elapsed = nowNs() - begin;
+        applyConfigMaxNs = std::max(applyConfigMaxNs, elapsed);
+        ++configsApplied;
+        LOGI("APM config applied in %.2f ms (%zu commands)", elapsed / 1e6, count);
+    }
+    for (size_t i = 0; i < settings; ++i) {
+        apm->SetRuntimeSetting(pending[i]);
+    }
+    settingsApplied += settings;
+    return count;
+}
+
+void ApmControl::recordFrame(int64_t processNs, bool reconfigured) {
+    if (reconfigured) {
+        ++reconfiguredFrames;
+        reconfiguredMaxNs = std::max(reconfiguredMaxNs, processNs);
+    } else {
+        frameMaxNs = std::max(frameMaxNs, processNs);
+    }
+}
+
+void ApmControl::report() {
+    uint64_t dropped = rejected.exchange(0, std::memory_order_relaxed);
+    if (commands > 0 || dropped > 0) {
+        LOGI("APM control: %llu commands (%llu ApplyConfig, %llu runtime settings), %llu rejected; "
+             "worst frame %.2f ms over %llu reconfigured frames (ApplyConfig %.2f ms), %.2f ms otherwise",
+             (unsigned long long) commands, (unsigned long long) configsApplied,
+             (unsigned long long) settingsApplied, (unsigned long long) dropped,
+             reconfiguredMaxNs / 1e6, (unsigned long long) reconfiguredFrames,
+             applyConfigMaxNs / 1e6, frameMaxNs / 1e6);
+    }
+    commands = 0;
+    configsApplied = 0;
+    settingsApplied = 0;
+    reconfiguredFrames = 0;
+    reconfiguredMaxNs = 0;
+    applyConfigMaxNs = 0;
+    frameMaxNs = 0;
+}
@@ -0,0 +1,196 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_APMCONTROL_H
+#define AAUDIORECORDER_APMCONTROL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "modules/audio_processing/include/audio_processing.h"
+
+#include "MpscQueue.h"
+
+class DeepFilterProcessing;
+
+// 对 defaultApmConfig() 的增量修改，只有 set 过的字段才会生效
+struct ApmConfigDelta {
+    using Config = webrtc::AudioProcessing::Config;
+
+    enum Field : uint32_t {
+        kHighPassFilter = 1u << 0,
+        kEchoCanceller = 1u << 1,
+        kNoiseSuppression = 1u << 2,
+        kGainController2 = 1u << 3,
+        kAdaptiveDigital = 1u << 4,
+        kFixedDigitalGain = 1u << 5,
+        kCaptureLevelAdjustment = 1u << 6,
+    };
+
+    ApmConfigDelta& setHighPassFilter(bool enabled) {
+        fields |= kHighPassFilter;
+        highPassFilter = enabled;
+        return *this;
+    }
+
+    ApmConfigDelta& setEchoCanceller(bool enabled, bool mobileMode = false) {
+        fields |= kEchoCanceller;
+        echoCanceller = enabled;
+        echoMobileMode = mobileMode;
+        return *this;
+    }
+
+    ApmConfigDelta& setNoiseSuppression(bool enabled, Config::NoiseSuppression::Level level = Config::NoiseSuppression::kHigh) {
+        fields |= kNoiseSuppression;
+        noiseSuppression = enabled;
+        noiseLevel = level;
+        return *this;
+    }
+
+    ApmConfigDelta& setGainController2(bool enabled) {
+        fields |= kGainController2;
+        gainController2 = enabled;
+        return *this;
+    }
+
+    ApmConfigDelta& setAdaptiveDigital(bool enabled) {
+        fields |= kAdaptiveDigital;
+        adaptiveDigital = enabled;
+        return *this;
+    }
+
+    // AGC2 的固定增益，运行中只调整数值时用 RuntimeSetting::CreateCaptureFixedPostGain 更轻
+    ApmConfigDelta& setFixedDigitalGain(float gainDb) {
+        fields |= kFixedDigitalGain;
+        fixedDigitalGainDb = gainDb;
+        return *this;
+    }
+
+    ApmConfigDelta& setCaptureLevelAdjustment(bool enabled) {
+        fields |= kCaptureLevelAdjustment;
+        captureLevelAdjustment = enabled;
+        return *this;
+    }
+
+    void applyTo(Config& config) const;
+
+    uint32_t fields = 0;
+    bool highPassFilter = false;
+    bool echoCanceller = false;
+    bool echoMobileMode = false;
+    bool noiseSuppression = false;
+    Config::NoiseSuppression::Level noiseLevel = Config::NoiseSuppression::kHigh;
+    bool gainController2 = false;
+    bool adaptiveDigital = false;
+    float fixedDigitalGainDb = 0.f;
+    bool captureLevelAdjustment = false;
+};
+
+/**
+ * 运行中修改 APM 配置，不需要 stop() / start()，AEC、AGC 等自适应状态得以保留
+ *
+ * 控制线程 (以及 QualityGovernor) 把配置增量、RuntimeSetting 和降级标志放进无锁的 MpscQueue，
+ * 处理线程在每帧 ProcessStream 之前调用 apply() 一次性取空队列：
+ *   - 同一批里的配置增量合并成一次 ApplyConfig
+ *   - RuntimeSetting 按顺序交给 SetRuntimeSetting，同时记到当前配置里，下次 ApplyConfig 或重新 start() 不会丢
+ *   - capture pre / post gain 需要 capture_level_adjustment，没有打开时随这一批自动打开
+ * ApplyConfig 始终在处理线程上调用，不会和 ProcessStream 争 APM 内部的锁；
+ * 会重建子模块的修改 (例如开关 AEC) 在这一帧上有明显耗时，也会分配内存 (AUDIO_ALLOC_GUARD 下计入)。
+ *
+ * 内联 DF (DeepFilterProcessing) 归 APM 所有，APM 重建时会被释放，所以它的参数也走这个队列，
+ * 只在处理线程上通过 attach() 给出的指针修改；修改同样会保留到下一次 attach()。
+ *
+ * 处理线程每帧调用 recordFrame()，stop 时 report() 输出带配置修改的帧和普通帧各自的最大耗时。
+ */
+class ApmControl {
+public:
+    using RuntimeSetting = webrtc::AudioProcessing::RuntimeSetting;
+
+    // QualityGovernor 的降级，叠加在当前配置之上，不会改写控制线程设置的值
+    enum Degrade : uint32_t {
+        kNsModerate = 1u << 0,      // 噪声抑制最多 kModerate
+        kAecOff = 1u << 1,
+        kRate32k = 1u << 2,         // maximum_internal_processing_rate 32000
+    };
+
+    enum DeepFilterParam : uint32_t {
+        kDfAttenLimDb = 1u << 0,
+        kDfPostFilterBeta = 1u << 1,
+        kDfGating = 1u << 2,        // value != 0 时打开
+        kDfSuspended = 1u << 3,     // value != 0 时走旁路
+        kDfGovernorOff = 1u << 4,   // QualityGovernor 的旁路，和 kDfSuspended 相互独立，任一个为真时走旁路
+    };
+
+    static constexpr size_t kQueueCapacity = 32;
+
+    ApmControl();
+    ApmControl(const ApmControl&) = delete;
+    ApmControl& operator=(const ApmControl&) = delete;
+
+    // ---------------- 任意线程，非阻塞，队列满时返回 false ----------------
+
+    bool update(const ApmConfigDelta& delta);
+    bool post(RuntimeSetting setting);
+    bool degrade(uint32_t flags);
+    bool deepFilter(DeepFilterParam param, float value);
+
+    // ---------------- 处理线程 ----------------
+
+    /**
+     * 新建的 APM (defaultApmConfig()) 开始处理之前调用：清除降级，补上之前的修改和排队的命令。
+     * df 是 APM 采集后处理中的 DF，没有时为空。调用时处理线程还没有运行
+     */
+    void attach(webrtc::AudioProcessing* apm, DeepFilterProcessing* df);
+
+    // 每帧 ProcessStream 之前调用，返回本次应用的命令数；队列为空时只有一次原子读
+    size_t apply(webrtc::AudioProcessing* apm);
+
+    void recordFrame(int64_t processNs, bool reconfigured);
+
+    // 处理线程退出之后调用，输出统计并清零
+    void report();
+
+private:
+    struct Command {
+        enum class Type { Config, Runtime, Degrade, DeepFilter };
+        Type type = Type::Config;
+        ApmConfigDelta delta;
+        RuntimeSetting setting;
+        uint32_t degrade = 0;
+        DeepFilterParam dfParam = kDfAttenLimDb;
+        float dfValue = 0.f;
+    };
+
+    webrtc::AudioProcessing::Config effectiveConfig() const;
+    // 把 RuntimeSetting 记到 config 中，返回是否需要 ApplyConfig 才能生效
+    bool trackRuntimeSetting(const RuntimeSetting& setting);
+    void applyDeepFilter(uint32_t params);
+
+    MpscQueue<Command, kQueueCapacity> queue;
+    std::atomic<uint64_t> rejected{0};
+
+    // 处理线程状态
+    webrtc::AudioProcessing::Config config;     // defaultApmConfig() + 所有增量和 RuntimeSetting
+    bool customized = false;                    // config 和 defaultApmConfig() 不同
+    uint32_t degradeFlags = 0;
+    RuntimeSetting pending[kQueueCapacity];
+    DeepFilterProcessing* df = nullptr;
+    uint32_t dfParams = 0;                      // 设置过的 DF 参数
+    float dfAttenLimDb = 0.f;
+    float dfPostFilterBeta = 0.f;
+    bool dfGating = false;
+    bool dfSuspended = false;
+    bool dfGovernorOff = false;
+
+    uint64_t commands = 0;
+    uint64_t configsApplied = 0;
+    uint64_t settingsApplied = 0;
+    uint64_t reconfiguredFrames = 0;
+    int64_t reconfiguredMaxNs = 0;
+    int64_t applyConfigMaxNs = 0;
+    int64_t frameMaxNs = 0;
+};
+
+#endif //AAUDIORECORDER_APMCONTROL_H
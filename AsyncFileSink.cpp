@@ -0,0 +1,464 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include "AsyncFileSink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "RecorderLog.h"
+
+#if defined(AUDIO_SINK_STALL_MS) && !defined(AUDIO_SINK_STALL_EVERY)
+#define AUDIO_SINK_STALL_EVERY 4
+#endif
+
+namespace {
+
+int64_t monotonicNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void updateMax(std::atomic<int64_t>& target, int64_t value) {
+    int64_t current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+} // namespace
+
+AsyncFileWriter::AsyncFileWriter() {
+    arena = static_cast<uint8_t*>(::operator new(kBlockBytes * kBlockCount, std::align_val_t(kBlockAlign)));
+    // 提前触碰所有页面，避免处理线程第一次写入时缺页
+    std::memset(arena, 0, kBlockBytes * kBlockCount);
+    for (uint32_t i = 0; i < kBlockCount; ++i) {
+        blocks[i] = {arena + i * kBlockBytes, nullptr, 0, 0};
+        freeBlocks.write(&i, 1);
+    }
+}
+
+AsyncFileWriter::~AsyncFileWriter() {
+    stop();
+    ::operator delete(arena, std::align_val_t(kBlockAlign));
+}
+
+void AsyncFileWriter::start() {
+    if (running.load(std::memory_order_relaxed)) return;
+    running = true;
+    worker = std::thread(&AsyncFileWriter::run, this);
+}
+
+void AsyncFileWriter::stop() {
+    if (!worker.joinable()) return;
+    running = false;
+    signal.wakeAll();
+    worker.join();
+
+    Stats s = stats();
+    LOGI("File sink wrote %llu bytes in %llu calls (%llu blocks), latency avg %lld us max %lld us, "
+         "queue depth max %zu/%zu, header patches %llu, errors %llu",
+         (unsigned long long) s.bytesWritten, (unsigned long long) s.writeCalls,
+         (unsigned long long) s.blocksWritten,
+         (long long) (s.writeCalls ? s.writeNsTotal / (int64_t) s.writeCalls / 1000 : 0),
+         (long long) (s.writeNsMax / 1000), s.queueDepthMax, kBlockCount,
+         (unsigned long long) s.headerPatches, (unsigned long long) s.writeErrors);
+}
+
+void AsyncFileWriter::drain() {
+    while (completedBlocks.load(std::memory_order_acquire) < submittedBlocks
+           && running.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+AsyncFileWriter::Stats AsyncFileWriter::stats() const {
+    return {blocksWritten.load(std::memory_order_relaxed),
+            bytesWritten.load(std::memory_order_relaxed),
+            writeCalls.load(std::memory_order_relaxed),
+            writeErrors.load(std::memory_order_relaxed),
+            headerPatches.load(std::memory_order_relaxed),
+            writeNsTotal.load(std::memory_order_relaxed),
+            writeNsMax.load(std::memory_order_relaxed),
+            queueDepthMax.load(std::memory_order_relaxed)};
+}
+
+AsyncFileWriter::Block* AsyncFileWriter::acquireBlock() {
+    uint32_t index;
+    if (freeBlocks.read(&index, 1) == 0) return nullptr;
+    return &blocks[index];
+}
+
+void AsyncFileWriter::submit(Block* block) {
+    auto index = static_cast<uint32_t>(block - blocks);
+    fullBlocks.write(&index, 1);    // 块总数等于队列容量，不会写满
+    ++submittedBlocks;
+    signal.publish(1, 1);
+}
+
+void AsyncFileWriter::run() {
+    while (true) {
+        signal.wait([&] {
+            return !running.load(std::memory_order_relaxed) || fullBlocks.availableFrames() > 0;
+        }, 100);
+
+        while (writeBatch() > 0) {
+        }
+        if (!running.load(std::memory_order_relaxed) && fullBlocks.availableFrames() == 0) break;
+    }
+}
+
+size_t AsyncFileWriter::writeBatch() {
+    size_t available = fullBlocks.availableFrames();
+    if (available == 0) return 0;
+    if (available > queueDepthMax.load(std::memory_order_relaxed)) {
+        queueDepthMax.store(available, std::memory_order_relaxed);
+    }
+
+    uint32_t indices[kMaxBatch];
+    size_t n = fullBlocks.read(indices, std::min(available, kMaxBatch));
+
+    size_t i = 0;
+    while (i < n) {
+        Block& first = blocks[indices[i]];
+        AsyncFileSink* sink = first.sink;
+
+        // 同一文件中首尾相接的块合并成一次 pwritev
+        struct iovec iov[kMaxBatch];
+        int count = 0;
+        int64_t end = first.offset;
+        size_t j = i;
+        while (j < n && blocks[indices[j]].sink == sink && blocks[indices[j]].offset == end) {
+            const Block& block = blocks[indices[j]];
+            if (block.bytes > 0) {
+                iov[count++] = {block.data, block.bytes};
+            }
+            end += static_cast<int64_t>(block.bytes);
+            ++j;
+        }
+
+        // FLAC: 整段先编码，再把码流一次写到文件末尾
+        int64_t writeBegin = first.offset;
+        int64_t writeEnd = end;
+        if (sink->container == AsyncFileSink::Container::Flac) {
+            size_t bytes = encodeRun(sink, indices + i, j - i);
+            writeBegin = sink->encodedOutputBytes;
+            writeEnd = writeBegin + static_cast<int64_t>(bytes);
+            count = 0;
+            if (bytes > 0) {
+                iov[count++] = {sink->encoded.data(), bytes};
+            }
+        }
+
+        if (count > 0) {
+            reserve(sink, writeEnd);
+
+#if defined(AUDIO_SINK_STALL_MS)
+            // 模拟存储抖动 (其他应用 fsync、eMMC 垃圾回收等)
+            static uint64_t batches = 0;
+            if (++batches % AUDIO_SINK_STALL_EVERY == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(AUDIO_SINK_STALL_MS));
+            }
+#endif
+
+            int64_t begin = monotonicNs();
+            bool ok = writeFully(sink->fd, iov, count, writeBegin);
+            int64_t elapsed = monotonicNs() - begin;
+
+            writeNsTotal.fetch_add(elapsed, std::memory_order_relaxed);
+            updateMax(writeNsMax, elapsed);
+            writeCalls.fetch_add(1, std::memory_order_relaxed);
+            if (ok) {
+                bytesWritten.fetch_add(static_cast<uint64_t>(writeEnd - writeBegin), std::memory_order_relaxed);
+            } else {
+                writeErrors.fetch_add(1, std::memory_order_relaxed);
+            }
+            blocksWritten.fetch_add(j - i, std::memory_order_relaxed);
+            if (sink->container == AsyncFileSink::Container::Flac) {
+                sink->encodedOutputBytes = writeEnd;
+            }
+
+            // 数据落盘之后再更新头部，头部记录的长度不会超过实际数据
+            if (ok && sink->container != AsyncFileSink::Container::Raw
+                && writeEnd - sink->patchedBytes >= kHeaderPatchBytes) {
+                patchHeader(sink, writeEnd);
+            }
+        }
+
+        for (size_t k = i; k < j; ++k) {
+            freeBlocks.write(&indices[k], 1);
+        }
+        completedBlocks.fetch_add(j - i, std::memory_order_release);
+        i = j;
+    }
+    return n;
+}
+
+size_t AsyncFileWriter::encodeRun(AsyncFileSink* sink, const uint32_t* indices, size_t count) {
+    FlacEncoder& encoder = *sink->encoder;
+    const size_t frameBytes = sink->format.blockAlign();
+    sink->encoded.clear();
+
+    int64_t begin = monotonicNs();
+    for (size_t k = 0; k < count; ++k) {
+        const Block& block = blocks[indices[k]];
+
+        // 生产者丢弃的数据按静音编码，保持时间轴
+        if (block.offset > sink->encodedInputBytes) {
+            auto gap = static_cast<size_t>(block.offset - sink->encodedInputBytes);
+            sink->carryBytes = 0;
+            encoder.push(nullptr, gap / frameBytes, sink->encoded);
+            sink->encodedInputBytes = block.offset;
+        }
+
+        const uint8_t* data = block.data;
+        size_t bytes = block.bytes;
+        sink->encodedInputBytes += static_cast<int64_t>(bytes);
+
+        // 先补齐上一个块留下的半帧
+        if (sink->carryBytes > 0) {
+            size_t n = std::min(bytes, frameBytes - sink->carryBytes);
+            std::memcpy(sink->carry + sink->carryBytes, data, n);
+            sink->carryBytes += n;
+            data += n;
+            bytes -= n;
+            if (sink->carryBytes < frameBytes) continue;
+            encoder.push(reinterpret_cast<const int16_t*>(sink->carry), 1, sink->encoded);
+            sink->carryBytes = 0;
+        }
+
+        size_t frames = bytes / frameBytes;
+        encoder.push(reinterpret_cast<const int16_t*>(data), frames, sink->encoded);
+        sink->carryBytes = bytes - frames * frameBytes;
+        std::memcpy(sink->carry, data + frames * frameBytes, sink->carryBytes);
+    }
+    sink->encodeNsTotal += monotonicNs() - begin;
+    return sink->encoded.size();
+}
+
+bool AsyncFileWriter::writeFully(int fd, struct iovec* iov, int count, int64_t offset) {
+    while (count > 0) {
+        ssize_t written = pwritev(fd, iov, count, offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            LOGE("pwritev failed: %s", strerror(errno));
+            return false;
+        }
+        offset += written;
+
+        // 部分写入时跳过已经写完的 iovec
+        auto remaining = static_cast<size_t>(written);
+        while (count > 0 && remaining >= iov->iov_len) {
+            remaining -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + remaining;
+            iov->iov_len -= remaining;
+        }
+    }
+    return true;
+}
+
+void AsyncFileWriter::reserve(AsyncFileSink* sink, int64_t end) {
+    if (end <= sink->reservedBytes) return;
+
+    int64_t target = std::max(end, sink->reservedBytes + kPreallocateBytes);
+    // KEEP_SIZE: 只分配磁盘块，不改变文件长度
+    if (fallocate(sink->fd, FALLOC_FL_KEEP_SIZE, sink->reservedBytes, target - sink->reservedBytes) == 0) {
+        sink->reservedBytes = target;
+    } else {
+        // 文件系统不支持时不再尝试
+        LOGI("fallocate unsupported (%s), writing without preallocation", strerror(errno));
+        sink->reservedBytes = INT64_MAX;
+    }
+}
+
+void AsyncFileWriter::patchHeader(AsyncFileSink* sink, int64_t end) {
+    uint8_t header[kWavHeaderBytes > FlacEncoder::kStreamHeaderBytes ? kWavHeaderBytes : FlacEncoder::kStreamHeaderBytes];
+    size_t size;
+    if (sink->container == AsyncFileSink::Container::Flac) {
+        sink->encoder->streamHeader(header);
+        size = FlacEncoder::kStreamHeaderBytes;
+    } else {
+        buildWavHeader(sink->format, static_cast<uint64_t>(end) - kWavHeaderBytes, header);
+        size = kWavHeaderBytes;
+    }
+    if (pwrite(sink->fd, header, size, 0) != (ssize_t) size) {
+        LOGE("Header patch failed: %s", strerror(errno));
+        writeErrors.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    sink->patchedBytes = end;
+    headerPatches.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool AsyncFileSink::openWav(const char* path, const WavFormat& wavFormat) {
+    if (!open(path)) return false;
+    container = Container::Wav;
+    format = wavFormat;
+
+    // 初始头部 (长度为 0) 和数据一起进入第一个块，不额外产生系统调用
+    uint8_t header[kWavHeaderBytes];
+    buildWavHeader(format, 0, header);
+    write(reinterpret_cast<const char*>(header), kWavHeaderBytes);
+    patchedBytes = kWavHeaderBytes;
+    return true;
+}
+
+bool AsyncFileSink::openFlac(const char* path, const WavFormat& flacFormat) {
+    if (flacFormat.bitsPerSample != 16 || flacFormat.channels == 0 || flacFormat.channels > 8) {
+        LOGE("FLAC sink only supports 16-bit PCM with 1-8 channels");
+        return false;
+    }
+    if (!open(path)) return false;
+    container = Container::Flac;
+    format = flacFormat;
+
+    // 编码器和码流缓冲在写入线程开始使用之前分配好
+    encoder = std::make_unique<FlacEncoder>(format);
+    encoded.reserve(AsyncFileWriter::kMaxBatch * AsyncFileWriter::kBlockBytes * 9 / 8 + FlacEncoder::kMaxFrameBytes);
+    encodedInputBytes = 0;
+    encodedOutputBytes = FlacEncoder::kStreamHeaderBytes;
+    encodeNsTotal = 0;
+    carryBytes = 0;
+
+    // 文件头只在打开和刷新时各写一次，之后全部是追加的帧
+    writer.patchHeader(this, encodedOutputBytes);
+    return true;
+}
+
+bool AsyncFileSink::openByExtension(const char* path, const WavFormat& pcmFormat) {
+    size_t length = std::strlen(path);
+    if (length >= 4 && strcasecmp(path + length - 4, ".wav") == 0) {
+        return openWav(path, pcmFormat);
+    }
+    if (length >= 5 && strcasecmp(path + length - 5, ".flac") == 0) {
+        return openFlac(path, pcmFormat);
+    }
+    return open(path);
+}
+
+bool AsyncFileSink::open(const char* path) {
+    close();
+
+    fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOGE("Failed to open %s: %s", path, strerror(errno));
+        return false;
+    }
+    submittedBytes = 0;
+    dropped = 0;
+    container = Container::Raw;
+    reservedBytes = 0;
+    patchedBytes = 0;
+
+    // 第一次预留在写入线程看到这个文件之前完成
+    writer.reserve(this, AsyncFileWriter::kPreallocateBytes);
+    writer.start();
+    return true;
+}
+
+void AsyncFileSink::write(const char* data, size_t bytes) {
+    if (fd < 0) return;
+
+    while (bytes > 0) {
+        if (current == nullptr) {
+            current = writer.acquireBlock();
+            while (current == nullptr && blocking && writer.running.load(std::memory_order_relaxed)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                current = writer.acquireBlock();
+            }
+            if (current == nullptr) {
+                // 块池耗尽: 丢弃数据但保留文件偏移，文件中留下静音空洞，前后数据仍然对齐
+                dropped += bytes;
+                submittedBytes += static_cast<int64_t>(bytes);
+                return;
+            }
+            current->sink = this;
+            current->offset = submittedBytes;
+            current->bytes = 0;
+        }
+
+        size_t n = std::min(bytes, AsyncFileWriter::kBlockBytes - current->bytes);
+        std::memcpy(current->data + current->bytes, data, n);
+        current->bytes += n;
+        data += n;
+        bytes -= n;
+
+        if (current->bytes == AsyncFileWriter::kBlockBytes) {
+            flush();
+        }
+    }
+}
+
+void AsyncFileSink::flush() {
+    if (current == nullptr || current->bytes == 0) return;
+    submittedBytes += static_cast<int64_t>(current->bytes);
+    writer.submit(current);
+    current = nullptr;
+}
+
+void AsyncFileSink::close() {
+    if (fd < 0) return;
+
+    // 空块也提交，由写入线程归还到空闲队列
+    if (current != nullptr) {
+        submittedBytes += static_cast<int64_t>(current->bytes);
+        writer.submit(current);
+        current = nullptr;
+    }
+    writer.drain();
+
+    // 写入线程已经空闲，剩下的收尾直接在当前线程完成
+    int64_t fileBytes = submittedBytes;
+    if (container == Container::Flac) {
+        fileBytes = finishFlac();
+        writer.patchHeader(this, fileBytes);
+    } else if (container == Container::Wav && patchedBytes != submittedBytes) {
+        writer.patchHeader(this, submittedBytes);
+    }
+
+    // 末尾是丢弃留下的空洞时文件长度需要补齐，同时释放多余的预留空间
+    if (ftruncate(fd, fileBytes) != 0) {
+        LOGE("ftruncate failed: %s", strerror(errno));
+    }
+    ::close(fd);
+    fd = -1;
+
+    if (dropped > 0) {
+        LOGE("File sink dropped %llu bytes, block pool exhausted", (unsigned long long) dropped);
+    }
+}
+
+int64_t AsyncFileSink::finishFlac() {
+    encoded.clear();
+    if (submittedBytes > encodedInputBytes) {
+        encoder->push(nullptr, static_cast<size_t>(submittedBytes - encodedInputBytes) / format.blockAlign(), encoded);
+    }
+    encoder->finish(encoded);
+    if (!encoded.empty()) {
+        struct iovec iov = {encoded.data(), encoded.size()};
+        writer.writeFully(fd, &iov, 1, encodedOutputBytes);
+        encodedOutputBytes += static_cast<int64_t>(encoded.size());
+    }
+
+    // 每 10ms 的编码耗时，与裸 PCM 路径的差别就是这部分写入线程上的 CPU
+    const double frames10ms = static_cast<double>(submittedBytes)
+                              / (format.sampleRate / 100.0 * format.blockAlign());
+    LOGI("FLAC sink %lld -> %lld bytes, ratio %.3f, encode %.1f us per 10ms on writer thread%s",
+         (long long) submittedBytes, (long long) encodedOutputBytes,
+         submittedBytes > 0 ? (double) encodedOutputBytes / (double) submittedBytes : 0.0,
+         frames10ms > 0 ? (double) encodeNsTotal / 1000.0 / frames10ms : 0.0,
+         encoder->verifyErrors() > 0 ? ", VERIFY FAILED" : "");
+    return encodedOutputBytes;
+}
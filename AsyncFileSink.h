@@ -0,0 +1,182 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_ASYNCFILESINK_H
+#define AAUDIORECORDER_ASYNCFILESINK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "FlacCodec.h"
+#include "FrameSignal.h"
+#include "SpscFrameRing.h"
+#include "WavFormat.h"
+
+class AsyncFileSink;
+
+/**
+ * 文件写入线程
+ *
+ * 所有 AsyncFileSink 共用一个预分配的块池 (kBlockCount 个 kBlockBytes 大小、按页对齐的缓冲区)：
+ *   - 生产者(处理线程)把数据拷进当前块，写满后通过无锁 SPSC 队列交给写入线程
+ *   - 写入线程把同一文件中连续的块合并成一次 pwritev，写完再把块还回空闲队列
+ *   - 文件按 kPreallocateBytes 为单位用 fallocate 预留空间，减少写入时的元数据更新
+ *   - WAV 文件每写入 kHeaderPatchBytes 由写入线程用 pwrite 刷新一次头部长度，崩溃后最多丢失这部分的长度信息
+ *   - FLAC 文件在写入线程上编码，处理线程上的开销与裸 PCM 相同
+ * 块池耗尽时生产者直接丢弃数据并计数，永远不会等待磁盘。
+ *
+ * 编译时定义 AUDIO_SINK_STALL_MS 会在写入线程中周期性注入停顿，用于验证处理线程不受影响。
+ */
+class AsyncFileWriter {
+public:
+    static constexpr size_t kBlockBytes = 128 * 1024;
+    static constexpr size_t kBlockCount = 16;
+    static constexpr size_t kBlockAlign = 4096;
+    static constexpr size_t kMaxBatch = 8;                      // 一次 pwritev 最多合并的块数
+    static constexpr int64_t kPreallocateBytes = 8 * 1024 * 1024;
+    static constexpr int64_t kHeaderPatchBytes = 256 * 1024;
+
+    AsyncFileWriter();
+    ~AsyncFileWriter();
+
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+    // 可重复调用
+    void start();
+    // 写完所有已提交的块后退出写入线程，并输出统计
+    void stop();
+
+    // 等待已提交的块全部写完，只能由生产者调用
+    void drain();
+
+    struct Stats {
+        uint64_t blocksWritten;
+        uint64_t bytesWritten;
+        uint64_t writeCalls;
+        uint64_t writeErrors;
+        uint64_t headerPatches;
+        int64_t writeNsTotal;
+        int64_t writeNsMax;
+        size_t queueDepthMax;
+    };
+    Stats stats() const;
+
+private:
+    friend class AsyncFileSink;
+
+    struct Block {
+        uint8_t* data;
+        AsyncFileSink* sink;
+        int64_t offset;
+        size_t bytes;
+    };
+
+    // ---------------- 生产者 ----------------
+    Block* acquireBlock();
+    void submit(Block* block);
+
+    // ---------------- 写入线程 ----------------
+    void run();
+    size_t writeBatch();
+    bool writeFully(int fd, struct iovec* iov, int count, int64_t offset);
+    void reserve(AsyncFileSink* sink, int64_t end);
+    void patchHeader(AsyncFileSink* sink, int64_t end);
+    size_t encodeRun(AsyncFileSink* sink, const uint32_t* indices, size_t count);
+
+    Block blocks[kBlockCount];
+    uint8_t* arena = nullptr;
+
+    // 写满的块: 生产者 -> 写入线程；空闲块: 写入线程 -> 生产者
+    SpscFrameRing<uint32_t, 1, kBlockCount> fullBlocks;
+    SpscFrameRing<uint32_t, 1, kBlockCount> freeBlocks;
+
+    uint64_t submittedBlocks = 0;               // 只由生产者写
+    std::atomic<uint64_t> completedBlocks{0};
+
+    std::atomic<bool> running{false};
+    std::thread worker;
+    FrameSignal signal;
+
+    // 写入线程统计
+    std::atomic<uint64_t> blocksWritten{0};
+    std::atomic<uint64_t> bytesWritten{0};
+    std::atomic<uint64_t> writeCalls{0};
+    std::atomic<uint64_t> writeErrors{0};
+    std::atomic<uint64_t> headerPatches{0};
+    std::atomic<int64_t> writeNsTotal{0};
+    std::atomic<int64_t> writeNsMax{0};
+    std::atomic<size_t> queueDepthMax{0};
+};
+
+/**
+ * 通过 AsyncFileWriter 异步写入的文件
+ * 接口与 std::ofstream 中录音用到的部分保持一致 (open / is_open / write / close)，
+ * write 只做内存拷贝，只能由同一个生产者线程调用
+ */
+class AsyncFileSink {
+public:
+    explicit AsyncFileSink(AsyncFileWriter& writer) : writer(writer) {}
+    ~AsyncFileSink() { close(); }
+
+    AsyncFileSink(const AsyncFileSink&) = delete;
+    AsyncFileSink& operator=(const AsyncFileSink&) = delete;
+
+    // 截断打开并预留空间，同时确保写入线程已经启动，写入裸 PCM
+    bool open(const char* path);
+    // 同上，数据前预留 WAV 头，超过 4GB 时自动切换为 RF64
+    bool openWav(const char* path, const WavFormat& format);
+    // 同上，写入线程把 PCM 压缩为 FLAC (format 必须是 16 位)
+    bool openFlac(const char* path, const WavFormat& format);
+    // 按扩展名选择: .wav -> openWav，.flac -> openFlac，其它 -> open
+    bool openByExtension(const char* path, const WavFormat& format);
+    bool is_open() const { return fd >= 0; }
+
+    void write(const char* data, size_t bytes);
+
+    // 离线处理使用：块池耗尽时等待写入线程归还空闲块，而不是丢弃数据
+    void setBlocking(bool enable) { blocking = enable; }
+
+    // 提交未满的块
+    void flush();
+
+    // 写完所有数据后关闭文件，并输出该文件的统计
+    void close();
+
+    uint64_t droppedBytes() const { return dropped; }
+
+private:
+    friend class AsyncFileWriter;
+
+    // 编码剩余数据并写入，返回文件长度
+    int64_t finishFlac();
+
+    AsyncFileWriter& writer;
+    int fd = -1;
+    AsyncFileWriter::Block* current = nullptr;
+    int64_t submittedBytes = 0;     // 已提交给写入线程的字节数，即下一个块的文件偏移
+    uint64_t dropped = 0;
+    bool blocking = false;
+    enum class Container { Raw, Wav, Flac };
+
+    Container container = Container::Raw;
+    WavFormat format{};
+    int64_t reservedBytes = 0;      // 只由写入线程访问
+    int64_t patchedBytes = 0;       // 只由写入线程访问，头部记录到的文件长度
+
+    // FLAC 编码状态，只由写入线程访问
+    std::unique_ptr<FlacEncoder> encoder;
+    std::vector<uint8_t> encoded;
+    int64_t encodedInputBytes = 0;  // 已编码的 PCM 字节数 (含空洞)
+    int64_t encodedOutputBytes = 0; // 文件当前长度
+    int64_t encodeNsTotal = 0;
+    uint8_t carry[16];              // 块边界处不完整的采样帧
+    size_t carryBytes = 0;
+};
+
+#endif //AAUDIORECORDER_ASYNCFILESINK_H
@@ -0,0 +1,178 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_AUDIOFRAMEPOOL_H
+#define AAUDIORECORDER_AUDIOFRAMEPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "modules/audio_processing/include/audio_processing.h"
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+/**
+ * 一个 10ms 音频帧
+ * 同一块内存上同时提供平面 float 视图（给 APM float 接口）和交织 int16 视图（给文件/int16 接口）
+ */
+struct AudioFrame {
+    int sampleRate = 0;
+    size_t channels = 0;
+    size_t samplesPerChannel = 0;
+    int64_t timestampNs = 0;
+
+    // 平面 float，planar()[ch] 指向第 ch 个声道
+    float* const* planar() { return channelPointers; }
+    float* channel(size_t ch) { return channelPointers[ch]; }
+
+    // 交织 int16，共 channels * samplesPerChannel 个采样
+    int16_t* interleaved() { return pcm; }
+    size_t interleavedSamples() const { return channels * samplesPerChannel; }
+
+private:
+    friend class AudioFramePool;
+
+    float* channelPointers[8] = {};  // AudioFramePool::kMaxChannels
+    int16_t* pcm = nullptr;
+    std::atomic<uint32_t> next{0};
+};
+
+/**
+ * 预分配、对齐的 AudioFrame 池
+ *
+ * 构造时按 StreamConfig 一次性分配所有帧，之后 acquire/release 不再触碰堆。
+ * 空闲链表是带版本号的无锁栈，可以在采集/处理/写文件等不同线程之间借还。
+ */
+class AudioFramePool {
+public:
+    static constexpr size_t kMaxChannels = 8;
+
+    AudioFramePool(const webrtc::StreamConfig& config, size_t count)
+        : frames(count) {
+        size_t channels = std::min(config.num_channels(), kMaxChannels);
+        size_t samples = config.num_frames();
+        size_t channelBytes = align(samples * sizeof(float));
+        size_t pcmBytes = align(channels * samples * sizeof(int16_t));
+        frameBytes = channelBytes * channels + pcmBytes;
+
+        storage = static_cast<uint8_t*>(::operator new(frameBytes * count, std::align_val_t(CACHE_LINE_SIZE)));
+
+        for (size_t i = 0; i < count; ++i) {
+            AudioFrame& frame = frames[i];
+            uint8_t* base = storage + i * frameBytes;
+            frame.sampleRate = config.sample_rate_hz();
+            frame.channels = channels;
+            frame.samplesPerChannel = samples;
+            for (size_t ch = 0; ch < channels; ++ch) {
+                frame.channelPointers[ch] = reinterpret_cast<float*>(base + ch * channelBytes);
+            }
+            frame.pcm = reinterpret_cast<int16_t*>(base + channels * channelBytes);
+            frame.next.store(static_cast<uint32_t>(i + 1), std::memory_order_relaxed);
+        }
+        head.store(pack(0, count > 0 ? 0 : kNil), std::memory_order_relaxed);
+        if (count > 0) frames[count - 1].next.store(kNil, std::memory_order_relaxed);
+        freeCount.store(count, std::memory_order_relaxed);
+    }
+
+    ~AudioFramePool() {
+        ::operator delete(storage, std::align_val_t(CACHE_LINE_SIZE));
+    }
+
+    AudioFramePool(const AudioFramePool&) = delete;
+    AudioFramePool& operator=(const AudioFramePool&) = delete;
+
+    // 借出一帧，池空时返回 nullptr
+    AudioFrame* acquire() {
+        uint64_t old = head.load(std::memory_order_acquire);
+        while (true) {
+            uint32_t index = indexOf(old);
+            if (index == kNil) return nullptr;
+            uint32_t next = frames[index].next.load(std::memory_order_relaxed);
+            uint64_t desired = pack(tagOf(old) + 1, next);
+            if (head.compare_exchange_weak(old, desired, std::memory_order_acq_rel,
+                                           std::memory_order_acquire)) {
+                freeCount.fetch_sub(1, std::memory_order_relaxed);
+                frames[index].timestampNs = 0;
+                return &frames[index];
+            }
+        }
+    }
+
+    // 归还 acquire 得到的帧
+    void release(AudioFrame* frame) {
+        if (frame == nullptr) return;
+        auto index = static_cast<uint32_t>(frame - frames.data());
+        uint64_t old = head.load(std::memory_order_relaxed);
+        while (true) {
+            frame->next.store(indexOf(old), std::memory_order_relaxed);
+            uint64_t desired = pack(tagOf(old) + 1, index);
+            if (head.compare_exchange_weak(old, desired, std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+                freeCount.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+
+    size_t available() const { return freeCount.load(std::memory_order_relaxed); }
+    size_t capacity() const { return frames.size(); }
+
+private:
+    static constexpr uint32_t kNil = UINT32_MAX;
+
+    static size_t align(size_t bytes) {
+        return (bytes + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    }
+    static uint64_t pack(uint32_t tag, uint32_t index) { return (uint64_t(tag) << 32) | index; }
+    static uint32_t tagOf(uint64_t v) { return static_cast<uint32_t>(v >> 32); }
+    static uint32_t indexOf(uint64_t v) { return static_cast<uint32_t>(v); }
+
+    std::vector<AudioFrame> frames;
+    uint8_t* storage = nullptr;
+    size_t frameBytes = 0;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head{0};
+    std::atomic<size_t> freeCount{0};
+};
+
+/**
+ * RAII 借用，离开作用域自动归还
+ */
+class PooledFrame {
+public:
+    explicit PooledFrame(AudioFramePool& pool) : pool(&pool), frame(pool.acquire()) {}
+    ~PooledFrame() { if (pool) pool->release(frame); }
+
+    PooledFrame(PooledFrame&& other) noexcept : pool(other.pool), frame(other.frame) {
+        other.pool = nullptr;
+        other.frame = nullptr;
+    }
+    PooledFrame(const PooledFrame&) = delete;
+    PooledFrame& operator=(const PooledFrame&) = delete;
+
+    // 放弃所有权，由调用方负责归还
+    AudioFrame* detach() {
+        AudioFrame* f = frame;
+        frame = nullptr;
+        pool = nullptr;
+        return f;
+    }
+
+    explicit operator bool() const { return frame != nullptr; }
+    AudioFrame* operator->() const { return frame; }
+    AudioFrame* get() const { return frame; }
+
+private:
+    AudioFramePool* pool;
+    AudioFrame* frame;
+};
+
+#endif //AAUDIORECORDER_AUDIOFRAMEPOOL_H
@@ -0,0 +1,548 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include "BatchProcessor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ApmConfig.h"
+#include "AsyncFileSink.h"
+#include "DeepFilterStream.h"
+#include "MappedAudioFile.h"
+#include "PcmConvert.h"
+#include "RecorderLog.h"
+
+namespace {
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 每个工作线程一个，只有 steal 时才会被其它线程访问
+struct WorkQueue {
+    std::mutex lock;
+    std::deque<size_t> jobs;
+};
+
+bool hasExtension(const std::string& path, const char* extension) {
+    size_t length = std::strlen(extension);
+    return path.size() >= length && strcasecmp(path.c_str() + path.size() - length, extension) == 0;
+}
+
+/**
+ * 分段模式中一个线程使用的输入和 APM，按 10ms 一帧处理
+ */
+struct SegmentStream {
+    MappedAudioFile input;
+    MappedAudioFile far;
+    bool hasFar = false;
+    size_t frameSize = 0;
+    webrtc::StreamConfig config;
+    rtc::scoped_refptr<webrtc::AudioProcessing> apm;
+    std::vector<int16_t> reverse;
+
+    bool open(const BatchJob& job, const WavFormat& rawFormat) {
+        if (!input.open(job.input.c_str(), rawFormat)) return false;
+        const WavFormat& format = input.format();
+        hasFar = !job.far.empty();
+        if (hasFar && (!far.open(job.far.c_str(), rawFormat) || far.format().sampleRate != format.sampleRate
+                       || far.format().channels != format.channels)) {
+            LOGE("Cannot use %s as the far-end reference of %s", job.far.c_str(), job.input.c_str());
+            return false;
+        }
+        frameSize = format.sampleRate / 100;
+        config = webrtc::StreamConfig(format.sampleRate, format.channels);
+        reverse.resize(frameSize * format.channels);
+        apm = createDefaultApm();
+        return true;
+    }
+
+    // 从第 block 个 10ms 帧开始，APM 状态清零
+    void restart(uint64_t block) {
+        apm->Initialize();
+        input.seek(block * frameSize);
+        if (hasFar) far.seek(block * frameSize);
+    }
+
+    bool process(int16_t* output) {
+        PcmFrameView view;
+        if (!input.next(frameSize, view)) return false;
+        PcmFrameView farView;
+        if (hasFar && far.next(frameSize, farView)) {
+            apm->ProcessReverseStream(farView.spans[0].data, config, config, reverse.data());
+        }
+        return apm->ProcessStream(view.spans[0].data, config, config, output) == 0;
+    }
+};
+
+/**
+ * 一个工作线程的全部处理状态，文件之间复用
+ */
+class BatchWorker {
+public:
+    BatchWorker(const BatchOptions& options, int id) : options(options), id(id) {
+        output.setBlocking(true);
+        if (!options.dfModelPath.empty()) {
+            DeepFilterSpectralConfig spectral;
+            df = DeepFilterStream::create(options.dfModelPath.c_str(), options.dfAttenLimDb,
+                                          options.dfSpectral ? &spectral : nullptr);
+            if (!df) {
+                LOGE("Batch worker %d: DeepFilterNet disabled", id);
+            } else {
+                // 每次喂一个完整的 hop，FIFO 不引入延迟
+                dfHop = df->hop();
+                df->configure(dfHop);
+                df->setGating(options.dfGating);
+                dfPcm.resize(dfHop);
+                dfBlock.resize(dfHop);
+            }
+        }
+    }
+
+    ~BatchWorker() {
+        output.close();
+        writer.stop();
+    }
+
+    DeepFilterStream::Stats dfStats() const {
+        return df ? df->stats() : DeepFilterStream::Stats{0, 0, 0, 0};
+    }
+
+    bool process(const BatchJob& job, BatchFileReport& report) {
+        MappedAudioFile input;
+        if (!input.open(job.input.c_str(), options.rawFormat)) return false;
+        const WavFormat format = input.format();
+
+        MappedAudioFile far;
+        bool hasFar = !job.far.empty();
+        if (hasFar) {
+            if (!far.open(job.far.c_str(), options.rawFormat)) return false;
+            if (far.format().sampleRate != format.sampleRate || far.format().channels != format.channels) {
+                LOGE("%s does not match the format of %s", job.far.c_str(), job.input.c_str());
+                return false;
+            }
+        }
+
+        if (!output.openByExtension(job.output.c_str(), format)) return false;
+
+        // APM 每次处理 10ms
+        const size_t frameSize = format.sampleRate / 100;
+        const size_t samples = frameSize * format.channels;
+        webrtc::StreamConfig config(format.sampleRate, format.channels);
+        if (!apm) {
+            apm = createDefaultApm();
+        } else {
+            apm->Initialize();
+        }
+        if (processed.size() < samples) {
+            processed.resize(samples);
+            reverse.resize(samples);
+        }
+
+        bool useDf = df && format.sampleRate == DeepFilterStream::kSampleRate && format.channels == 1;
+        dfFill = 0;
+
+        uint64_t errors = 0;
+        PcmFrameView view;
+        PcmFrameView farView;
+        while (input.next(frameSize, view)) {
+            if (hasFar && far.next(frameSize, farView)) {
+                apm->ProcessReverseStream(farView.spans[0].data, config, config, reverse.data());
+            }
+            if (apm->ProcessStream(view.spans[0].data, config, config, processed.data()) != 0) {
+                ++errors;
+            }
+            if (useDf) {
+                pushDf(processed.data(), samples);
+            } else {
+                output.write(reinterpret_cast<const char*>(processed.data()), samples * sizeof(int16_t));
+            }
+        }
+        if (useDf) flushDf();
+        output.close();
+
+        if (errors > 0) {
+            LOGE("%s: %llu frames failed in APM", job.input.c_str(), (unsigned long long) errors);
+        }
+        report.frames = input.position();
+        report.audioSeconds = static_cast<double>(report.frames) / format.sampleRate;
+        return true;
+    }
+
+private:
+    // APM 的 10ms 输出按 DF 的帧长重新分块
+    void pushDf(const int16_t* pcm, size_t samples) {
+        while (samples > 0) {
+            size_t n = std::min(samples, dfHop - dfFill);
+            std::copy(pcm, pcm + n, dfPcm.data() + dfFill);
+            dfFill += n;
+            pcm += n;
+            samples -= n;
+            if (dfFill == dfHop) {
+                runDf(dfHop);
+            }
+        }
+    }
+
+    // 文件末尾不足一帧的部分补零处理，只写出有效的采样
+    void flushDf() {
+        if (dfFill == 0) return;
+        std::fill(dfPcm.begin() + dfFill, dfPcm.end(), 0);
+        runDf(dfFill);
+    }
+
+    void runDf(size_t valid) {
+        convertS16ToFloat(dfPcm.data(), dfBlock.data(), dfHop);
+        df->process(dfBlock.data());
+        convertFloatToS16(dfBlock.data(), dfPcm.data(), dfHop);
+        output.write(reinterpret_cast<const char*>(dfPcm.data()), valid * sizeof(int16_t));
+        dfFill = 0;
+    }
+
+    const BatchOptions& options;
+    int id;
+    rtc::scoped_refptr<webrtc::AudioProcessing> apm;
+    AsyncFileWriter writer;
+    AsyncFileSink output{writer};
+    std::vector<int16_t> processed;
+    std::vector<int16_t> reverse;
+
+    std::unique_ptr<DeepFilterStream> df;
+    size_t dfHop = 0;
+    size_t dfFill = 0;
+    std::vector<int16_t> dfPcm;
+    std::vector<float> dfBlock;
+};
+
+} // namespace
+
+BatchSummary BatchProcessor::run(const std::vector<BatchJob>& jobs, const ProgressFn& progress) {
+    unsigned threads = options.threads != 0 ? options.threads : std::thread::hardware_concurrency();
+    threads = std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>(std::max<size_t>(jobs.size(), 1))));
+
+    // 大文件先分配，轮流放进各线程的队列
+    std::vector<std::pair<int64_t, size_t>> order;
+    order.reserve(jobs.size());
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        struct stat st{};
+        int64_t size = stat(jobs[i].input.c_str(), &st) == 0 ? static_cast<int64_t>(st.st_size) : 0;
+        order.emplace_back(size, i);
+    }
+    std::sort(order.begin(), order.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    std::vector<WorkQueue> queues(threads);
+    for (size_t i = 0; i < order.size(); ++i) {
+        queues[i % threads].jobs.push_back(order[i].second);
+    }
+
+    BatchSummary summary{jobs.size(), 0, 0.0, 0.0, 0, std::vector<double>(threads, 0.0), 0, 0, 0.0};
+    std::atomic<uint64_t> steals{0};
+    std::mutex reportLock;
+    size_t done = 0;
+
+    // 自己的队列从头部取，其它线程的队列从尾部偷；所有队列都空时退出
+    auto take = [&](unsigned self, size_t& job) {
+        {
+            std::lock_guard<std::mutex> guard(queues[self].lock);
+            if (!queues[self].jobs.empty()) {
+                job = queues[self].jobs.front();
+                queues[self].jobs.pop_front();
+                return true;
+            }
+        }
+        for (unsigned k = 1; k < threads; ++k) {
+            WorkQueue& victim = queues[(self + k) % threads];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.jobs.empty()) {
+                job = victim.jobs.back();
+                victim.jobs.pop_back();
+                steals.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    };
+
+    int64_t started = nowNs();
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            BatchWorker worker(options, static_cast<int>(t));
+            int64_t busyNs = 0;
+            size_t index;
+            while (take(t, index)) {
+                BatchFileReport report{index, static_cast<int>(t), false, 0, 0.0, 0.0, 0.0};
+                int64_t begin = nowNs();
+                report.ok = worker.process(jobs[index], report);
+                int64_t elapsed = nowNs() - begin;
+                busyNs += elapsed;
+                report.wallSeconds = elapsed / 1e9;
+                report.realtimeFactor = report.audioSeconds > 0 ? report.wallSeconds / report.audioSeconds : 0.0;
+
+                std::lock_guard<std::mutex> guard(reportLock);
+                ++done;
+                if (report.ok) {
+                    summary.audioSeconds += report.audioSeconds;
+                } else {
+                    ++summary.failed;
+                }
+                if (progress) {
+                    progress(report, done, jobs.size());
+                } else {
+                    LOGI("[%zu/%zu] worker %d %s: %.1f s audio in %.2f s, RTF %.4f%s",
+                         done, jobs.size(), report.worker, jobs[index].input.c_str(), report.audioSeconds,
+                         report.wallSeconds, report.realtimeFactor, report.ok ? "" : " FAILED");
+                }
+            }
+            DeepFilterStream::Stats dfStats = worker.dfStats();
+            std::lock_guard<std::mutex> guard(reportLock);
+            summary.workerBusySeconds[t] = busyNs / 1e9;
+            summary.dfHops += dfStats.hops;
+            summary.dfModelHops += dfStats.modelHops;
+            summary.dfModelSeconds += dfStats.modelNsTotal / 1e9;
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    summary.wallSeconds = (nowNs() - started) / 1e9;
+    summary.steals = steals.load();
+
+    double busy = 0.0;
+    for (double seconds : summary.workerBusySeconds) busy += seconds;
+    LOGI("Batch done: %zu files (%zu failed), %.1f s audio in %.2f s on %u threads, %.1fx realtime, "
+         "utilization %.0f%%, %llu steals",
+         summary.files, summary.failed, summary.audioSeconds, summary.wallSeconds, threads,
+         summary.wallSeconds > 0 ? summary.audioSeconds / summary.wallSeconds : 0.0,
+         summary.wallSeconds > 0 ? 100.0 * busy / (summary.wallSeconds * threads) : 0.0,
+         (unsigned long long) summary.steals);
+    if (summary.dfHops > 0 && summary.dfModelHops > 0) {
+        // 跳过的 hop 按实际运行的平均耗时估算
+        double perHop = summary.dfModelSeconds / summary.dfModelHops;
+        LOGI("DeepFilterNet: model ran %llu of %llu hops (%.1f%% skipped), %.2f s inference, ~%.2f s CPU saved",
+             (unsigned long long) summary.dfModelHops, (unsigned long long) summary.dfHops,
+             100.0 * (summary.dfHops - summary.dfModelHops) / summary.dfHops, summary.dfModelSeconds,
+             (summary.dfHops - summary.dfModelHops) * perHop);
+    }
+    return summary;
+}
+
+SegmentReport BatchProcessor::runSegmented(const BatchJob& job, const SegmentOptions& segment) {
+    SegmentReport report{false, 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0, {}};
+    int64_t started = nowNs();
+
+    MappedAudioFile probe;
+    if (!probe.open(job.input.c_str(), options.rawFormat)) return report;
+    const WavFormat format = probe.format();
+    const size_t channels = format.channels;
+    const size_t frameSize = format.sampleRate / 100;
+    const size_t samples = frameSize * channels;
+    const uint64_t blocks = probe.totalFrames() / frameSize;    // 末尾不足 10ms 的部分丢弃
+    probe.close();
+    if (blocks == 0) {
+        LOGE("%s is shorter than one frame", job.input.c_str());
+        return report;
+    }
+    if (hasExtension(job.output, ".flac")) {
+        LOGE("Segmented mode writes WAV or raw PCM only: %s", job.output.c_str());
+        return report;
+    }
+
+    // 段长、预热以 10ms 帧为单位；淡化以采样帧为单位，不超过预热区和段长
+    const auto segmentBlocks = static_cast<uint64_t>(std::max(1.0, std::round(segment.segmentSeconds * 100)));
+    const auto warmupBlocks = static_cast<uint64_t>(std::max(0.0, std::round(segment.warmupSeconds * 100)));
+    const size_t fade = static_cast<size_t>(std::min<double>(
+        std::max(0.0, std::round(segment.crossfadeMs * format.sampleRate / 1000)),
+        static_cast<double>(std::min(warmupBlocks, segmentBlocks) * frameSize)));
+    const size_t segments = static_cast<size_t>((blocks + segmentBlocks - 1) / segmentBlocks);
+
+    unsigned threads = options.threads != 0 ? options.threads : std::thread::hardware_concurrency();
+    threads = std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>(segments)));
+    report.segments = segments;
+    report.threads = threads;
+    report.audioSeconds = static_cast<double>(blocks) / 100;
+
+    // 输出文件按最终长度建好后整体映射，各段直接写到自己的位置
+    const size_t headerBytes = hasExtension(job.output, ".wav") ? kWavHeaderBytes : 0;
+    const uint64_t dataBytes = blocks * samples * sizeof(int16_t);
+    const auto fileBytes = static_cast<size_t>(headerBytes + dataBytes);
+    int fd = ::open(job.output.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOGE("Failed to open %s: %s", job.output.c_str(), strerror(errno));
+        return report;
+    }
+    void* mapped = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(fileBytes)) == 0) {
+        mapped = mmap(nullptr, fileBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        LOGE("Failed to map %s: %s", job.output.c_str(), strerror(errno));
+        return report;
+    }
+    auto* file = static_cast<uint8_t*>(mapped);
+    if (headerBytes > 0) {
+        buildWavHeader(format, dataBytes, file);
+    }
+    auto* out = reinterpret_cast<int16_t*>(file + headerBytes);
+
+    // 第 k 段在淡化区的输出，全部段完成后再与第 k-1 段的结尾混合
+    std::vector<std::vector<int16_t>> heads(segments);
+    std::atomic<size_t> nextSegment{0};
+    std::atomic<bool> failed{false};
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            SegmentStream stream;
+            if (!stream.open(job, options.rawFormat)) {
+                failed = true;
+                return;
+            }
+            std::vector<int16_t> processed(samples);
+            size_t k;
+            while ((k = nextSegment.fetch_add(1)) < segments) {
+                const uint64_t outBegin = k * segmentBlocks;
+                const uint64_t outEnd = std::min(blocks, outBegin + segmentBlocks);
+                const uint64_t begin = k == 0 ? 0 : outBegin - std::min(outBegin, warmupBlocks);
+                const size_t headFrames = k == 0 ? 0 : fade;
+                const uint64_t fadeBegin = outBegin * frameSize - headFrames;
+                heads[k].assign(headFrames * channels, 0);
+
+                stream.restart(begin);
+                for (uint64_t b = begin; b < outEnd; ++b) {
+                    stream.process(processed.data());
+                    if (b >= outBegin) {
+                        std::memcpy(out + b * samples, processed.data(), samples * sizeof(int16_t));
+                        continue;
+                    }
+                    // 预热区只保留落在淡化区内的部分
+                    uint64_t first = b * frameSize;
+                    uint64_t lo = std::max(first, fadeBegin);
+                    uint64_t hi = std::min(first + frameSize, outBegin * frameSize);
+                    if (lo < hi) {
+                        std::copy(processed.data() + (lo - first) * channels,
+                                  processed.data() + (hi - first) * channels,
+                                  heads[k].data() + (lo - fadeBegin) * channels);
+                    }
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    for (size_t k = 1; k < segments && fade > 0; ++k) {
+        int16_t* tail = out + (k * segmentBlocks * frameSize - fade) * channels;
+        const int16_t* head = heads[k].data();
+        for (size_t i = 0; i < fade; ++i) {
+            float w = (static_cast<float>(i) + 0.5f) / static_cast<float>(fade);
+            for (size_t c = 0; c < channels; ++c) {
+                size_t n = i * channels + c;
+                float mixed = tail[n] * (1.0f - w) + head[n] * w;
+                tail[n] = static_cast<int16_t>(std::lrint(std::max(-32768.0f, std::min(32767.0f, mixed))));
+            }
+        }
+    }
+    report.wallSeconds = (nowNs() - started) / 1e9;
+    report.ok = !failed;
+
+    if (report.ok && segment.compareSequential) {
+        compareSegmented(job, segment, format, blocks, segmentBlocks, fade, out, report);
+    }
+    munmap(file, fileBytes);
+
+    LOGI("Segmented %s: %.1f s audio, %zu segments on %u threads, %.2f s (%.1fx realtime)%s",
+         job.input.c_str(), report.audioSeconds, segments, threads, report.wallSeconds,
+         report.audioSeconds / report.wallSeconds, report.ok ? "" : " FAILED");
+    return report;
+}
+
+void BatchProcessor::compareSegmented(const BatchJob& job, const SegmentOptions& segment, const WavFormat& format,
+                                      uint64_t blocks, uint64_t segmentBlocks, size_t fade, const int16_t* out,
+                                      SegmentReport& report) {
+    const size_t channels = format.channels;
+    const size_t frameSize = format.sampleRate / 100;
+    const size_t samples = frameSize * channels;
+    const auto window = static_cast<uint64_t>(std::max(0.0, segment.compareWindowSeconds) * format.sampleRate);
+
+    SegmentStream stream;
+    if (!stream.open(job, options.rawFormat)) return;
+
+    // 每个拼接点统计 [起点 - 淡化, 起点 + window) 内的误差
+    struct Accumulator {
+        double reference = 0.0;
+        double error = 0.0;
+        int maxAbs = 0;
+    };
+    std::vector<Accumulator> boundaries(report.segments);
+    Accumulator total;
+    std::vector<int16_t> processed(samples);
+
+    int64_t compareNs = 0;
+    int64_t started = nowNs();
+    for (uint64_t b = 0; b < blocks; ++b) {
+        stream.process(processed.data());
+
+        int64_t compareStart = nowNs();
+        uint64_t first = b * frameSize;
+        size_t k = static_cast<size_t>((b + segmentBlocks / 2) / segmentBlocks);     // 最近的拼接点
+        if (k >= 1 && k < report.segments) {
+            const uint64_t boundary = k * segmentBlocks * frameSize;
+            const int16_t* stitched = out + b * samples;
+            for (size_t i = 0; i < frameSize; ++i) {
+                uint64_t position = first + i;
+                if (position + fade < boundary || position >= boundary + window) continue;
+                for (size_t c = 0; c < channels; ++c) {
+                    int reference = processed[i * channels + c];
+                    int diff = stitched[i * channels + c] - reference;
+                    boundaries[k].reference += static_cast<double>(reference) * reference;
+                    boundaries[k].error += static_cast<double>(diff) * diff;
+                    boundaries[k].maxAbs = std::max(boundaries[k].maxAbs, std::abs(diff));
+                }
+            }
+        }
+        compareNs += nowNs() - compareStart;
+    }
+    report.sequentialWallSeconds = (nowNs() - started - compareNs) / 1e9;
+    report.speedup = report.wallSeconds > 0 ? report.sequentialWallSeconds / report.wallSeconds : 0.0;
+
+    auto snr = [](const Accumulator& a) {
+        return a.error > 0 ? 10.0 * std::log10(a.reference / a.error) : INFINITY;
+    };
+    for (size_t k = 1; k < report.segments; ++k) {
+        const Accumulator& a = boundaries[k];
+        double seconds = static_cast<double>(k * segmentBlocks) / 100;
+        report.boundaries.push_back({seconds, a.maxAbs, snr(a)});
+        LOGI("  boundary %.1f s: max |error| %d, SNR %.1f dB", seconds, a.maxAbs, snr(a));
+        total.reference += a.reference;
+        total.error += a.error;
+        total.maxAbs = std::max(total.maxAbs, a.maxAbs);
+    }
+    report.stitchedSnrDb = snr(total);
+    report.stitchedMaxAbsError = total.maxAbs;
+    LOGI("Segmented vs sequential: stitched SNR %.1f dB, max |error| %d, sequential %.2f s, speedup %.2fx",
+         report.stitchedSnrDb, report.stitchedMaxAbsError, report.sequentialWallSeconds, report.speedup);
+}
@@ -0,0 +1,118 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_BATCHPROCESSOR_H
+#define AAUDIORECORDER_BATCHPROCESSOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "WavFormat.h"
+
+struct BatchJob {
+    std::string input;
+    std::string output;     // 按扩展名写 WAV / FLAC / 裸 PCM
+    std::string far;        // 可选，成对的远端参考，为空时不送 ProcessReverseStream
+};
+
+struct BatchOptions {
+    unsigned threads = 0;                   // 0 表示 hardware_concurrency
+    WavFormat rawFormat{48000, 1, 16};      // 没有 WAV 头的输入按这个格式解释
+    std::string dfModelPath;                // 为空时不做 DeepFilterNet 降噪
+    float dfAttenLimDb = 100.f;
+    bool dfGating = false;                  // 静音和干净语音段跳过 DF 推理，汇总中报告节省的 CPU
+    bool dfSpectral = false;                // 用 DeepFilterSpectral 驱动 df_process_frame_raw，参数取默认配置
+};
+
+struct BatchFileReport {
+    size_t index;           // 在 jobs 中的下标
+    int worker;
+    bool ok;
+    uint64_t frames;
+    double audioSeconds;
+    double wallSeconds;
+    double realtimeFactor;  // 处理耗时 / 音频时长，越小越快
+};
+
+struct BatchSummary {
+    size_t files;
+    size_t failed;
+    double audioSeconds;
+    double wallSeconds;
+    uint64_t steals;
+    std::vector<double> workerBusySeconds;
+    uint64_t dfHops;                        // 经过 DF 的 hop 总数
+    uint64_t dfModelHops;                   // 其中实际运行模型的
+    double dfModelSeconds;                  // 模型推理的总耗时
+};
+
+struct SegmentOptions {
+    double segmentSeconds = 300.0;          // 每段输出的长度
+    double warmupSeconds = 10.0;            // 每段之前多处理、输出丢弃的长度，用于 AGC / NS / AEC 收敛
+    double crossfadeMs = 20.0;              // 拼接处线性交叉淡化的长度，取自预热区的末尾
+    bool compareSequential = false;         // 再顺序处理一遍，统计拼接区的误差和加速比
+    double compareWindowSeconds = 2.0;      // 每个拼接点之后参与误差统计的长度
+};
+
+struct SegmentBoundaryReport {
+    double seconds;         // 拼接点在文件中的位置
+    int maxAbsError;        // 与顺序处理结果的最大采样差
+    double snrDb;           // 顺序结果能量 / 差值能量
+};
+
+struct SegmentReport {
+    bool ok;
+    size_t segments;
+    unsigned threads;
+    double audioSeconds;
+    double wallSeconds;
+    double sequentialWallSeconds;           // 未比较时为 0
+    double speedup;                         // 顺序耗时 / 分段并行耗时，未比较时为 0
+    double stitchedSnrDb;                   // 所有拼接区合计
+    int stitchedMaxAbsError;
+    std::vector<SegmentBoundaryReport> boundaries;
+};
+
+/**
+ * 多核离线批处理
+ *
+ * 每个工作线程持有自己的 APM (和可选的 DeepFilterStream)，文件之间只调用 Initialize() 重置状态，
+ * 输出通过各自的 AsyncFileWriter 写入，处理循环中没有任何共享锁。
+ * 任务按输入文件大小从大到小轮流分给各线程的队列，线程先从自己队列头部取，
+ * 取空后从其它线程队列尾部窃取，长文件先开始、短文件用来填平尾部。
+ *
+ * DeepFilterNet 的 C 接口没有重置函数，同一线程上 DF 的状态会延续到下一个文件开头；
+ * 只有 48kHz 单声道的输入才经过 DF。分段模式只做 APM。
+ */
+class BatchProcessor {
+public:
+    // 每完成一个文件调用一次，调用之间互斥
+    using ProgressFn = std::function<void(const BatchFileReport& report, size_t done, size_t total)>;
+
+    explicit BatchProcessor(const BatchOptions& options) : options(options) {}
+
+    BatchSummary run(const std::vector<BatchJob>& jobs, const ProgressFn& progress = nullptr);
+
+    /**
+     * 把一个长文件切成若干段，在各自的 APM 上并行处理后拼接
+     *
+     * 第 k 段从输出起点之前 warmupSeconds 开始处理，预热区的输出丢弃，只保留末尾 crossfadeMs
+     * 与上一段的结尾交叉淡化。输出文件先按最终长度建好并映射，各段直接写入自己的区域，
+     * 只支持 WAV 和裸 PCM 输出。
+     */
+    SegmentReport runSegmented(const BatchJob& job, const SegmentOptions& segment);
+
+private:
+    // 顺序处理同一个文件，与已经拼接好的输出逐采样比较
+    void compareSegmented(const BatchJob& job, const SegmentOptions& segment, const WavFormat& format,
+                          uint64_t blocks, uint64_t segmentBlocks, size_t fade, const int16_t* out,
+                          SegmentReport& report);
+
+    BatchOptions options;
+};
+
+#endif //AAUDIORECORDER_BATCHPROCESSOR_H
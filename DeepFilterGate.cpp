@@ -0,0 +1,108 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include "DeepFilterGate.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#define DEEP_FILTER_GATE_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#define DEEP_FILTER_GATE_NEON 1
+#include <arm_neon.h>
+#endif
+
+float sumOfSquares(const float* x, size_t n) {
+    size_t i = 0;
+    float sum = 0.f;
+#if defined(DEEP_FILTER_GATE_SSE2)
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (; i + 8 <= n; i += 8) {
+        __m128 a = _mm_loadu_ps(x + i);
+        __m128 b = _mm_loadu_ps(x + i + 4);
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(a, a));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(b, b));
+    }
+    acc0 = _mm_add_ps(acc0, acc1);
+    acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+    acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+    sum = _mm_cvtss_f32(acc0);
+#elif defined(DEEP_FILTER_GATE_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.f);
+    float32x4_t acc1 = vdupq_n_f32(0.f);
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t a = vld1q_f32(x + i);
+        float32x4_t b = vld1q_f32(x + i + 4);
+        acc0 = vmlaq_f32(acc0, a, a);
+        acc1 = vmlaq_f32(acc1, b, b);
+    }
+    acc0 = vaddq_f32(acc0, acc1);
+    float32x2_t half = vadd_f32(vget_low_f32(acc0), vget_high_f32(acc0));
+    sum = vget_lane_f32(vpadd_f32(half, half), 0);
+#endif
+    for (; i < n; ++i) {
+        sum += x[i] * x[i];
+    }
+    return sum;
+}
+
+void DeepFilterGate::reset() {
+    state = State::Active;
+    eligibleRun = 0;
+    warmupLeft = 0;
+    level = kMinDbfs;
+    floor = 0.f;
+}
+
+DeepFilterGate::Decision DeepFilterGate::update(const float* hop, size_t n, float lastSnrDb,
+                                                bool gating, bool allowModel) {
+    float meanSquare = n > 0 ? sumOfSquares(hop, n) / static_cast<float>(n) : 0.f;
+    level = std::max(kMinDbfs, 10.f * std::log10(meanSquare + 1e-10f));
+    floor = level < floor ? level : std::min(level, floor + kFloorRiseDb);
+
+    bool speech = level > floor + kSpeechMarginDb;
+    bool quiet = !speech && level < kQuietDbfs;
+    bool clean = state == State::Active ? lastSnrDb > kCleanSnrDb : speech && level - floor > kCleanSnrDb;
+    bool eligible = gating && (quiet || clean);
+    float gain = quiet ? silenceGain : 1.f;
+
+    if (!allowModel) {
+        // 正在输出模型结果时再跑一个 hop 淡出，之后才完全跳过模型
+        bool fadeOut = state == State::Active;
+        state = State::Bypass;
+        eligibleRun = 0;
+        return fadeOut ? Decision{true, Output::FadeToBypass, 1.f} : Decision{false, Output::Bypass, 1.f};
+    }
+
+    switch (state) {
+        case State::Active:
+            if (!eligible) {
+                eligibleRun = 0;
+            } else if (++eligibleRun >= kHangoverHops) {
+                state = State::Bypass;
+                eligibleRun = 0;
+                return {true, Output::FadeToBypass, gain};
+            }
+            return {true, Output::Model, gain};
+
+        case State::Bypass:
+            if (eligible) {
+                return {false, Output::Bypass, gain};
+            }
+            state = State::Resuming;
+            warmupLeft = warmupHops;
+            [[fallthrough]];
+
+        case State::Resuming:
+            if (--warmupLeft > 0) {
+                return {true, Output::Bypass, gain};
+            }
+            state = State::Active;
+            return {true, Output::FadeToModel, gain};
+    }
+    return {true, Output::Model, gain};
+}
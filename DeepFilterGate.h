@@ -0,0 +1,71 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_DEEPFILTERGATE_H
+#define AAUDIORECORDER_DEEPFILTERGATE_H
+
+#include <cstddef>
+
+// 平方和，SSE2 / NEON 每次处理 4 个采样
+float sumOfSquares(const float* x, size_t n);
+
+/**
+ * 逐 hop 决定是否运行 DeepFilterNet 模型
+ *
+ * 输入是 APM 的输出，用三种信息判断模型是否有必要:
+ *   - 能量 VAD: 电平相对噪声底 (快降慢升的最小值跟踪) 高出 kSpeechMarginDb 视为语音
+ *   - 电平: 非语音且低于 kQuietDbfs 的静音段，用固定衰减代替模型
+ *   - SNR: 模型运行时 df_process_frame 返回的局部 SNR 超过 kCleanSnrDb (与 df_process_frame_raw
+ *     不再输出增益的门限一致)，或者跳过时电平高出噪声底 kCleanSnrDb 的干净语音，直接透传
+ *
+ * 满足跳过条件连续 kHangoverHops 个 hop 后才切到旁路；条件消失时先让模型空跑 warmupHops 个 hop
+ * (模型内部的分析窗和 RNN 状态需要新数据)，再切回模型。切换的那个 hop 两条路径都计算并交叉淡化，
+ * 旁路的增益变化也在一个 hop 内线性过渡。
+ */
+class DeepFilterGate {
+public:
+    static constexpr float kSpeechMarginDb = 9.f;
+    static constexpr float kQuietDbfs = -45.f;
+    static constexpr float kCleanSnrDb = 30.f;
+    static constexpr int kHangoverHops = 30;
+    static constexpr float kFloorRiseDb = 0.05f;        // 每个 hop 噪声底最多上升的量
+    static constexpr float kMinDbfs = -100.f;
+
+    enum class Output { Model, Bypass, FadeToModel, FadeToBypass };
+
+    struct Decision {
+        bool runModel;
+        Output output;
+        float bypassGain;
+    };
+
+    explicit DeepFilterGate(int warmupHops = 2) : warmupHops(warmupHops) {}
+
+    void setWarmupHops(int hops) { warmupHops = hops; }
+    void setSilenceGain(float gain) { silenceGain = gain; }
+    void reset();
+
+    /**
+     * \param gating       false 时只在 allowModel 为 false 时跳过
+     * \param allowModel   false 时不等 hangover 切到增益为 1 的旁路 (挂起、降级、流水线追赶)；
+     *                     当时输出的是模型结果时，这个 hop 仍然运行模型并 FadeToBypass
+     */
+    Decision update(const float* hop, size_t n, float lastSnrDb, bool gating, bool allowModel);
+
+    float levelDbfs() const { return level; }
+    float noiseFloorDbfs() const { return floor; }
+
+private:
+    enum class State { Active, Bypass, Resuming };
+
+    int warmupHops;
+    float silenceGain = 0.1f;
+    State state = State::Active;
+    int eligibleRun = 0;
+    int warmupLeft = 0;
+    float level = kMinDbfs;
+    float floor = 0.f;
+};
+
+#endif //AAUDIORECORDER_DEEPFILTERGATE_H
@@ -0,0 +1,263 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include "DeepFilterModels.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "RecorderLog.h"
+#include "df.h"
+
+namespace {
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+constexpr uint64_t kFnvOffset = 14695981039346656037ull;
+constexpr uint64_t kFnvPrime = 1099511628211ull;
+
+} // namespace
+
+DeepFilterModelManager::DeepFilterModelManager() {
+    worker = std::thread(&DeepFilterModelManager::run, this);
+}
+
+DeepFilterModelManager::~DeepFilterModelManager() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    for (auto& item : models) {
+        Model& model = item.second;
+        LOGI("DeepFilterNet model %s: %llu cache hits, %llu misses", model.path.c_str(),
+             (unsigned long long) model.hits, (unsigned long long) model.misses);
+        for (DFState* state : model.ready) {
+            df_free(state);
+        }
+    }
+}
+
+bool DeepFilterModelManager::fileId(const char* path, FileId& out) {
+    struct stat st{};
+    if (stat(path, &st) != 0) return false;
+    out.size = st.st_size;
+    out.mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+
+bool DeepFilterModelManager::hashFile(const char* path, uint64_t& out) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOGE("open %s failed: %s", path, strerror(errno));
+        return false;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    auto size = static_cast<size_t>(st.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        LOGE("mmap %s failed: %s", path, strerror(errno));
+        return false;
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    uint64_t hash = kFnvOffset;
+    const auto* bytes = static_cast<const uint8_t*>(mapped);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * kFnvPrime;
+    }
+    munmap(mapped, size);
+    out = hash;
+    return true;
+}
+
+DeepFilterModelManager::Model* DeepFilterModelManager::findModel(const std::string& path, const FileId& id) {
+    auto entry = paths.find(path);
+    if (entry == paths.end() || !entry->second.hashed || !(entry->second.id == id)) return nullptr;
+    auto model = models.find(entry->second.hash);
+    return model != models.end() ? &model->second : nullptr;
+}
+
+void DeepFilterModelManager::preload(const char* path, size_t count) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        PathEntry& entry = paths[path];
+        entry.target = std::max(entry.target, count);
+        if (std::find(pending.begin(), pending.end(), path) == pending.end()) {
+            pending.emplace_back(path);
+        }
+    }
+    cv.notify_one();
+}
+
+DFState* DeepFilterModelManager::acquire(const char* path, float attenLimDb) {
+    int64_t begin = nowNs();
+    FileId id{};
+    if (!fileId(path, id)) {
+        LOGE("DeepFilterNet model %s not found", path);
+        return nullptr;
+    }
+
+    DFState* state = nullptr;
+    Timing timing{};
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        PathEntry& entry = paths[path];
+        entry.target = std::max<size_t>(entry.target, 1);
+        Model* model = findModel(path, id);
+        if (model != nullptr && !model->ready.empty()) {
+            state = model->ready.back();
+            model->ready.pop_back();
+            ++model->hits;
+            model->timing.cachedFirstFrameMs = (nowNs() - begin) / 1e6 + model->timing.warmFrameMs;
+            timing = model->timing;
+        } else if (model != nullptr) {
+            ++model->misses;
+        }
+        // 补上取走的一个，或者继续还没完成的加载
+        if (std::find(pending.begin(), pending.end(), path) == pending.end()) {
+            pending.emplace_back(path);
+        }
+    }
+    cv.notify_one();
+
+    if (state == nullptr) {
+        LOGE("DeepFilterNet model %s is not ready yet, loading in background", path);
+        return nullptr;
+    }
+    df_set_atten_lim(state, attenLimDb);
+    LOGI("DeepFilterNet model %s from cache: first frame after %.2f ms (cold path %.1f ms)",
+         path, timing.cachedFirstFrameMs, timing.coldFirstFrameMs);
+    return state;
+}
+
+bool DeepFilterModelManager::waitReady(const char* path, int timeoutMs) {
+    FileId id{};
+    if (!fileId(path, id)) return false;
+    preload(path, 1);
+    std::unique_lock<std::mutex> lock(mutex);
+    return readyCv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&] {
+        Model* model = findModel(path, id);
+        return stopping || (model != nullptr && !model->ready.empty());
+    }) && !stopping;
+}
+
+bool DeepFilterModelManager::timing(const char* path, Timing& out) {
+    FileId id{};
+    if (!fileId(path, id)) return false;
+    std::lock_guard<std::mutex> lock(mutex);
+    Model* model = findModel(path, id);
+    if (model == nullptr || model->timing.createMs == 0.0) return false;
+    out = model->timing;
+    return true;
+}
+
+void DeepFilterModelManager::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (stopping) break;
+        std::string path = std::move(pending.front());
+        pending.pop_front();
+        lock.unlock();
+        load(path);
+        lock.lock();
+    }
+}
+
+void DeepFilterModelManager::load(const std::string& path) {
+    FileId id{};
+    if (!fileId(path.c_str(), id)) {
+        LOGE("DeepFilterNet model %s not found", path.c_str());
+        return;
+    }
+
+    // 文件没变时沿用上次的哈希
+    uint64_t hash = 0;
+    bool known = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        PathEntry& entry = paths[path];
+        if (entry.hashed && entry.id == id) {
+            hash = entry.hash;
+            known = true;
+        }
+    }
+    double hashMs = 0.0;
+    if (!known) {
+        int64_t begin = nowNs();
+        if (!hashFile(path.c_str(), hash)) return;
+        hashMs = (nowNs() - begin) / 1e6;
+        std::lock_guard<std::mutex> lock(mutex);
+        PathEntry& entry = paths[path];
+        entry.id = id;
+        entry.hash = hash;
+        entry.hashed = true;
+        Model& model = models[hash];
+        if (model.path.empty()) model.path = path;
+        model.timing.hashMs = hashMs;
+    }
+
+    std::vector<float> in;
+    std::vector<float> out;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping || models[hash].ready.size() >= paths[path].target) return;
+        }
+
+        int64_t begin = nowNs();
+        DFState* state = df_create(path.c_str(), 100.f, "warn");
+        int64_t created = nowNs();
+        if (state == nullptr) {
+            LOGE("df_create failed for %s", path.c_str());
+            return;
+        }
+
+        // 静音预热，第一帧是冷启动的首帧耗时，最后一帧代表预热后的耗时
+        const size_t hop = df_get_frame_length(state);
+        in.assign(hop, 0.f);
+        out.resize(hop);
+        double coldFrameMs = 0.0;
+        double warmFrameMs = 0.0;
+        for (size_t i = 0; i < kWarmupFrames; ++i) {
+            int64_t frameBegin = nowNs();
+            df_process_frame(state, in.data(), out.data());
+            double ms = (nowNs() - frameBegin) / 1e6;
+            if (i == 0) coldFrameMs = ms;
+            warmFrameMs = ms;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        Model& model = models[hash];
+        model.ready.push_back(state);
+        model.timing.createMs = (created - begin) / 1e6;
+        model.timing.coldFrameMs = coldFrameMs;
+        model.timing.warmFrameMs = warmFrameMs;
+        model.timing.coldFirstFrameMs = model.timing.createMs + coldFrameMs;
+        LOGI("DeepFilterNet model %s (%016llx) ready: hash %.1f ms, df_create %.1f ms, "
+             "first frame %.2f ms cold / %.2f ms warm, cold time to first frame %.1f ms",
+             path.c_str(), (unsigned long long) hash, model.timing.hashMs, model.timing.createMs,
+             coldFrameMs, warmFrameMs, model.timing.coldFirstFrameMs);
+        readyCv.notify_all();
+    }
+}
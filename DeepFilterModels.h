@@ -0,0 +1,106 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_DEEPFILTERMODELS_H
+#define AAUDIORECORDER_DEEPFILTERMODELS_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct DFState;
+
+/**
+ * DeepFilterNet 模型的后台加载和缓存
+ *
+ * df_create 要在调用线程上解压 tar.gz、解析并优化 ONNX，刚创建的状态前几帧也明显偏慢。
+ * 应用启动时调用 preload()，后台线程完成 df_create 并送入 kWarmupFrames 帧静音预热，
+ * 就绪的 DFState 按模型文件内容的 64 位 FNV-1a 哈希缓存：不同路径下的同一模型共用一份，
+ * 同一路径的文件被替换 (大小或修改时间变化) 后重新计算哈希。
+ *
+ * acquire() 只做一次 stat 和加锁取出，不会等待加载；取走一个后后台立即补上，下一次 start() 同样不等待。
+ * df.h 只接受 tar.gz 路径，解压后的模型无法直接交给 df_create，所以缓存的是就绪的状态而不是解压结果。
+ *
+ * 每次加载记录冷启动路径的首帧时间 (df_create + 第一帧)，每次取用记录缓存路径的首帧时间
+ * (取出 + 预热后的一帧)，都输出到日志。
+ */
+class DeepFilterModelManager {
+public:
+    static constexpr size_t kWarmupFrames = 10;
+
+    DeepFilterModelManager();
+    ~DeepFilterModelManager();
+
+    DeepFilterModelManager(const DeepFilterModelManager&) = delete;
+    DeepFilterModelManager& operator=(const DeepFilterModelManager&) = delete;
+
+    // 后台加载，之后始终保持 count 个就绪的状态
+    void preload(const char* path, size_t count = 1);
+
+    // 非阻塞，返回的状态归调用方所有 (df_free)；尚未就绪时返回空并在后台继续加载
+    DFState* acquire(const char* path, float attenLimDb);
+
+    // 等待 path 至少有一个就绪的状态，超时返回 false
+    bool waitReady(const char* path, int timeoutMs);
+
+    struct Timing {
+        double hashMs;
+        double createMs;            // df_create
+        double coldFrameMs;         // 新状态的第一帧
+        double warmFrameMs;         // 预热最后一帧
+        double coldFirstFrameMs;    // createMs + coldFrameMs，没有缓存时 start() 到第一帧输出的代价
+        double cachedFirstFrameMs;  // 最近一次 acquire 的耗时 + warmFrameMs
+    };
+    // 没有加载过时返回 false
+    bool timing(const char* path, Timing& out);
+
+private:
+    struct FileId {
+        int64_t size;
+        int64_t mtimeNs;
+        bool operator==(const FileId& other) const { return size == other.size && mtimeNs == other.mtimeNs; }
+    };
+
+    struct PathEntry {
+        FileId id{-1, 0};
+        uint64_t hash = 0;
+        bool hashed = false;
+        size_t target = 0;
+    };
+
+    struct Model {
+        std::string path;
+        std::vector<DFState*> ready;
+        Timing timing{};
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    void run();
+    void load(const std::string& path);
+    // 调用时持有 mutex；文件不存在或尚未计算哈希时返回空
+    Model* findModel(const std::string& path, const FileId& id);
+
+    static bool fileId(const char* path, FileId& out);
+    static bool hashFile(const char* path, uint64_t& out);
+
+    std::map<std::string, PathEntry> paths;
+    std::unordered_map<uint64_t, Model> models;
+    std::deque<std::string> pending;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable cv;         // 有新任务或停止
+    std::condition_variable readyCv;    // 有新的就绪状态
+    bool stopping = false;
+};
+
+#endif //AAUDIORECORDER_DEEPFILTERMODELS_H
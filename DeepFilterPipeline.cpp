@@ -0,0 +1,147 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include "DeepFilterPipeline.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "PcmConvert.h"
+#include "RecorderLog.h"
+
+namespace {
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+constexpr int kWaitTimeoutMs = 100;
+
+} // namespace
+
+bool DeepFilterPipeline::start(std::unique_ptr<DeepFilterStream> df, const char* outputPath,
+                               const WavFormat& format, size_t frames, size_t depthFrames) {
+    stop();
+    if (!df || format.sampleRate != DeepFilterStream::kSampleRate || format.channels != 1) {
+        LOGE("DeepFilterNet pipeline needs a model and %d Hz mono", DeepFilterStream::kSampleRate);
+        return false;
+    }
+    if (!sink.openByExtension(outputPath, format)) {
+        return false;
+    }
+
+    stream = std::move(df);
+    frameSize = frames;
+    depth = std::max<size_t>(1, std::min(depthFrames, kQueueSamples / frameSize - 1));
+    stream->configure(frameSize);
+    applySettings();
+    pcm.resize(frameSize);
+    block.resize(frameSize);
+    queue.reset();
+
+    busyNsTotal = 0;
+    framesProcessed = 0;
+    framesSkipped = 0;
+    framesDropped = 0;
+    maxBacklog = 0;
+    startedNs = nowNs();
+
+    running = true;
+    worker = std::thread(&DeepFilterPipeline::run, this);
+    LOGI("DeepFilterNet pipeline started: added latency %zu frames (%zu ms) + %zu samples rebuffer",
+         depth, depth * 1000 * frameSize / format.sampleRate, stream->latencySamples());
+    return true;
+}
+
+void DeepFilterPipeline::stop() {
+    if (!running.exchange(false)) return;
+    signal.wakeAll();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    sink.close();
+    writer.stop();
+
+    double wall = static_cast<double>(nowNs() - startedNs);
+    LOGI("DeepFilterNet stage: %llu frames, %llu skipped, %llu dropped, max backlog %zu frames, %.0f%% busy",
+         (unsigned long long) framesProcessed.load(), (unsigned long long) framesSkipped.load(),
+         (unsigned long long) framesDropped.load(), maxBacklog,
+         wall > 0 ? 100.0 * busyNsTotal.load() / wall : 0.0);
+    stream.reset();
+}
+
+void DeepFilterPipeline::applySettings() {
+    appliedVersion = settingsVersion.load(std::memory_order_acquire);
+    float db = attenLimDb.load(std::memory_order_relaxed);
+    if (!std::isnan(db)) stream->setAttenLimDb(db);
+    float beta = postFilterBeta.load(std::memory_order_relaxed);
+    if (!std::isnan(beta)) stream->setPostFilterBeta(beta);
+    stream->setGating(gating.load(std::memory_order_relaxed));
+    stream->setSuspended(suspended.load(std::memory_order_relaxed) || governorOff.load(std::memory_order_relaxed));
+}
+
+void DeepFilterPipeline::push(const int16_t* frame) {
+    if (queue.freeFrames() < frameSize) {
+        framesDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    queue.write(frame, frameSize);
+    signal.publish(queue.availableFrames(), frameSize);
+}
+
+void DeepFilterPipeline::run() {
+    uint64_t windowFrames = 0;
+    uint64_t windowSkipped = 0;
+    int64_t windowBusy = 0;
+    int64_t windowStart = nowNs();
+
+    while (true) {
+        signal.wait([&] {
+            return !running.load(std::memory_order_relaxed) || queue.availableFrames() >= frameSize;
+        }, kWaitTimeoutMs);
+
+        size_t backlog = queue.availableFrames() / frameSize;
+        if (backlog == 0) {
+            if (!running.load(std::memory_order_relaxed)) break;
+            continue;
+        }
+        maxBacklog = std::max(maxBacklog, backlog);
+
+        int64_t begin = nowNs();
+        if (settingsVersion.load(std::memory_order_relaxed) != appliedVersion) applySettings();
+        queue.read(pcm.data(), frameSize);
+        convertS16ToFloat(pcm.data(), block.data(), frameSize);
+
+        // 积压超过固定延迟时只过 FIFO，让 DF 线程追上
+        if (backlog > depth) {
+            stream->passThrough(block.data());
+            framesSkipped.fetch_add(1, std::memory_order_relaxed);
+            ++windowSkipped;
+        } else {
+            stream->process(block.data());
+        }
+
+        convertFloatToS16(block.data(), pcm.data(), frameSize);
+        sink.write(reinterpret_cast<const char*>(pcm.data()), frameSize * sizeof(int16_t));
+
+        int64_t elapsed = nowNs() - begin;
+        busyNsTotal.fetch_add(elapsed, std::memory_order_relaxed);
+        framesProcessed.fetch_add(1, std::memory_order_relaxed);
+        windowBusy += elapsed;
+
+        if (++windowFrames == kReportFrames) {
+            int64_t now = nowNs();
+            double busy = static_cast<double>(windowBusy) / static_cast<double>(now - windowStart);
+            if (busy > kBottleneckBusy || windowSkipped > 0) {
+                LOGE("DeepFilterNet stage is the bottleneck: %.0f%% busy, %llu of %llu frames skipped",
+                     100.0 * busy, (unsigned long long) windowSkipped, (unsigned long long) windowFrames);
+            }
+            windowFrames = 0;
+            windowSkipped = 0;
+            windowBusy = 0;
+            windowStart = now;
+        }
+    }
+}
@@ -0,0 +1,111 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_DEEPFILTERPIPELINE_H
+#define AAUDIORECORDER_DEEPFILTERPIPELINE_H
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "AsyncFileSink.h"
+#include "DeepFilterStream.h"
+#include "FrameSignal.h"
+#include "SpscFrameRing.h"
+#include "WavFormat.h"
+
+/**
+ * APM -> DeepFilterNet 的两级流水线
+ *
+ * 处理线程做完 APM 后把 10ms 帧写入无锁 SPSC 队列，DF 线程取出后调用 df_process_frame 并写入
+ * 输出文件 (自己的 AsyncFileWriter，写入线程仍然只有一个生产者)。两级在不同核心上并行，
+ * 处理线程上每帧的开销只剩 APM 和一次拷贝。
+ *
+ * 附加延迟固定为 depthFrames 帧: DF 线程积压超过 depthFrames 帧时，多出来的帧只经过 FIFO
+ * 不跑模型 (passThrough)，输出样本的对齐关系不变，积压永远不会超过这个上限。
+ * 每 kReportFrames 帧检查一次 DF 线程的占用率，超过 kBottleneckBusy 或发生跳帧时报告 DF 成为瓶颈。
+ */
+class DeepFilterPipeline {
+public:
+    static constexpr size_t kQueueSamples = 8192;           // 48kHz 下约 17 帧
+    static constexpr size_t kReportFrames = 500;            // 5 秒
+    static constexpr double kBottleneckBusy = 0.9;
+
+    DeepFilterPipeline() = default;
+    ~DeepFilterPipeline() { stop(); }
+
+    DeepFilterPipeline(const DeepFilterPipeline&) = delete;
+    DeepFilterPipeline& operator=(const DeepFilterPipeline&) = delete;
+
+    /**
+     * 接管 df，打开输出文件并启动 DF 线程
+     * \param frameSize     每帧采样数 (单声道)
+     * \param depthFrames   DF 线程允许落后的帧数，即固定的附加延迟
+     */
+    bool start(std::unique_ptr<DeepFilterStream> df, const char* outputPath, const WavFormat& format,
+               size_t frameSize, size_t depthFrames);
+
+    // 处理完队列中剩余的帧后停止，关闭输出文件并输出统计
+    void stop();
+
+    bool isRunning() const { return running.load(std::memory_order_relaxed); }
+
+    // 处理线程调用，只拷贝一帧，不等待
+    void push(const int16_t* frame);
+
+    // 任意线程调用，包括停止期间：参数保存在这里，由 DF 线程在下一帧之前交给 stream，
+    // 之后每次 start() 都会重新应用到新的 stream 上
+    void setAttenLimDb(float db) { attenLimDb.store(db, std::memory_order_relaxed); touchSettings(); }
+    void setPostFilterBeta(float beta) { postFilterBeta.store(beta, std::memory_order_relaxed); touchSettings(); }
+    void setGating(bool enable) { gating.store(enable, std::memory_order_relaxed); touchSettings(); }
+    void setSuspended(bool suspend) { suspended.store(suspend, std::memory_order_relaxed); touchSettings(); }
+    // QualityGovernor 的旁路，和 setSuspended 相互独立，任一个为 true 时走旁路
+    void setGovernorOff(bool off) { governorOff.store(off, std::memory_order_relaxed); touchSettings(); }
+
+    size_t latencyFrames() const { return depth; }
+    uint64_t busyNs() const { return busyNsTotal.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    void touchSettings() { settingsVersion.fetch_add(1, std::memory_order_release); }
+    // 只在 DF 线程或 DF 线程启动之前调用
+    void applySettings();
+
+    std::unique_ptr<DeepFilterStream> stream;
+    AsyncFileWriter writer;
+    AsyncFileSink sink{writer};
+    SpscFrameRing<int16_t, 1, kQueueSamples> queue;
+    FrameSignal signal;
+    std::thread worker;
+    std::atomic<bool> running{false};
+
+    size_t frameSize = 0;
+    size_t depth = 0;
+    int64_t startedNs = 0;
+
+    // DF 线程使用
+    std::vector<int16_t> pcm;
+    std::vector<float> block;
+
+    // 没有设置过的衰减上限和后置滤波参数为 NAN，保留 stream 创建时的值
+    std::atomic<float> attenLimDb{NAN};
+    std::atomic<float> postFilterBeta{NAN};
+    std::atomic<bool> gating{false};
+    std::atomic<bool> suspended{false};
+    std::atomic<bool> governorOff{false};
+    std::atomic<uint64_t> settingsVersion{0};
+    uint64_t appliedVersion = 0;
+
+    std::atomic<uint64_t> busyNsTotal{0};
+    std::atomic<uint64_t> framesProcessed{0};
+    std::atomic<uint64_t> framesSkipped{0};
+    std::atomic<uint64_t> framesDropped{0};    // 队列满时处理线程丢弃的帧
+    size_t maxBacklog = 0;
+};
+
+#endif //AAUDIORECORDER_DEEPFILTERPIPELINE_H
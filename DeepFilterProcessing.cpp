@@ -0,0 +1,43 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include "DeepFilterProcessing.h"
+
+#include <cstdio>
+
+#include "ApmAudioBuffer.h"
+#include "RecorderLog.h"
+
+void DeepFilterProcessing::Initialize(int sample_rate_hz, int num_channels) {
+    active = sample_rate_hz == DeepFilterStream::kSampleRate && num_channels == 1;
+    if (!active) {
+        LOGE("DeepFilterNet needs %d Hz mono, got %d Hz / %d channels, bypassed",
+             DeepFilterStream::kSampleRate, sample_rate_hz, num_channels);
+        return;
+    }
+
+    // 所有缓冲在这里分配，Process 中不再分配
+    config = webrtc::StreamConfig(sample_rate_hz, num_channels);
+    block.resize(config.num_frames());
+    stream->configure(config.num_frames());
+    LOGI("DeepFilterNet post-processing: hop %zu, block %zu, rebuffer latency %zu samples",
+         stream->hop(), config.num_frames(), stream->latencySamples());
+}
+
+void DeepFilterProcessing::Process(webrtc::AudioBuffer* audio) {
+    if (!active) return;
+
+    float* channels[1] = {block.data()};
+    apm_audio_buffer_copy_to(audio, &config, channels);
+    stream->process(block.data());
+    const float* const processed[1] = {block.data()};
+    apm_audio_buffer_copy_from(audio, processed, &config);
+}
+
+std::string DeepFilterProcessing::ToString() const {
+    char text[128];
+    snprintf(text, sizeof(text), "DeepFilterNet(hop=%zu, latency=%zu, snr=%.1f dB%s)",
+             stream->hop(), stream->latencySamples(), stream->lastSnrDb(), active ? "" : ", bypassed");
+    return text;
+}
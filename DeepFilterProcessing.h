@@ -0,0 +1,47 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_DEEPFILTERPROCESSING_H
+#define AAUDIORECORDER_DEEPFILTERPROCESSING_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "modules/audio_processing/include/audio_processing.h"
+
+#include "DeepFilterStream.h"
+
+/**
+ * 把 DeepFilterNet 作为 APM 采集链路的最后一级 (AudioProcessingBuilder::SetCapturePostProcessing)
+ *
+ * APM 每次给出 10ms 的 AudioBuffer，由 DeepFilterStream 重新分块到 df_get_frame_length()。
+ * DF 只支持 48kHz 单声道，其它配置下直接透传。
+ */
+class DeepFilterProcessing : public webrtc::CustomProcessing {
+public:
+    explicit DeepFilterProcessing(std::unique_ptr<DeepFilterStream> stream) : stream(std::move(stream)) {}
+
+    void Initialize(int sample_rate_hz, int num_channels) override;
+    void Process(webrtc::AudioBuffer* audio) override;
+    std::string ToString() const override;
+
+    // APM 不会把采集侧的 RuntimeSetting 转发给后处理模块，DF 的参数只能通过下面的 setter 修改。
+    // 任意线程调用，下一帧生效
+    void setAttenLimDb(float db) { stream->setAttenLimDb(db); }
+    void setPostFilterBeta(float beta) { stream->setPostFilterBeta(beta); }
+    void setGating(bool enable) { stream->setGating(enable); }
+    void setSuspended(bool suspend) { stream->setSuspended(suspend); }
+
+    size_t latencySamples() const { return stream->latencySamples(); }
+    float lastSnrDb() const { return stream->lastSnrDb(); }
+
+private:
+    std::unique_ptr<DeepFilterStream> stream;
+    bool active = false;                // 48kHz 单声道时为 true
+    webrtc::StreamConfig config;
+    std::vector<float> block;           // APM 一帧，float [-1, 1]
+};
+
+#endif //AAUDIORECORDER_DEEPFILTERPROCESSING_H
@@ -0,0 +1,313 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include "DeepFilterSpectral.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "RecorderLog.h"
+#include "df.h"
+
+#if defined(__SSE2__)
+#define DEEP_FILTER_SPECTRAL_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#define DEEP_FILTER_SPECTRAL_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+using cpx = std::complex<float>;
+
+// out = a * b
+void multiply(const float* a, const float* b, float* out, size_t n) {
+    size_t i = 0;
+#if defined(DEEP_FILTER_SPECTRAL_SSE2)
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+#elif defined(DEEP_FILTER_SPECTRAL_NEON)
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(out + i, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = a[i] * b[i];
+    }
+}
+
+// out = a + b
+void add(const float* a, const float* b, float* out, size_t n) {
+    size_t i = 0;
+#if defined(DEEP_FILTER_SPECTRAL_SSE2)
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+#elif defined(DEEP_FILTER_SPECTRAL_NEON)
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(out + i, vaddq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+// x *= gain
+void scale(float* x, size_t n, float gain) {
+    size_t i = 0;
+#if defined(DEEP_FILTER_SPECTRAL_SSE2)
+    const __m128 g = _mm_set1_ps(gain);
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(x + i, _mm_mul_ps(_mm_loadu_ps(x + i), g));
+    }
+#elif defined(DEEP_FILTER_SPECTRAL_NEON)
+    const float32x4_t g = vdupq_n_f32(gain);
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(x + i, vmulq_f32(vld1q_f32(x + i), g));
+    }
+#endif
+    for (; i < n; ++i) {
+        x[i] *= gain;
+    }
+}
+
+// acc += a * b (复数)
+void complexMultiplyAccumulate(const cpx* a, const cpx* b, cpx* acc, size_t n) {
+    size_t i = 0;
+#if defined(DEEP_FILTER_SPECTRAL_SSE2)
+    const __m128 sign = _mm_set_ps(1.f, -1.f, 1.f, -1.f);
+    for (; i + 2 <= n; i += 2) {
+        __m128 x = _mm_loadu_ps(reinterpret_cast<const float*>(a + i));       // ar0 ai0 ar1 ai1
+        __m128 y = _mm_loadu_ps(reinterpret_cast<const float*>(b + i));
+        __m128 yRe = _mm_shuffle_ps(y, y, _MM_SHUFFLE(2, 2, 0, 0));
+        __m128 yIm = _mm_shuffle_ps(y, y, _MM_SHUFFLE(3, 3, 1, 1));
+        __m128 xSwap = _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1));         // ai0 ar0 ai1 ar1
+        __m128 prod = _mm_add_ps(_mm_mul_ps(x, yRe), _mm_mul_ps(_mm_mul_ps(xSwap, yIm), sign));
+        float* o = reinterpret_cast<float*>(acc + i);
+        _mm_storeu_ps(o, _mm_add_ps(_mm_loadu_ps(o), prod));
+    }
+#elif defined(DEEP_FILTER_SPECTRAL_NEON)
+    for (; i + 4 <= n; i += 4) {
+        float32x4x2_t x = vld2q_f32(reinterpret_cast<const float*>(a + i));
+        float32x4x2_t y = vld2q_f32(reinterpret_cast<const float*>(b + i));
+        float* o = reinterpret_cast<float*>(acc + i);
+        float32x4x2_t r = vld2q_f32(o);
+        r.val[0] = vmlaq_f32(r.val[0], x.val[0], y.val[0]);
+        r.val[0] = vmlsq_f32(r.val[0], x.val[1], y.val[1]);
+        r.val[1] = vmlaq_f32(r.val[1], x.val[0], y.val[1]);
+        r.val[1] = vmlaq_f32(r.val[1], x.val[1], y.val[0]);
+        vst2q_f32(o, r);
+    }
+#endif
+    for (; i < n; ++i) {
+        acc[i] += a[i] * b[i];
+    }
+}
+
+float freqToErb(float hz) {
+    return 9.265f * std::log1p(hz / (24.7f * 9.265f));
+}
+
+float erbToFreq(float erb) {
+    return 24.7f * 9.265f * (std::exp(erb / 9.265f) - 1.f);
+}
+
+} // namespace
+
+std::vector<size_t> DeepFilterSpectral::erbBandWidths(int sampleRate, size_t fftSize, size_t nbErb,
+                                                      size_t minNbFreqs) {
+    const float freqWidth = static_cast<float>(sampleRate) / static_cast<float>(fftSize);
+    const float erbLow = freqToErb(0.f);
+    const float erbHigh = freqToErb(static_cast<float>(sampleRate / 2));
+    const float step = (erbHigh - erbLow) / static_cast<float>(nbErb);
+
+    std::vector<size_t> widths(nbErb);
+    long prevFreq = 0;      // 上一个频带结束的频点
+    long freqOver = 0;      // 为满足最小宽度多分给前面频带的频点数
+    for (size_t i = 1; i <= nbErb; ++i) {
+        long fb = std::lround(erbToFreq(erbLow + static_cast<float>(i) * step) / freqWidth);
+        long count = fb - prevFreq - freqOver;
+        if (count < static_cast<long>(minNbFreqs)) {
+            freqOver = static_cast<long>(minNbFreqs) - count;
+            count = static_cast<long>(minNbFreqs);
+        } else {
+            freqOver = 0;
+        }
+        widths[i - 1] = static_cast<size_t>(count);
+        prevFreq = fb;
+    }
+
+    // 最后一个频带包含 Nyquist，多出来的频点从最后一个频带扣掉
+    widths[nbErb - 1] += 1;
+    size_t total = 0;
+    for (size_t w : widths) total += w;
+    if (total > fftSize / 2 + 1) {
+        widths[nbErb - 1] -= total - (fftSize / 2 + 1);
+    }
+    return widths;
+}
+
+DeepFilterSpectral::DeepFilterSpectral(DFState* state, const DeepFilterSpectralConfig& config)
+    : state(state), fftSize(config.fftSize), hopSize(config.hopSize), bins(config.fftSize / 2 + 1),
+      nbDf(std::min(config.nbDf, config.fftSize / 2 + 1)), dfOrder(config.dfOrder),
+      dfLookahead(std::min(config.dfLookahead, config.convLookahead)), convLookahead(config.convLookahead),
+      specFrames(std::max(convLookahead + 1, convLookahead - dfLookahead + dfOrder)),
+      fft(config.fftSize), window(config.fftSize), bypassWindow(config.fftSize),
+      erbWidths(erbBandWidths(config.sampleRate, config.fftSize, config.nbErb, config.minNbErbFreqs)),
+      wnorm(static_cast<float>(2 * config.hopSize) / static_cast<float>(config.fftSize * config.fftSize)),
+      timeHistory(convLookahead * config.hopSize + config.fftSize), frame(config.fftSize),
+      specHistory(specFrames * bins), rawInput(bins), spec(bins), synthesis(config.fftSize),
+      synthesisMem(config.fftSize - config.hopSize) {
+    // Vorbis 窗，w[n]² + w[n + fftSize/2]² = 1
+    const double half = static_cast<double>(fftSize / 2);
+    for (size_t i = 0; i < fftSize; ++i) {
+        double s = std::sin(0.5 * kPi * (static_cast<double>(i) + 0.5) / half);
+        window[i] = static_cast<float>(std::sin(0.5 * kPi * s * s));
+        bypassWindow[i] = window[i] * window[i] * wnorm * static_cast<float>(fftSize);
+    }
+}
+
+DeepFilterSpectral::~DeepFilterSpectral() {
+    if (frames > 0) {
+        LOGI("DeepFilterNet spectral: %llu frames, synthesis skipped on %.0f%%, deep filter on %.0f%%",
+             (unsigned long long) frames, 100.0 * bypassFrames / frames, 100.0 * dfFrames / frames);
+    }
+#if defined(DEEP_FILTER_SPECTRAL_VERIFY)
+    if (reference != nullptr) {
+        LOGI("DeepFilterNet spectral vs df_process_frame: SNR %.1f dB, max abs error %g",
+             10.0 * std::log10((referenceEnergy + 1e-20) / (errorEnergy + 1e-20)), maxAbsError);
+        df_free(reference);
+    }
+#endif
+}
+
+void DeepFilterSpectral::reset() {
+    std::fill(timeHistory.begin(), timeHistory.end(), 0.f);
+    std::fill(specHistory.begin(), specHistory.end(), cpx());
+    std::fill(synthesisMem.begin(), synthesisMem.end(), 0.f);
+    newest = 0;
+}
+
+void DeepFilterSpectral::setAttenLimDb(float db) {
+    // 与 libDF 相同，100 dB 及以上视为不限制
+    float lim = std::fabs(db);
+    attenLim = lim >= 100.f ? 0.f : std::pow(10.f, -lim / 20.f);
+#if defined(DEEP_FILTER_SPECTRAL_VERIFY)
+    if (reference != nullptr) df_set_atten_lim(reference, db);
+#endif
+}
+
+const std::complex<float>* DeepFilterSpectral::noisyFrame(size_t age) const {
+    return specHistory.data() + ((newest + specFrames - age) % specFrames) * bins;
+}
+
+float DeepFilterSpectral::process(const float* input, float* output) {
+    // 时域历史: 最新的 fftSize 个采样是本帧的分析窗，开头的 fftSize 个对应 convLookahead 帧之前的输出帧
+    std::memmove(timeHistory.data(), timeHistory.data() + hopSize, (timeHistory.size() - hopSize) * sizeof(float));
+    std::memcpy(timeHistory.data() + timeHistory.size() - hopSize, input, hopSize * sizeof(float));
+
+    multiply(timeHistory.data() + convLookahead * hopSize, window.data(), frame.data(), fftSize);
+    newest = (newest + 1) % specFrames;
+    cpx* noisy = specHistory.data() + newest * bins;
+    fft.forward(frame.data(), noisy);
+    scale(reinterpret_cast<float*>(noisy), 2 * bins, wnorm);
+
+    // 模型可能改写输入，送一份拷贝
+    std::copy(noisy, noisy + bins, rawInput.begin());
+    float* gains = nullptr;
+    float* coefs = nullptr;
+    float snr = df_process_frame_raw(state, reinterpret_cast<float*>(rawInput.data()), &gains, &coefs);
+    ++frames;
+
+    if (gains == nullptr && coefs == nullptr) {
+        // 频谱不变: 逆 FFT 再加窗等价于分析帧乘以 w²
+        multiply(timeHistory.data(), bypassWindow.data(), synthesis.data(), fftSize);
+        ++bypassFrames;
+    } else {
+        const cpx* target = noisyFrame(convLookahead);
+        std::copy(target, target + bins, spec.begin());
+        if (gains != nullptr) applyGains(spec.data(), gains);
+        if (coefs != nullptr) {
+            applyDeepFilter(spec.data(), coefs);
+            ++dfFrames;
+        }
+        if (postFilterBeta > 0.f) applyPostFilter(target, spec.data());
+        if (attenLim > 0.f) {
+            for (size_t k = 0; k < bins; ++k) {
+                spec[k] = spec[k] * (1.f - attenLim) + target[k] * attenLim;
+            }
+        }
+        fft.inverse(spec.data(), synthesis.data());
+        multiply(synthesis.data(), window.data(), synthesis.data(), fftSize);
+    }
+
+    // 重叠相加
+    const size_t memSize = synthesisMem.size();
+    add(synthesis.data(), synthesisMem.data(), output, hopSize);
+    const size_t split = memSize - hopSize;
+    std::memmove(synthesisMem.data(), synthesisMem.data() + hopSize, split * sizeof(float));
+    add(synthesisMem.data(), synthesis.data() + hopSize, synthesisMem.data(), split);
+    std::memcpy(synthesisMem.data() + split, synthesis.data() + hopSize + split, hopSize * sizeof(float));
+
+#if defined(DEEP_FILTER_SPECTRAL_VERIFY)
+    verify(input, output);
+#endif
+    return snr;
+}
+
+void DeepFilterSpectral::applyGains(cpx* out, const float* gains) const {
+    size_t begin = 0;
+    for (size_t b = 0; b < erbWidths.size(); ++b) {
+        scale(reinterpret_cast<float*>(out + begin), 2 * erbWidths[b], gains[b]);
+        begin += erbWidths[b];
+    }
+}
+
+void DeepFilterSpectral::applyDeepFilter(cpx* out, const float* coefs) const {
+    // 低频 nbDf 个频点替换为 dfOrder 帧带噪频谱与系数的复数卷积，系数按从旧到新排列
+    std::fill(out, out + nbDf, cpx());
+    const cpx* c = reinterpret_cast<const cpx*>(coefs);
+    const size_t oldest = convLookahead - dfLookahead + dfOrder - 1;
+    for (size_t k = 0; k < dfOrder; ++k) {
+        complexMultiplyAccumulate(noisyFrame(oldest - k), c + k * nbDf, out, nbDf);
+    }
+}
+
+void DeepFilterSpectral::applyPostFilter(const cpx* noisy, cpx* out) const {
+    // libDF 的 post_filter: 按增益的正弦映射进一步压低低增益频点
+    constexpr float kEps = 1e-12f;
+    const float betaP1 = postFilterBeta + 1.f;
+    for (size_t k = 0; k < bins; ++k) {
+        float g = std::clamp(std::abs(out[k]) / (std::abs(noisy[k]) + kEps), kEps, 1.f);
+        float gSin = std::min(std::sin(g * static_cast<float>(kPi) / 2.f), 1.f);
+        float ratio = g / gSin;
+        out[k] *= betaP1 / (1.f + postFilterBeta * ratio * ratio);
+    }
+}
+
+#if defined(DEEP_FILTER_SPECTRAL_VERIFY)
+void DeepFilterSpectral::setReference(DFState* ref) {
+    reference = ref;
+    referenceIn.resize(hopSize);
+    referenceOut.resize(hopSize);
+}
+
+void DeepFilterSpectral::verify(const float* input, const float* output) {
+    if (reference == nullptr) return;
+    std::copy(input, input + hopSize, referenceIn.begin());
+    df_process_frame(reference, referenceIn.data(), referenceOut.data());
+    for (size_t i = 0; i < hopSize; ++i) {
+        float error = output[i] - referenceOut[i];
+        referenceEnergy += static_cast<double>(referenceOut[i]) * referenceOut[i];
+        errorEnergy += static_cast<double>(error) * error;
+        maxAbsError = std::max(maxAbsError, std::fabs(error));
+    }
+}
+#endif
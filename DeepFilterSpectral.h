@@ -0,0 +1,136 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_DEEPFILTERSPECTRAL_H
+#define AAUDIORECORDER_DEEPFILTERSPECTRAL_H
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Fft.h"
+
+struct DFState;
+
+/**
+ * 模型的 STFT / ERB / DF 参数，df.h 没有接口读取，需要与模型 config.ini 一致
+ * 默认值对应 48kHz 的 DeepFilterNet2/3；convLookahead 和 dfLookahead 为 0 的是低延迟模型
+ */
+struct DeepFilterSpectralConfig {
+    int sampleRate = 48000;
+    size_t fftSize = 960;
+    size_t hopSize = 480;
+    size_t nbErb = 32;
+    size_t minNbErbFreqs = 2;
+    size_t nbDf = 96;
+    size_t dfOrder = 5;
+    size_t dfLookahead = 0;     // DF 系数覆盖的未来帧数
+    size_t convLookahead = 0;   // 模型输出相对输入滞后的帧数，不小于 dfLookahead
+};
+
+/**
+ * 围绕 df_process_frame_raw 的分析/合成引擎
+ *
+ * 每个 hop: Vorbis 窗 + 实数 FFT 得到频谱 -> df_process_frame_raw 给出 ERB 增益和 DF 系数 ->
+ * 增益按 ERB 频带展开到频点，低频 nbDf 个频点用 dfOrder 帧的复数卷积替换 -> 后置滤波、衰减上限 ->
+ * 逆 FFT、加窗、重叠相加。与 df_process_frame 的处理顺序相同。
+ *
+ * 模型认为不需要处理 (增益和系数都返回 NULL) 的帧频谱不变，合成结果等于时域的 w² 加窗输入，
+ * 这时跳过 DF 卷积、逆 FFT 和合成窗，直接用分析帧乘以预先算好的 w² 重叠相加。
+ * 窗口乘法、重叠相加、ERB 增益和复数乘加有 SSE2 / NEON 实现。
+ *
+ * 不持有 DFState，所有调用都在处理线程上。
+ */
+class DeepFilterSpectral {
+public:
+    DeepFilterSpectral(DFState* state, const DeepFilterSpectralConfig& config);
+    ~DeepFilterSpectral();
+
+    DeepFilterSpectral(const DeepFilterSpectral&) = delete;
+    DeepFilterSpectral& operator=(const DeepFilterSpectral&) = delete;
+
+    // 每个 ERB 频带的频点数，总和为 fftSize / 2 + 1，与 libDF 的 erb_fb 相同
+    static std::vector<size_t> erbBandWidths(int sampleRate, size_t fftSize, size_t nbErb, size_t minNbFreqs);
+
+    // 处理一个 hop，返回模型给出的局部 SNR
+    float process(const float* input, float* output);
+
+    // 清空分析/合成状态，模型自身的状态不受影响
+    void reset();
+
+    void setAttenLimDb(float db);
+    void setPostFilterBeta(float beta) { postFilterBeta = beta; }
+
+    // 输出相对输入的延迟
+    size_t delaySamples() const { return fftSize - hopSize + convLookahead * hopSize; }
+    // 一帧输出依赖的频谱帧数，跳过模型之后至少要重新喂这么多 hop
+    size_t historyFrames() const { return specFrames; }
+
+    struct Stats {
+        uint64_t frames;
+        uint64_t bypassFrames;      // 增益和系数都为 NULL，跳过合成
+        uint64_t dfFrames;          // 应用了 DF 系数
+    };
+    Stats stats() const { return {frames, bypassFrames, dfFrames}; }
+
+#if defined(DEEP_FILTER_SPECTRAL_VERIFY)
+    // 调试：接管另一个用同一模型创建的 DFState，相同输入送给 df_process_frame 并统计输出差异
+    void setReference(DFState* reference);
+#endif
+
+private:
+    using cpx = std::complex<float>;
+
+    const cpx* noisyFrame(size_t age) const;
+    void applyGains(cpx* spec, const float* gains) const;
+    void applyDeepFilter(cpx* spec, const float* coefs) const;
+    void applyPostFilter(const cpx* noisy, cpx* spec) const;
+#if defined(DEEP_FILTER_SPECTRAL_VERIFY)
+    void verify(const float* input, const float* output);
+#endif
+
+    DFState* state;
+    size_t fftSize;
+    size_t hopSize;
+    size_t bins;
+    size_t nbDf;
+    size_t dfOrder;
+    size_t dfLookahead;
+    size_t convLookahead;
+    size_t specFrames;          // 频谱历史的帧数
+
+    RealFft fft;
+    std::vector<float> window;
+    std::vector<float> bypassWindow;    // w² * wnorm * fftSize，跳过合成时直接作用在时域
+    std::vector<size_t> erbWidths;
+    float wnorm;
+
+    std::vector<float> timeHistory;     // convLookahead * hop + fftSize 个输入采样，开头是输出帧对应的分析帧
+    std::vector<float> frame;
+    std::vector<cpx> specHistory;       // specFrames 帧的带噪频谱，环形
+    size_t newest = 0;
+    std::vector<cpx> rawInput;
+    std::vector<cpx> spec;
+    std::vector<float> synthesis;
+    std::vector<float> synthesisMem;    // fftSize - hop
+
+    float attenLim = 0.f;               // 0 表示不限制
+    float postFilterBeta = 0.f;
+
+    uint64_t frames = 0;
+    uint64_t bypassFrames = 0;
+    uint64_t dfFrames = 0;
+
+#if defined(DEEP_FILTER_SPECTRAL_VERIFY)
+    DFState* reference = nullptr;
+    std::vector<float> referenceIn;
+    std::vector<float> referenceOut;
+    double referenceEnergy = 0.0;
+    double errorEnergy = 0.0;
+    float maxAbsError = 0.f;
+#endif
+};
+
+#endif //AAUDIORECORDER_DEEPFILTERSPECTRAL_H
@@ -0,0 +1,193 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include "DeepFilterStream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#include "RecorderLog.h"
+#include "df.h"
+
+namespace {
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+std::unique_ptr<DeepFilterStream> DeepFilterStream::create(const char* modelPath, float attenLimDb,
+                                                           const DeepFilterSpectralConfig* spectral) {
+    DFState* state = df_create(modelPath, attenLimDb, "warn");
+    if (state == nullptr) {
+        LOGE("df_create failed for %s", modelPath);
+        return nullptr;
+    }
+    auto stream = create(state, attenLimDb, spectral);
+#if defined(DEEP_FILTER_SPECTRAL_VERIFY)
+    if (stream->spectral) {
+        DFState* reference = df_create(modelPath, attenLimDb, "warn");
+        if (reference != nullptr) stream->spectral->setReference(reference);
+    }
+#endif
+    return stream;
+}
+
+std::unique_ptr<DeepFilterStream> DeepFilterStream::create(DFState* state, float attenLimDb,
+                                                           const DeepFilterSpectralConfig* spectral) {
+    auto stream = std::make_unique<DeepFilterStream>(state);
+    stream->gate.setSilenceGain(std::pow(10.f, -std::min(attenLimDb, kMaxSilenceAttenDb) / 20.f));
+
+    if (spectral != nullptr) {
+        if (spectral->hopSize != stream->hopFrames) {
+            LOGE("DeepFilterNet spectral hop %zu does not match the model (%zu), using df_process_frame",
+                 spectral->hopSize, stream->hopFrames);
+            return stream;
+        }
+        stream->spectral = std::make_unique<DeepFilterSpectral>(state, *spectral);
+        stream->spectral->setAttenLimDb(attenLimDb);
+        stream->modelDelay = stream->spectral->delaySamples();
+    }
+    return stream;
+}
+
+DeepFilterStream::DeepFilterStream(DFState* state)
+    : state(state), hopFrames(df_get_frame_length(state)), modelDelay(hopFrames),
+      pendingAttenLimDb(NAN), pendingPostFilterBeta(NAN) {
+    input.resize(hopFrames);
+    modelOut.resize(hopFrames);
+    gate.setSilenceGain(std::pow(10.f, -kMaxSilenceAttenDb / 20.f));
+}
+
+DeepFilterStream::~DeepFilterStream() {
+    if (hops > 0) {
+        double avgUs = modelHops > 0 ? processNsTotal / 1e3 / modelHops : 0.0;
+        LOGI("DeepFilterNet: model ran %llu of %llu hops (%.0f%% skipped, ~%.2f s CPU saved), "
+             "avg %.1f us, max %.1f us per hop of %zu samples",
+             (unsigned long long) modelHops, (unsigned long long) hops,
+             100.0 * (hops - modelHops) / hops, (hops - modelHops) * avgUs / 1e6,
+             avgUs, processNsMax / 1e3, hopFrames);
+    }
+    spectral.reset();
+    df_free(state);
+}
+
+void DeepFilterStream::configure(size_t frames) {
+    blockFrames = frames;
+    latency = hopFrames - std::gcd(blockFrames, hopFrames);
+    output.resize(latency + blockFrames + hopFrames);
+    delayLine.resize(modelDelay + hopFrames);
+    size_t warmup = (modelDelay + hopFrames - 1) / hopFrames + 1;
+    if (spectral) warmup = std::max(warmup, spectral->historyFrames());
+    gate.setWarmupHops(static_cast<int>(warmup));
+    reset();
+}
+
+void DeepFilterStream::reset() {
+    inputFill = 0;
+    std::fill(output.begin(), output.end(), 0.f);
+    outputFill = latency;
+    std::fill(delayLine.begin(), delayLine.end(), 0.f);
+    bypassGain = 1.f;
+    gate.reset();
+    if (spectral) spectral->reset();
+}
+
+void DeepFilterStream::applyPendingSettings() {
+    float atten = pendingAttenLimDb.exchange(NAN, std::memory_order_relaxed);
+    if (!std::isnan(atten)) {
+        df_set_atten_lim(state, atten);
+        if (spectral) spectral->setAttenLimDb(atten);
+        gate.setSilenceGain(std::pow(10.f, -std::min(atten, kMaxSilenceAttenDb) / 20.f));
+    }
+    float beta = pendingPostFilterBeta.exchange(NAN, std::memory_order_relaxed);
+    if (!std::isnan(beta)) {
+        df_set_post_filter_beta(state, beta);
+        if (spectral) spectral->setPostFilterBeta(beta);
+    }
+}
+
+void DeepFilterStream::process(float* block) {
+    applyPendingSettings();
+    run(block, !suspended.load(std::memory_order_relaxed));
+}
+
+void DeepFilterStream::passThrough(float* block) {
+    run(block, false);
+}
+
+void DeepFilterStream::run(float* block, bool allowModel) {
+    // 输入 FIFO: 最多攒一个 hop
+    size_t consumed = 0;
+    while (consumed < blockFrames) {
+        size_t n = std::min(blockFrames - consumed, hopFrames - inputFill);
+        std::memcpy(input.data() + inputFill, block + consumed, n * sizeof(float));
+        inputFill += n;
+        consumed += n;
+        if (inputFill < hopFrames) break;
+
+        runHop(output.data() + outputFill, allowModel);
+        outputFill += hopFrames;
+        inputFill = 0;
+    }
+
+    // 输出 FIFO: 预填的延迟保证这里总有一块
+    std::memcpy(block, output.data(), blockFrames * sizeof(float));
+    outputFill -= blockFrames;
+    std::memmove(output.data(), output.data() + blockFrames, outputFill * sizeof(float));
+}
+
+void DeepFilterStream::runHop(float* out, bool allowModel) {
+    // 延迟线: 前 hop 个采样是与模型输出对齐的输入
+    std::memcpy(delayLine.data() + modelDelay, input.data(), hopFrames * sizeof(float));
+    const float* delayed = delayLine.data();
+
+    DeepFilterGate::Decision decision = gate.update(input.data(), hopFrames, lastSnrDb(),
+                                                    gating.load(std::memory_order_relaxed), allowModel);
+    if (decision.runModel) {
+        int64_t start = nowNs();
+        float snr = spectral ? spectral->process(input.data(), modelOut.data())
+                             : df_process_frame(state, input.data(), modelOut.data());
+        snrDb.store(snr, std::memory_order_relaxed);
+        int64_t elapsed = nowNs() - start;
+        processNsTotal += elapsed;
+        processNsMax = std::max(processNsMax, elapsed);
+        ++modelHops;
+    }
+    ++hops;
+
+    const float step = 1.f / static_cast<float>(hopFrames);
+    const float gainFrom = bypassGain;
+    const float gainStep = (decision.bypassGain - gainFrom) * step;
+    bypassGain = decision.bypassGain;
+
+    switch (decision.output) {
+        case DeepFilterGate::Output::Model:
+            std::memcpy(out, modelOut.data(), hopFrames * sizeof(float));
+            break;
+        case DeepFilterGate::Output::Bypass:
+            for (size_t i = 0; i < hopFrames; ++i) {
+                out[i] = delayed[i] * (gainFrom + gainStep * static_cast<float>(i + 1));
+            }
+            break;
+        case DeepFilterGate::Output::FadeToModel:
+        case DeepFilterGate::Output::FadeToBypass: {
+            bool toModel = decision.output == DeepFilterGate::Output::FadeToModel;
+            for (size_t i = 0; i < hopFrames; ++i) {
+                float w = (static_cast<float>(i) + 0.5f) * step;
+                float bypass = delayed[i] * (gainFrom + gainStep * static_cast<float>(i + 1));
+                out[i] = toModel ? bypass + (modelOut[i] - bypass) * w
+                                 : modelOut[i] + (bypass - modelOut[i]) * w;
+            }
+            break;
+        }
+    }
+
+    std::memmove(delayLine.data(), delayLine.data() + hopFrames, modelDelay * sizeof(float));
+}
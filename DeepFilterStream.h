@@ -0,0 +1,120 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_DEEPFILTERSTREAM_H
+#define AAUDIORECORDER_DEEPFILTERSTREAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "DeepFilterGate.h"
+#include "DeepFilterSpectral.h"
+
+struct DFState;
+
+/**
+ * 按固定块长驱动 DeepFilterNet 的单声道流
+ *
+ * 调用方每次给出 blockFrames 个 float [-1, 1] 采样 (APM 的 10ms)，DF 每次处理 hop 个，
+ * 两者不相等时通过输入/输出 FIFO 重新分块。输出 FIFO 预先填入 hop - gcd(blockFrames, hop) 个零，
+ * 这是保证每个块都有输出的最小延迟；两者相等时 (DFN2/DFN3 在 48kHz 下都是 480) 不引入额外延迟。
+ *
+ * 衰减上限和后置滤波参数可以在任意线程设置，下一块开始时在处理线程上调用 df_set_atten_lim /
+ * df_set_post_filter_beta，DF 的状态只由处理线程访问。
+ *
+ * 开启门控后每个 hop 由 DeepFilterGate 决定是否运行模型。旁路输出取自延迟 modelDelay 个采样的输入，
+ * 与模型输出对齐，切换时两路交叉淡化不会产生相位跳变。默认的 modelDelay 为一个 hop，
+ * 对应 fft = 2 * hop 且没有前瞻的低延迟模型 (DeepFilterNet2_onnx_ll)，带前瞻的模型需要再加上前瞻的 hop 数。
+ *
+ * 给出 DeepFilterSpectralConfig 时模型改由 DeepFilterSpectral 通过 df_process_frame_raw 驱动，
+ * modelDelay 取自其配置。
+ */
+class DeepFilterStream {
+public:
+    static constexpr int kSampleRate = 48000;
+    static constexpr float kMaxSilenceAttenDb = 30.f;     // 静音段旁路的衰减，同时不超过 DF 的衰减上限
+
+    // 加载模型，失败时返回空；spectral 不为空时使用本地的分析/合成引擎
+    static std::unique_ptr<DeepFilterStream> create(const char* modelPath, float attenLimDb,
+                                                    const DeepFilterSpectralConfig* spectral = nullptr);
+    // 接管已经加载好的 state (DeepFilterModelManager::acquire)
+    static std::unique_ptr<DeepFilterStream> create(DFState* state, float attenLimDb,
+                                                    const DeepFilterSpectralConfig* spectral = nullptr);
+
+    // 接管 state 的所有权
+    explicit DeepFilterStream(DFState* state);
+    ~DeepFilterStream();
+
+    DeepFilterStream(const DeepFilterStream&) = delete;
+    DeepFilterStream& operator=(const DeepFilterStream&) = delete;
+
+    // 模型自身的输出延迟，configure 之前设置
+    void setModelDelay(size_t samples) { modelDelay = samples; }
+
+    // 分配所有缓冲并清空 FIFO，之后 process / passThrough 不再分配
+    void configure(size_t blockFrames);
+    void reset();
+
+    // 原地处理一块
+    void process(float* block);
+    // 经过同样的 FIFO 但不跑模型，保持与 process 相同的延迟，用于跳过推理的帧；
+    // 从模型输出切过来的那个 hop 仍然跑一次模型用来淡出
+    void passThrough(float* block);
+
+    void setAttenLimDb(float db) { pendingAttenLimDb.store(db, std::memory_order_relaxed); }
+    void setPostFilterBeta(float beta) { pendingPostFilterBeta.store(beta, std::memory_order_relaxed); }
+    void setGating(bool enable) { gating.store(enable, std::memory_order_relaxed); }
+    // 任意线程调用，挂起期间 process 等同于 passThrough，恢复时经过预热和淡入
+    void setSuspended(bool suspend) { suspended.store(suspend, std::memory_order_relaxed); }
+
+    size_t hop() const { return hopFrames; }
+    size_t latencySamples() const { return latency; }
+    float lastSnrDb() const { return snrDb.load(std::memory_order_relaxed); }
+
+    struct Stats {
+        uint64_t hops;
+        uint64_t modelHops;
+        int64_t modelNsTotal;
+        int64_t modelNsMax;
+    };
+    Stats stats() const { return {hops, modelHops, processNsTotal, processNsMax}; }
+
+private:
+    void run(float* block, bool allowModel);
+    void runHop(float* out, bool allowModel);
+    void applyPendingSettings();
+
+    DFState* state;
+    std::unique_ptr<DeepFilterSpectral> spectral;
+    size_t hopFrames;
+    size_t blockFrames = 0;
+    size_t latency = 0;
+    size_t modelDelay;
+
+    std::vector<float> input;           // 攒够 hop 后送给 DF
+    size_t inputFill = 0;
+    std::vector<float> output;          // 每块取走 blockFrames 个，最多 latency + blockFrames + hop
+    size_t outputFill = 0;
+
+    DeepFilterGate gate;
+    std::vector<float> delayLine;       // modelDelay + hop，前 hop 个是与模型输出对齐的输入
+    std::vector<float> modelOut;
+    float bypassGain = 1.f;
+
+    std::atomic<float> pendingAttenLimDb;
+    std::atomic<float> pendingPostFilterBeta;
+    std::atomic<float> snrDb{0.f};
+    std::atomic<bool> gating{false};
+    std::atomic<bool> suspended{false};
+
+    uint64_t hops = 0;
+    uint64_t modelHops = 0;
+    int64_t processNsTotal = 0;
+    int64_t processNsMax = 0;
+};
+
+#endif //AAUDIORECORDER_DEEPFILTERSTREAM_H
@@ -0,0 +1,298 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include "DelayEstimator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "RecorderLog.h"
+
+#if defined(__SSE2__)
+#define DELAY_ESTIMATOR_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#define DELAY_ESTIMATOR_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+constexpr float kPhatEpsilon = 1e-12f;
+constexpr float kMinRenderPower = 1e-6f;     // 参考信号太弱时不做估计
+constexpr float kMinConfidence = 6.0f;       // 峰值 / 平均幅度
+constexpr float kSmoothing = 0.3f;
+constexpr int kPublishThresholdMs = 2;
+
+/**
+ * GCC-PHAT 加权: out = x * conj(y) / |x * conj(y)|
+ * 复数按 {re, im} 交织存放，SSE2 / NEON 每次处理 2 / 4 个频点，
+ * 余下频点走标量路径
+ */
+void phatWeight(const std::complex<float>* x, const std::complex<float>* y,
+                std::complex<float>* out, size_t bins) {
+    auto xf = reinterpret_cast<const float*>(x);
+    auto yf = reinterpret_cast<const float*>(y);
+    auto of = reinterpret_cast<float*>(out);
+    size_t i = 0;
+#if defined(DELAY_ESTIMATOR_SSE2)
+    const __m128 eps = _mm_set1_ps(kPhatEpsilon);
+    const __m128 signOdd = _mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f);
+    for (; i + 2 <= bins; i += 2) {
+        __m128 a = _mm_loadu_ps(xf + 2 * i);               // ar0 ai0 ar1 ai1
+        __m128 b = _mm_loadu_ps(yf + 2 * i);               // br0 bi0 br1 bi1
+        __m128 aRe = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 0, 0));
+        __m128 aIm = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 1, 1));
+        __m128 bSwap = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1));   // bi br
+        // a * conj(b) = (ar*br + ai*bi) + i(ai*br - ar*bi)
+        __m128 p = _mm_mul_ps(aRe, b);                      // ar*br  ar*bi
+        __m128 q = _mm_mul_ps(aIm, bSwap);                  // ai*bi  ai*br
+        __m128 c = _mm_add_ps(q, _mm_xor_ps(p, signOdd));
+        __m128 sq = _mm_mul_ps(c, c);
+        __m128 mag = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1)));
+        mag = _mm_add_ps(_mm_sqrt_ps(mag), eps);
+        _mm_storeu_ps(of + 2 * i, _mm_div_ps(c, mag));
+    }
+#elif defined(DELAY_ESTIMATOR_NEON)
+    const float32x4_t eps = vdupq_n_f32(kPhatEpsilon);
+    for (; i + 4 <= bins; i += 4) {
+        float32x4x2_t a = vld2q_f32(xf + 2 * i);
+        float32x4x2_t b = vld2q_f32(yf + 2 * i);
+        float32x4_t re = vmlaq_f32(vmulq_f32(a.val[0], b.val[0]), a.val[1], b.val[1]);
+        float32x4_t im = vmlsq_f32(vmulq_f32(a.val[1], b.val[0]), a.val[0], b.val[1]);
+        float32x4_t mag = vmlaq_f32(vmulq_f32(re, re), im, im);
+        // 1/sqrt 估计 + 一次 Newton 迭代，精度对峰值检测足够
+        float32x4_t inv = vrsqrteq_f32(vaddq_f32(mag, eps));
+        inv = vmulq_f32(inv, vrsqrtsq_f32(vmulq_f32(vaddq_f32(mag, eps), inv), inv));
+        float32x4x2_t o;
+        o.val[0] = vmulq_f32(re, inv);
+        o.val[1] = vmulq_f32(im, inv);
+        vst2q_f32(of + 2 * i, o);
+    }
+#endif
+    for (; i < bins; ++i) {
+        std::complex<float> c = x[i] * std::conj(y[i]);
+        out[i] = c / (std::abs(c) + kPhatEpsilon);
+    }
+}
+
+float meanPower(const std::vector<float>& v) {
+    double sum = 0.0;
+    for (float s : v) sum += static_cast<double>(s) * s;
+    return v.empty() ? 0.0f : static_cast<float>(sum / static_cast<double>(v.size()));
+}
+
+} // namespace
+
+DelayEstimator::DelayEstimator(int sampleRate)
+    : sampleRate(sampleRate),
+      decimatedRate(sampleRate / kDecimation),
+      decimatedFrame(static_cast<size_t>(sampleRate / 100 / kDecimation)),
+      pendingCapture(decimatedFrame),
+      pendingRender(decimatedFrame),
+      pairBuffer(decimatedFrame * 2),
+      captureHistory(kWindow),
+      renderHistory(kWindow),
+      fft(kWindow * 2),
+      captureSpectrum(fft.bins()),
+      renderSpectrum(fft.bins()),
+      crossSpectrum(fft.bins()),
+      timeBuffer(kWindow * 2),
+      correlation(kWindow * 2) {
+}
+
+DelayEstimator::~DelayEstimator() {
+    stop();
+}
+
+void DelayEstimator::start(rtc::scoped_refptr<webrtc::AudioProcessing> processing) {
+    stop();
+    apm = std::move(processing);
+    pairs.reset();
+    pendingCaptureCount = 0;
+    captureSum = 0.0f;
+    captureSumCount = 0;
+    hasRender = false;
+    historyFilled = 0;
+    smoothedDelayMs = -1.0f;
+    timestampDelayMs.store(-1, std::memory_order_relaxed);
+    publishedDelayMs.store(-1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = false;
+    }
+    worker = std::thread(&DelayEstimator::run, this);
+}
+
+void DelayEstimator::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    apm = nullptr;
+}
+
+void DelayEstimator::pushRender(const int16_t* data, size_t frames, size_t channels) {
+    const size_t n = std::min(frames / kDecimation, decimatedFrame);
+    for (size_t i = 0; i < n; ++i) {
+        int32_t sum = 0;
+        for (int k = 0; k < kDecimation; ++k) {
+            sum += data[(i * kDecimation + k) * channels];
+        }
+        pendingRender[i] = static_cast<float>(sum) * (1.0f / (32768.0f * kDecimation));
+    }
+    std::fill(pendingRender.begin() + n, pendingRender.end(), 0.0f);
+    hasRender = true;
+}
+
+void DelayEstimator::pushCapture(const int16_t* data, size_t frames, size_t channels) {
+    for (size_t i = 0; i < frames; ++i) {
+        captureSum += data[i * channels];
+        if (++captureSumCount < kDecimation) continue;
+
+        pendingCapture[pendingCaptureCount++] = captureSum * (1.0f / (32768.0f * kDecimation));
+        captureSum = 0.0f;
+        captureSumCount = 0;
+        if (pendingCaptureCount < decimatedFrame) continue;
+
+        // 凑满一帧，与本帧的参考信号配对；没有参考时填 0
+        for (size_t k = 0; k < decimatedFrame; ++k) {
+            pairBuffer[2 * k] = pendingCapture[k];
+            pairBuffer[2 * k + 1] = hasRender ? pendingRender[k] : 0.0f;
+        }
+        hasRender = false;
+        pendingCaptureCount = 0;
+        // 后台线程跟不上时直接丢弃，不阻塞处理线程
+        pairs.write(pairBuffer.data(), decimatedFrame);
+    }
+}
+
+void DelayEstimator::pushTimestampDelay(int delayMs) {
+    if (delayMs < 0 || delayMs > kMaxDelayMs) return;
+    timestampDelayMs.store(delayMs, std::memory_order_relaxed);
+    // 第一次估计之前先用时间戳，GCC-PHAT 收敛前 AEC 也有一个大致正确的延迟
+    int expected = -1;
+    publishedDelayMs.compare_exchange_strong(expected, delayMs, std::memory_order_relaxed);
+}
+
+void DelayEstimator::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        cv.wait_for(lock, std::chrono::milliseconds(kIntervalMs));
+        if (stopping) break;
+        lock.unlock();
+        drain();
+        estimate();
+        lock.lock();
+    }
+}
+
+void DelayEstimator::drain() {
+    size_t available = pairs.availableFrames();
+    if (available == 0) return;
+    if (available > kWindow) {
+        pairs.skip(available - kWindow);
+        available = kWindow;
+    }
+
+    // 滑动窗口: 丢掉最旧的 available 个点，新数据追加在尾部
+    const size_t keep = kWindow - available;
+    std::memmove(captureHistory.data(), captureHistory.data() + available, keep * sizeof(float));
+    std::memmove(renderHistory.data(), renderHistory.data() + available, keep * sizeof(float));
+
+    FrameView<float> view{};
+    if (!pairs.acquire(available, view)) return;
+    view.forEach([&](const float* data, size_t samples, size_t offset) {
+        float* capture = captureHistory.data() + keep + offset / 2;
+        float* render = renderHistory.data() + keep + offset / 2;
+        for (size_t i = 0; i < samples / 2; ++i) {
+            capture[i] = data[2 * i];
+            render[i] = data[2 * i + 1];
+        }
+    });
+    pairs.release(view);
+    historyFilled = std::min(historyFilled + available, kWindow);
+}
+
+void DelayEstimator::estimate() {
+    float estimateMs = -1.0f;
+    float confidence = 0.0f;
+    const char* source = "gcc-phat";
+
+    if (historyFilled == kWindow && meanPower(renderHistory) > kMinRenderPower) {
+        int lag = gccPhat(&confidence);
+        if (confidence >= kMinConfidence) {
+            estimateMs = static_cast<float>(lag) * 1000.0f / static_cast<float>(decimatedRate);
+        }
+    }
+
+    // GCC-PHAT 不可靠时先用时间戳，再参考 AEC3 自己的延迟统计
+    int stamped = timestampDelayMs.load(std::memory_order_relaxed);
+    if (estimateMs < 0.0f && stamped >= 0) {
+        estimateMs = static_cast<float>(stamped);
+        source = "timestamps";
+    }
+    if (estimateMs < 0.0f && apm) {
+        webrtc::AudioProcessingStats stats = apm->GetStatistics();
+        if (stats.delay_median_ms && *stats.delay_median_ms >= 0) {
+            estimateMs = static_cast<float>(*stats.delay_median_ms);
+            source = "aec3";
+        }
+    }
+    if (estimateMs < 0.0f) return;
+
+    smoothedDelayMs = smoothedDelayMs < 0.0f
+                      ? estimateMs
+                      : smoothedDelayMs + kSmoothing * (estimateMs - smoothedDelayMs);
+
+    int rounded = static_cast<int>(std::lround(smoothedDelayMs));
+    int previous = publishedDelayMs.load(std::memory_order_relaxed);
+    if (previous < 0 || std::abs(rounded - previous) >= kPublishThresholdMs) {
+        publishedDelayMs.store(rounded, std::memory_order_relaxed);
+        LOGI("stream delay %d -> %d ms (%s %.1f ms, confidence %.1f)",
+             previous, rounded, source, estimateMs, confidence);
+    }
+}
+
+int DelayEstimator::gccPhat(float* confidence) {
+    const size_t n = fft.size();
+
+    // 各自去均值，后半段补零，避免循环相关
+    auto spectrum = [&](const std::vector<float>& history, std::vector<std::complex<float>>& out) {
+        double mean = 0.0;
+        for (float s : history) mean += s;
+        auto m = static_cast<float>(mean / static_cast<double>(kWindow));
+        for (size_t i = 0; i < kWindow; ++i) timeBuffer[i] = history[i] - m;
+        std::fill(timeBuffer.begin() + kWindow, timeBuffer.end(), 0.0f);
+        fft.forward(timeBuffer.data(), out.data());
+    };
+    spectrum(captureHistory, captureSpectrum);
+    spectrum(renderHistory, renderSpectrum);
+
+    phatWeight(captureSpectrum.data(), renderSpectrum.data(), crossSpectrum.data(), fft.bins());
+    fft.inverse(crossSpectrum.data(), correlation.data());
+
+    // correlation[lag] = Σ capture[t + lag] * render[t]，采集滞后于参考，只搜索非负延迟
+    const size_t maxLag = std::min(static_cast<size_t>(kMaxDelayMs * decimatedRate / 1000), kWindow / 2);
+    size_t best = 0;
+    float peak = 0.0f;
+    double sum = 0.0;
+    for (size_t lag = 0; lag <= maxLag && lag < n; ++lag) {
+        float v = std::fabs(correlation[lag]);
+        sum += v;
+        if (correlation[lag] > peak) {
+            peak = correlation[lag];
+            best = lag;
+        }
+    }
+    float mean = static_cast<float>(sum / static_cast<double>(maxLag + 1));
+    *confidence = mean > 0.0f ? peak / mean : 0.0f;
+    return static_cast<int>(best);
+}
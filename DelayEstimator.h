@@ -0,0 +1,105 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_DELAYESTIMATOR_H
+#define AAUDIORECORDER_DELAYESTIMATOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "modules/audio_processing/include/audio_processing.h"
+
+#include "Fft.h"
+#include "SpscFrameRing.h"
+
+/**
+ * 参考信号 -> 采集信号 的延迟估计，结果用于 set_stream_delay_ms
+ *
+ * 处理线程只做 4 倍降采样并把 {采集, 参考} 样本对写入无锁 ring buffer；
+ * 后台线程周期性地对最近一个窗口做 GCC-PHAT（FFT 互相关 + 相位变换加权），
+ * 置信度不够时依次参考播放 / 采集时间戳算出的延迟和 AEC3 统计的 delay_median_ms，
+ * 平滑后通过原子变量发布。时间戳延迟在还没有任何估计时直接发布，作为 AEC 的初值。
+ */
+class DelayEstimator {
+public:
+    static constexpr int kDecimation = 4;
+    static constexpr size_t kWindow = 8192;          // 降采样后的分析窗口
+    static constexpr int kMaxDelayMs = 250;
+    static constexpr int kIntervalMs = 250;
+
+    explicit DelayEstimator(int sampleRate);
+    ~DelayEstimator();
+
+    DelayEstimator(const DelayEstimator&) = delete;
+    DelayEstimator& operator=(const DelayEstimator&) = delete;
+
+    // apm 用于读取 AEC3 的延迟统计，可以为空
+    void start(rtc::scoped_refptr<webrtc::AudioProcessing> apm);
+    void stop();
+
+    // ---------------- 处理线程，非阻塞 ----------------
+
+    // 当前采集帧对应的参考帧，交织 int16，只取第 0 声道
+    void pushRender(const int16_t* data, size_t frames, size_t channels);
+
+    // 采集数据，可以分多次送入；凑满一帧后与最近的参考帧配对
+    void pushCapture(const int16_t* data, size_t frames, size_t channels);
+
+    // 参考帧播放时间 - 采集帧采集时间 (ms)，超出 [0, kMaxDelayMs] 时忽略
+    void pushTimestampDelay(int delayMs);
+
+    // 当前延迟估计(ms)，尚无估计时返回 -1
+    int delayMs() const { return publishedDelayMs.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    void drain();
+    void estimate();
+    int gccPhat(float* confidence);
+
+    const int sampleRate;
+    const int decimatedRate;
+    const size_t decimatedFrame;    // 每 10ms 的降采样点数
+
+    // 处理线程状态
+    std::vector<float> pendingCapture;
+    std::vector<float> pendingRender;
+    std::vector<float> pairBuffer;
+    size_t pendingCaptureCount = 0;
+    float captureSum = 0.0f;
+    int captureSumCount = 0;
+    bool hasRender = false;
+
+    // ch0 = 采集, ch1 = 参考
+    SpscFrameRing<float, 2, 16384> pairs;
+
+    // 后台线程状态
+    std::vector<float> captureHistory;
+    std::vector<float> renderHistory;
+    size_t historyFilled = 0;
+    RealFft fft;
+    std::vector<std::complex<float>> captureSpectrum;
+    std::vector<std::complex<float>> renderSpectrum;
+    std::vector<std::complex<float>> crossSpectrum;
+    std::vector<float> timeBuffer;
+    std::vector<float> correlation;
+    float smoothedDelayMs = -1.0f;
+
+    rtc::scoped_refptr<webrtc::AudioProcessing> apm;
+    std::atomic<int> timestampDelayMs{-1};
+    std::atomic<int> publishedDelayMs{-1};
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+};
+
+#endif //AAUDIORECORDER_DELAYESTIMATOR_H
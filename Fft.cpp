@@ -0,0 +1,290 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+/*
+ * 因子分解 (factorize) 和各个 butterfly 移植自 KISS FFT 的 kf_factor / kf_bfly2..5 / kf_bfly_generic，
+ * RealFft 的拆分与合并对应 kiss_fftr，原始代码的版权和许可如下。
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2003-2010, Mark Borgerding. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice, this list
+ *     of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright notice, this list
+ *     of conditions and the following disclaimer in the documentation and/or other
+ *     materials provided with the distribution.
+ *   * Neither the author nor the names of any contributors may be used to endorse or
+ *     promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Fft.h"
+
+#include <cmath>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+using cpx = std::complex<float>;
+
+// 先分解出 4，再 2，再奇数因子，与 butterfly 的实现顺序对应
+std::vector<size_t> factorize(size_t n) {
+    std::vector<size_t> out;
+    size_t p = 4;
+    auto floorSqrt = static_cast<size_t>(std::floor(std::sqrt(static_cast<double>(n))));
+    do {
+        while (n % p) {
+            switch (p) {
+                case 4: p = 2; break;
+                case 2: p = 3; break;
+                default: p += 2; break;
+            }
+            if (p > floorSqrt) p = n;
+        }
+        n /= p;
+        out.push_back(p);
+        out.push_back(n);
+    } while (n > 1);
+    return out;
+}
+
+} // namespace
+
+Fft::Fft(size_t n, bool inverse) : n(n), inverse(inverse), twiddles(n) {
+    for (size_t i = 0; i < n; ++i) {
+        double phase = (inverse ? 2.0 : -2.0) * kPi * static_cast<double>(i) / static_cast<double>(n);
+        twiddles[i] = cpx(static_cast<float>(std::cos(phase)), static_cast<float>(std::sin(phase)));
+    }
+    factors = n > 1 ? factorize(n) : std::vector<size_t>{1, 1};
+
+    size_t maxRadix = 0;
+    for (size_t i = 0; i < factors.size(); i += 2) {
+        if (factors[i] > 5 && factors[i] > maxRadix) maxRadix = factors[i];
+    }
+    scratch.resize(maxRadix);
+}
+
+void Fft::transform(const cpx* in, cpx* out) const {
+    if (n <= 1) {
+        if (n == 1) out[0] = in[0];
+        return;
+    }
+    work(out, in, 1, factors.data());
+}
+
+void Fft::work(cpx* out, const cpx* in, size_t fstride, const size_t* f) const {
+    const size_t p = f[0];
+    const size_t m = f[1];
+    cpx* begin = out;
+    cpx* end = out + p * m;
+
+    if (m == 1) {
+        do {
+            *out = *in;
+            in += fstride;
+        } while (++out != end);
+    } else {
+        do {
+            // 递归处理 p 个长度为 m 的子序列
+            work(out, in, fstride * p, f + 2);
+            in += fstride;
+        } while ((out += m) != end);
+    }
+
+    out = begin;
+    switch (p) {
+        case 2: butterfly2(out, fstride, m); break;
+        case 3: butterfly3(out, fstride, m); break;
+        case 4: butterfly4(out, fstride, m); break;
+        case 5: butterfly5(out, fstride, m); break;
+        default: butterflyGeneric(out, fstride, m, p); break;
+    }
+}
+
+void Fft::butterfly2(cpx* out, size_t fstride, size_t m) const {
+    cpx* out2 = out + m;
+    const cpx* tw = twiddles.data();
+    for (size_t k = 0; k < m; ++k) {
+        cpx t = out2[k] * *tw;
+        tw += fstride;
+        out2[k] = out[k] - t;
+        out[k] += t;
+    }
+}
+
+void Fft::butterfly3(cpx* out, size_t fstride, size_t m) const {
+    const float epi3 = twiddles[fstride * m].imag();
+    const cpx* tw1 = twiddles.data();
+    const cpx* tw2 = twiddles.data();
+    const size_t m2 = 2 * m;
+    for (size_t k = 0; k < m; ++k) {
+        cpx s1 = out[m] * *tw1;
+        cpx s2 = out[m2] * *tw2;
+        cpx s3 = s1 + s2;
+        cpx s0 = s1 - s2;
+        tw1 += fstride;
+        tw2 += fstride * 2;
+
+        out[m] = out[0] - s3 * 0.5f;
+        s0 *= epi3;
+        out[0] += s3;
+
+        out[m2] = cpx(out[m].real() + s0.imag(), out[m].imag() - s0.real());
+        out[m] = cpx(out[m].real() - s0.imag(), out[m].imag() + s0.real());
+        ++out;
+    }
+}
+
+void Fft::butterfly4(cpx* out, size_t fstride, size_t m) const {
+    const cpx* tw1 = twiddles.data();
+    const cpx* tw2 = twiddles.data();
+    const cpx* tw3 = twiddles.data();
+    const size_t m2 = 2 * m;
+    const size_t m3 = 3 * m;
+    for (size_t k = 0; k < m; ++k) {
+        cpx s0 = out[m] * *tw1;
+        cpx s1 = out[m2] * *tw2;
+        cpx s2 = out[m3] * *tw3;
+
+        cpx s5 = out[0] - s1;
+        out[0] += s1;
+        cpx s3 = s0 + s2;
+        cpx s4 = s0 - s2;
+        out[m2] = out[0] - s3;
+        tw1 += fstride;
+        tw2 += fstride * 2;
+        tw3 += fstride * 3;
+        out[0] += s3;
+
+        if (inverse) {
+            out[m] = cpx(s5.real() - s4.imag(), s5.imag() + s4.real());
+            out[m3] = cpx(s5.real() + s4.imag(), s5.imag() - s4.real());
+        } else {
+            out[m] = cpx(s5.real() + s4.imag(), s5.imag() - s4.real());
+            out[m3] = cpx(s5.real() - s4.imag(), s5.imag() + s4.real());
+        }
+        ++out;
+    }
+}
+
+void Fft::butterfly5(cpx* out, size_t fstride, size_t m) const {
+    const cpx ya = twiddles[fstride * m];
+    const cpx yb = twiddles[fstride * 2 * m];
+    cpx* out0 = out;
+    cpx* out1 = out + m;
+    cpx* out2 = out + 2 * m;
+    cpx* out3 = out + 3 * m;
+    cpx* out4 = out + 4 * m;
+
+    for (size_t u = 0; u < m; ++u) {
+        cpx s0 = *out0;
+        cpx s1 = *out1 * twiddles[u * fstride];
+        cpx s2 = *out2 * twiddles[2 * u * fstride];
+        cpx s3 = *out3 * twiddles[3 * u * fstride];
+        cpx s4 = *out4 * twiddles[4 * u * fstride];
+
+        cpx s7 = s1 + s4;
+        cpx s10 = s1 - s4;
+        cpx s8 = s2 + s3;
+        cpx s9 = s2 - s3;
+
+        *out0 += s7 + s8;
+
+        cpx s5(s0.real() + s7.real() * ya.real() + s8.real() * yb.real(),
+               s0.imag() + s7.imag() * ya.real() + s8.imag() * yb.real());
+        cpx s6(s10.imag() * ya.imag() + s9.imag() * yb.imag(),
+               -s10.real() * ya.imag() - s9.real() * yb.imag());
+        *out1 = s5 - s6;
+        *out4 = s5 + s6;
+
+        cpx s11(s0.real() + s7.real() * yb.real() + s8.real() * ya.real(),
+                s0.imag() + s7.imag() * yb.real() + s8.imag() * ya.real());
+        cpx s12(-s10.imag() * yb.imag() + s9.imag() * ya.imag(),
+                s10.real() * yb.imag() - s9.real() * ya.imag());
+        *out2 = s11 + s12;
+        *out3 = s11 - s12;
+
+        ++out0; ++out1; ++out2; ++out3; ++out4;
+    }
+}
+
+void Fft::butterflyGeneric(cpx* out, size_t fstride, size_t m, size_t p) const {
+    for (size_t u = 0; u < m; ++u) {
+        size_t k = u;
+        for (size_t q1 = 0; q1 < p; ++q1) {
+            scratch[q1] = out[k];
+            k += m;
+        }
+
+        k = u;
+        for (size_t q1 = 0; q1 < p; ++q1) {
+            size_t twidx = 0;
+            out[k] = scratch[0];
+            for (size_t q = 1; q < p; ++q) {
+                twidx += fstride * k;
+                if (twidx >= n) twidx -= n;
+                out[k] += scratch[q] * twiddles[twidx];
+            }
+            k += m;
+        }
+    }
+}
+
+RealFft::RealFft(size_t n)
+    : n(n), fwd(n / 2, false), inv(n / 2, true), super(n / 2), bufferIn(n / 2), bufferOut(n / 2) {
+    for (size_t k = 0; k < n / 2; ++k) {
+        double phase = -2.0 * kPi * static_cast<double>(k) / static_cast<double>(n);
+        super[k] = cpx(static_cast<float>(std::cos(phase)), static_cast<float>(std::sin(phase)));
+    }
+}
+
+void RealFft::forward(const float* in, cpx* out) const {
+    const size_t half = n / 2;
+    // 偶数/奇数样本打包成一个 n/2 点复数序列
+    for (size_t k = 0; k < half; ++k) {
+        bufferIn[k] = cpx(in[2 * k], in[2 * k + 1]);
+    }
+    fwd.transform(bufferIn.data(), bufferOut.data());
+
+    const cpx z0 = bufferOut[0];
+    out[0] = cpx(z0.real() + z0.imag(), 0.0f);
+    out[half] = cpx(z0.real() - z0.imag(), 0.0f);
+    for (size_t k = 1; k < half; ++k) {
+        cpx a = bufferOut[k];
+        cpx b = std::conj(bufferOut[half - k]);
+        cpx even = (a + b) * 0.5f;
+        cpx odd = (a - b) * cpx(0.0f, -0.5f);
+        out[k] = even + super[k] * odd;
+    }
+}
+
+void RealFft::inverse(const cpx* in, float* out) const {
+    const size_t half = n / 2;
+    for (size_t k = 0; k < half; ++k) {
+        cpx a = in[k];
+        cpx b = std::conj(in[half - k]);
+        cpx even = a + b;
+        cpx odd = (a - b) * std::conj(super[k]);
+        bufferIn[k] = even + cpx(0.0f, 1.0f) * odd;
+    }
+    inv.transform(bufferIn.data(), bufferOut.data());
+    for (size_t k = 0; k < half; ++k) {
+        out[2 * k] = bufferOut[k].real();
+        out[2 * k + 1] = bufferOut[k].imag();
+    }
+}
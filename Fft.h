@@ -0,0 +1,67 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_FFT_H
+#define AAUDIORECORDER_FFT_H
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+/**
+ * 混合基 (4/2/3/5/通用) 复数 FFT，长度任意，不要求 2 的幂
+ * 构造时完成分解和旋转因子计算，transform 本身不分配内存（通用基除外，其长度 <= 素因子）
+ * 正变换和逆变换都不做归一化，逆变换(正变换(x)) = n * x
+ * 算法移植自 KISS FFT (BSD-3-Clause)，版权声明见 Fft.cpp
+ */
+class Fft {
+public:
+    Fft(size_t n, bool inverse);
+
+    // 非原地变换，in 与 out 不能重叠
+    void transform(const std::complex<float>* in, std::complex<float>* out) const;
+
+    size_t size() const { return n; }
+
+private:
+    void work(std::complex<float>* out, const std::complex<float>* in, size_t fstride,
+              const size_t* factors) const;
+    void butterfly2(std::complex<float>* out, size_t fstride, size_t m) const;
+    void butterfly3(std::complex<float>* out, size_t fstride, size_t m) const;
+    void butterfly4(std::complex<float>* out, size_t fstride, size_t m) const;
+    void butterfly5(std::complex<float>* out, size_t fstride, size_t m) const;
+    void butterflyGeneric(std::complex<float>* out, size_t fstride, size_t m, size_t p) const;
+
+    size_t n;
+    bool inverse;
+    std::vector<size_t> factors;               // {p0, m0, p1, m1, ...}
+    std::vector<std::complex<float>> twiddles;
+    mutable std::vector<std::complex<float>> scratch;
+};
+
+/**
+ * 实数 FFT，长度 n 必须为偶数，内部使用 n/2 点复数 FFT
+ * forward: n 个实数 -> n/2 + 1 个复数频点
+ * inverse: n/2 + 1 个复数频点 -> n 个实数，结果为原信号的 n 倍
+ */
+class RealFft {
+public:
+    explicit RealFft(size_t n);
+
+    void forward(const float* in, std::complex<float>* out) const;
+    void inverse(const std::complex<float>* in, float* out) const;
+
+    size_t size() const { return n; }
+    size_t bins() const { return n / 2 + 1; }
+
+private:
+    size_t n;
+    Fft fwd;
+    Fft inv;
+    std::vector<std::complex<float>> super;   // e^{-2πik/n}, k < n/2
+    mutable std::vector<std::complex<float>> bufferIn;
+    mutable std::vector<std::complex<float>> bufferOut;
+};
+
+#endif //AAUDIORECORDER_FFT_H
@@ -0,0 +1,886 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include "FlacCodec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#define FLAC_CODEC_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#define FLAC_CODEC_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr int kBitsPerSample = 16;
+constexpr int kMaxRiceParameter = 14;       // 15 是 escape
+
+struct CrcTables {
+    uint8_t crc8[256];
+    uint16_t crc16[256];
+
+    CrcTables() {
+        for (int i = 0; i < 256; ++i) {
+            uint8_t c8 = static_cast<uint8_t>(i);
+            uint16_t c16 = static_cast<uint16_t>(i << 8);
+            for (int b = 0; b < 8; ++b) {
+                c8 = static_cast<uint8_t>((c8 & 0x80) ? (c8 << 1) ^ 0x07 : c8 << 1);
+                c16 = static_cast<uint16_t>((c16 & 0x8000) ? (c16 << 1) ^ 0x8005 : c16 << 1);
+            }
+            crc8[i] = c8;
+            crc16[i] = c16;
+        }
+    }
+};
+
+const CrcTables& crcTables() {
+    static const CrcTables tables;
+    return tables;
+}
+
+uint8_t crc8(const uint8_t* data, size_t size) {
+    const CrcTables& t = crcTables();
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; ++i) crc = t.crc8[crc ^ data[i]];
+    return crc;
+}
+
+uint16_t crc16(const uint8_t* data, size_t size) {
+    const CrcTables& t = crcTables();
+    uint16_t crc = 0;
+    for (size_t i = 0; i < size; ++i) {
+        crc = static_cast<uint16_t>((crc << 8) ^ t.crc16[(crc >> 8) ^ data[i]]);
+    }
+    return crc;
+}
+
+int sampleRateCode(uint32_t rate) {
+    switch (rate) {
+        case 88200: return 1;
+        case 176400: return 2;
+        case 192000: return 3;
+        case 8000: return 4;
+        case 16000: return 5;
+        case 22050: return 6;
+        case 24000: return 7;
+        case 32000: return 8;
+        case 44100: return 9;
+        case 48000: return 10;
+        case 96000: return 11;
+        default: return 0;      // 使用 STREAMINFO 中的采样率
+    }
+}
+
+inline uint32_t fold(int32_t e) {
+    return (static_cast<uint32_t>(e) << 1) ^ static_cast<uint32_t>(e >> 31);
+}
+
+inline int32_t unfold(uint32_t u) {
+    return static_cast<int32_t>(u >> 1) ^ -static_cast<int32_t>(u & 1);
+}
+
+// 已知分区内折叠残差之和时，Rice 参数 k 的比特数 (忽略商的取整误差)
+inline uint64_t riceBits(uint64_t sum, size_t count, int k) {
+    return count * static_cast<uint64_t>(k + 1) + (sum >> k);
+}
+
+int bestRiceParameter(uint64_t sum, size_t count, uint64_t* bits) {
+    int k = 0;
+    if (count > 0 && sum > count) {
+        uint64_t mean = sum / count;
+        while (k < kMaxRiceParameter && (mean >> (k + 1)) > 0) ++k;
+    }
+    int best = k;
+    uint64_t bestBits = riceBits(sum, count, k);
+    for (int c : {k - 1, k + 1}) {
+        if (c < 0 || c > kMaxRiceParameter) continue;
+        uint64_t b = riceBits(sum, count, c);
+        if (b < bestBits) {
+            bestBits = b;
+            best = c;
+        }
+    }
+    *bits = bestBits;
+    return best;
+}
+
+struct RicePlan {
+    int partitionOrder;
+    uint8_t parameters[1 << FlacEncoder::kMaxPartitionOrder];
+    uint64_t bits;
+};
+
+// residual[0] 对应块内第 order 个采样
+RicePlan planResidual(const int32_t* residual, size_t blockSize, int order) {
+    int maxOrder = 0;
+    while (maxOrder < FlacEncoder::kMaxPartitionOrder
+           && (blockSize % (size_t(2) << maxOrder)) == 0
+           && (blockSize >> (maxOrder + 1)) > static_cast<size_t>(order)) {
+        ++maxOrder;
+    }
+
+    // 先在最细的分区上求和，粗分区逐级合并
+    uint64_t sums[1 << FlacEncoder::kMaxPartitionOrder];
+    const size_t partitions = size_t(1) << maxOrder;
+    const size_t partitionSize = blockSize >> maxOrder;
+    size_t index = 0;
+    for (size_t p = 0; p < partitions; ++p) {
+        size_t count = partitionSize - (p == 0 ? order : 0);
+        uint64_t sum = 0;
+        for (size_t i = 0; i < count; ++i) sum += fold(residual[index + i]);
+        sums[p] = sum;
+        index += count;
+    }
+
+    RicePlan best{};
+    best.bits = UINT64_MAX;
+    for (int po = maxOrder; po >= 0; --po) {
+        const size_t parts = size_t(1) << po;
+        const size_t size = blockSize >> po;
+        RicePlan plan{};
+        plan.partitionOrder = po;
+        plan.bits = 6;
+        for (size_t p = 0; p < parts; ++p) {
+            uint64_t partBits;
+            plan.parameters[p] = static_cast<uint8_t>(
+                    bestRiceParameter(sums[p], size - (p == 0 ? order : 0), &partBits));
+            plan.bits += 4 + partBits;
+        }
+        if (plan.bits < best.bits) best = plan;
+
+        // 合并相邻分区
+        for (size_t p = 0; p < parts / 2; ++p) sums[p] = sums[2 * p] + sums[2 * p + 1];
+    }
+    return best;
+}
+
+void fixedResidual(const int16_t* x, size_t n, int order, int32_t* e) {
+    for (size_t i = order; i < n; ++i) {
+        int32_t v;
+        switch (order) {
+            case 0: v = x[i]; break;
+            case 1: v = x[i] - x[i - 1]; break;
+            case 2: v = x[i] - 2 * x[i - 1] + x[i - 2]; break;
+            case 3: v = x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3]; break;
+            default: v = x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4]; break;
+        }
+        e[i - order] = v;
+    }
+}
+
+// 估计 0~4 阶固定预测中残差绝对值和最小的阶数
+int bestFixedOrder(const int16_t* x, size_t n, int maxOrder) {
+    uint64_t total[5] = {0, 0, 0, 0, 0};
+    for (size_t i = 4; i < n; ++i) {
+        int32_t e0 = x[i];
+        int32_t e1 = e0 - x[i - 1];
+        int32_t e2 = e1 - (x[i - 1] - x[i - 2]);
+        int32_t e3 = e2 - (x[i - 1] - 2 * x[i - 2] + x[i - 3]);
+        int32_t e4 = e3 - (x[i - 1] - 3 * x[i - 2] + 3 * x[i - 3] - x[i - 4]);
+        total[0] += std::abs(e0);
+        total[1] += std::abs(e1);
+        total[2] += std::abs(e2);
+        total[3] += std::abs(e3);
+        total[4] += std::abs(e4);
+    }
+    int best = 0;
+    for (int o = 1; o <= maxOrder; ++o) {
+        if (total[o] < total[best]) best = o;
+    }
+    return best;
+}
+
+void lpcResidualScalar(const int16_t* x, size_t begin, size_t end, const int16_t* q, int order, int shift,
+                       int32_t* e) {
+    for (size_t i = begin; i < end; ++i) {
+        int32_t sum = 0;
+        for (int j = 0; j < order; ++j) sum += q[j] * x[i - 1 - j];
+        e[i - order] = x[i] - (sum >> shift);
+    }
+}
+
+/**
+ * LPC 残差 e[i - order] = x[i] - (Σ q[j] * x[i-1-j]) >> shift
+ * 系数补零到 8 阶，每个输出采样做一次 8 路 int16 乘加，前 8 个采样走标量
+ */
+void lpcResidual(const int16_t* x, size_t n, const int16_t* q, int order, int shift, int32_t* e) {
+    static_assert(FlacEncoder::kMaxLpcOrder == 8, "SIMD kernel assumes 8 taps");
+    size_t simdBegin = std::max<size_t>(order, 8);
+    lpcResidualScalar(x, order, std::min(n, simdBegin), q, order, shift, e);
+    if (simdBegin >= n) return;
+
+    // rev[m] 与 x[i - 8 + m] 相乘
+    alignas(16) int16_t rev[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    for (int j = 0; j < order; ++j) rev[7 - j] = q[j];
+
+    size_t i = simdBegin;
+#if defined(FLAC_CODEC_SSE2)
+    const __m128i c = _mm_load_si128(reinterpret_cast<const __m128i*>(rev));
+    for (; i < n; ++i) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i - 8));
+        __m128i p = _mm_madd_epi16(v, c);
+        p = _mm_add_epi32(p, _mm_shuffle_epi32(p, _MM_SHUFFLE(1, 0, 3, 2)));
+        p = _mm_add_epi32(p, _mm_shuffle_epi32(p, _MM_SHUFFLE(2, 3, 0, 1)));
+        e[i - order] = x[i] - (_mm_cvtsi128_si32(p) >> shift);
+    }
+#elif defined(FLAC_CODEC_NEON)
+    const int16x8_t c = vld1q_s16(rev);
+    for (; i < n; ++i) {
+        int16x8_t v = vld1q_s16(x + i - 8);
+        int32x4_t p = vmull_s16(vget_low_s16(v), vget_low_s16(c));
+        p = vmlal_s16(p, vget_high_s16(v), vget_high_s16(c));
+#if defined(__aarch64__)
+        int32_t sum = vaddvq_s32(p);
+#else
+        int32x2_t h = vadd_s32(vget_low_s32(p), vget_high_s32(p));
+        int32_t sum = vget_lane_s32(vpadd_s32(h, h), 0);
+#endif
+        e[i - order] = x[i] - (sum >> shift);
+    }
+#endif
+    lpcResidualScalar(x, i, n, q, order, shift, e);
+}
+
+/**
+ * Levinson-Durbin，autocorr 长度 order + 1，输出 lpc[0..order) 使 x[n] ≈ Σ lpc[j] * x[n-1-j]
+ * \return          自相关退化时返回 false
+ */
+bool levinsonDurbin(const double* autocorr, int order, double* lpc) {
+    double err = autocorr[0];
+    if (err <= 0.0) return false;
+    double a[FlacEncoder::kMaxLpcOrder + 1] = {0};
+    double tmp[FlacEncoder::kMaxLpcOrder + 1];
+    for (int i = 1; i <= order; ++i) {
+        double acc = autocorr[i];
+        for (int j = 1; j < i; ++j) acc -= a[j] * autocorr[i - j];
+        double k = acc / err;
+        std::memcpy(tmp, a, sizeof(a));
+        a[i] = k;
+        for (int j = 1; j < i; ++j) a[j] = tmp[j] - k * tmp[i - j];
+        err *= (1.0 - k * k);
+        if (err <= 0.0) return false;
+    }
+    for (int j = 0; j < order; ++j) lpc[j] = a[j + 1];
+    return true;
+}
+
+// 量化到 precision 位有符号整数，误差反馈到下一个系数
+bool quantizeLpc(const double* lpc, int order, int precision, int16_t* q, int* shift) {
+    double cmax = 0.0;
+    for (int j = 0; j < order; ++j) cmax = std::max(cmax, std::fabs(lpc[j]));
+    if (cmax <= 0.0) return false;
+
+    int exponent;
+    std::frexp(cmax, &exponent);
+    int s = (precision - 1) - (exponent - 1) - 1;
+    if (s < 0) return false;
+    s = std::min(s, 15);
+
+    const int32_t qmax = (1 << (precision - 1)) - 1;
+    const int32_t qmin = -(1 << (precision - 1));
+    double error = 0.0;
+    for (int j = 0; j < order; ++j) {
+        error += lpc[j] * (1 << s);
+        auto v = static_cast<int32_t>(std::lround(error));
+        v = std::min(std::max(v, qmin), qmax);
+        q[j] = static_cast<int16_t>(v);
+        error -= v;
+    }
+    *shift = s;
+    return true;
+}
+
+} // namespace
+
+/**
+ * 大端比特写入，直接追加到 std::vector 后面，调用方预留好容量
+ */
+class FlacBitWriter {
+public:
+    explicit FlacBitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+    // bits <= 32
+    void put(uint32_t value, int bits) {
+        if (bits == 0) return;
+        accumulator = (accumulator << bits) | (value & (bits == 32 ? 0xFFFFFFFFu : ((1u << bits) - 1)));
+        count += bits;
+        while (count >= 8) {
+            count -= 8;
+            out.push_back(static_cast<uint8_t>(accumulator >> count));
+        }
+    }
+
+    void putSigned(int32_t value, int bits) { put(static_cast<uint32_t>(value), bits); }
+
+    void putRice(uint32_t u, int k) {
+        uint32_t q = u >> k;
+        while (q >= 32) {
+            put(0, 32);
+            q -= 32;
+        }
+        if (q + 1 + k <= 32) {
+            put((1u << k) | (u & ((1u << k) - 1)), static_cast<int>(q + 1 + k));
+        } else {
+            put(1, static_cast<int>(q + 1));
+            put(u & ((1u << k) - 1), k);
+        }
+    }
+
+    void putUtf8(uint64_t value) {
+        if (value < 0x80) {
+            put(static_cast<uint32_t>(value), 8);
+            return;
+        }
+        int bytes = value < 0x800 ? 2 : value < 0x10000 ? 3 : value < 0x200000 ? 4
+                  : value < 0x4000000 ? 5 : value < 0x80000000 ? 6 : 7;
+        uint32_t prefix = (0xFF00u >> bytes) & 0xFF;
+        put(prefix | static_cast<uint32_t>(value >> (6 * (bytes - 1))), 8);
+        for (int i = bytes - 2; i >= 0; --i) {
+            put(0x80 | static_cast<uint32_t>((value >> (6 * i)) & 0x3F), 8);
+        }
+    }
+
+    void align() {
+        if (count > 0) put(0, 8 - count);
+    }
+
+private:
+    std::vector<uint8_t>& out;
+    uint64_t accumulator = 0;
+    int count = 0;
+};
+
+/**
+ * 大端比特读取，越界时置 overrun 并返回 0，由调用方判断是否需要更多数据
+ */
+class FlacBitReader {
+public:
+    FlacBitReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    uint32_t get(int bits) {
+        if (bits == 0) return 0;
+        if (position + bits > size * 8) {
+            overrun = true;
+            position = size * 8;
+            return 0;
+        }
+        uint64_t window = 0;
+        size_t byte = position >> 3;
+        for (size_t i = 0; i < 8; ++i) {
+            window = (window << 8) | (byte + i < size ? data[byte + i] : 0);
+        }
+        window <<= (position & 7);
+        position += bits;
+        return static_cast<uint32_t>(window >> (64 - bits));
+    }
+
+    int32_t getSigned(int bits) {
+        if (bits == 0) return 0;
+        uint32_t v = get(bits);
+        uint32_t sign = 1u << (bits - 1);
+        return static_cast<int32_t>((v ^ sign) - sign);
+    }
+
+    uint32_t getUnary() {
+        uint32_t zeros = 0;
+        while (true) {
+            if (position >= size * 8) {
+                overrun = true;
+                return 0;
+            }
+            // 按字节跳过全 0
+            if ((position & 7) == 0 && data[position >> 3] == 0) {
+                zeros += 8;
+                position += 8;
+                continue;
+            }
+            if ((data[position >> 3] >> (7 - (position & 7))) & 1) {
+                ++position;
+                return zeros;
+            }
+            ++zeros;
+            ++position;
+        }
+    }
+
+    bool getUtf8(uint64_t* value) {
+        uint32_t first = get(8);
+        int bytes = 0;
+        while (bytes < 8 && (first & (0x80u >> bytes))) ++bytes;
+        if (bytes == 1 || bytes > 7) return false;
+        uint64_t v = bytes == 0 ? first : (first & (0x7Fu >> bytes));
+        for (int i = 1; i < bytes; ++i) {
+            uint32_t c = get(8);
+            if ((c & 0xC0) != 0x80) return false;
+            v = (v << 6) | (c & 0x3F);
+        }
+        *value = v;
+        return true;
+    }
+
+    void align() { position = (position + 7) & ~size_t(7); }
+    size_t bytePosition() const { return position >> 3; }
+    bool overrun = false;
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t position = 0;
+};
+
+// ---------------- 编码器 ----------------
+
+FlacEncoder::FlacEncoder(const WavFormat& format)
+    : format(format),
+      pending(kBlockSize * format.channels),
+      residual(kBlockSize),
+      bestResidual(kBlockSize),
+      window(kBlockSize),
+      windowed(kBlockSize) {
+    // Tukey(0.5): 两端各 1/4 做余弦过渡
+    const size_t taper = kBlockSize / 4;
+    for (size_t i = 0; i < kBlockSize; ++i) {
+        double w = 1.0;
+        if (i < taper) {
+            w = 0.5 * (1.0 - std::cos(kPi * static_cast<double>(i) / static_cast<double>(taper)));
+        } else if (i >= kBlockSize - taper) {
+            w = 0.5 * (1.0 - std::cos(kPi * static_cast<double>(kBlockSize - 1 - i) / static_cast<double>(taper)));
+        }
+        window[i] = w;
+    }
+}
+
+void FlacEncoder::streamHeader(uint8_t header[kStreamHeaderBytes]) const {
+    std::memset(header, 0, kStreamHeaderBytes);
+    std::memcpy(header, "fLaC", 4);
+    header[4] = 0x80;           // 最后一个元数据块，类型 0 = STREAMINFO
+    header[7] = 34;
+
+    uint8_t* info = header + 8;
+    info[0] = static_cast<uint8_t>(kBlockSize >> 8);
+    info[1] = static_cast<uint8_t>(kBlockSize);
+    info[2] = info[0];
+    info[3] = info[1];
+    info[4] = static_cast<uint8_t>(minFrameBytes >> 16);
+    info[5] = static_cast<uint8_t>(minFrameBytes >> 8);
+    info[6] = static_cast<uint8_t>(minFrameBytes);
+    info[7] = static_cast<uint8_t>(maxFrameBytes >> 16);
+    info[8] = static_cast<uint8_t>(maxFrameBytes >> 8);
+    info[9] = static_cast<uint8_t>(maxFrameBytes);
+
+    // 采样率 20 位 | 声道数-1 3 位 | 位深-1 5 位 | 总采样帧数 36 位；MD5 留 0 表示未计算
+    uint64_t packed = (static_cast<uint64_t>(format.sampleRate & 0xFFFFF) << 44)
+                      | (static_cast<uint64_t>(format.channels - 1) << 41)
+                      | (static_cast<uint64_t>(kBitsPerSample - 1) << 36)
+                      | (encodedFrames & 0xFFFFFFFFFull);
+    for (int i = 0; i < 8; ++i) {
+        info[10 + i] = static_cast<uint8_t>(packed >> (56 - 8 * i));
+    }
+}
+
+void FlacEncoder::push(const int16_t* samples, size_t frames, std::vector<uint8_t>& out) {
+    const size_t channels = format.channels;
+    while (frames > 0) {
+        size_t n = std::min(frames, kBlockSize - pendingFrames);
+        for (size_t ch = 0; ch < channels; ++ch) {
+            int16_t* dst = pending.data() + ch * kBlockSize + pendingFrames;
+            if (samples == nullptr) {
+                std::fill(dst, dst + n, 0);
+            } else {
+                for (size_t i = 0; i < n; ++i) dst[i] = samples[i * channels + ch];
+            }
+        }
+        if (samples != nullptr) samples += n * channels;
+        frames -= n;
+        pendingFrames += n;
+
+        if (pendingFrames == kBlockSize) {
+            encodeFrame(kBlockSize, out);
+        }
+    }
+}
+
+void FlacEncoder::finish(std::vector<uint8_t>& out) {
+    if (pendingFrames > 0) {
+        encodeFrame(pendingFrames, out);
+    }
+}
+
+void FlacEncoder::encodeFrame(size_t frames, std::vector<uint8_t>& out) {
+    const size_t start = out.size();
+    FlacBitWriter bits(out);
+
+    const bool fullBlock = frames == kBlockSize;
+    bits.put(0xFFF8, 16);                               // 同步码 + 定长块
+    bits.put(fullBlock ? 12 : 7, 4);                    // 12: 4096，7: 帧头末尾附 16 位块长
+    bits.put(static_cast<uint32_t>(sampleRateCode(format.sampleRate)), 4);
+    bits.put(format.channels - 1u, 4);                  // 独立声道
+    bits.put(4, 3);                                     // 16 位
+    bits.put(0, 1);
+    bits.putUtf8(frameNumber);
+    if (!fullBlock) bits.put(static_cast<uint32_t>(frames - 1), 16);
+    bits.put(crc8(out.data() + start, out.size() - start), 8);
+
+    for (size_t ch = 0; ch < format.channels; ++ch) {
+        encodeSubframe(pending.data() + ch * kBlockSize, frames, bits);
+    }
+    bits.align();
+    bits.put(crc16(out.data() + start, out.size() - start), 16);
+
+    auto frameBytes = static_cast<uint32_t>(out.size() - start);
+    minFrameBytes = minFrameBytes == 0 ? frameBytes : std::min(minFrameBytes, frameBytes);
+    maxFrameBytes = std::max(maxFrameBytes, frameBytes);
+
+#if defined(AUDIO_SINK_FLAC_VERIFY)
+    {
+        FlacDecoder verifier;
+        size_t consumed = 0;
+        verifyPcm.clear();
+        bool same = verifier.decodeFrame(out.data() + start, frameBytes, verifyPcm, &consumed)
+                    == FlacDecoder::Result::Frame
+                    && consumed == frameBytes && verifyPcm.size() == frames * format.channels;
+        for (size_t i = 0; same && i < frames; ++i) {
+            for (size_t ch = 0; ch < format.channels; ++ch) {
+                same = same && verifyPcm[i * format.channels + ch] == pending[ch * kBlockSize + i];
+            }
+        }
+        if (!same) ++mismatches;
+    }
+#endif
+
+    encodedFrames += frames;
+    pendingFrames = 0;
+    ++frameNumber;
+}
+
+void FlacEncoder::encodeSubframe(const int16_t* x, size_t n, FlacBitWriter& bits) {
+    // CONSTANT
+    if (std::all_of(x + 1, x + n, [&](int16_t v) { return v == x[0]; })) {
+        bits.put(0x00, 8);
+        bits.putSigned(x[0], kBitsPerSample);
+        return;
+    }
+
+    const uint64_t verbatimBits = 8 + n * kBitsPerSample;
+
+    // FIXED
+    int fixedOrder = n > 4 ? bestFixedOrder(x, n, 4) : 0;
+    fixedResidual(x, n, fixedOrder, bestResidual.data());
+    RicePlan bestPlan = planResidual(bestResidual.data(), n, fixedOrder);
+    uint64_t bestBits = 8 + fixedOrder * kBitsPerSample + bestPlan.bits;
+
+    // LPC
+    int lpcOrder = 0;
+    int16_t q[kMaxLpcOrder];
+    int shift = 0;
+    if (n > static_cast<size_t>(kMaxLpcOrder) * 4) {
+        const double* w = window.data();
+        std::vector<double> partialWindow;
+        if (n != kBlockSize) {
+            // 最后一帧长度不同，窗口现算
+            partialWindow.resize(n);
+            const size_t taper = n / 4;
+            for (size_t i = 0; i < n; ++i) {
+                double v = 1.0;
+                if (i < taper) v = 0.5 * (1.0 - std::cos(kPi * i / taper));
+                else if (i >= n - taper) v = 0.5 * (1.0 - std::cos(kPi * (n - 1 - i) / taper));
+                partialWindow[i] = v;
+            }
+            w = partialWindow.data();
+        }
+        for (size_t i = 0; i < n; ++i) windowed[i] = x[i] * w[i];
+
+        double autocorr[kMaxLpcOrder + 1];
+        for (int lag = 0; lag <= kMaxLpcOrder; ++lag) {
+            double sum = 0.0;
+            for (size_t i = lag; i < n; ++i) sum += windowed[i] * windowed[i - lag];
+            autocorr[lag] = sum;
+        }
+        autocorr[0] *= 1.0 + 1e-9;      // 轻微白化，避免病态
+
+        double lpc[kMaxLpcOrder];
+        if (levinsonDurbin(autocorr, kMaxLpcOrder, lpc)
+            && quantizeLpc(lpc, kMaxLpcOrder, kLpcPrecision, q, &shift)) {
+            lpcResidual(x, n, q, kMaxLpcOrder, shift, residual.data());
+            RicePlan plan = planResidual(residual.data(), n, kMaxLpcOrder);
+            uint64_t lpcBits = 8 + kMaxLpcOrder * kBitsPerSample + 4 + 5 + kMaxLpcOrder * kLpcPrecision + plan.bits;
+            if (lpcBits < bestBits) {
+                bestBits = lpcBits;
+                bestPlan = plan;
+                lpcOrder = kMaxLpcOrder;
+                std::swap(residual, bestResidual);
+            }
+        }
+    }
+
+    // VERBATIM
+    if (verbatimBits <= bestBits) {
+        bits.put(0x02, 8);
+        for (size_t i = 0; i < n; ++i) bits.putSigned(x[i], kBitsPerSample);
+        return;
+    }
+
+    const int order = lpcOrder > 0 ? lpcOrder : fixedOrder;
+    if (lpcOrder > 0) {
+        bits.put(static_cast<uint32_t>(0x20 | (lpcOrder - 1)) << 1, 8);
+    } else {
+        bits.put(static_cast<uint32_t>(0x08 | fixedOrder) << 1, 8);
+    }
+    for (int i = 0; i < order; ++i) bits.putSigned(x[i], kBitsPerSample);
+    if (lpcOrder > 0) {
+        bits.put(kLpcPrecision - 1, 4);
+        bits.putSigned(shift, 5);
+        for (int j = 0; j < lpcOrder; ++j) bits.putSigned(q[j], kLpcPrecision);
+    }
+
+    // 分区 Rice 残差
+    bits.put(0, 2);
+    bits.put(static_cast<uint32_t>(bestPlan.partitionOrder), 4);
+    const size_t partitions = size_t(1) << bestPlan.partitionOrder;
+    const size_t partitionSize = n >> bestPlan.partitionOrder;
+    size_t index = 0;
+    for (size_t p = 0; p < partitions; ++p) {
+        int k = bestPlan.parameters[p];
+        bits.put(static_cast<uint32_t>(k), 4);
+        size_t count = partitionSize - (p == 0 ? order : 0);
+        for (size_t i = 0; i < count; ++i) bits.putRice(fold(bestResidual[index + i]), k);
+        index += count;
+    }
+}
+
+// ---------------- 解码器 ----------------
+
+namespace {
+
+bool decodeResidual(FlacBitReader& br, size_t blockSize, int order, int32_t* out) {
+    uint32_t method = br.get(2);
+    if (method > 1) return false;
+    const int parameterBits = method == 0 ? 4 : 5;
+    const uint32_t escape = method == 0 ? 15 : 31;
+    const int partitionOrder = static_cast<int>(br.get(4));
+    const size_t partitions = size_t(1) << partitionOrder;
+    const size_t partitionSize = blockSize >> partitionOrder;
+    if ((partitionSize << partitionOrder) != blockSize || partitionSize < static_cast<size_t>(order)) return false;
+
+    size_t index = order;
+    for (size_t p = 0; p < partitions && !br.overrun; ++p) {
+        size_t count = partitionSize - (p == 0 ? order : 0);
+        uint32_t k = br.get(parameterBits);
+        if (k == escape) {
+            int raw = static_cast<int>(br.get(5));
+            for (size_t i = 0; i < count; ++i) out[index++] = br.getSigned(raw);
+        } else {
+            for (size_t i = 0; i < count && !br.overrun; ++i) {
+                uint32_t q = br.getUnary();
+                out[index++] = unfold((q << k) | br.get(static_cast<int>(k)));
+            }
+        }
+    }
+    return true;
+}
+
+bool decodeSubframe(FlacBitReader& br, int bps, size_t blockSize, int32_t* out) {
+    if (br.get(1) != 0) return false;
+    uint32_t type = br.get(6);
+    int wasted = 0;
+    if (br.get(1)) {
+        wasted = static_cast<int>(br.getUnary()) + 1;
+        bps -= wasted;
+    }
+    if (bps <= 0) return false;
+
+    if (type == 0) {
+        int32_t v = br.getSigned(bps);
+        std::fill(out, out + blockSize, v);
+    } else if (type == 1) {
+        for (size_t i = 0; i < blockSize; ++i) out[i] = br.getSigned(bps);
+    } else if (type >= 8 && type <= 12) {
+        int order = static_cast<int>(type - 8);
+        if (static_cast<size_t>(order) > blockSize) return false;
+        for (int i = 0; i < order; ++i) out[i] = br.getSigned(bps);
+        if (!decodeResidual(br, blockSize, order, out)) return false;
+        for (size_t i = order; i < blockSize; ++i) {
+            switch (order) {
+                case 0: break;
+                case 1: out[i] += out[i - 1]; break;
+                case 2: out[i] += 2 * out[i - 1] - out[i - 2]; break;
+                case 3: out[i] += 3 * out[i - 1] - 3 * out[i - 2] + out[i - 3]; break;
+                default: out[i] += 4 * out[i - 1] - 6 * out[i - 2] + 4 * out[i - 3] - out[i - 4]; break;
+            }
+        }
+    } else if (type >= 32) {
+        int order = static_cast<int>(type - 31);
+        if (static_cast<size_t>(order) > blockSize) return false;
+        for (int i = 0; i < order; ++i) out[i] = br.getSigned(bps);
+        int precision = static_cast<int>(br.get(4)) + 1;
+        if (precision == 16) return false;
+        int shift = br.getSigned(5);
+        if (shift < 0) return false;
+        int32_t coefs[32];
+        for (int j = 0; j < order; ++j) coefs[j] = br.getSigned(precision);
+        if (!decodeResidual(br, blockSize, order, out)) return false;
+        for (size_t i = order; i < blockSize; ++i) {
+            int64_t sum = 0;
+            for (int j = 0; j < order; ++j) sum += static_cast<int64_t>(coefs[j]) * out[i - 1 - j];
+            out[i] += static_cast<int32_t>(sum >> shift);
+        }
+    } else {
+        return false;
+    }
+
+    if (wasted > 0) {
+        for (size_t i = 0; i < blockSize; ++i) out[i] = static_cast<int32_t>(static_cast<uint32_t>(out[i]) << wasted);
+    }
+    return true;
+}
+
+} // namespace
+
+FlacDecoder::Result FlacDecoder::parseHeader(const uint8_t* data, size_t size, size_t* consumed) {
+    if (size < 4) return Result::NeedMore;
+    if (std::memcmp(data, "fLaC", 4) != 0) return Result::Error;
+
+    size_t offset = 4;
+    bool last = false;
+    while (!last) {
+        if (size < offset + 4) return Result::NeedMore;
+        last = (data[offset] & 0x80) != 0;
+        uint32_t type = data[offset] & 0x7F;
+        size_t length = (size_t(data[offset + 1]) << 16) | (size_t(data[offset + 2]) << 8) | data[offset + 3];
+        if (size < offset + 4 + length) return Result::NeedMore;
+
+        if (type == 0 && length >= 34) {
+            const uint8_t* info = data + offset + 4;
+            uint64_t packed = 0;
+            for (int i = 0; i < 8; ++i) packed = (packed << 8) | info[10 + i];
+            format.sampleRate = static_cast<uint32_t>(packed >> 44);
+            format.channels = static_cast<uint16_t>(((packed >> 41) & 0x7) + 1);
+            format.bitsPerSample = static_cast<uint16_t>(((packed >> 36) & 0x1F) + 1);
+        }
+        offset += 4 + length;
+    }
+    if (format.bitsPerSample == 0 || format.bitsPerSample > 16) return Result::Error;
+
+    *consumed = offset;
+    return Result::Frame;
+}
+
+FlacDecoder::Result FlacDecoder::decodeFrame(const uint8_t* data, size_t size, std::vector<int16_t>& pcm,
+                                             size_t* consumed) {
+    FlacBitReader br(data, size);
+    uint32_t sync = br.get(15);
+    if (br.overrun) return Result::NeedMore;
+    if (sync != 0x7FFC) return Result::Error;
+    br.get(1);      // 定长 / 变长块都按帧头里的块长解码
+
+    uint32_t blockCode = br.get(4);
+    uint32_t rateCode = br.get(4);
+    uint32_t channelCode = br.get(4);
+    uint32_t sizeCode = br.get(3);
+    br.get(1);
+    uint64_t number;
+    bool numberOk = br.getUtf8(&number);
+    if (br.overrun) return Result::NeedMore;
+    if (!numberOk) return Result::Error;
+
+    size_t blockSize;
+    if (blockCode == 1) blockSize = 192;
+    else if (blockCode >= 2 && blockCode <= 5) blockSize = size_t(576) << (blockCode - 2);
+    else if (blockCode == 6) blockSize = br.get(8) + 1;
+    else if (blockCode == 7) blockSize = br.get(16) + 1;
+    else if (blockCode >= 8) blockSize = size_t(256) << (blockCode - 8);
+    else return Result::Error;
+    if (br.overrun) return Result::NeedMore;
+
+    if (rateCode == 12) br.get(8);
+    else if (rateCode == 13 || rateCode == 14) br.get(16);
+    else if (rateCode == 15) return Result::Error;
+
+    int bps;
+    switch (sizeCode) {
+        case 0: bps = format.bitsPerSample; break;
+        case 1: bps = 8; break;
+        case 2: bps = 12; break;
+        case 4: bps = 16; break;
+        default: return Result::Error;
+    }
+    if (bps <= 0 || bps > 16) return Result::Error;
+
+    if (br.overrun) return Result::NeedMore;
+    size_t headerBytes = br.bytePosition();
+    uint32_t headerCrc = br.get(8);
+    if (br.overrun) return Result::NeedMore;
+    if (headerCrc != crc8(data, headerBytes)) return Result::Error;
+
+    size_t channels = channelCode < 8 ? channelCode + 1 : 2;
+    if (channelCode > 10) return Result::Error;
+
+    channelData.resize(channels * blockSize);
+    for (size_t ch = 0; ch < channels; ++ch) {
+        // side 声道多 1 位
+        bool side = (channelCode == 8 && ch == 1) || (channelCode == 9 && ch == 0) || (channelCode == 10 && ch == 1);
+        if (!decodeSubframe(br, bps + (side ? 1 : 0), blockSize, channelData.data() + ch * blockSize)) {
+            return br.overrun ? Result::NeedMore : Result::Error;
+        }
+        if (br.overrun) return Result::NeedMore;
+    }
+    br.align();
+    size_t frameBytes = br.bytePosition();
+    uint32_t frameCrc = br.get(16);
+    if (br.overrun) return Result::NeedMore;
+    if (frameCrc != crc16(data, frameBytes)) return Result::Error;
+
+    int32_t* a = channelData.data();
+    int32_t* b = channelData.data() + blockSize;
+    for (size_t i = 0; i < blockSize && channelCode >= 8; ++i) {
+        if (channelCode == 8) {
+            b[i] = a[i] - b[i];
+        } else if (channelCode == 9) {
+            a[i] = a[i] + b[i];
+        } else {
+            int32_t mid = static_cast<int32_t>(static_cast<uint32_t>(a[i]) << 1) | (b[i] & 1);
+            a[i] = (mid + b[i]) >> 1;
+            b[i] = (mid - b[i]) >> 1;
+        }
+    }
+
+    const int scale = 16 - bps;
+    size_t base = pcm.size();
+    pcm.resize(base + blockSize * channels);
+    for (size_t i = 0; i < blockSize; ++i) {
+        for (size_t ch = 0; ch < channels; ++ch) {
+            pcm[base + i * channels + ch] = static_cast<int16_t>(channelData[ch * blockSize + i] * (1 << scale));
+        }
+    }
+    *consumed = frameBytes + 2;
+    return Result::Frame;
+}
+
+bool FlacDecoder::decode(const uint8_t* data, size_t size, std::vector<int16_t>& pcm) {
+    buffer.insert(buffer.end(), data, data + size);
+
+    while (position < buffer.size()) {
+        size_t consumed = 0;
+        Result result = headerParsed
+                        ? decodeFrame(buffer.data() + position, buffer.size() - position, pcm, &consumed)
+                        : parseHeader(buffer.data() + position, buffer.size() - position, &consumed);
+        if (result == Result::NeedMore) break;
+        if (result == Result::Error) return false;
+        headerParsed = true;
+        position += consumed;
+    }
+
+    // 已消费的部分超过一半时整理缓冲区
+    if (position > 0 && position * 2 >= buffer.size()) {
+        buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(position));
+        position = 0;
+    }
+    return true;
+}
@@ -0,0 +1,107 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_FLACCODEC_H
+#define AAUDIORECORDER_FLACCODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "WavFormat.h"
+
+class FlacBitWriter;
+
+/**
+ * 16-bit PCM 的流式 FLAC 编码器
+ *
+ * 输出标准 FLAC 码流 ("fLaC" + STREAMINFO + 定长帧)，可以直接用 flac / ffmpeg 解码。
+ * 每帧 kBlockSize 个采样帧，声道独立编码，每个声道在以下子帧中选最小的：
+ *   - CONSTANT: 整块同值 (静音、丢帧留下的空洞)
+ *   - FIXED:    0 ~ 4 阶固定多项式预测
+ *   - LPC:      Levinson-Durbin 求 kMaxLpcOrder 阶系数，量化到 kLpcPrecision 位
+ *   - VERBATIM: 兜底
+ * 残差使用分区 Rice 编码，分区阶数和参数按估算的比特数选择。
+ * 量化系数和采样都在 int16 范围内，LPC 残差用 SSE2 (pmaddwd) / NEON (vmlal) 计算，结果与标量一致。
+ *
+ * 编译时定义 AUDIO_SINK_FLAC_VERIFY 时，每编码一帧立即解码并与输入逐位比较。
+ */
+class FlacEncoder {
+public:
+    static constexpr size_t kBlockSize = 4096;
+    static constexpr int kMaxLpcOrder = 8;
+    static constexpr int kLpcPrecision = 12;
+    static constexpr int kMaxPartitionOrder = 6;
+    static constexpr size_t kStreamHeaderBytes = 42;    // "fLaC" + STREAMINFO
+    static constexpr size_t kMaxFrameBytes = kBlockSize * 2 * 8 + 64;
+
+    explicit FlacEncoder(const WavFormat& format);
+
+    // 生成文件头，编码过程中或结束后都可以调用，用于刷新总长度和帧大小范围
+    void streamHeader(uint8_t header[kStreamHeaderBytes]) const;
+
+    // 送入交织 int16，samples 为空时送入静音；每凑满 kBlockSize 编码一帧追加到 out
+    void push(const int16_t* samples, size_t frames, std::vector<uint8_t>& out);
+
+    // 不足一帧的剩余采样编码为最后一帧
+    void finish(std::vector<uint8_t>& out);
+
+    uint64_t totalFrames() const { return encodedFrames + pendingFrames; }
+    uint64_t verifyErrors() const { return mismatches; }
+
+private:
+    void encodeFrame(size_t frames, std::vector<uint8_t>& out);
+    void encodeSubframe(const int16_t* x, size_t n, FlacBitWriter& bits);
+
+    WavFormat format;
+    std::vector<int16_t> pending;       // 平面存放，每声道 kBlockSize
+    size_t pendingFrames = 0;
+    uint64_t encodedFrames = 0;
+    uint64_t frameNumber = 0;
+    uint32_t minFrameBytes = 0;
+    uint32_t maxFrameBytes = 0;
+    uint64_t mismatches = 0;
+
+    // 编码一帧用到的临时缓冲，构造时分配
+    std::vector<int32_t> residual;
+    std::vector<int32_t> bestResidual;
+    std::vector<double> window;         // Tukey(0.5)，kBlockSize 点
+    std::vector<double> windowed;
+    std::vector<int16_t> verifyPcm;
+};
+
+/**
+ * 流式 FLAC 解码器，输出交织 int16
+ * 支持 16 位以内的定长/变长帧、独立和 left/right/mid-side 声道、所有子帧类型及两种 Rice 编码方式
+ */
+class FlacDecoder {
+public:
+    enum class Result { Frame, NeedMore, Error };
+
+    /**
+     * 送入任意长度的码流，把已经完整的帧解出追加到 pcm
+     * \return          码流损坏时返回 false
+     */
+    bool decode(const uint8_t* data, size_t size, std::vector<int16_t>& pcm);
+
+    /**
+     * 解码 data 开头的一帧 (不含文件头)
+     * \param consumed  成功时为这一帧的字节数
+     */
+    Result decodeFrame(const uint8_t* data, size_t size, std::vector<int16_t>& pcm, size_t* consumed);
+
+    bool hasFormat() const { return headerParsed; }
+    const WavFormat& streamFormat() const { return format; }
+
+private:
+    Result parseHeader(const uint8_t* data, size_t size, size_t* consumed);
+
+    std::vector<uint8_t> buffer;
+    size_t position = 0;
+    bool headerParsed = false;
+    WavFormat format{0, 0, 0};
+    std::vector<int32_t> channelData;
+};
+
+#endif //AAUDIORECORDER_FLACCODEC_H
@@ -0,0 +1,77 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_FRAMESIGNAL_H
+#define AAUDIORECORDER_FRAMESIGNAL_H
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <climits>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * 音频回调线程 -> 处理线程 的唤醒通道
+ *
+ * 生产者(dataCallback)只做原子操作：递增 sequence，只有当消费者已经挂起
+ * 并且可读数据达到阈值时才发起一次 FUTEX_WAKE，不持有任何锁，不会因为
+ * 处理线程持锁而发生优先级反转。
+ *
+ * 消费者(handlerLoop)先发布 parked 标记，再读取 sequence 并重新检查条件，
+ * 最后在 sequence 上 FUTEX_WAIT；与生产者的 seq/parked 顺序构成 Dekker 配对，
+ * 不会丢失唤醒。
+ */
+class FrameSignal {
+public:
+    // 生产者：数据已写入 ring buffer 之后调用，available 为当前可读量
+    void publish(size_t available, size_t threshold) {
+        sequence.fetch_add(1, std::memory_order_seq_cst);
+        if (parked.load(std::memory_order_seq_cst) && available >= threshold) {
+            futexWake(1);
+        }
+    }
+
+    // 消费者：阻塞直到 ready() 为真，或超时 timeoutMs 毫秒
+    template <typename Ready>
+    bool wait(Ready ready, int timeoutMs) {
+        if (ready()) return true;
+
+        parked.store(true, std::memory_order_seq_cst);
+        uint32_t seq = sequence.load(std::memory_order_seq_cst);
+        if (ready()) {
+            parked.store(false, std::memory_order_relaxed);
+            return true;
+        }
+
+        timespec timeout{timeoutMs / 1000, (timeoutMs % 1000) * 1000000L};
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&sequence), FUTEX_WAIT_PRIVATE,
+                seq, &timeout, nullptr, 0);
+
+        parked.store(false, std::memory_order_relaxed);
+        return ready();
+    }
+
+    // 退出时唤醒所有等待者
+    void wakeAll() {
+        sequence.fetch_add(1, std::memory_order_seq_cst);
+        futexWake(INT_MAX);
+    }
+
+private:
+    void futexWake(int count) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&sequence), FUTEX_WAKE_PRIVATE,
+                count, nullptr, nullptr, 0);
+    }
+
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be 32-bit");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "futex word must be lock free");
+
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<bool> parked{false};
+};
+
+#endif //AAUDIORECORDER_FRAMESIGNAL_H
@@ -0,0 +1,215 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include "MappedAudioFile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "RecorderLog.h"
+
+namespace {
+
+inline uint16_t get16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline uint32_t get32(const uint8_t* p) {
+    return get16(p) | (static_cast<uint32_t>(get16(p + 2)) << 16);
+}
+
+inline uint64_t get64(const uint8_t* p) {
+    return get32(p) | (static_cast<uint64_t>(get32(p + 4)) << 32);
+}
+
+constexpr uint16_t kFormatPcm = 1;
+constexpr uint16_t kFormatExtensible = 0xFFFE;
+
+} // namespace
+
+bool MappedAudioFile::open(const char* path, const WavFormat& rawFormat) {
+    close();
+
+    fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOGE("Failed to open %s: %s", path, strerror(errno));
+        return false;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        LOGE("Empty or unreadable input %s", path);
+        close();
+        return false;
+    }
+
+    auto size = static_cast<size_t>(st.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+        LOGE("mmap %s failed: %s", path, strerror(errno));
+        close();
+        return false;
+    }
+    base = static_cast<uint8_t*>(mapped);
+    mappedBytes = size;
+    madvise(base, mappedBytes, MADV_SEQUENTIAL);
+
+    if (size >= 12 && (std::memcmp(base, "RIFF", 4) == 0 || std::memcmp(base, "RF64", 4) == 0)
+        && std::memcmp(base + 8, "WAVE", 4) == 0) {
+        if (!parseWav(size)) {
+            close();
+            return false;
+        }
+        wav = true;
+    } else {
+        fileFormat = rawFormat;
+        dataOffset = 0;
+        frames = size / fileFormat.blockAlign();
+    }
+
+    if (dataOffset % sizeof(int16_t) != 0) {
+        LOGI("WAV data chunk is not 2-byte aligned, frames will be copied");
+    }
+
+    cursor = 0;
+    advisedUntil = 0;
+    releasedUntil = 0;
+    advise(dataOffset);
+    return true;
+}
+
+void MappedAudioFile::close() {
+    if (base != nullptr) {
+        munmap(base, mappedBytes);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = -1;
+    base = nullptr;
+    mappedBytes = 0;
+    dataOffset = 0;
+    frames = 0;
+    cursor = 0;
+    wav = false;
+}
+
+bool MappedAudioFile::parseWav(size_t size) {
+    const bool rf64 = std::memcmp(base, "RF64", 4) == 0;
+    uint64_t ds64DataBytes = 0;
+    bool haveFormat = false;
+
+    size_t offset = 12;
+    while (offset + 8 <= size) {
+        const uint8_t* chunk = base + offset;
+        uint64_t chunkBytes = get32(chunk + 4);
+        const size_t body = offset + 8;
+
+        if (std::memcmp(chunk, "ds64", 4) == 0 && chunkBytes >= 24 && body + 24 <= size) {
+            ds64DataBytes = get64(base + body + 8);
+        } else if (std::memcmp(chunk, "fmt ", 4) == 0 && chunkBytes >= 16 && body + 16 <= size) {
+            uint16_t tag = get16(base + body);
+            // WAVE_FORMAT_EXTENSIBLE 的子格式 GUID 前两个字节就是实际的格式标签
+            if (tag == kFormatExtensible && chunkBytes >= 40 && body + 26 <= size) {
+                tag = get16(base + body + 24);
+            }
+            fileFormat.channels = get16(base + body + 2);
+            fileFormat.sampleRate = get32(base + body + 4);
+            fileFormat.bitsPerSample = get16(base + body + 14);
+            if (tag != kFormatPcm || fileFormat.bitsPerSample != 16 || fileFormat.channels == 0) {
+                LOGE("Unsupported WAV format tag %u, %u bits, %u channels",
+                     tag, fileFormat.bitsPerSample, fileFormat.channels);
+                return false;
+            }
+            haveFormat = true;
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat) {
+                LOGE("WAV data chunk before fmt chunk");
+                return false;
+            }
+            if (rf64 && chunkBytes == UINT32_MAX) {
+                chunkBytes = ds64DataBytes;
+            }
+            // 长度没有刷新 (0) 或者文件被截断时，以实际文件长度为准
+            const uint64_t remaining = size - body;
+            if (chunkBytes == 0 || chunkBytes > remaining) {
+                chunkBytes = remaining;
+            }
+            dataOffset = body;
+            frames = chunkBytes / fileFormat.blockAlign();
+            return true;
+        }
+
+        offset = body + static_cast<size_t>(chunkBytes) + (chunkBytes & 1);
+    }
+
+    LOGE("WAV file has no data chunk");
+    return false;
+}
+
+bool MappedAudioFile::next(size_t count, PcmFrameView& view) {
+    if (base == nullptr || frames - cursor < count) {
+        return false;
+    }
+
+    const size_t bytes = count * fileFormat.blockAlign();
+    const size_t offset = dataOffset + static_cast<size_t>(cursor) * fileFormat.blockAlign();
+    advise(offset + bytes);
+
+    const int16_t* data;
+    if (dataOffset % sizeof(int16_t) == 0) {
+        data = reinterpret_cast<const int16_t*>(base + offset);
+    } else {
+        if (unaligned.size() < count * fileFormat.channels) {
+            unaligned.resize(count * fileFormat.channels);
+        }
+        std::memcpy(unaligned.data(), base + offset, bytes);
+        data = unaligned.data();
+    }
+
+    view.spans[0] = {data, count * fileFormat.channels};
+    view.count = 1;
+    view.samples = count * fileFormat.channels;
+    cursor += count;
+    return true;
+}
+
+void MappedAudioFile::seek(uint64_t frame) {
+    if (base == nullptr) return;
+    cursor = std::min(frame, frames);
+
+    // 预读和释放窗口从新位置重新开始
+    const auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t offset = dataOffset + static_cast<size_t>(cursor) * fileFormat.blockAlign();
+    advisedUntil = offset & ~(page - 1);
+    releasedUntil = advisedUntil;
+    advise(offset);
+}
+
+void MappedAudioFile::advise(size_t offset) {
+    const auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    // 预读提前量用完一半时再发起下一段，每 2MB 一次 madvise
+    if (offset + kReadAheadBytes / 2 > advisedUntil && advisedUntil < mappedBytes) {
+        size_t begin = advisedUntil & ~(page - 1);
+        size_t end = std::min(mappedBytes, offset + kReadAheadBytes);
+        madvise(base + begin, end - begin, MADV_WILLNEED);
+        advisedUntil = end;
+    }
+
+    // 已经处理过的页面交还给系统，同样按 kReadAheadBytes 批量进行
+    size_t done = offset > kReadAheadBytes ? (offset - kReadAheadBytes) & ~(page - 1) : 0;
+    if (done >= releasedUntil + kReadAheadBytes) {
+        // 文件映射上的 MADV_DONTNEED 只解除映射，页缓存要靠 fadvise 释放
+        madvise(base + releasedUntil, done - releasedUntil, MADV_DONTNEED);
+        posix_fadvise(fd, static_cast<off_t>(releasedUntil), static_cast<off_t>(done - releasedUntil),
+                      POSIX_FADV_DONTNEED);
+        releasedUntil = done;
+    }
+}
@@ -0,0 +1,72 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_MAPPEDAUDIOFILE_H
+#define AAUDIORECORDER_MAPPEDAUDIOFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PcmFrameView.h"
+#include "WavFormat.h"
+
+/**
+ * 只读映射的 16-bit PCM 文件，离线处理时直接在映射内存上取帧视图
+ *
+ * - WAV (RIFF / RF64) 按头部解析格式和 data 块；长度字段为 0 或超出文件时取到文件末尾，
+ *   可以读取录音中途崩溃、头部没来得及刷新的文件
+ * - 其它文件按调用方给出的格式当作裸 PCM
+ * - 整个文件 MADV_SEQUENTIAL，读指针前方 kReadAheadBytes 提前 MADV_WILLNEED
+ * - 后方已经处理过的部分先 MADV_DONTNEED 解除本进程的映射，再 POSIX_FADV_DONTNEED
+ *   让内核丢掉这些干净的页缓存。只用 MADV_DONTNEED 时文件页仍然留在页缓存里，
+ *   几个小时的录音会把页缓存占满，所以映射期间一直持有 fd
+ */
+class MappedAudioFile {
+public:
+    static constexpr size_t kReadAheadBytes = 4 * 1024 * 1024;
+
+    MappedAudioFile() = default;
+    ~MappedAudioFile() { close(); }
+
+    MappedAudioFile(const MappedAudioFile&) = delete;
+    MappedAudioFile& operator=(const MappedAudioFile&) = delete;
+
+    bool open(const char* path, const WavFormat& rawFormat);
+    void close();
+    bool is_open() const { return base != nullptr; }
+
+    const WavFormat& format() const { return fileFormat; }
+    bool isWav() const { return wav; }
+    uint64_t totalFrames() const { return frames; }
+    uint64_t position() const { return cursor; }
+
+    /**
+     * 取下一段 count 帧的视图并前移读指针，剩余不足 count 帧时返回 false
+     * 视图指向映射内存，在下一次 next / close 之前有效
+     */
+    bool next(size_t count, PcmFrameView& view);
+
+    // 把读指针移到第 frame 帧，超出时停在末尾
+    void seek(uint64_t frame);
+    void rewind() { seek(0); }
+
+private:
+    bool parseWav(size_t size);
+    void advise(size_t offset);
+
+    int fd = -1;                        // posix_fadvise 需要，close() 时关闭
+    uint8_t* base = nullptr;
+    size_t mappedBytes = 0;
+    size_t dataOffset = 0;
+    uint64_t frames = 0;
+    uint64_t cursor = 0;
+    size_t advisedUntil = 0;
+    size_t releasedUntil = 0;
+    bool wav = false;
+    WavFormat fileFormat{0, 0, 0};
+    std::vector<int16_t> unaligned;     // data 块起点不是 2 字节对齐时才使用
+};
+
+#endif //AAUDIORECORDER_MAPPEDAUDIOFILE_H
@@ -0,0 +1,82 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_MPSCQUEUE_H
+#define AAUDIORECORDER_MPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+/**
+ * 多生产者单消费者的有界无锁队列 (Vyukov)
+ *
+ * - Capacity 必须是 2 的幂，存储区在构造时一次分配，push / pop 都不分配内存
+ * - 每个槽位带一个序号：生产者 CAS 抢到写下标后写入数据再发布序号，消费者只看序号，不需要 CAS
+ * - 队列满时 push 直接返回 false，不会阻塞任何一方
+ * T 应当是可平凡拷贝的小对象，用来传递控制命令而不是音频数据
+ */
+template <typename T, size_t Capacity>
+class MpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be power of two");
+
+public:
+    static constexpr size_t kMask = Capacity - 1;
+
+    MpscQueue() {
+        for (size_t i = 0; i < Capacity; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // 任意线程调用，队列满时返回 false
+    bool push(const T& value) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & kMask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 只能在消费者线程上调用，队列空 (或下一个槽位还没写完) 时返回 false
+    bool pop(T& out) {
+        Cell& cell = cells[head & kMask];
+        if (cell.sequence.load(std::memory_order_acquire) != head + 1) return false;
+        out = cell.value;
+        cell.sequence.store(head + Capacity, std::memory_order_release);
+        ++head;
+        return true;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence{0};
+        T value{};
+    };
+
+    Cell cells[Capacity];
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail{0};
+    alignas(CACHE_LINE_SIZE) size_t head = 0;
+};
+
+#endif //AAUDIORECORDER_MPSCQUEUE_H
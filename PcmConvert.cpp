@@ -0,0 +1,272 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include "PcmConvert.h"
+
+#include <algorithm>
+
+#include "system_wrappers/include/cpu_features_wrapper.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PCM_CONVERT_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#define PCM_CONVERT_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+constexpr float kToFloat = 1.0f / 32768.0f;
+constexpr float kToS16 = 32768.0f;
+constexpr float kS16Min = -32768.0f;
+constexpr float kS16Max = 32767.0f;
+
+inline int16_t floatToS16(float x) {
+    float v = std::min(std::max(x * kToS16, kS16Min), kS16Max);
+    return static_cast<int16_t>(static_cast<int32_t>(v + (v < 0.0f ? -0.5f : 0.5f)));
+}
+
+void deinterleave2Scalar(const int16_t* src, size_t frames, float* left, float* right) {
+    for (size_t i = 0; i < frames; ++i) {
+        left[i] = src[2 * i] * kToFloat;
+        right[i] = src[2 * i + 1] * kToFloat;
+    }
+}
+
+#if defined(PCM_CONVERT_X86)
+
+// ---------------- SSE2 ----------------
+
+inline __m128 roundHalfAwaySse2(__m128 v) {
+    const __m128 sign = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int32_t>(0x80000000u)));
+    return _mm_add_ps(v, _mm_or_ps(_mm_and_ps(v, sign), _mm_set1_ps(0.5f)));
+}
+
+void s16ToFloatSse2(const int16_t* src, float* dst, size_t n) {
+    const __m128 scale = _mm_set1_ps(kToFloat);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    for (; i < n; ++i) dst[i] = src[i] * kToFloat;
+}
+
+void floatToS16Sse2(const float* src, int16_t* dst, size_t n) {
+    const __m128 scale = _mm_set1_ps(kToS16);
+    const __m128 lo = _mm_set1_ps(kS16Min);
+    const __m128 hi = _mm_set1_ps(kS16Max);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), lo), hi);
+        __m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale), lo), hi);
+        __m128i ia = _mm_cvttps_epi32(roundHalfAwaySse2(a));
+        __m128i ib = _mm_cvttps_epi32(roundHalfAwaySse2(b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(ia, ib));
+    }
+    for (; i < n; ++i) dst[i] = floatToS16(src[i]);
+}
+
+void deinterleave2Sse2(const int16_t* src, size_t frames, float* left, float* right) {
+    const __m128 scale = _mm_set1_ps(kToFloat);
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        // 4 个 L/R 对看作 4 个 int32：低 16 位是左声道，高 16 位是右声道
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+        __m128i l = _mm_srai_epi32(_mm_slli_epi32(x, 16), 16);
+        __m128i r = _mm_srai_epi32(x, 16);
+        _mm_storeu_ps(left + i, _mm_mul_ps(_mm_cvtepi32_ps(l), scale));
+        _mm_storeu_ps(right + i, _mm_mul_ps(_mm_cvtepi32_ps(r), scale));
+    }
+    deinterleave2Scalar(src + 2 * i, frames - i, left + i, right + i);
+}
+
+// ---------------- AVX2 ----------------
+
+__attribute__((target("avx2")))
+void s16ToFloatAvx2(const int16_t* src, float* dst, size_t n) {
+    const __m256 scale = _mm256_set1_ps(kToFloat);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), scale));
+        _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), scale));
+    }
+    for (; i < n; ++i) dst[i] = src[i] * kToFloat;
+}
+
+__attribute__((target("avx2")))
+void floatToS16Avx2(const float* src, int16_t* dst, size_t n) {
+    const __m256 scale = _mm256_set1_ps(kToS16);
+    const __m256 lo = _mm256_set1_ps(kS16Min);
+    const __m256 hi = _mm256_set1_ps(kS16Max);
+    const __m256 sign = _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int32_t>(0x80000000u)));
+    const __m256 half = _mm256_set1_ps(0.5f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 a = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i), scale), lo), hi);
+        __m256 b = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i + 8), scale), lo), hi);
+        a = _mm256_add_ps(a, _mm256_or_ps(_mm256_and_ps(a, sign), half));
+        b = _mm256_add_ps(b, _mm256_or_ps(_mm256_and_ps(b, sign), half));
+        // packs 按 128 位 lane 交错，需要再按 64 位重排
+        __m256i packed = _mm256_packs_epi32(_mm256_cvttps_epi32(a), _mm256_cvttps_epi32(b));
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+    }
+    for (; i < n; ++i) dst[i] = floatToS16(src[i]);
+}
+
+__attribute__((target("avx2")))
+void deinterleave2Avx2(const int16_t* src, size_t frames, float* left, float* right) {
+    const __m256 scale = _mm256_set1_ps(kToFloat);
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * i));
+        __m256i l = _mm256_srai_epi32(_mm256_slli_epi32(x, 16), 16);
+        __m256i r = _mm256_srai_epi32(x, 16);
+        _mm256_storeu_ps(left + i, _mm256_mul_ps(_mm256_cvtepi32_ps(l), scale));
+        _mm256_storeu_ps(right + i, _mm256_mul_ps(_mm256_cvtepi32_ps(r), scale));
+    }
+    deinterleave2Scalar(src + 2 * i, frames - i, left + i, right + i);
+}
+
+#endif // PCM_CONVERT_X86
+
+#if defined(PCM_CONVERT_NEON)
+
+// ---------------- NEON ----------------
+
+void s16ToFloatNeon(const int16_t* src, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t x = vld1q_s16(src + i);
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), kToFloat));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), kToFloat));
+    }
+    for (; i < n; ++i) dst[i] = src[i] * kToFloat;
+}
+
+inline int32x4_t floatToS32Neon(float32x4_t x) {
+    const float32x4_t lo = vdupq_n_f32(kS16Min);
+    const float32x4_t hi = vdupq_n_f32(kS16Max);
+    const uint32x4_t sign = vdupq_n_u32(0x80000000u);
+    const uint32x4_t half = vreinterpretq_u32_f32(vdupq_n_f32(0.5f));
+    float32x4_t v = vminq_f32(vmaxq_f32(vmulq_n_f32(x, kToS16), lo), hi);
+    float32x4_t h = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(vreinterpretq_u32_f32(v), sign), half));
+    // vcvtq_s32_f32 向零截断
+    return vcvtq_s32_f32(vaddq_f32(v, h));
+}
+
+void floatToS16Neon(const float* src, int16_t* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x4_t a = vqmovn_s32(floatToS32Neon(vld1q_f32(src + i)));
+        int16x4_t b = vqmovn_s32(floatToS32Neon(vld1q_f32(src + i + 4)));
+        vst1q_s16(dst + i, vcombine_s16(a, b));
+    }
+    for (; i < n; ++i) dst[i] = floatToS16(src[i]);
+}
+
+void deinterleave2Neon(const int16_t* src, size_t frames, float* left, float* right) {
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        int16x8x2_t x = vld2q_s16(src + 2 * i);
+        vst1q_f32(left + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x.val[0]))), kToFloat));
+        vst1q_f32(left + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x.val[0]))), kToFloat));
+        vst1q_f32(right + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x.val[1]))), kToFloat));
+        vst1q_f32(right + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x.val[1]))), kToFloat));
+    }
+    deinterleave2Scalar(src + 2 * i, frames - i, left + i, right + i);
+}
+
+#endif // PCM_CONVERT_NEON
+
+std::vector<PcmConvertKernels> supportedKernels() {
+    std::vector<PcmConvertKernels> supported;
+#if defined(PCM_CONVERT_X86)
+    if (webrtc::GetCPUInfo(webrtc::kAVX2)) {
+        supported.push_back({s16ToFloatAvx2, floatToS16Avx2, deinterleave2Avx2, "avx2"});
+    }
+    if (webrtc::GetCPUInfo(webrtc::kSSE2)) {
+        supported.push_back({s16ToFloatSse2, floatToS16Sse2, deinterleave2Sse2, "sse2"});
+    }
+#elif defined(PCM_CONVERT_NEON)
+#if defined(__aarch64__)
+    supported.push_back({s16ToFloatNeon, floatToS16Neon, deinterleave2Neon, "neon"});
+#else
+    if (webrtc::GetCPUFeaturesARM() & webrtc::kCPUFeatureNEON) {
+        supported.push_back({s16ToFloatNeon, floatToS16Neon, deinterleave2Neon, "neon"});
+    }
+#endif
+#endif
+    supported.push_back({convertS16ToFloatScalar, convertFloatToS16Scalar, deinterleave2Scalar, "scalar"});
+    return supported;
+}
+
+const PcmConvertKernels& kernels() {
+    static const PcmConvertKernels selected = pcmConvertKernels().front();
+    return selected;
+}
+
+} // namespace
+
+void convertS16ToFloatScalar(const int16_t* src, float* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) dst[i] = src[i] * kToFloat;
+}
+
+void convertFloatToS16Scalar(const float* src, int16_t* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) dst[i] = floatToS16(src[i]);
+}
+
+void deinterleaveS16ToFloatScalar(const int16_t* src, size_t frames, size_t channels, float* const* dst) {
+    for (size_t i = 0; i < frames; ++i) {
+        for (size_t ch = 0; ch < channels; ++ch) {
+            dst[ch][i] = src[i * channels + ch] * kToFloat;
+        }
+    }
+}
+
+void convertS16ToFloat(const int16_t* src, float* dst, size_t n) {
+    kernels().s16ToFloat(src, dst, n);
+}
+
+void convertFloatToS16(const float* src, int16_t* dst, size_t n) {
+    kernels().floatToS16(src, dst, n);
+}
+
+void deinterleaveS16ToFloat(const int16_t* src, size_t frames, size_t channels, float* const* dst) {
+    if (channels == 1) {
+        kernels().s16ToFloat(src, dst[0], frames);
+    } else if (channels == 2) {
+        kernels().deinterleave2(src, frames, dst[0], dst[1]);
+    } else {
+        deinterleaveS16ToFloatScalar(src, frames, channels, dst);
+    }
+}
+
+void interleaveFloatToS16(const float* const* src, size_t frames, size_t channels, int16_t* dst) {
+    if (channels == 1) {
+        kernels().floatToS16(src[0], dst, frames);
+        return;
+    }
+    for (size_t i = 0; i < frames; ++i) {
+        for (size_t ch = 0; ch < channels; ++ch) {
+            dst[i * channels + ch] = floatToS16(src[ch][i]);
+        }
+    }
+}
+
+const char* pcmConvertBackend() {
+    return kernels().name;
+}
+
+const std::vector<PcmConvertKernels>& pcmConvertKernels() {
+    static const std::vector<PcmConvertKernels> supported = supportedKernels();
+    return supported;
+}
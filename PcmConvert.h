@@ -0,0 +1,53 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_PCMCONVERT_H
+#define AAUDIORECORDER_PCMCONVERT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * int16 <-> float 转换内核
+ *
+ * 两个方向使用对称的缩放系数 32768：
+ *   - int16 -> float: x / 32768
+ *   - float -> int16: 先乘 32768 并饱和到 [-32768, 32767]，再加上同号的 0.5 后截断（四舍五入，远离零）
+ * 所有实现(标量 / SSE2 / AVX2 / NEON)都只用精确的 IEEE 运算，结果逐位一致（NaN 输入除外）。
+ * 运行时通过 cpu_features_wrapper 选择最快的实现。
+ */
+
+// int16 -> float，n 个采样
+void convertS16ToFloat(const int16_t* src, float* dst, size_t n);
+
+// float -> int16，带饱和，n 个采样
+void convertFloatToS16(const float* src, int16_t* dst, size_t n);
+
+// 交织 int16 -> 平面 float，dst[ch] 各自容纳 frames 个采样
+void deinterleaveS16ToFloat(const int16_t* src, size_t frames, size_t channels, float* const* dst);
+
+// 平面 float -> 交织 int16，带饱和
+void interleaveFloatToS16(const float* const* src, size_t frames, size_t channels, int16_t* dst);
+
+// 标量参考实现，用于校验 SIMD 结果
+void convertS16ToFloatScalar(const int16_t* src, float* dst, size_t n);
+void convertFloatToS16Scalar(const float* src, int16_t* dst, size_t n);
+void deinterleaveS16ToFloatScalar(const int16_t* src, size_t frames, size_t channels, float* const* dst);
+
+// 当前选中的实现名称: "avx2" / "sse2" / "neon" / "scalar"
+const char* pcmConvertBackend();
+
+// 一组转换内核，deinterleave2 是双声道的交织 -> 平面
+struct PcmConvertKernels {
+    void (*s16ToFloat)(const int16_t*, float*, size_t);
+    void (*floatToS16)(const float*, int16_t*, size_t);
+    void (*deinterleave2)(const int16_t*, size_t, float*, float*);
+    const char* name;
+};
+
+// 当前 CPU 支持的全部实现，从快到慢排列：第一个是运行时选中的，最后一个总是 "scalar"
+const std::vector<PcmConvertKernels>& pcmConvertKernels();
+
+#endif //AAUDIORECORDER_PCMCONVERT_H
@@ -0,0 +1,43 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_PCMFRAMEVIEW_H
+#define AAUDIORECORDER_PCMFRAMEVIEW_H
+
+#include <cstddef>
+#include <cstdint>
+
+// ring buffer 中的一段连续采样
+template <typename T>
+struct FrameSpan {
+    const T* data;
+    size_t samples;
+};
+
+/**
+ * 覆盖恰好 samples 个采样的只读视图
+ * 数据没有回绕时只有一段，回绕时分成尾部 + 头部两段
+ * 镜像映射的 SpscFrameRing 和 MappedAudioFile 给出的视图总是只有一段
+ */
+template <typename T>
+struct FrameView {
+    FrameSpan<T> spans[2];
+    size_t count;
+    size_t samples;
+
+    // 依次访问每一段，fn(const T* data, size_t samples, size_t offset)
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        size_t offset = 0;
+        for (size_t i = 0; i < count; ++i) {
+            fn(spans[i].data, spans[i].samples, offset);
+            offset += spans[i].samples;
+        }
+    }
+};
+
+using PcmSpan = FrameSpan<int16_t>;
+using PcmFrameView = FrameView<int16_t>;
+
+#endif //AAUDIORECORDER_PCMFRAMEVIEW_H
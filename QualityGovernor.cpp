@@ -0,0 +1,220 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include "QualityGovernor.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "ApmControl.h"
+#include "RecorderLog.h"
+
+namespace {
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+const char* QualityGovernor::tierName(Tier tier) {
+    switch (tier) {
+        case Tier::Full: return "full";
+        case Tier::DeepFilterOff: return "DF off";
+        case Tier::NsModerate: return "NS moderate";
+        case Tier::AecOff: return "AEC off";
+        case Tier::Rate32k: return "32 kHz";
+    }
+    return "?";
+}
+
+void QualityGovernor::start(ApmControl* apmControl, DeepFilterSwitch df) {
+    stop();
+    control = apmControl;
+    deepFilter = std::move(df);
+    tierNow = Tier::Full;
+    currentTier.store(0, std::memory_order_relaxed);
+    aecOff = false;
+    appliedConfig = 0;
+    dfSuspended = false;
+    cooldown = 0;
+    calmWindows = 0;
+    recoverWindows = kRecoverWindows;
+    windowsSinceStepUp = kRelapseWindows;
+    renderIdleWindows = 0;
+    std::fill(std::begin(tierNs), std::end(tierNs), 0);
+    tierChanges = 0;
+    tierSinceNs = nowNs();
+    windowNs.store(0, std::memory_order_relaxed);
+    windowFrames.store(0, std::memory_order_relaxed);
+    windowMaxNs.store(0, std::memory_order_relaxed);
+    windowBacklogMax.store(0, std::memory_order_relaxed);
+    windowRenderFrames.store(0, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = false;
+    }
+    worker = std::thread(&QualityGovernor::run, this);
+}
+
+void QualityGovernor::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    if (!worker.joinable()) return;
+    worker.join();
+
+    int64_t now = nowNs();
+    tierNs[static_cast<int>(tierNow)] += now - tierSinceNs;
+    int64_t total = 0;
+    for (int64_t ns : tierNs) total += ns;
+    if (total > 0) {
+        LOGI("Quality governor: %u tier changes, time in tier: full %.1f%%, DF off %.1f%%, NS moderate %.1f%%, "
+             "AEC off %.1f%%, 32 kHz %.1f%%", tierChanges,
+             100.0 * tierNs[0] / total, 100.0 * tierNs[1] / total, 100.0 * tierNs[2] / total,
+             100.0 * tierNs[3] / total, 100.0 * tierNs[4] / total);
+    }
+    // 撤销还在队列里的降级，下一次 attach 从完整配置开始
+    if (control != nullptr && appliedConfig != 0) {
+        control->degrade(0);
+    }
+    if (deepFilter && dfSuspended) {
+        deepFilter(false);
+    }
+    control = nullptr;
+    deepFilter = nullptr;
+}
+
+void QualityGovernor::recordFrame(int64_t processNs, size_t backlogFrames, bool renderActive) {
+    windowNs.fetch_add(processNs, std::memory_order_relaxed);
+    windowFrames.fetch_add(1, std::memory_order_relaxed);
+    if (processNs > windowMaxNs.load(std::memory_order_relaxed)) {
+        windowMaxNs.store(processNs, std::memory_order_relaxed);
+    }
+    auto backlog = static_cast<uint32_t>(backlogFrames);
+    if (backlog > windowBacklogMax.load(std::memory_order_relaxed)) {
+        windowBacklogMax.store(backlog, std::memory_order_relaxed);
+    }
+    if (renderActive) {
+        windowRenderFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void QualityGovernor::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        cv.wait_for(lock, std::chrono::milliseconds(kIntervalMs));
+        if (stopping) break;
+        lock.unlock();
+        evaluate();
+        lock.lock();
+    }
+}
+
+bool QualityGovernor::applicable(Tier tier) const {
+    switch (tier) {
+        case Tier::DeepFilterOff: return static_cast<bool>(deepFilter);
+        case Tier::AecOff: return renderIdleWindows >= kRenderIdleWindows;
+        default: return true;
+    }
+}
+
+void QualityGovernor::evaluate() {
+    uint32_t frames = windowFrames.exchange(0, std::memory_order_relaxed);
+    int64_t ns = windowNs.exchange(0, std::memory_order_relaxed);
+    int64_t maxNs = windowMaxNs.exchange(0, std::memory_order_relaxed);
+    uint32_t backlog = windowBacklogMax.exchange(0, std::memory_order_relaxed);
+    uint32_t renderFrames = windowRenderFrames.exchange(0, std::memory_order_relaxed);
+    // 这个窗口没有处理任何帧，不做判断
+    if (frames == 0) return;
+
+    renderIdleWindows = renderFrames > 0 ? 0 : std::min(renderIdleWindows + 1, kRenderIdleWindows);
+    windowsSinceStepUp = std::min(windowsSinceStepUp + 1, kMaxRecoverWindows);
+
+    // 参考信号恢复时 AEC 必须立刻打开，不等升级
+    bool wantAecOff = tierNow >= Tier::AecOff && renderIdleWindows >= kRenderIdleWindows;
+    if (wantAecOff != aecOff) {
+        aecOff = wantAecOff;
+        LOGI("Quality governor: AEC %s (render %s)", aecOff ? "off" : "on", aecOff ? "idle" : "active");
+    }
+    // 每个窗口都对一次账：AEC 切换，或者上次队列满没有送出去的降级 / DF 旁路在这里补发，冷却期间也一样
+    applyConfig();
+
+    const double load = static_cast<double>(ns) / frames / frameBudgetNs;
+    if (cooldown > 0) {
+        --cooldown;
+        return;
+    }
+
+    if (load > kOverloadLoad || backlog >= kOverloadBacklogFrames) {
+        calmWindows = 0;
+        int next = static_cast<int>(tierNow) + 1;
+        while (next < kTierCount && !applicable(static_cast<Tier>(next))) ++next;
+        if (next < kTierCount) {
+            // 刚升级不久又扛不住，下次升级多等一倍
+            if (windowsSinceStepUp < kRelapseWindows) {
+                recoverWindows = std::min(recoverWindows * 2, kMaxRecoverWindows);
+            }
+            LOGE("Processing over budget: avg %.2f ms, max %.2f ms, backlog %u frames",
+                 ns / 1e6 / frames, maxNs / 1e6, backlog);
+            setTier(static_cast<Tier>(next));
+        }
+        return;
+    }
+
+    if (load < kRecoverLoad && backlog <= 1) {
+        calmWindows = std::min(calmWindows + 1, kMaxRecoverWindows);
+        if (tierNow == Tier::Full) {
+            // 长时间稳定后恢复默认的升级等待
+            if (calmWindows >= kMaxRecoverWindows) recoverWindows = kRecoverWindows;
+        } else if (calmWindows >= recoverWindows) {
+            int prev = static_cast<int>(tierNow) - 1;
+            while (prev > 0 && !applicable(static_cast<Tier>(prev))) --prev;
+            calmWindows = 0;
+            windowsSinceStepUp = 0;
+            setTier(static_cast<Tier>(prev));
+        }
+    } else {
+        calmWindows = 0;
+    }
+}
+
+void QualityGovernor::setTier(Tier tier) {
+    int64_t now = nowNs();
+    int64_t stayed = now - tierSinceNs;
+    tierNs[static_cast<int>(tierNow)] += stayed;
+    tierSinceNs = now;
+
+    Tier previous = tierNow;
+    tierNow = tier;
+    currentTier.store(static_cast<int>(tier), std::memory_order_relaxed);
+    aecOff = tier >= Tier::AecOff && renderIdleWindows >= kRenderIdleWindows;
+    applyConfig();
+
+    cooldown = kCooldownWindows;
+    ++tierChanges;
+    LOGI("Quality tier %s -> %s after %.1f s%s", tierName(previous), tierName(tier),
+         stayed / 1e9, tier > previous ? "" : " (recovering)");
+}
+
+void QualityGovernor::applyConfig() {
+    bool dfOff = tierNow >= Tier::DeepFilterOff;
+    if (deepFilter && dfOff != dfSuspended && deepFilter(dfOff)) {
+        dfSuspended = dfOff;
+    }
+
+    bool nsModerate = tierNow >= Tier::NsModerate;
+    bool rate32k = tierNow >= Tier::Rate32k;
+    uint32_t flags = (nsModerate ? static_cast<uint32_t>(ApmControl::kNsModerate) : 0u) |
+                     (aecOff ? static_cast<uint32_t>(ApmControl::kAecOff) : 0u) |
+                     (rate32k ? static_cast<uint32_t>(ApmControl::kRate32k) : 0u);
+    if (flags == appliedConfig || control == nullptr) return;
+    // 队列满时保持原值，下个窗口的 evaluate() 会再试
+    if (control->degrade(flags)) {
+        appliedConfig = flags;
+    }
+}
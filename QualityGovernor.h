@@ -0,0 +1,109 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_QUALITYGOVERNOR_H
+#define AAUDIORECORDER_QUALITYGOVERNOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+class ApmControl;
+
+/**
+ * 处理线程跟不上时逐级降低处理质量
+ *
+ * 处理线程每帧只把耗时、ring 积压和是否有参考信号写进几个原子变量；后台线程每 kIntervalMs 取一次窗口：
+ *   - 平均耗时超过预算的 kOverloadLoad，或积压达到 kOverloadBacklogFrames 帧，降一级
+ *   - 连续 recoverWindows 个窗口平均耗时低于 kRecoverLoad 且没有积压，升一级
+ *   - 升级后 kRelapseWindows 内又降级时 recoverWindows 翻倍 (最多 kMaxRecoverWindows)，避免来回切换
+ * 每次切换之后 kCooldownWindows 个窗口不再降级，等新配置的效果体现在统计里。
+ *
+ * 各级在前一级的基础上继续降低：
+ *   DeepFilterOff  DF 走延迟对齐的旁路 (没有 DF 时跳过)
+ *   NsModerate     噪声抑制 kHigh -> kModerate
+ *   AecOff         连续 kRenderIdleWindows 没有参考信号时关闭 AEC，参考信号恢复后立即重新打开
+ *   Rate32k        maximum_internal_processing_rate 48000 -> 32000
+ * APM 的降级通过 ApmControl 排队，由处理线程在两帧之间 ApplyConfig，叠加在控制线程的配置之上。
+ */
+class QualityGovernor {
+public:
+    enum class Tier { Full, DeepFilterOff, NsModerate, AecOff, Rate32k };
+    static constexpr int kTierCount = 5;
+
+    static constexpr int kIntervalMs = 200;
+    static constexpr double kOverloadLoad = 0.8;
+    static constexpr double kRecoverLoad = 0.5;
+    static constexpr size_t kOverloadBacklogFrames = 3;
+    static constexpr int kCooldownWindows = 2;
+    static constexpr int kRecoverWindows = 25;          // 5 秒
+    static constexpr int kMaxRecoverWindows = 200;      // 40 秒
+    static constexpr int kRelapseWindows = 50;
+    static constexpr int kRenderIdleWindows = 10;       // 2 秒
+
+    // 参数为 true 时 DF 走旁路，在本线程上调用；命令没有送出时返回 false，下个窗口重试。
+    // 这是 governor 自己的旁路标志，用户的挂起不受它影响
+    using DeepFilterSwitch = std::function<bool(bool suspended)>;
+
+    explicit QualityGovernor(int64_t frameBudgetNs) : frameBudgetNs(frameBudgetNs) {}
+    ~QualityGovernor() { stop(); }
+
+    QualityGovernor(const QualityGovernor&) = delete;
+    QualityGovernor& operator=(const QualityGovernor&) = delete;
+
+    // deepFilter 为空表示没有 DF 这一级
+    void start(ApmControl* control, DeepFilterSwitch deepFilter);
+    // 输出切换次数和每一级停留的时间
+    void stop();
+
+    // 处理线程每帧调用，非阻塞
+    void recordFrame(int64_t processNs, size_t backlogFrames, bool renderActive);
+
+    Tier tier() const { return static_cast<Tier>(currentTier.load(std::memory_order_relaxed)); }
+    static const char* tierName(Tier tier);
+
+private:
+    void run();
+    void evaluate();
+    bool applicable(Tier tier) const;
+    void setTier(Tier tier);
+    void applyConfig();
+
+    const int64_t frameBudgetNs;
+
+    // 处理线程写，后台线程 exchange 取走；max 只有一个写入者，取走时可能丢掉同时发生的一次更新
+    std::atomic<int64_t> windowNs{0};
+    std::atomic<uint32_t> windowFrames{0};
+    std::atomic<int64_t> windowMaxNs{0};
+    std::atomic<uint32_t> windowBacklogMax{0};
+    std::atomic<uint32_t> windowRenderFrames{0};
+    std::atomic<int> currentTier{0};
+
+    // 后台线程状态
+    ApmControl* control = nullptr;
+    DeepFilterSwitch deepFilter;
+    Tier tierNow = Tier::Full;
+    bool aecOff = false;
+    uint32_t appliedConfig = 0;         // 已经交给 ApmControl 的降级标志
+    bool dfSuspended = false;           // 已经送出的 DF 旁路状态
+    int cooldown = 0;
+    int calmWindows = 0;
+    int recoverWindows = kRecoverWindows;
+    int windowsSinceStepUp = kRelapseWindows;
+    int renderIdleWindows = 0;
+    int64_t tierSinceNs = 0;
+    int64_t tierNs[kTierCount] = {};
+    uint32_t tierChanges = 0;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+};
+
+#endif //AAUDIORECORDER_QUALITYGOVERNOR_H
@@ -0,0 +1,27 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_RECORDERLOG_H
+#define AAUDIORECORDER_RECORDERLOG_H
+
+#if defined(__ANDROID__)
+
+#include <android/log.h>
+
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, "NDKRecorder", __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, "NDKRecorder", __VA_ARGS__)
+
+#else
+
+// 主机上 (tests/) 没有 liblog，输出到 stderr
+#include <stdio.h>
+
+#define RECORDER_HOST_LOG(level, ...) \
+    do { fprintf(stderr, level "/NDKRecorder: " __VA_ARGS__); fputc('\n', stderr); } while (0)
+#define LOGI(...) RECORDER_HOST_LOG("I", __VA_ARGS__)
+#define LOGE(...) RECORDER_HOST_LOG("E", __VA_ARGS__)
+
+#endif
+
+#endif //AAUDIORECORDER_RECORDERLOG_H
@@ -0,0 +1,185 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_SPSCFRAMERING_H
+#define AAUDIORECORDER_SPSCFRAMERING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+#include "lwrb.h"
+#include "PcmFrameView.h"
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+/**
+ * 单生产者单消费者的定长帧环形队列
+ *
+ * - Capacity 以帧为单位且必须是 2 的幂，下标只做 & 运算
+ * - 读写下标单调递增，分别放在独立的 cache line 上，容量可以全部用满
+ * - 双方各自缓存对端下标，只有缓存值不够用时才去读对端的 cache line
+ * - 读写都以整帧为单位（一帧 = Channels 个 T）
+ * - 存储区的字节数是页大小整数倍时使用镜像映射，读视图总是一段连续内存
+ */
+template <typename T, size_t Channels, size_t Capacity>
+class SpscFrameRing {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be power of two");
+    static_assert(Channels > 0, "Channels must be positive");
+
+public:
+    static constexpr size_t kMask = Capacity - 1;
+    static constexpr size_t kBytes = Capacity * Channels * sizeof(T);
+
+    SpscFrameRing() {
+        lwrb_sz_t size = kBytes;
+        void* mapped = lwrb_mirror_map(&size);
+        if (mapped != nullptr && size == kBytes) {
+            storage = static_cast<T*>(mapped);
+            mirrored = true;
+        } else {
+            lwrb_mirror_unmap(mapped, size);
+            storage = static_cast<T*>(::operator new(kBytes, std::align_val_t(CACHE_LINE_SIZE)));
+        }
+    }
+
+    ~SpscFrameRing() {
+        if (mirrored) {
+            lwrb_mirror_unmap(storage, kBytes);
+        } else {
+            ::operator delete(storage, std::align_val_t(CACHE_LINE_SIZE));
+        }
+    }
+
+    SpscFrameRing(const SpscFrameRing&) = delete;
+    SpscFrameRing& operator=(const SpscFrameRing&) = delete;
+
+    // ---------------- 生产者 ----------------
+
+    // 写入最多 frames 帧，返回实际写入的帧数
+    size_t write(const T* data, size_t frames) {
+        size_t w = producer.index.load(std::memory_order_relaxed);
+        size_t space = Capacity - (w - producer.cachedPeer);
+        if (space < frames) {
+            producer.cachedPeer = consumer.index.load(std::memory_order_acquire);
+            space = Capacity - (w - producer.cachedPeer);
+        }
+        if (frames > space) frames = space;
+        if (frames == 0) return 0;
+
+        copyIn(w & kMask, data, frames);
+        producer.index.store(w + frames, std::memory_order_release);
+        return frames;
+    }
+
+    // 生产者写下标，即 reset() 以来写入的总帧数
+    size_t writePosition() const { return producer.index.load(std::memory_order_relaxed); }
+
+    // 生产者视角的空闲帧数
+    size_t freeFrames() const {
+        return Capacity - (producer.index.load(std::memory_order_relaxed)
+                           - consumer.index.load(std::memory_order_acquire));
+    }
+
+    // ---------------- 消费者 ----------------
+
+    // 消费者视角的可读帧数
+    size_t availableFrames() {
+        size_t r = consumer.index.load(std::memory_order_relaxed);
+        consumer.cachedPeer = producer.index.load(std::memory_order_acquire);
+        return consumer.cachedPeer - r;
+    }
+
+    // 消费者读下标，即 reset() 以来读出和丢弃的总帧数，也是下一次 acquire 的第一帧
+    size_t readPosition() const { return consumer.index.load(std::memory_order_relaxed); }
+
+    // 获取恰好 frames 帧的只读视图，不移动读下标
+    bool acquire(size_t frames, FrameView<T>& view) {
+        size_t r = consumer.index.load(std::memory_order_relaxed);
+        if (consumer.cachedPeer - r < frames) {
+            consumer.cachedPeer = producer.index.load(std::memory_order_acquire);
+            if (consumer.cachedPeer - r < frames) return false;
+        }
+
+        size_t offset = r & kMask;
+        size_t linear = mirrored ? frames : std::min(frames, Capacity - offset);
+        view.samples = frames * Channels;
+        view.spans[0] = {storage + offset * Channels, linear * Channels};
+        view.count = 1;
+        if (linear < frames) {
+            view.spans[1] = {storage, (frames - linear) * Channels};
+            view.count = 2;
+        }
+        return true;
+    }
+
+    // 释放 acquire 得到的视图
+    void release(const FrameView<T>& view) {
+        size_t r = consumer.index.load(std::memory_order_relaxed);
+        consumer.index.store(r + view.samples / Channels, std::memory_order_release);
+    }
+
+    // 丢弃最多 frames 帧，返回实际丢弃的帧数
+    size_t skip(size_t frames) {
+        size_t available = availableFrames();
+        if (frames > available) frames = available;
+        size_t r = consumer.index.load(std::memory_order_relaxed);
+        consumer.index.store(r + frames, std::memory_order_release);
+        return frames;
+    }
+
+    // 拷贝读出最多 frames 帧，返回实际读出的帧数
+    size_t read(T* data, size_t frames) {
+        size_t available = availableFrames();
+        if (frames > available) frames = available;
+        if (frames == 0) return 0;
+
+        FrameView<T> view{};
+        acquire(frames, view);
+        view.forEach([&](const T* src, size_t samples, size_t off) {
+            std::memcpy(data + off, src, samples * sizeof(T));
+        });
+        release(view);
+        return frames;
+    }
+
+    // 只能在两端都停止时调用
+    void reset() {
+        producer.index.store(0, std::memory_order_relaxed);
+        producer.cachedPeer = 0;
+        consumer.index.store(0, std::memory_order_relaxed);
+        consumer.cachedPeer = 0;
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+    bool isMirrored() const { return mirrored; }
+
+private:
+    void copyIn(size_t offset, const T* data, size_t frames) {
+        size_t linear = mirrored ? frames : std::min(frames, Capacity - offset);
+        std::memcpy(storage + offset * Channels, data, linear * Channels * sizeof(T));
+        if (linear < frames) {
+            std::memcpy(storage, data + linear * Channels, (frames - linear) * Channels * sizeof(T));
+        }
+    }
+
+    // 每一端独占一条 cache line：自己的下标 + 缓存的对端下标
+    struct alignas(CACHE_LINE_SIZE) Side {
+        std::atomic<size_t> index{0};
+        size_t cachedPeer = 0;
+    };
+
+    Side producer;
+    Side consumer;
+
+    alignas(CACHE_LINE_SIZE) T* storage = nullptr;
+    bool mirrored = false;
+};
+
+#endif //AAUDIORECORDER_SPSCFRAMERING_H
@@ -0,0 +1,86 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_WAVFORMAT_H
+#define AAUDIORECORDER_WAVFORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// 16-bit PCM WAV 的格式参数
+struct WavFormat {
+    uint32_t sampleRate;
+    uint16_t channels;
+    uint16_t bitsPerSample;
+
+    uint16_t blockAlign() const { return static_cast<uint16_t>(channels * bitsPerSample / 8); }
+};
+
+/**
+ * 固定 80 字节的 WAV 头，数据从偏移 80 开始：
+ *
+ *   0  "RIFF" / "RF64"   riff 大小(32 位，RF64 时为 0xFFFFFFFF)   "WAVE"
+ *  12  "JUNK" / "ds64"   28 字节: riff 大小 / data 大小 / 采样帧数 (各 64 位) + table 长度
+ *  48  "fmt "            16 字节 PCM 格式
+ *  72  "data"           data 大小(32 位，RF64 时为 0xFFFFFFFF)
+ *
+ * 录音开始时预留 JUNK 块，超过 4GB 时原地改写为 ds64 (EBU Tech 3306)，
+ * 头部长度不变，所以随时可以用定位写入刷新长度字段而不用移动数据。
+ */
+constexpr size_t kWavHeaderBytes = 80;
+
+namespace wav_detail {
+
+inline void put16(uint8_t* p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+inline void put32(uint8_t* p, uint32_t v) {
+    put16(p, static_cast<uint16_t>(v));
+    put16(p + 2, static_cast<uint16_t>(v >> 16));
+}
+
+inline void put64(uint8_t* p, uint64_t v) {
+    put32(p, static_cast<uint32_t>(v));
+    put32(p + 4, static_cast<uint32_t>(v >> 32));
+}
+
+} // namespace wav_detail
+
+// 根据已写入的数据字节数生成 WAV 头，数据超过 32 位能表示的范围时自动切换到 RF64
+inline void buildWavHeader(const WavFormat& format, uint64_t dataBytes, uint8_t header[kWavHeaderBytes]) {
+    using namespace wav_detail;
+
+    const uint64_t riffBytes = dataBytes + kWavHeaderBytes - 8;
+    const bool rf64 = riffBytes > UINT32_MAX;
+
+    std::memset(header, 0, kWavHeaderBytes);
+    std::memcpy(header, rf64 ? "RF64" : "RIFF", 4);
+    put32(header + 4, rf64 ? UINT32_MAX : static_cast<uint32_t>(riffBytes));
+    std::memcpy(header + 8, "WAVE", 4);
+
+    std::memcpy(header + 12, rf64 ? "ds64" : "JUNK", 4);
+    put32(header + 16, 28);
+    if (rf64) {
+        put64(header + 20, riffBytes);
+        put64(header + 28, dataBytes);
+        put64(header + 36, format.blockAlign() ? dataBytes / format.blockAlign() : 0);
+    }
+
+    std::memcpy(header + 48, "fmt ", 4);
+    put32(header + 52, 16);
+    put16(header + 56, 1);                      // WAVE_FORMAT_PCM
+    put16(header + 58, format.channels);
+    put32(header + 60, format.sampleRate);
+    put32(header + 64, format.sampleRate * format.blockAlign());
+    put16(header + 68, format.blockAlign());
+    put16(header + 70, format.bitsPerSample);
+
+    std::memcpy(header + 72, "data", 4);
+    put32(header + 76, rf64 ? UINT32_MAX : static_cast<uint32_t>(dataBytes));
+}
+
+#endif //AAUDIORECORDER_WAVFORMAT_H
@@ -75,6 +75,7 @@ lwrb_init(lwrb_t* buff, void* buffdata, lwrb_sz_t size) {
     buff->evt_fn = NULL;
     buff->size = size;
     buff->buff = buffdata;
+    buff->mirrored = 0;
     LWRB_INIT(buff->w_ptr, 0);
     LWRB_INIT(buff->r_ptr, 0);
     return 1;
@@ -194,8 +195,8 @@ lwrb_write_ex(lwrb_t* buff, const void* data, lwrb_sz_t btw, lwrb_sz_t* bwritten
     btw = BUF_MIN(free, btw);
     w_ptr = LWRB_LOAD(buff->w_ptr, memory_order_acquire);
 
-    /* Step 1: Write data to linear part of buffer */
-    tocopy = BUF_MIN(buff->size - w_ptr, btw);
+    /* Step 1: Write data to linear part of buffer, mirrored buffer is always linear */
+    tocopy = buff->mirrored ? btw : BUF_MIN(buff->size - w_ptr, btw);
     BUF_MEMCPY(&buff->buff[w_ptr], d_ptr, tocopy);
     d_ptr += tocopy;
     w_ptr += tocopy;
@@ -209,7 +210,7 @@ lwrb_write_ex(lwrb_t* buff, const void* data, lwrb_sz_t btw, lwrb_sz_t* bwritten
 
     /* Step 3: Check end of buffer */
     if (w_ptr >= buff->size) {
-        w_ptr = 0;
+        w_ptr -= buff->size;
     }
 
     /*
@@ -278,8 +279,8 @@ lwrb_read_ex(lwrb_t* buff, void* data, lwrb_sz_t btr, lwrb_sz_t* bread, uint16_t
     btr = BUF_MIN(full, btr);
     r_ptr = LWRB_LOAD(buff->r_ptr, memory_order_acquire);
 
-    /* Step 1: Read data from linear part of buffer */
-    tocopy = BUF_MIN(buff->size - r_ptr, btr);
+    /* Step 1: Read data from linear part of buffer, mirrored buffer is always linear */
+    tocopy = buff->mirrored ? btr : BUF_MIN(buff->size - r_ptr, btr);
     BUF_MEMCPY(d_ptr, &buff->buff[r_ptr], tocopy);
     d_ptr += tocopy;
     r_ptr += tocopy;
@@ -293,7 +294,7 @@ lwrb_read_ex(lwrb_t* buff, void* data, lwrb_sz_t btr, lwrb_sz_t* bread, uint16_t
 
     /* Step 3: Check end of buffer */
     if (r_ptr >= buff->size) {
-        r_ptr = 0;
+        r_ptr -= buff->size;
     }
 
     /*
@@ -347,8 +348,8 @@ lwrb_peek(const lwrb_t* buff, lwrb_sz_t skip_count, void* data, lwrb_sz_t btp) {
         return 0;
     }
 
-    /* Step 1: Read data from linear part of buffer */
-    tocopy = BUF_MIN(buff->size - r_ptr, btp);
+    /* Step 1: Read data from linear part of buffer, mirrored buffer is always linear */
+    tocopy = buff->mirrored ? btp : BUF_MIN(buff->size - r_ptr, btp);
     BUF_MEMCPY(d_ptr, &buff->buff[r_ptr], tocopy);
     d_ptr += tocopy;
     btp -= tocopy;
@@ -500,7 +501,8 @@ lwrb_get_linear_block_read_length(const lwrb_t* buff) {
     if (w_ptr > r_ptr) {
         len = w_ptr - r_ptr;
     } else if (r_ptr > w_ptr) {
-        len = buff->size - r_ptr;
+        /* Mirrored buffer continues past the end, all readable data is linear */
+        len = buff->mirrored ? buff->size - (r_ptr - w_ptr) : buff->size - r_ptr;
     } else {
         len = 0;
     }
@@ -565,6 +567,11 @@ lwrb_get_linear_block_write_length(const lwrb_t* buff) {
         return 0;
     }
 
+    /* Mirrored buffer continues past the end, all free memory is linear */
+    if (buff->mirrored) {
+        return lwrb_get_free(buff);
+    }
+
     /*
      * Use temporary values in case they are changed during operations.
      * See lwrb_buff_free or lwrb_buff_full functions for more information why this is OK.
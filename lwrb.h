@@ -105,9 +105,17 @@ typedef struct lwrb {
                                 Buffer is considered empty when `r == w` and full when `w == r - 1` */
     lwrb_evt_fn evt_fn;     /*!< Pointer to event callback function */
     void* arg;              /*!< Event custom user argument */
+    uint8_t mirrored;       /*!< Set to `1` when `buff` is followed by a virtual memory mirror of itself,
+                                see \ref lwrb_init_mirrored */
 } lwrb_t;
 
 uint8_t lwrb_init(lwrb_t* buff, void* buffdata, lwrb_sz_t size);
+uint8_t lwrb_init_mirrored(lwrb_t* buff, lwrb_sz_t size);
+void lwrb_free_mirrored(lwrb_t* buff);
+
+/* Mirrored memory helpers */
+void* lwrb_mirror_map(lwrb_sz_t* size);
+void lwrb_mirror_unmap(void* addr, lwrb_sz_t size);
 uint8_t lwrb_is_ready(lwrb_t* buff);
 void lwrb_free(lwrb_t* buff);
 void lwrb_reset(lwrb_t* buff);
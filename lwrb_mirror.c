@@ -0,0 +1,127 @@
+/**
+ * \file            lwrb_mirror.c
+ * \brief           Virtual memory mirrored storage backend for LwRB
+ */
+
+/*
+ * The same memfd pages are mapped twice, back to back, so that
+ * `buff[i]` and `buff[i + size]` alias the same byte. Any read or write
+ * of up to `size` bytes starting anywhere inside the buffer is then
+ * a single contiguous region and never has to be split at the wrap point.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "lwrb.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+#define BUF_IS_VALID(b) ((b) != NULL && (b)->buff != NULL && (b)->size > 0)
+
+/**
+ * \brief           Map `size` bytes of shared memory twice, back to back
+ * \param[in,out]   size: Requested size in units of bytes.
+ *                      Rounded up to page size, actual mapped size is written back
+ * \return          Start address of the first mapping, `NULL` on failure
+ */
+void*
+lwrb_mirror_map(lwrb_sz_t* size) {
+    long page = sysconf(_SC_PAGESIZE);
+    lwrb_sz_t len = 0;
+    uint8_t* base = NULL;
+    int fd = -1;
+
+    if (size == NULL || *size == 0 || page <= 0) {
+        return NULL;
+    }
+    len = (*size + (lwrb_sz_t)page - 1) / (lwrb_sz_t)page * (lwrb_sz_t)page;
+
+    /* memfd_create is not exported by older bionic, go through syscall directly */
+    fd = (int)syscall(__NR_memfd_create, "lwrb_mirror", MFD_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t)len) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    /* Reserve address space for both halves, then map the file over it */
+    base = mmap(NULL, len * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    if (mmap(base, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED
+        || mmap(base + len, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, len * 2);
+        close(fd);
+        return NULL;
+    }
+
+    /* Mappings keep the memory alive */
+    close(fd);
+    *size = len;
+    return base;
+}
+
+/**
+ * \brief           Release memory previously mapped with \ref lwrb_mirror_map
+ * \param[in]       addr: Address returned by \ref lwrb_mirror_map
+ * \param[in]       size: Size written back by \ref lwrb_mirror_map
+ */
+void
+lwrb_mirror_unmap(void* addr, lwrb_sz_t size) {
+    if (addr != NULL && size > 0) {
+        munmap(addr, size * 2);
+    }
+}
+
+/**
+ * \brief           Initialize buffer handle with mirrored storage
+ *
+ *                  Linear block read/write lengths always cover all readable/free data,
+ *                  so \ref lwrb_get_linear_block_read_address can be used as one contiguous pointer.
+ *
+ * \note            Buffer must be released with \ref lwrb_free_mirrored
+ * \param[in]       buff: Ring buffer instance
+ * \param[in]       size: Minimum size of buffer in units of bytes, rounded up to page size
+ * \return          `1` on success, `0` otherwise
+ */
+uint8_t
+lwrb_init_mirrored(lwrb_t* buff, lwrb_sz_t size) {
+    void* data = NULL;
+
+    if (buff == NULL) {
+        return 0;
+    }
+
+    data = lwrb_mirror_map(&size);
+    if (data == NULL || !lwrb_init(buff, data, size)) {
+        lwrb_mirror_unmap(data, size);
+        return 0;
+    }
+    buff->mirrored = 1;
+    return 1;
+}
+
+/**
+ * \brief           Free buffer initialized with \ref lwrb_init_mirrored
+ * \note            For buffers initialized with \ref lwrb_init it behaves as \ref lwrb_free
+ * \param[in]       buff: Ring buffer instance
+ */
+void
+lwrb_free_mirrored(lwrb_t* buff) {
+    if (BUF_IS_VALID(buff) && buff->mirrored) {
+        lwrb_mirror_unmap(buff->buff, buff->size);
+        buff->mirrored = 0;
+    }
+    lwrb_free(buff);
+}
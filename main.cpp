@@ -1,5 +1,6 @@
 #include <iostream>
 #include "AAudioRecorder.h"
+#include "BatchProcessor.h"
 #include "df.h"
 
 #include <thread>
@@ -7,16 +8,42 @@
 
 int main() {
 
+    // DeepFilterModelManager models;
+    // models.preload("/sdcard/DeepFilterNet2_onnx_ll.tar.gz");
+    //
     // CallbackPCMRecorder recorder;
+    // recorder.setDeepFilterModels(&models);
+    // recorder.setDeepFilterModel("/sdcard/DeepFilterNet2_onnx_ll.tar.gz", 20);
+    // recorder.setDeepFilterSpectral(true);
     //
-    // bool startResult = recorder.start("/sdcard/source.pcm", "/sdcard/record.pcm");
+    // bool startResult = recorder.start("/sdcard/source.wav", "/sdcard/record.wav");
     //
     // LOGI("start aaudio recorder result is: %d", startResult);
     //
-    // std::this_thread::sleep_for(std::chrono::seconds(20));
+    // std::this_thread::sleep_for(std::chrono::seconds(10));
+    //
+    // // 运行中调整，不需要重新 start()
+    // recorder.updateApmConfig(ApmConfigDelta().setNoiseSuppression(true,
+    //         webrtc::AudioProcessing::Config::NoiseSuppression::kVeryHigh));
+    // recorder.setCapturePostGain(1.5f);
+    //
+    // // 暂停期间 APM / DF 状态保留，恢复后不需要重新收敛
+    // recorder.pause();
+    // std::this_thread::sleep_for(std::chrono::seconds(2));
+    // recorder.resume();
+    //
+    // std::this_thread::sleep_for(std::chrono::seconds(10));
     //
     // recorder.stop();
 
+    // BatchOptions options;
+    // options.dfModelPath = "/sdcard/DeepFilterNet2_onnx_ll.tar.gz";
+    //
+    // std::vector<BatchJob> jobs = {{"/sdcard/batch/a/source.wav", "/sdcard/batch/a/record.wav", ""},
+    //                               {"/sdcard/batch/b/source.wav", "/sdcard/batch/b/record.flac", ""}};
+    //
+    // BatchProcessor(options).run(jobs);
+
     DFState *state = df_create("/sdcard/DeepFilterNet2_onnx_ll.tar.gz", 20, "info");
 
     if (state != nullptr) {
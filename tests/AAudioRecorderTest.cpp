@@ -0,0 +1,371 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AAudioRecorder.h"
+
+#include "FakeDevices.h"
+#include "TestHarness.h"
+
+/**
+ * recorder 的端到端检查和基准，AAudio / APM / libdf 都是 host/ 里的替身 (见 FakeDevices.h)：
+ * 设备按实时节奏回调，APM 直通，耗时可以注入。比较的是 recorder 自己的路径和调度
+ */
+namespace {
+
+constexpr int kSampleRate = 48000;
+constexpr size_t kFrame = 480;
+
+// seconds 秒 48 kHz 单声道：1 kHz 正弦加白噪声，-12 dBFS 左右
+std::vector<int16_t> speechLike(double seconds, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.f, 1000.f);
+    std::vector<int16_t> samples(static_cast<size_t>(seconds * kSampleRate));
+    for (size_t i = 0; i < samples.size(); ++i) {
+        float v = 6000.f * std::sin(2.f * static_cast<float>(M_PI) * 1000.f * i / kSampleRate) + noise(rng);
+        samples[i] = static_cast<int16_t>(std::max(-32768.f, std::min(32767.f, v)));
+    }
+    return samples;
+}
+
+constexpr int64_t kMs = 1000000;
+
+// 轮询 done 直到返回 true，超时返回 false；单核主机上忙等会饿死被测线程，所以每次都 sleep
+template <typename Fn>
+bool waitFor(Fn done, int64_t timeoutNs) {
+    int64_t deadline = recorder_test::nowNs() + timeoutNs;
+    while (!done()) {
+        if (recorder_test::nowNs() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// 设备已经送出、APM 还没处理的整帧数
+int64_t backlogFrames() {
+    return static_cast<int64_t>(fake_device::aaudio().framesDelivered.load() / kFrame) -
+           static_cast<int64_t>(fake_device::apm().framesProcessed.load());
+}
+
+struct Drain {
+    bool ok;
+    int64_t peakFrames;     // 停顿期间的最大积压
+    int64_t drainNs;        // 停顿结束到积压回到一帧以内
+};
+
+// 让下一次 ProcessStream 停顿 stallNs，测量之后追上积压的时间
+Drain injectStall(int64_t stallNs) {
+    auto& apm = fake_device::apm();
+    apm.stallOnceNs = stallNs;
+    Drain drain{false, 0, 0};
+    // 替身在停顿开始时清零 stallOnceNs，停顿结束后 framesProcessed 才加一
+    if (!waitFor([&] { return apm.stallOnceNs.load() == 0; }, 1000 * kMs)) return drain;
+    // 停顿期间采样积压；单核上处理线程一恢复就会在测试线程再被调度之前追完，停顿结束后再看就晚了
+    const uint64_t stalledFrame = apm.framesProcessed.load();
+    bool resumed = waitFor([&] {
+        drain.peakFrames = std::max(drain.peakFrames, backlogFrames());
+        return apm.framesProcessed.load() > stalledFrame;
+    }, stallNs + 1000 * kMs);
+    if (!resumed) return drain;
+    const int64_t stallEnd = apm.lastProcessNs.load();
+    drain.ok = waitFor([] { return backlogFrames() <= 1; }, 1000 * kMs);
+    drain.drainNs = recorder_test::nowNs() - stallEnd;
+    return drain;
+}
+
+// 替身设备送出的正弦 (见 fake_aaudio.cpp)
+int16_t deviceSample(size_t position) {
+    return static_cast<int16_t>(8192.0 * std::sin(2.0 * M_PI * 1000.0 * position / kSampleRate));
+}
+
+} // namespace
+
+// 同一段输入分别走 float 和 int16 路径 (apmHandlePcm 与实时处理共用 processFrame / processFrameS16)，
+// 比较处理线程上每帧的 CPU 时间。替身 APM 是直通的，只在 int16 接口内部做和真实 APM 一样的格式转换，
+// 所以这里量到的只是两条路径的转换和拷贝开销，不代表真实 APM 下 int16 / float 的总 CPU 差别
+RECORDER_BENCH(AAudioRecorder, sampleFormatCpuPerFrame) {
+    fake_device::resetAll();
+    const std::string input = recorder_test::tempPath("format_input.pcm");
+    const std::vector<int16_t> samples = speechLike(30.0, 7);
+    recorder_test::writePcm(input, samples);
+    const double frames = static_cast<double>(samples.size() / kFrame);
+
+    printf("  CPU per 10 ms frame, best of 3 passes over %.0f frames\n", frames);
+    printf("  pass-through fake APM: conversion and copy overhead only, not APM processing cost\n");
+    for (SampleFormat format : {SampleFormat::Float, SampleFormat::Int16}) {
+        int64_t best = INT64_MAX;
+        for (int pass = 0; pass < 3; ++pass) {
+            CallbackPCMRecorder recorder;
+            recorder.setSampleFormat(format);
+            int64_t begin = recorder_test::threadCpuNs();
+            recorder.apmHandlePcm(input.c_str());
+            best = std::min(best, recorder_test::threadCpuNs() - begin);
+        }
+        printf("  %-6s %8.2f us\n", format == SampleFormat::Int16 ? "int16" : "float", best / frames / 1e3);
+    }
+}
+
+// 处理线程停顿 100 ms 后一次取走多帧追赶：很快回到一帧以内，期间没有丢帧，
+// 批量转换和合并写出的输出与原始采集逐采样一致 (替身 APM 直通)
+RECORDER_TEST(AAudioRecorder, backlogDrainsAfterStall) {
+    fake_device::resetAll();
+    const std::string source = recorder_test::tempPath("stall_source.pcm");
+    const std::string output = recorder_test::tempPath("stall_output.pcm");
+    Drain drain{};
+    {
+        CallbackPCMRecorder recorder;
+        CHECK(recorder.start(source.c_str(), output.c_str()));
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        drain = injectStall(100 * kMs);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        recorder.stop();
+    }
+    CHECK(drain.ok);
+    CHECK_MSG(drain.peakFrames >= 8, "peak backlog %lld frames", (long long) drain.peakFrames);
+    CHECK_MSG(drain.drainNs < 60 * kMs, "drained %lld frames in %.1f ms",
+              (long long) drain.peakFrames, drain.drainNs / 1e6);
+
+    std::vector<int16_t> captured = recorder_test::readPcm(source);
+    std::vector<int16_t> processed = recorder_test::readPcm(output);
+    CHECK(captured.size() >= 50 * kFrame && captured.size() % kFrame == 0);
+    CHECK_MSG(processed == captured, "output %zu samples, source %zu", processed.size(), captured.size());
+    for (size_t i = 0; i < captured.size(); ++i) {
+        CHECK_MSG(captured[i] == deviceSample(i), "sample %zu lost or reordered", i);
+    }
+}
+
+// 不同长度的停顿之后追平积压的时间；ring 只有 RING_FRAMES (约 170 ms)，停顿不能超过它。
+// 替身 APM 不耗时，追赶时间是测试线程观察到的上界，反映的是每次多帧取走的调度，而不是 APM 的速度
+RECORDER_BENCH(AAudioRecorder, backlogDrain) {
+    printf("  %-8s %8s %12s %10s\n", "format", "stall", "peak frames", "drain");
+    for (SampleFormat format : {SampleFormat::Float, SampleFormat::Int16}) {
+        fake_device::resetAll();
+        const std::string source = recorder_test::tempPath("drain_source.pcm");
+        const std::string output = recorder_test::tempPath("drain_output.pcm");
+        CallbackPCMRecorder recorder;
+        recorder.setSampleFormat(format);
+        if (!recorder.start(source.c_str(), output.c_str())) continue;
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        for (int64_t stallMs : {30, 60, 120}) {
+            Drain drain = injectStall(stallMs * kMs);
+            printf("  %-8s %5lld ms %12lld %7.1f ms%s\n", format == SampleFormat::Int16 ? "int16" : "float",
+                   (long long) stallMs, (long long) drain.peakFrames, drain.drainNs / 1e6,
+                   drain.ok ? "" : "  TIMEOUT");
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+        recorder.stop();
+    }
+}
+
+namespace {
+
+// 调用 action 到下一次 ProcessStream 完成的时间，也就是处理线程写出第一帧的时间
+template <typename Fn>
+int64_t timeToFirstOutput(Fn action) {
+    auto& apm = fake_device::apm();
+    const uint64_t before = apm.framesProcessed.load();
+    const int64_t begin = recorder_test::nowNs();
+    if (!action()) return -1;
+    if (!waitFor([&] { return apm.framesProcessed.load() > before; }, 2000 * kMs)) return -1;
+    return apm.lastProcessNs.load() - begin;
+}
+
+// 暂停足够久，ring 中剩下的整帧已经处理完
+bool pauseAndSettle(CallbackPCMRecorder& recorder) {
+    if (!recorder.pause()) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    return true;
+}
+
+} // namespace
+
+// 打开流 50 ms、创建 APM 80 ms 时 start() 要等这些都完成；resume() 只重新启动同一个流，
+// 第一帧在凑满 480 个采样 (3 次 192 帧的回调) 后立即处理，不超过一个回调周期加一帧
+RECORDER_TEST(AAudioRecorder, resumeSkipsStartupCost) {
+    fake_device::resetAll();
+    fake_device::aaudio().openDelayNs = 50 * kMs;
+    fake_device::apm().createDelayNs = 80 * kMs;
+    const std::string source = recorder_test::tempPath("resume_source.pcm");
+    const std::string output = recorder_test::tempPath("resume_output.pcm");
+    const int64_t callbackNs = 1000000000LL * fake_device::aaudio().framesPerCallback.load() / kSampleRate;
+    const int64_t frameNs = 1000000000LL * kFrame / kSampleRate;
+
+    std::vector<int64_t> resumes;
+    int64_t startNs;
+    {
+        CallbackPCMRecorder recorder;
+        startNs = timeToFirstOutput([&] { return recorder.start(source.c_str(), output.c_str()); });
+        CHECK(startNs >= 80 * kMs);
+        for (int i = 0; i < 5; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            CHECK(pauseAndSettle(recorder));
+            CHECK(!recorder.pause());
+            const uint64_t created = fake_device::apm().created.load();
+            resumes.push_back(timeToFirstOutput([&] { return recorder.resume(); }));
+            // 恢复不会重新打开流或重建 APM
+            CHECK(fake_device::apm().created.load() == created);
+            CHECK(fake_device::aaudio().openStreams.load() == 1);
+        }
+        CHECK(!recorder.resume());
+        recorder.stop();
+    }
+    for (size_t i = 0; i < resumes.size(); ++i) {
+        CHECK_MSG(resumes[i] > 0 && resumes[i] < callbackNs + frameNs + 5 * kMs,
+                  "resume %zu: first output after %.1f ms (start %.1f ms)", i, resumes[i] / 1e6, startNs / 1e6);
+        CHECK(resumes[i] * 4 < startNs);
+    }
+    // 暂停前后的输出首尾相接，没有丢帧也没有重复
+    std::vector<int16_t> captured = recorder_test::readPcm(source);
+    CHECK(recorder_test::readPcm(output) == captured);
+    for (size_t i = 0; i < captured.size(); ++i) {
+        CHECK_MSG(captured[i] == deviceSample(i), "sample %zu lost or reordered", i);
+    }
+}
+
+// 冷启动和恢复到第一帧输出的时间；替身设备和 APM 的耗时都是 sleep，冷启动的数字取决于设定的延迟
+RECORDER_BENCH(AAudioRecorder, timeToFirstOutput) {
+    fake_device::resetAll();
+    fake_device::aaudio().openDelayNs = 50 * kMs;
+    fake_device::apm().createDelayNs = 80 * kMs;
+    printf("  fake openStream 50 ms, APM create 80 ms, %d frames per callback\n",
+           fake_device::aaudio().framesPerCallback.load());
+    printf("  %-8s %10s %10s %10s %10s\n", "path", "runs", "p50", "p90", "max");
+    const std::string source = recorder_test::tempPath("first_source.pcm");
+    const std::string output = recorder_test::tempPath("first_output.pcm");
+
+    std::vector<int64_t> starts, resumes;
+    for (int run = 0; run < 5; ++run) {
+        CallbackPCMRecorder recorder;
+        int64_t startNs = timeToFirstOutput([&] { return recorder.start(source.c_str(), output.c_str()); });
+        if (startNs > 0) starts.push_back(startNs);
+        for (int i = 0; i < 10; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(30));
+            if (!pauseAndSettle(recorder)) break;
+            int64_t resumeNs = timeToFirstOutput([&] { return recorder.resume(); });
+            if (resumeNs > 0) resumes.push_back(resumeNs);
+        }
+        recorder.stop();
+    }
+    for (auto* path : {&starts, &resumes}) {
+        if (path->empty()) continue;
+        printf("  %-8s %10zu %8.1fms %8.1fms %8.1fms\n", path == &starts ? "start" : "resume", path->size(),
+               recorder_test::percentile(*path, 50) / 1e6, recorder_test::percentile(*path, 90) / 1e6,
+               *std::max_element(path->begin(), path->end()) / 1e6);
+    }
+}
+
+// 打开流、创建 APM 和打开文件并行进行，全部完成后才 requestStart，第一个回调到来时处理线程已经就绪；
+// start() 的耗时接近最慢的一项，而不是各项之和
+RECORDER_TEST(AAudioRecorder, startupRunsSetupInParallel) {
+    fake_device::resetAll();
+    auto& device = fake_device::aaudio();
+    auto& apm = fake_device::apm();
+    device.openDelayNs = 60 * kMs;
+    apm.createDelayNs = 80 * kMs;
+    const std::string source = recorder_test::tempPath("startup_source.pcm");
+    const std::string output = recorder_test::tempPath("startup_output.pcm");
+
+    CallbackPCMRecorder recorder;
+    const int64_t begin = recorder_test::nowNs();
+    CHECK(recorder.start(source.c_str(), output.c_str()));
+    const int64_t startNs = recorder_test::nowNs() - begin;
+    CHECK(waitFor([&] { return apm.framesProcessed.load() > 0; }, 2000 * kMs));
+    recorder.stop();
+
+    const int64_t requestStart = device.requestStartNs.load();
+    CHECK(apm.created.load() == 1 && device.openedNs.load() != 0);
+    CHECK_MSG(apm.createdNs.load() <= requestStart, "APM ready %.1f ms after requestStart",
+              (apm.createdNs.load() - requestStart) / 1e6);
+    CHECK(device.openedNs.load() <= requestStart);
+    CHECK(device.firstCallbackNs.load() >= requestStart);
+    const int64_t serialNs = device.openDelayNs.load() + apm.createDelayNs.load();
+    CHECK_MSG(startNs < serialNs - 30 * kMs, "start() took %.1f ms, serial setup %.1f ms",
+              startNs / 1e6, serialNs / 1e6);
+    CHECK(device.openStreams.load() == 0);
+}
+
+// requestStart 失败时 start() 返回 false，流、处理线程和文件都被释放，同一个对象还能再次启动
+RECORDER_TEST(AAudioRecorder, failedStartCleansUp) {
+    fake_device::resetAll();
+    auto& device = fake_device::aaudio();
+    device.failStart = true;
+    const std::string source = recorder_test::tempPath("failed_source.pcm");
+    const std::string output = recorder_test::tempPath("failed_output.pcm");
+
+    CallbackPCMRecorder recorder;
+    CHECK(!recorder.start(source.c_str(), output.c_str()));
+    CHECK(device.openStreams.load() == 0);
+    CHECK(device.requestStartNs.load() == 0 && device.framesDelivered.load() == 0);
+    CHECK(!recorder.pause());
+    CHECK(!recorder.resume());
+    recorder.stop();
+
+    device.failStart = false;
+    CHECK(recorder.start(source.c_str(), output.c_str()));
+    CHECK(device.openStreams.load() == 1);
+    CHECK(waitFor([] { return fake_device::apm().framesProcessed.load() >= 10; }, 2000 * kMs));
+    recorder.stop();
+    CHECK(device.openStreams.load() == 0);
+    std::vector<int16_t> captured = recorder_test::readPcm(source);
+    CHECK(!captured.empty() && recorder_test::readPcm(output) == captured);
+}
+
+// 处理线程预热 (100 帧) 后由 AllocGuard 统计堆分配：稳态和追赶积压都不应分配，
+// 内联 DF 和单独线程的 DF 各跑一遍。计数包括 malloc/calloc/realloc，libdf 的分配器也算在内
+RECORDER_TEST(AAudioRecorder, steadyStateDoesNotAllocate) {
+    using Mode = CallbackPCMRecorder::DeepFilterMode;
+    for (Mode mode : {Mode::Inline, Mode::Pipelined}) {
+        fake_device::resetAll();
+        const std::string source = recorder_test::tempPath("alloc_source.pcm");
+        const std::string output = recorder_test::tempPath("alloc_output.pcm");
+        const uint64_t before = AllocGuard::count();
+        {
+            CallbackPCMRecorder recorder;
+            recorder.setDeepFilterModel("model.tar.gz", 100.f, mode);
+            CHECK(recorder.start(source.c_str(), output.c_str()));
+            CHECK(waitFor([] { return fake_device::apm().framesProcessed.load() >= 150; }, 3000 * kMs));
+            CHECK(injectStall(50 * kMs).ok);
+            CHECK(waitFor([] { return fake_device::apm().framesProcessed.load() >= 250; }, 3000 * kMs));
+            recorder.stop();
+        }
+        const uint64_t allocations = AllocGuard::count() - before;
+        CHECK_MSG(allocations == 0, "%s DF: %llu heap allocations on the processing thread after warm-up",
+                  mode == Mode::Inline ? "inline" : "pipelined", (unsigned long long) allocations);
+    }
+}
+
+// 各项 setup 的耗时都是 sleep，start() 的时间和按各项之和估计的串行时间对比
+RECORDER_BENCH(AAudioRecorder, startupTimeline) {
+    struct Setup {
+        int64_t openMs;
+        int64_t apmMs;
+    };
+    printf("  %-10s %-10s %10s %10s %14s %16s\n", "open", "APM", "serial", "start()", "first callback",
+           "first output");
+    for (Setup setup : {Setup{0, 0}, Setup{60, 20}, Setup{20, 80}, Setup{100, 100}}) {
+        fake_device::resetAll();
+        auto& device = fake_device::aaudio();
+        device.openDelayNs = setup.openMs * kMs;
+        fake_device::apm().createDelayNs = setup.apmMs * kMs;
+        CallbackPCMRecorder recorder;
+        const int64_t begin = recorder_test::nowNs();
+        if (!recorder.start(recorder_test::tempPath("timeline_source.pcm").c_str(),
+                            recorder_test::tempPath("timeline_output.pcm").c_str())) continue;
+        const int64_t startNs = recorder_test::nowNs() - begin;
+        // 下一帧要 10 ms 之后才到，轮询到的就是第一帧的处理时间
+        waitFor([] { return fake_device::apm().framesProcessed.load() > 0; }, 2000 * kMs);
+        const int64_t firstOutputNs = fake_device::apm().lastProcessNs.load() - begin;
+        recorder.stop();
+        printf("  %7lld ms %7lld ms %7lld ms %7.1f ms %11.1f ms %13.1f ms\n", (long long) setup.openMs,
+               (long long) setup.apmMs, (long long) (setup.openMs + setup.apmMs), startNs / 1e6,
+               (device.firstCallbackNs.load() - begin) / 1e6, firstOutputNs / 1e6);
+    }
+}
@@ -0,0 +1,48 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include <cstdlib>
+#include <thread>
+
+#include "AllocGuard.h"
+
+#include "TestHarness.h"
+
+namespace {
+
+// 经过函数指针调用，编译器不能把成对的 malloc / free 消掉
+void* (*volatile mallocFn)(size_t) = malloc;
+void* (*volatile callocFn)(size_t, size_t) = calloc;
+void* (*volatile reallocFn)(void*, size_t) = realloc;
+int (*volatile posixMemalignFn)(void**, size_t, size_t) = posix_memalign;
+void (*volatile freeFn)(void*) = free;
+
+} // namespace
+
+// C 分配接口 (libdf 的 Rust 分配器走这里) 和 operator new 都计数；free 和未 arm 的线程不计数
+RECORDER_TEST(AllocGuard, countsEveryAllocator) {
+    const uint64_t before = AllocGuard::count();
+    AllocGuard::arm();
+    void* p = mallocFn(64);
+    void* q = callocFn(4, 16);
+    p = reallocFn(p, 4096);
+    void* aligned = nullptr;
+    int alignedResult = posixMemalignFn(&aligned, 64, 256);
+    int* object = new int(7);
+    recorder_test::keep(object);
+    delete object;
+    freeFn(p);
+    freeFn(q);
+    freeFn(aligned);
+    AllocGuard::disarm();
+    const uint64_t counted = AllocGuard::count() - before;
+    CHECK(alignedResult == 0);
+    CHECK_MSG(counted == 5, "counted %llu allocations, expected 5", (unsigned long long) counted);
+
+    std::thread other([] { freeFn(mallocFn(64)); });
+    AllocGuard::arm();
+    other.join();
+    AllocGuard::disarm();
+    CHECK_MSG(AllocGuard::count() - before == 5, "counted an allocation on an unarmed thread");
+}
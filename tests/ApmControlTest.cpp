@@ -0,0 +1,69 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include <memory>
+#include <vector>
+
+#include "ApmConfig.h"
+#include "ApmControl.h"
+#include "DeepFilterProcessing.h"
+#include "FakeDevices.h"
+
+#include "TestHarness.h"
+
+namespace {
+
+constexpr size_t kFrame = 480;
+
+// 安装了内联 DF 的 APM，和 createApm(true) 一样由 ApmControl 调整 DF 参数
+struct InlineDeepFilter {
+    InlineDeepFilter() {
+        auto processing = std::make_unique<DeepFilterProcessing>(DeepFilterStream::create("model.tar.gz", 100.f));
+        DeepFilterProcessing* df = processing.get();
+        apm = createDefaultApm(std::move(processing));
+        control.attach(apm.get(), df);
+    }
+
+    // 处理 frames 帧，返回其中 DF 模型实际运行的 hop 数
+    uint64_t run(int frames) {
+        const webrtc::StreamConfig config(48000, 1);
+        std::vector<float> frame(kFrame, 0.1f);
+        float* channels[1] = {frame.data()};
+        const uint64_t before = fake_device::deepFilter().framesProcessed.load();
+        for (int i = 0; i < frames; ++i) {
+            control.apply(apm.get());
+            apm->ProcessStream(channels, config, config, channels);
+        }
+        return fake_device::deepFilter().framesProcessed.load() - before;
+    }
+
+    ApmControl control;
+    rtc::scoped_refptr<webrtc::AudioProcessing> apm;
+};
+
+} // namespace
+
+// 用户的挂起和 QualityGovernor 的旁路分开记录：governor 恢复或退出时不会撤销用户的挂起
+RECORDER_TEST(ApmControl, governorDoesNotUndoUserSuspend) {
+    fake_device::resetAll();
+    InlineDeepFilter apm;
+    CHECK(apm.run(10) > 0);
+
+    // 挂起时只再跑一个 hop 淡出
+    CHECK(apm.control.deepFilter(ApmControl::kDfSuspended, 1.f));
+    CHECK(apm.run(10) == 1);
+
+    // governor 降到 DF off 又恢复
+    CHECK(apm.control.deepFilter(ApmControl::kDfGovernorOff, 1.f));
+    CHECK(apm.run(10) == 0);
+    CHECK(apm.control.deepFilter(ApmControl::kDfGovernorOff, 0.f));
+    CHECK_MSG(apm.run(10) == 0, "governor step-up resumed a user-suspended DF");
+
+    // 反过来: 用户恢复时 governor 的旁路仍然有效
+    CHECK(apm.control.deepFilter(ApmControl::kDfGovernorOff, 1.f));
+    CHECK(apm.control.deepFilter(ApmControl::kDfSuspended, 0.f));
+    CHECK_MSG(apm.run(10) == 0, "user resume overrode the governor");
+    CHECK(apm.control.deepFilter(ApmControl::kDfGovernorOff, 0.f));
+    CHECK(apm.run(10) > 0);
+}
@@ -0,0 +1,187 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AsyncFileSink.h"
+
+#include "FakeDevices.h"
+#include "TestHarness.h"
+
+/**
+ * 写盘停顿由 host/fake_storage.cpp 注入到 pwritev，生产者模拟处理线程：
+ * 每 1 ms 向 source / rtc 两个文件各写一帧 (480 个 int16)，约 10 倍实时速率，
+ * 记录每次 write() 在生产者线程上的耗时
+ */
+namespace {
+
+constexpr size_t kFrameSamples = 480;
+
+// 第 index 帧的内容，没有全零的帧，文件里的空洞可以和数据区分开
+void fillFrame(std::vector<int16_t>& frame, size_t index, int16_t salt) {
+    for (size_t i = 0; i < frame.size(); ++i) {
+        frame[i] = static_cast<int16_t>((index * 7 + i) % 1000 + 1 + salt);
+    }
+}
+
+struct ProducerResult {
+    std::vector<int64_t> writeNs;       // 每次 write() 的耗时
+    std::vector<int16_t> source;
+    std::vector<int16_t> rtc;
+};
+
+ProducerResult produce(AsyncFileSink& source, AsyncFileSink& rtc, size_t frames, int periodUs) {
+    ProducerResult result;
+    result.writeNs.reserve(frames * 2);
+    result.source.reserve(frames * kFrameSamples);
+    result.rtc.reserve(frames * kFrameSamples);
+    std::vector<int16_t> frame(kFrameSamples);
+
+    int64_t next = recorder_test::nowNs();
+    for (size_t i = 0; i < frames; ++i) {
+        fillFrame(frame, i, 0);
+        int64_t begin = recorder_test::nowNs();
+        source.write(reinterpret_cast<const char*>(frame.data()), frame.size() * sizeof(int16_t));
+        result.writeNs.push_back(recorder_test::nowNs() - begin);
+        result.source.insert(result.source.end(), frame.begin(), frame.end());
+
+        fillFrame(frame, i, 1);
+        begin = recorder_test::nowNs();
+        rtc.write(reinterpret_cast<const char*>(frame.data()), frame.size() * sizeof(int16_t));
+        result.writeNs.push_back(recorder_test::nowNs() - begin);
+        result.rtc.insert(result.rtc.end(), frame.begin(), frame.end());
+
+        next += periodUs * 1000LL;
+        int64_t wait = next - recorder_test::nowNs();
+        if (wait > 0) std::this_thread::sleep_for(std::chrono::nanoseconds(wait));
+    }
+    return result;
+}
+
+int64_t maxOf(const std::vector<int64_t>& samples) {
+    int64_t value = 0;
+    for (int64_t s : samples) value = std::max(value, s);
+    return value;
+}
+
+} // namespace
+
+// 每 3 次 pwritev 停顿 200 ms：写入线程被卡住，生产者的 write() 仍然只是内存拷贝，数据完整
+RECORDER_TEST(AsyncFileSink, stallsDoNotBlockProducer) {
+    fake_device::resetAll();
+    fake_device::storage().stallEvery = 3;
+    fake_device::storage().stallNs = 200000000;
+
+    const std::string sourcePath = recorder_test::tempPath("stall_source.pcm");
+    const std::string rtcPath = recorder_test::tempPath("stall_rtc.pcm");
+    AsyncFileWriter writer;
+    AsyncFileSink source(writer), rtc(writer);
+    CHECK(source.open(sourcePath.c_str()));
+    CHECK(rtc.open(rtcPath.c_str()));
+
+    ProducerResult produced = produce(source, rtc, 2000, 1000);
+    CHECK(source.droppedBytes() == 0);
+    CHECK(rtc.droppedBytes() == 0);
+    source.close();
+    rtc.close();
+    AsyncFileWriter::Stats stats = writer.stats();
+    writer.stop();
+
+    CHECK_MSG(fake_device::storage().stalls > 0, "no stall was injected (%llu writes)",
+              (unsigned long long) fake_device::storage().writes.load());
+    CHECK(stats.writeNsMax >= 200000000);
+    // 停顿是 200 ms，生产者上最慢的一次 write() 也应该只是调度抖动的量级
+    int64_t worst = maxOf(produced.writeNs);
+    CHECK_MSG(worst < 5000000, "producer write() took %.2f ms", worst / 1e6);
+
+    CHECK(recorder_test::readPcm(sourcePath) == produced.source);
+    CHECK(recorder_test::readPcm(rtcPath) == produced.rtc);
+}
+
+// 停顿超过块池能缓冲的时长：生产者丢弃数据而不是等待，文件中对应位置是静音，前后数据保持对齐
+RECORDER_TEST(AsyncFileSink, exhaustedPoolDropsInsteadOfWaiting) {
+    fake_device::resetAll();
+    fake_device::storage().stallEvery = 1;
+    fake_device::storage().stallNs = 300000000;
+
+    const std::string path = recorder_test::tempPath("drop.pcm");
+    AsyncFileWriter writer;
+    AsyncFileSink sink(writer);
+    CHECK(sink.open(path.c_str()));
+
+    // 块池的 1.5 倍，一次性写入
+    const size_t frames = AsyncFileWriter::kBlockBytes * AsyncFileWriter::kBlockCount * 3 / 2
+                          / (kFrameSamples * sizeof(int16_t));
+    std::vector<int16_t> expected;
+    std::vector<int16_t> frame(kFrameSamples);
+    int64_t worst = 0;
+    for (size_t i = 0; i < frames; ++i) {
+        fillFrame(frame, i, 0);
+        int64_t begin = recorder_test::nowNs();
+        sink.write(reinterpret_cast<const char*>(frame.data()), frame.size() * sizeof(int16_t));
+        worst = std::max(worst, recorder_test::nowNs() - begin);
+        expected.insert(expected.end(), frame.begin(), frame.end());
+    }
+    uint64_t dropped = sink.droppedBytes();
+    fake_device::storage().stallEvery = 0;
+    sink.close();
+    writer.stop();
+
+    CHECK_MSG(worst < 5000000, "producer write() took %.2f ms", worst / 1e6);
+    CHECK(dropped > 0);
+    std::vector<int16_t> written = recorder_test::readPcm(path);
+    CHECK(written.size() == expected.size());
+    uint64_t silentBytes = 0;
+    for (size_t i = 0; i < written.size(); ++i) {
+        if (written[i] == 0) {
+            silentBytes += sizeof(int16_t);
+        } else {
+            CHECK_MSG(written[i] == expected[i], "sample %zu misplaced", i);
+        }
+    }
+    CHECK(silentBytes == dropped);
+}
+
+RECORDER_BENCH(AsyncFileSink, writeLatencyUnderStalls) {
+    printf("  producer write() latency (us) and writer thread stats, 1500 frames x 2 files at 1 ms (10x real time)\n");
+    printf("  %-22s %8s %8s %8s %8s %12s %10s %8s\n", "storage", "p50", "p99", "max", "dropped",
+           "pwritev avg", "max (ms)", "queue");
+    struct Case {
+        const char* name;
+        int every;
+        int64_t stallNs;
+    };
+    for (const Case& c : {Case{"no stalls", 0, 0}, Case{"100 ms every 4th write", 4, 100000000},
+                          Case{"500 ms every 4th write", 4, 500000000}}) {
+        fake_device::resetAll();
+        fake_device::storage().stallEvery = c.every;
+        fake_device::storage().stallNs = c.stallNs;
+
+        const std::string sourcePath = recorder_test::tempPath("bench_source.pcm");
+        const std::string rtcPath = recorder_test::tempPath("bench_rtc.pcm");
+        AsyncFileWriter writer;
+        AsyncFileSink source(writer), rtc(writer);
+        source.open(sourcePath.c_str());
+        rtc.open(rtcPath.c_str());
+        ProducerResult produced = produce(source, rtc, 1500, 1000);
+        uint64_t dropped = source.droppedBytes() + rtc.droppedBytes();
+        fake_device::storage().stallEvery = 0;
+        source.close();
+        rtc.close();
+        AsyncFileWriter::Stats stats = writer.stats();
+        writer.stop();
+
+        std::vector<int64_t>& ns = produced.writeNs;
+        int64_t p50 = recorder_test::percentile(ns, 50);
+        int64_t p99 = recorder_test::percentile(ns, 99);
+        printf("  %-22s %8.1f %8.1f %8.1f %8llu %9.2f ms %10.1f %5zu/%zu\n", c.name, p50 / 1e3, p99 / 1e3,
+               maxOf(ns) / 1e3, (unsigned long long) dropped,
+               stats.writeCalls ? stats.writeNsTotal / 1e6 / stats.writeCalls : 0.0, stats.writeNsMax / 1e6,
+               stats.queueDepthMax, AsyncFileWriter::kBlockCount);
+    }
+}
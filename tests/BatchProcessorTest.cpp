@@ -0,0 +1,272 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BatchProcessor.h"
+#include "FakeDevices.h"
+
+#include "TestHarness.h"
+
+namespace {
+
+constexpr uint32_t kSampleRate = 48000;
+
+// 正弦加噪声，拼接位置错一个采样也会产生很大的差值
+std::vector<int16_t> toneWithNoise(double seconds, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.f, 1000.f);
+    std::vector<int16_t> samples(static_cast<size_t>(seconds * kSampleRate));
+    for (size_t i = 0; i < samples.size(); ++i) {
+        float v = 8000.f * std::sin(2.f * static_cast<float>(M_PI) * 997.f * i / kSampleRate) + noise(rng);
+        samples[i] = static_cast<int16_t>(std::max(-32768.f, std::min(32767.f, v)));
+    }
+    return samples;
+}
+
+BatchJob makeJob(const char* name, const std::vector<int16_t>& samples) {
+    BatchJob job;
+    job.input = recorder_test::tempPath((std::string(name) + "_in.pcm").c_str());
+    job.output = recorder_test::tempPath((std::string(name) + "_out.pcm").c_str());
+    recorder_test::writePcm(job.input, samples);
+    return job;
+}
+
+BatchOptions monoOptions(unsigned threads) {
+    BatchOptions options;
+    options.threads = threads;
+    options.rawFormat = {kSampleRate, 1, 16};
+    return options;
+}
+
+// 长短不一的一组文件，内容各不相同
+std::vector<BatchJob> makeJobs(const char* name, const std::vector<double>& seconds) {
+    std::vector<BatchJob> jobs;
+    for (size_t i = 0; i < seconds.size(); ++i) {
+        std::string file = std::string(name) + std::to_string(i);
+        jobs.push_back(makeJob(file.c_str(), toneWithNoise(seconds[i], static_cast<uint32_t>(100 + i))));
+    }
+    return jobs;
+}
+
+// 用 threads 个线程处理全部文件，输出改写到 tag 对应的文件名，返回每个文件的报告 (按下标)
+std::vector<BatchFileReport> runAll(std::vector<BatchJob> jobs, const char* tag, unsigned threads,
+                                    BatchSummary& summary) {
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        jobs[i].output = recorder_test::tempPath((std::string(tag) + std::to_string(i) + "_out.pcm").c_str());
+    }
+    std::vector<BatchFileReport> reports(jobs.size());
+    std::vector<int> seen(jobs.size(), 0);
+    summary = BatchProcessor(monoOptions(threads)).run(jobs, [&](const BatchFileReport& report, size_t, size_t) {
+        reports[report.index] = report;
+        ++seen[report.index];
+    });
+    for (size_t i = 0; i < jobs.size(); ++i) CHECK_MSG(seen[i] == 1, "file %zu reported %d times", i, seen[i]);
+    return reports;
+}
+
+} // namespace
+
+// 每个线程复用自己的 APM，文件之间 Initialize()；多线程的每个输出都应当和单线程处理逐采样一致，
+// 每个文件有自己的 RTF
+RECORDER_TEST(BatchProcessor, runMatchesSingleThread) {
+    fake_device::resetAll();
+    fake_device::apm().adaptFrames = 10;
+    fake_device::apm().targetGain = 0.5f;
+    const std::vector<double> seconds = {3.0, 0.5, 2.2, 0.01, 1.3, 4.0, 0.7, 2.9};
+    std::vector<BatchJob> jobs = makeJobs("files", seconds);
+
+    BatchSummary serial{}, parallel{};
+    std::vector<BatchFileReport> serialReports = runAll(jobs, "serial", 1, serial);
+    std::vector<BatchFileReport> parallelReports = runAll(jobs, "parallel", 4, parallel);
+    CHECK(serial.failed == 0 && parallel.failed == 0);
+    CHECK(parallel.files == jobs.size() && parallel.workerBusySeconds.size() == 4);
+
+    double totalSeconds = 0.0;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const BatchFileReport& report = parallelReports[i];
+        const uint64_t frames = static_cast<uint64_t>(seconds[i] * 100) * kSampleRate / 100;
+        CHECK_MSG(report.ok && report.frames == frames, "file %zu: %llu frames", i,
+                  (unsigned long long) report.frames);
+        CHECK(report.realtimeFactor > 0 && std::fabs(report.realtimeFactor * report.audioSeconds -
+                                                     report.wallSeconds) < 1e-9);
+        totalSeconds += report.audioSeconds;
+
+        std::vector<int16_t> a = recorder_test::readPcm(recorder_test::tempPath(
+                ("serial" + std::to_string(i) + "_out.pcm").c_str()));
+        std::vector<int16_t> b = recorder_test::readPcm(recorder_test::tempPath(
+                ("parallel" + std::to_string(i) + "_out.pcm").c_str()));
+        CHECK_MSG(a.size() == frames && a == b, "file %zu: %zu / %zu samples differ from the 1-thread run", i,
+                  a.size(), b.size());
+    }
+    CHECK(std::fabs(parallel.audioSeconds - totalSeconds) < 1e-9);
+}
+
+// 一个长文件加一串短文件：短文件所在的线程做完自己的队列后从长文件那个线程的队列尾部窃取
+RECORDER_TEST(BatchProcessor, unevenFilesAreStolen) {
+    fake_device::resetAll();
+    fake_device::apm().frameCostNs = 200000;
+    std::vector<double> seconds = {4.0};
+    for (int i = 0; i < 8; ++i) seconds.push_back(0.5);
+    std::vector<BatchJob> jobs = makeJobs("uneven", seconds);
+
+    BatchSummary summary{};
+    std::vector<BatchFileReport> reports = runAll(jobs, "uneven", 2, summary);
+    CHECK(summary.failed == 0);
+    CHECK_MSG(summary.steals > 0, "no steals");
+    // 长文件独占一个线程，其它文件都在另一个线程上完成
+    int longWorker = reports[0].worker;
+    size_t onLongWorker = 0;
+    for (size_t i = 1; i < reports.size(); ++i) onLongWorker += reports[i].worker == longWorker;
+    CHECK_MSG(onLongWorker <= 1, "%zu short files waited behind the long one", onLongWorker);
+    // 整体时间接近最长的那个文件，而不是按轮流分配的一半工作量
+    double busiest = std::max(summary.workerBusySeconds[0], summary.workerBusySeconds[1]);
+    CHECK_MSG(summary.wallSeconds < busiest * 1.3, "wall %.2f s, busiest worker %.2f s",
+              summary.wallSeconds, busiest);
+}
+
+// 替身 APM 的增益每次 Initialize() 后从 1 收敛到 0.5 (时间常数 10 帧)，
+// 预热 1 s 足够收敛，拼接后的输出应当和顺序处理一致，淡化只带来取整误差
+RECORDER_TEST(BatchProcessor, warmupMatchesSequential) {
+    fake_device::resetAll();
+    fake_device::apm().adaptFrames = 10;
+    fake_device::apm().targetGain = 0.5f;
+    const std::vector<int16_t> input = toneWithNoise(20.0, 1);
+    BatchJob job = makeJob("warmup", input);
+
+    SegmentOptions segment;
+    segment.segmentSeconds = 5.0;
+    segment.warmupSeconds = 1.0;
+    segment.crossfadeMs = 20.0;
+    segment.compareSequential = true;
+    segment.compareWindowSeconds = 1.0;
+    SegmentReport report = BatchProcessor(monoOptions(3)).runSegmented(job, segment);
+
+    CHECK(report.ok);
+    CHECK(report.segments == 4);
+    CHECK(report.boundaries.size() == 3);
+    CHECK_MSG(report.stitchedMaxAbsError <= 1, "stitched max |error| %d", report.stitchedMaxAbsError);
+    CHECK_MSG(report.stitchedSnrDb > 80.0, "stitched SNR %.1f dB", report.stitchedSnrDb);
+    for (size_t k = 0; k < report.boundaries.size(); ++k) {
+        CHECK(std::fabs(report.boundaries[k].seconds - 5.0 * static_cast<double>(k + 1)) < 1e-9);
+    }
+
+    // 输出文件本身：长度不变，收敛之后是输入的一半
+    std::vector<int16_t> output = recorder_test::readPcm(job.output);
+    CHECK_MSG(output.size() == input.size(), "output %zu samples, input %zu", output.size(), input.size());
+    for (size_t i = kSampleRate; i < output.size(); ++i) {
+        int expected = static_cast<int>(std::lrint(input[i] * 0.5f));
+        CHECK_MSG(std::abs(output[i] - expected) <= 1, "sample %zu: got %d, expected %d", i, output[i], expected);
+    }
+}
+
+// 不预热时每段开头都从初始增益开始，比较必须能发现拼接处的差异
+RECORDER_TEST(BatchProcessor, noWarmupShowsAtBoundaries) {
+    fake_device::resetAll();
+    fake_device::apm().adaptFrames = 10;
+    fake_device::apm().targetGain = 0.5f;
+    BatchJob job = makeJob("cold", toneWithNoise(12.0, 2));
+
+    SegmentOptions segment;
+    segment.segmentSeconds = 4.0;
+    segment.warmupSeconds = 0.0;
+    segment.compareSequential = true;
+    segment.compareWindowSeconds = 0.5;
+    SegmentReport report = BatchProcessor(monoOptions(2)).runSegmented(job, segment);
+
+    CHECK(report.ok);
+    CHECK(report.boundaries.size() == 2);
+    for (const auto& boundary : report.boundaries) {
+        CHECK_MSG(boundary.maxAbsError > 2000, "boundary %.1f s: max |error| %d",
+                  boundary.seconds, boundary.maxAbsError);
+        CHECK_MSG(boundary.snrDb < 40.0, "boundary %.1f s: SNR %.1f dB", boundary.seconds, boundary.snrDb);
+    }
+}
+
+// 最后一段不足 segmentSeconds，末尾不足 10 ms 的部分丢弃
+RECORDER_TEST(BatchProcessor, shortLastSegment) {
+    fake_device::resetAll();
+    std::vector<int16_t> input = toneWithNoise(7.3, 3);
+    input.resize(input.size() + 123);
+    BatchJob job = makeJob("tail", input);
+
+    SegmentOptions segment;
+    segment.segmentSeconds = 3.0;
+    segment.warmupSeconds = 0.5;
+    segment.compareSequential = true;
+    SegmentReport report = BatchProcessor(monoOptions(2)).runSegmented(job, segment);
+
+    CHECK(report.ok);
+    CHECK(report.segments == 3);
+    CHECK(report.stitchedMaxAbsError <= 1);
+    std::vector<int16_t> output = recorder_test::readPcm(job.output);
+    CHECK_MSG(output.size() == 730 * kSampleRate / 100, "output %zu samples", output.size());
+}
+
+// 替身 APM 每帧 sleep 一段时间，不占 CPU，数字只反映分段调度本身能得到的并行度；
+// 真实 APM 的加速比受核数限制
+RECORDER_BENCH(BatchProcessor, segmentedSpeedup) {
+    fake_device::resetAll();
+    fake_device::apm().frameCostNs = 200000;
+    fake_device::apm().adaptFrames = 50;
+    fake_device::apm().targetGain = 0.5f;
+    BatchJob job = makeJob("speedup", toneWithNoise(20.0, 4));
+
+    printf("  20 s mono, 200 us per frame, gain settles in ~50 frames, 5 s segments, 20 ms crossfade\n");
+    printf("  %-8s %-8s %10s %10s %9s %12s %10s\n", "threads", "warmup", "parallel", "sequential", "speedup",
+           "SNR dB", "max |err|");
+    for (unsigned threads : {1u, 4u}) {
+        for (double warmup : {0.5, 2.0}) {
+            SegmentOptions segment;
+            segment.segmentSeconds = 5.0;
+            segment.warmupSeconds = warmup;
+            segment.compareSequential = true;
+            SegmentReport report = BatchProcessor(monoOptions(threads)).runSegmented(job, segment);
+            printf("  %-8u %-8.1f %9.2fs %9.2fs %8.2fx %12.1f %10d\n", threads, warmup, report.wallSeconds,
+                   report.sequentialWallSeconds, report.speedup, report.stitchedSnrDb, report.stitchedMaxAbsError);
+        }
+    }
+}
+
+// 16 个长短不一的文件在 1 / 2 / 4 / N 个线程上的吞吐。第一组替身 APM 每帧 sleep 300 us 不占 CPU，
+// 只反映调度和窃取能得到的并行度；第二组没有 APM 开销，是转换、读写本身在这台机器的核数上的扩展
+RECORDER_BENCH(BatchProcessor, throughputByThreads) {
+    fake_device::resetAll();
+    std::vector<double> seconds;
+    for (int i = 0; i < 16; ++i) seconds.push_back(0.5 + (i * 7 % 11) * 0.5);
+    std::vector<BatchJob> jobs = makeJobs("throughput", seconds);
+    double audio = 0.0;
+    for (double s : seconds) audio += s;
+
+    std::vector<unsigned> threadCounts = {1u, 2u, 4u};
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    if (std::find(threadCounts.begin(), threadCounts.end(), cores) == threadCounts.end()) {
+        threadCounts.push_back(cores);
+    }
+
+    printf("  %zu files, %.1f s audio, %u hardware threads\n", jobs.size(), audio, cores);
+    printf("  %-16s %8s %10s %10s %8s %8s %10s %10s\n", "APM", "threads", "wall", "x realtime", "speedup",
+           "steals", "RTF p50", "RTF max");
+    for (int64_t frameCostNs : {300000, 0}) {
+        fake_device::apm().frameCostNs = frameCostNs;
+        double single = 0.0;
+        for (unsigned threads : threadCounts) {
+            BatchSummary summary{};
+            std::vector<BatchFileReport> reports = runAll(jobs, "throughput", threads, summary);
+            std::vector<int64_t> rtf;
+            for (const auto& report : reports) rtf.push_back(static_cast<int64_t>(report.realtimeFactor * 1e6));
+            if (threads == 1) single = summary.wallSeconds;
+            printf("  %-16s %8u %9.2fs %10.1f %7.2fx %8llu %10.4f %10.4f\n",
+                   frameCostNs > 0 ? "sleep 300 us/fr" : "none (CPU only)", threads, summary.wallSeconds,
+                   summary.audioSeconds / summary.wallSeconds, single / summary.wallSeconds,
+                   (unsigned long long) summary.steals, recorder_test::percentile(rtf, 50) / 1e6,
+                   recorder_test::percentile(rtf, 100) / 1e6);
+        }
+    }
+}
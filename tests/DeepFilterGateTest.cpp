@@ -0,0 +1,278 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "DeepFilterGate.h"
+#include "DeepFilterStream.h"
+#include "FakeDevices.h"
+
+#include "TestHarness.h"
+
+namespace {
+
+constexpr size_t kHop = 480;
+constexpr int kSampleRate = DeepFilterStream::kSampleRate;
+constexpr float kNoisy = -50.f;
+constexpr float kClean = -70.f;
+
+// 语音和长停顿交替的合成语料，speech[i] 标记第 i 个 hop 是否在语音段内
+struct Corpus {
+    std::vector<float> samples;
+    std::vector<bool> speech;
+};
+
+// 语音段是 180 Hz 基频加三次谐波，按 4 Hz 的音节节奏调幅，电平在 -32 ~ -21 dBFS 之间；段长都是整数个 hop。
+// 底噪 -50 dBFS 时语音只比噪声底高 20 dB 左右，需要模型；-70 dBFS 时是干净语音
+Corpus speechWithPauses(int bursts, double speechSeconds, double pauseSeconds, float noiseDbfs, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.f, std::pow(10.f, noiseDbfs / 20.f));
+    const auto speechHops = static_cast<size_t>(speechSeconds * kSampleRate / kHop);
+    const auto pauseHops = static_cast<size_t>(pauseSeconds * kSampleRate / kHop);
+    Corpus corpus;
+    size_t n = 0;
+    for (int b = 0; b < bursts; ++b) {
+        for (size_t h = 0; h < pauseHops + speechHops; ++h) {
+            bool speech = h >= pauseHops;
+            corpus.speech.push_back(speech);
+            for (size_t i = 0; i < kHop; ++i, ++n) {
+                float t = static_cast<float>(n) / kSampleRate;
+                float v = noise(rng);
+                if (speech) {
+                    float envelope = 0.65f + 0.35f * std::sin(2.f * static_cast<float>(M_PI) * 4.f * t);
+                    for (int k = 1; k <= 4; ++k) {
+                        v += 0.1f / k * envelope * std::sin(2.f * static_cast<float>(M_PI) * 180.f * k * t);
+                    }
+                }
+                corpus.samples.push_back(v);
+            }
+        }
+    }
+    return corpus;
+}
+
+// 按 10 ms 块送进 DeepFilterStream，返回输出
+std::vector<float> runStream(DeepFilterStream& stream, const std::vector<float>& input) {
+    std::vector<float> output(input);
+    for (size_t offset = 0; offset + kHop <= output.size(); offset += kHop) {
+        stream.process(output.data() + offset);
+    }
+    return output;
+}
+
+} // namespace
+
+RECORDER_TEST(DeepFilterGate, sumOfSquaresMatchesScalar) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> dist(-1.f, 1.f);
+    std::vector<float> x(kHop + 37);
+    for (float& v : x) v = dist(rng);
+    // 不同长度和起点覆盖 SIMD 主循环之后的尾部和非对齐加载
+    for (size_t offset = 0; offset < 4; ++offset) {
+        for (size_t n : {size_t(0), size_t(1), size_t(7), size_t(8), size_t(9), size_t(31), kHop}) {
+            double reference = 0.0;
+            for (size_t i = 0; i < n; ++i) reference += static_cast<double>(x[offset + i]) * x[offset + i];
+            float sum = sumOfSquares(x.data() + offset, n);
+            CHECK_MSG(std::fabs(sum - reference) <= 1e-5 * std::max(1.0, reference),
+                      "n %zu offset %zu: %.9g vs %.9g", n, offset, sum, reference);
+        }
+    }
+}
+
+// 停顿里 hangover 之后旁路，语音一开始就回到模型；切换都经过一个 hop 的淡化
+RECORDER_TEST(DeepFilterGate, speechWithPausesSkipsSilence) {
+    Corpus corpus = speechWithPauses(6, 1.5, 3.0, kNoisy, 1);
+    DeepFilterGate gate(2);
+    const float noisySnrDb = 10.f;
+
+    size_t modelHops = 0;
+    bool modelOutput = true;
+    size_t sinceOnset = 0;
+    for (size_t h = 0; h < corpus.speech.size(); ++h) {
+        DeepFilterGate::Decision decision = gate.update(corpus.samples.data() + h * kHop, kHop, noisySnrDb,
+                                                        true, true);
+        modelHops += decision.runModel;
+        sinceOnset = corpus.speech[h] ? (h > 0 && corpus.speech[h - 1] ? sinceOnset + 1 : 0) : 0;
+
+        using Output = DeepFilterGate::Output;
+        if (corpus.speech[h]) {
+            // 语音段从第一个 hop 开始跑模型，预热的 warmupHops - 1 个 hop 之后输出模型结果
+            CHECK_MSG(decision.runModel, "speech hop %zu skipped the model", h);
+            if (sinceOnset >= 2) CHECK_MSG(decision.output == Output::Model, "speech hop %zu not on the model", h);
+        }
+        // 输出路径只能经过 FadeToModel / FadeToBypass 改变
+        if (modelOutput) {
+            CHECK_MSG(decision.output == Output::Model || decision.output == Output::FadeToBypass,
+                      "hop %zu jumped from model to bypass", h);
+        } else {
+            CHECK_MSG(decision.output == Output::Bypass || decision.output == Output::FadeToModel,
+                      "hop %zu jumped from bypass to model", h);
+        }
+        if (decision.output == Output::FadeToBypass) modelOutput = false;
+        if (decision.output == Output::FadeToModel) modelOutput = true;
+        if (decision.output == Output::Bypass && !decision.runModel) {
+            CHECK_MSG(decision.bypassGain <= 0.1f, "bypass gain %.3f in a pause", decision.bypassGain);
+        }
+    }
+    // 每段停顿 300 个 hop，除去 hangover 都应当跳过
+    double skipped = 1.0 - static_cast<double>(modelHops) / static_cast<double>(corpus.speech.size());
+    CHECK_MSG(skipped > 0.55, "only %.0f%% of hops skipped", skipped * 100);
+}
+
+RECORDER_TEST(DeepFilterGate, disabledOrOverloaded) {
+    Corpus corpus = speechWithPauses(2, 0.5, 1.0, kNoisy, 2);
+    DeepFilterGate gate;
+    // 不开门控时每个 hop 都跑模型
+    for (size_t h = 0; h < corpus.speech.size(); ++h) {
+        auto decision = gate.update(corpus.samples.data() + h * kHop, kHop, 10.f, false, true);
+        CHECK(decision.runModel && decision.output == DeepFilterGate::Output::Model);
+    }
+    // 挂起或流水线追赶时不等 hangover：正在输出模型结果，先跑一个 hop 淡出，之后旁路，增益为 1
+    auto decision = gate.update(corpus.samples.data(), kHop, 10.f, false, false);
+    CHECK(decision.runModel && decision.output == DeepFilterGate::Output::FadeToBypass && decision.bypassGain == 1.f);
+    decision = gate.update(corpus.samples.data(), kHop, 10.f, false, false);
+    CHECK(!decision.runModel && decision.output == DeepFilterGate::Output::Bypass && decision.bypassGain == 1.f);
+    // 恢复时照常预热后淡入
+    decision = gate.update(corpus.samples.data(), kHop, 10.f, false, true);
+    CHECK(decision.runModel && decision.output == DeepFilterGate::Output::Bypass);
+    decision = gate.update(corpus.samples.data(), kHop, 10.f, false, true);
+    CHECK(decision.runModel && decision.output == DeepFilterGate::Output::FadeToModel);
+}
+
+// 模型报告的局部 SNR 高于 kCleanSnrDb 时 hangover 之后旁路，
+// 之后高出噪声底 kCleanSnrDb 的干净语音不再唤醒模型，增益为 1 直接透传
+RECORDER_TEST(DeepFilterGate, cleanSpeechPassesThrough) {
+    Corpus corpus = speechWithPauses(1, 1.5, 1.0, kClean, 3);
+    DeepFilterGate gate;
+    size_t modelHops = 0;
+    for (size_t h = 0; h < corpus.speech.size(); ++h) {
+        auto decision = gate.update(corpus.samples.data() + h * kHop, kHop, 40.f, true, true);
+        modelHops += decision.runModel;
+        if (corpus.speech[h]) CHECK_MSG(!decision.runModel && decision.bypassGain == 1.f, "speech hop %zu", h);
+    }
+    CHECK_MSG(modelHops == static_cast<size_t>(DeepFilterGate::kHangoverHops),
+              "model ran %zu hops", modelHops);
+}
+
+// 经过 DeepFilterStream：语音段的输出就是模型输出，切换处增益连续变化
+RECORDER_TEST(DeepFilterGate, streamOutputHasNoClicks) {
+    fake_device::resetAll();
+    Corpus corpus = speechWithPauses(4, 1.5, 2.0, kNoisy, 4);
+    auto stream = DeepFilterStream::create("model.tar.gz", 100.f);
+    CHECK(stream != nullptr);
+    stream->configure(kHop);
+    stream->setGating(true);
+    std::vector<float> output = runStream(*stream, corpus.samples);
+    // FIFO 的延迟加上替身模型自身一个 hop 的延迟
+    const size_t latency = stream->latencySamples() + kHop;
+    const float gain = fake_device::deepFilter().gain;
+
+    for (size_t h = 1; h + 1 < corpus.speech.size(); ++h) {
+        if (!corpus.speech[h] || !corpus.speech[h - 1]) continue;   // 语音段第一个 hop 是淡入
+        for (size_t i = h * kHop; i < (h + 1) * kHop; ++i) {
+            CHECK_MSG(std::fabs(output[i + latency] - corpus.samples[i] * gain) < 1e-6f,
+                      "speech sample %zu: %.6f vs %.6f", i, output[i + latency], corpus.samples[i] * gain);
+        }
+    }
+    // 替身模型和旁路都是纯增益，输出 / 延迟后的输入就是每个采样的实际增益；
+    // 淡化使它每个采样最多变化 1 / hop，硬切换会一步跳过 gain 和旁路增益之差
+    float worstGainStep = 0.f;
+    size_t worstAt = 0;
+    for (size_t n = latency + 1; n < output.size(); ++n) {
+        float x0 = corpus.samples[n - 1 - latency];
+        float x1 = corpus.samples[n - latency];
+        if (std::fabs(x0) < 1e-3f || std::fabs(x1) < 1e-3f) continue;
+        float step = std::fabs(output[n] / x1 - output[n - 1] / x0);
+        if (step > worstGainStep) {
+            worstGainStep = step;
+            worstAt = n;
+        }
+    }
+    CHECK_MSG(worstGainStep < 4.f / kHop, "gain jumps by %.4f at sample %zu", worstGainStep, worstAt);
+
+    DeepFilterStream::Stats stats = stream->stats();
+    CHECK(stats.modelHops == fake_device::deepFilter().framesProcessed);
+    // 2 s 停顿 / 1.5 s 语音，停顿除去 hangover 都跳过
+    CHECK_MSG(stats.modelHops * 5 < stats.hops * 3, "model ran %llu of %llu hops",
+              (unsigned long long) stats.modelHops, (unsigned long long) stats.hops);
+}
+
+// 语音中途挂起 / 恢复，以及流水线追赶时逐 hop 交替的 passThrough：输出的增益每个采样变化不超过淡化的斜率
+RECORDER_TEST(DeepFilterGate, suspendMidSpeechHasNoClicks) {
+    fake_device::resetAll();
+    Corpus corpus = speechWithPauses(1, 6.0, 0.1, kNoisy, 6);
+    auto stream = DeepFilterStream::create("model.tar.gz", 100.f);
+    CHECK(stream != nullptr);
+    stream->configure(kHop);
+    const size_t latency = stream->latencySamples() + kHop;
+
+    std::vector<float> output(corpus.samples);
+    uint64_t suspendedModelHops = 0;
+    for (size_t h = 0; h < corpus.speech.size(); ++h) {
+        float* block = output.data() + h * kHop;
+        if (h == 150) stream->setSuspended(true);
+        if (h == 300) stream->setSuspended(false);
+        const uint64_t before = stream->stats().modelHops;
+        if (h >= 400 && h < 500 && h % 2 == 0) {
+            stream->passThrough(block);
+        } else {
+            stream->process(block);
+        }
+        if (h >= 150 && h < 300) suspendedModelHops += stream->stats().modelHops - before;
+    }
+    // 挂起之后只有淡出的那一个 hop 跑了模型
+    CHECK_MSG(suspendedModelHops == 1, "model ran %llu hops while suspended",
+              (unsigned long long) suspendedModelHops);
+
+    float worstGainStep = 0.f;
+    size_t worstAt = 0;
+    for (size_t n = latency + 1; n < output.size(); ++n) {
+        float x0 = corpus.samples[n - 1 - latency];
+        float x1 = corpus.samples[n - latency];
+        if (std::fabs(x0) < 1e-3f || std::fabs(x1) < 1e-3f) continue;
+        float step = std::fabs(output[n] / x1 - output[n - 1] / x0);
+        if (step > worstGainStep) {
+            worstGainStep = step;
+            worstAt = n;
+        }
+    }
+    CHECK_MSG(worstGainStep < 4.f / kHop, "gain jumps by %.4f at sample %zu (hop %zu)", worstGainStep, worstAt,
+              worstAt / kHop);
+}
+
+// 替身模型每个 hop sleep frameCostNs，模型时间是按这个耗时算出的；门控本身的开销用线程 CPU 时间单独测
+RECORDER_BENCH(DeepFilterGate, cpuSavedOnSpeechWithPauses) {
+    Corpus corpus = speechWithPauses(8, 1.5, 3.0, kNoisy, 5);
+    const double seconds = static_cast<double>(corpus.samples.size()) / kSampleRate;
+    printf("  %.0f s corpus, 1.5 s speech / 3 s pause, fake model 200 us per hop\n", seconds);
+    printf("  %-8s %10s %10s %12s %14s\n", "gating", "model hops", "skipped", "model time", "gate us/hop");
+    for (bool gating : {false, true}) {
+        fake_device::resetAll();
+        fake_device::deepFilter().frameCostNs = 200000;
+        auto stream = DeepFilterStream::create("model.tar.gz", 100.f);
+        stream->configure(kHop);
+        stream->setGating(gating);
+        std::vector<float> output = runStream(*stream, corpus.samples);
+        recorder_test::keep(output);
+        DeepFilterStream::Stats stats = stream->stats();
+
+        // 门控判决的 CPU：只跑 update，不跑模型
+        DeepFilterGate gate;
+        const size_t hops = corpus.speech.size();
+        int64_t begin = recorder_test::threadCpuNs();
+        for (int pass = 0; pass < 10; ++pass) {
+            for (size_t h = 0; h < hops; ++h) {
+                auto decision = gate.update(corpus.samples.data() + h * kHop, kHop, 10.f, gating, true);
+                recorder_test::keep(decision);
+            }
+        }
+        double gateUs = (recorder_test::threadCpuNs() - begin) / 1e3 / static_cast<double>(hops * 10);
+
+        printf("  %-8s %10llu %9.1f%% %11.2fs %14.2f\n", gating ? "on" : "off",
+               (unsigned long long) stats.modelHops, 100.0 * (stats.hops - stats.modelHops) / stats.hops,
+               stats.modelNsTotal / 1e9, gateUs);
+    }
+}
@@ -0,0 +1,153 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include <df.h>
+
+#include <string>
+#include <vector>
+
+#include "DeepFilterModels.h"
+#include "FakeDevices.h"
+
+#include "TestHarness.h"
+
+namespace {
+
+constexpr int64_t kMs = 1000000;
+
+// 模型文件只用来计算哈希，内容不同就是不同的模型
+std::string modelFile(const char* name, int16_t content) {
+    std::string path = recorder_test::tempPath(name);
+    recorder_test::writePcm(path, std::vector<int16_t>(4096, content));
+    return path;
+}
+
+// 直接在调用线程上 df_create 再处理第一帧，也就是没有管理器时 start() 的代价
+int64_t coldFirstFrameNs(const std::string& path) {
+    std::vector<float> in(480, 0.f), out(480);
+    int64_t begin = recorder_test::nowNs();
+    DFState* state = df_create(path.c_str(), 100.f, "warn");
+    df_process_frame(state, in.data(), out.data());
+    int64_t elapsed = recorder_test::nowNs() - begin;
+    df_free(state);
+    return elapsed;
+}
+
+// 从管理器取出就绪的状态再处理第一帧
+int64_t cachedFirstFrameNs(DeepFilterModelManager& manager, const std::string& path) {
+    std::vector<float> in(480, 0.f), out(480);
+    int64_t begin = recorder_test::nowNs();
+    DFState* state = manager.acquire(path.c_str(), 100.f);
+    if (state == nullptr) return -1;
+    df_process_frame(state, in.data(), out.data());
+    int64_t elapsed = recorder_test::nowNs() - begin;
+    df_free(state);
+    return elapsed;
+}
+
+} // namespace
+
+// 模型还在加载时 acquire 立即返回空，不会等 df_create
+RECORDER_TEST(DeepFilterModels, acquireNeverBlocks) {
+    fake_device::resetAll();
+    fake_device::deepFilter().createDelayNs = 300 * kMs;
+    std::string path = modelFile("blocking.tar.gz", 1);
+    DeepFilterModelManager manager;
+
+    int64_t begin = recorder_test::nowNs();
+    DFState* early = manager.acquire(path.c_str(), 100.f);
+    int64_t elapsed = recorder_test::nowNs() - begin;
+    CHECK(early == nullptr);
+    CHECK_MSG(elapsed < 50 * kMs, "acquire took %.1f ms while loading", elapsed / 1e6);
+
+    CHECK(manager.waitReady(path.c_str(), 3000));
+    DFState* state = manager.acquire(path.c_str(), 100.f);
+    CHECK(state != nullptr);
+    df_free(state);
+
+    // 取走之后后台补上下一个
+    CHECK(manager.waitReady(path.c_str(), 3000));
+    CHECK(fake_device::deepFilter().created == 2);
+    CHECK(manager.acquire("/nonexistent/model.tar.gz", 100.f) == nullptr);
+}
+
+// 预热在后台完成：取出时已经跑过 kWarmupFrames 帧，冷启动的额外耗时不会落到处理线程上
+RECORDER_TEST(DeepFilterModels, warmupAndTiming) {
+    fake_device::resetAll();
+    fake_device::deepFilter().createDelayNs = 100 * kMs;
+    fake_device::deepFilter().coldFrameCostNs = 30 * kMs;
+    std::string path = modelFile("timing.tar.gz", 2);
+    DeepFilterModelManager manager;
+    manager.preload(path.c_str());
+    CHECK(manager.waitReady(path.c_str(), 3000));
+    CHECK(fake_device::deepFilter().framesProcessed == DeepFilterModelManager::kWarmupFrames);
+
+    int64_t cached = cachedFirstFrameNs(manager, path);
+    CHECK(cached >= 0);
+    CHECK_MSG(cached < 20 * kMs, "cached first frame %.1f ms", cached / 1e6);
+
+    DeepFilterModelManager::Timing timing{};
+    CHECK(manager.timing(path.c_str(), timing));
+    CHECK_MSG(timing.createMs >= 100.0 && timing.coldFrameMs >= 30.0, "create %.1f ms, cold frame %.1f ms",
+              timing.createMs, timing.coldFrameMs);
+    CHECK(timing.coldFirstFrameMs >= timing.createMs + timing.coldFrameMs - 1e-9);
+    CHECK(timing.warmFrameMs < timing.coldFrameMs);
+    CHECK_MSG(timing.cachedFirstFrameMs < timing.coldFirstFrameMs / 10, "cached %.2f ms vs cold %.1f ms",
+              timing.cachedFirstFrameMs, timing.coldFirstFrameMs);
+}
+
+// 缓存按文件内容：不同路径的同一模型共用就绪的状态，文件被替换后重新加载
+RECORDER_TEST(DeepFilterModels, cacheKeyedByContent) {
+    fake_device::resetAll();
+    std::string first = modelFile("same_a.tar.gz", 3);
+    std::string second = modelFile("same_b.tar.gz", 3);
+    DeepFilterModelManager manager;
+    manager.preload(first.c_str());
+    CHECK(manager.waitReady(first.c_str(), 3000));
+    CHECK(manager.waitReady(second.c_str(), 3000));
+    CHECK(fake_device::deepFilter().created == 1);
+
+    DFState* state = manager.acquire(second.c_str(), 100.f);
+    CHECK(state != nullptr);
+    df_free(state);
+    CHECK(manager.waitReady(first.c_str(), 3000));
+    CHECK(fake_device::deepFilter().created == 2);
+
+    // 换成不同的内容 (大小也变了)，旧的就绪状态不能再给出去
+    recorder_test::writePcm(second, std::vector<int16_t>(8192, 4));
+    state = manager.acquire(second.c_str(), 100.f);
+    CHECK(state == nullptr);
+    CHECK(manager.waitReady(second.c_str(), 3000));
+    CHECK(fake_device::deepFilter().created == 3);
+    state = manager.acquire(second.c_str(), 100.f);
+    CHECK(state != nullptr);
+    df_free(state);
+}
+
+// 替身 df_create 和第一帧按设定的耗时 sleep，数字反映的是管理器把这些耗时移出 start() 的效果
+RECORDER_BENCH(DeepFilterModels, timeToFirstFrame) {
+    fake_device::resetAll();
+    fake_device::deepFilter().createDelayNs = 250 * kMs;
+    fake_device::deepFilter().coldFrameCostNs = 40 * kMs;
+    fake_device::deepFilter().frameCostNs = kMs;
+    std::string path = modelFile("bench.tar.gz", 5);
+
+    printf("  fake df_create 250 ms, cold first frame +40 ms, 1 ms per frame\n");
+    printf("  %-24s %12s\n", "path", "first frame");
+    printf("  %-24s %10.1fms\n", "cold (df_create inline)", coldFirstFrameNs(path) / 1e6);
+
+    DeepFilterModelManager manager;
+    manager.preload(path.c_str());
+    manager.waitReady(path.c_str(), 5000);
+    for (int i = 0; i < 3; ++i) {
+        int64_t cached = cachedFirstFrameNs(manager, path);
+        printf("  %-24s %10.2fms\n", "cached (acquire)", cached / 1e6);
+        manager.waitReady(path.c_str(), 5000);
+    }
+    DeepFilterModelManager::Timing timing{};
+    if (manager.timing(path.c_str(), timing)) {
+        printf("  manager: hash %.2f ms, df_create %.1f ms, frame %.2f ms cold / %.2f ms warm\n",
+               timing.hashMs, timing.createMs, timing.coldFrameMs, timing.warmFrameMs);
+    }
+}
@@ -0,0 +1,123 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DeepFilterPipeline.h"
+#include "FakeDevices.h"
+
+#include "TestHarness.h"
+
+namespace {
+
+constexpr size_t kFrame = 480;
+const WavFormat kFormat{DeepFilterStream::kSampleRate, 1, 16};
+
+// 按略快于实时的节奏送帧，队列 (约 17 帧) 不会满
+void pushFrames(DeepFilterPipeline& pipeline, int frames) {
+    std::vector<int16_t> frame(kFrame);
+    for (int f = 0; f < frames; ++f) {
+        for (size_t i = 0; i < kFrame; ++i) {
+            frame[i] = static_cast<int16_t>(4000.0 * std::sin(2.0 * M_PI * 440.0 * (f * kFrame + i) / 48000.0));
+        }
+        pipeline.push(frame.data());
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+}
+
+bool startPipeline(DeepFilterPipeline& pipeline, const char* name) {
+    return pipeline.start(DeepFilterStream::create("model.tar.gz", 100.f), recorder_test::tempPath(name).c_str(),
+                          kFormat, kFrame, 4);
+}
+
+} // namespace
+
+// 停止期间设置的参数在 start() 时交给新的 stream，并且在之后的每次 start() 都保留
+RECORDER_TEST(DeepFilterPipeline, settingsSurviveRestart) {
+    fake_device::resetAll();
+    DeepFilterPipeline pipeline;
+    pipeline.setAttenLimDb(12.f);
+    pipeline.setPostFilterBeta(0.02f);
+    pipeline.setSuspended(true);
+
+    CHECK(startPipeline(pipeline, "settings_a.pcm"));
+    pushFrames(pipeline, 30);
+    pipeline.stop();
+    auto& df = fake_device::deepFilter();
+    CHECK_MSG(df.attenLimDb.load() == 12.f, "atten lim %.1f dB", df.attenLimDb.load());
+    CHECK_MSG(df.postFilterBeta.load() == 0.02f, "post filter beta %.3f", df.postFilterBeta.load());
+    // 新的 stream 从模型输出开始，挂起时只跑淡出的那一个 hop
+    CHECK_MSG(df.framesProcessed.load() == 1, "model ran %llu hops while suspended",
+              (unsigned long long) df.framesProcessed.load());
+
+    // 第二个 stream 从替身的默认值开始，参数和挂起状态都来自 pipeline
+    fake_device::resetAll();
+    CHECK(startPipeline(pipeline, "settings_b.pcm"));
+    pushFrames(pipeline, 30);
+    CHECK(df.attenLimDb.load() == 12.f && df.postFilterBeta.load() == 0.02f);
+    CHECK(df.framesProcessed.load() == 1);
+
+    // 运行中恢复，DF 线程在下一帧之前应用
+    pipeline.setSuspended(false);
+    pipeline.setAttenLimDb(6.f);
+    pushFrames(pipeline, 30);
+    pipeline.stop();
+    CHECK(df.attenLimDb.load() == 6.f);
+    CHECK_MSG(df.framesProcessed.load() > 0, "model did not resume");
+}
+
+// 用户的挂起和 QualityGovernor 的旁路互不覆盖
+RECORDER_TEST(DeepFilterPipeline, governorDoesNotUndoUserSuspend) {
+    fake_device::resetAll();
+    auto& df = fake_device::deepFilter();
+    DeepFilterPipeline pipeline;
+    CHECK(startPipeline(pipeline, "governor.pcm"));
+    pipeline.setSuspended(true);
+    pushFrames(pipeline, 5);
+    // 只有淡出的一个 hop
+    const uint64_t fadeOut = df.framesProcessed.load();
+    CHECK(fadeOut == 1);
+    pipeline.setGovernorOff(true);
+    pipeline.setGovernorOff(false);
+    pushFrames(pipeline, 20);
+    CHECK_MSG(df.framesProcessed.load() == fadeOut, "governor step-up resumed a user-suspended DF");
+
+    pipeline.setGovernorOff(true);
+    pipeline.setSuspended(false);
+    pushFrames(pipeline, 20);
+    CHECK_MSG(df.framesProcessed.load() == fadeOut, "user resume overrode the governor");
+
+    pipeline.setGovernorOff(false);
+    pushFrames(pipeline, 20);
+    pipeline.stop();
+    CHECK(df.framesProcessed.load() > fadeOut);
+}
+
+// 参数的 setter 不接触 stream，和 start() / stop() 并发调用是安全的
+RECORDER_TEST(DeepFilterPipeline, settersRaceStartStop) {
+    fake_device::resetAll();
+    DeepFilterPipeline pipeline;
+    std::atomic<bool> done{false};
+    std::thread setter([&] {
+        for (int i = 0; !done.load(); ++i) {
+            pipeline.setAttenLimDb(static_cast<float>(i % 40));
+            pipeline.setPostFilterBeta(0.01f * static_cast<float>(i % 3));
+            pipeline.setGating(i % 2 == 0);
+            pipeline.setSuspended(i % 5 == 0);
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    });
+    for (int round = 0; round < 20; ++round) {
+        CHECK(startPipeline(pipeline, "race.pcm"));
+        pushFrames(pipeline, 3);
+        pipeline.stop();
+    }
+    done = true;
+    setter.join();
+    CHECK(!pipeline.isRunning());
+}
@@ -0,0 +1,179 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include <df.h>
+
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "DeepFilterSpectral.h"
+#include "FakeDevices.h"
+
+#include "TestHarness.h"
+
+namespace {
+
+constexpr size_t kHop = 480;
+constexpr size_t kHops = 200;
+
+// 白噪声加两个正弦，覆盖所有 ERB 频带
+std::vector<float> testSignal(uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.f, 0.05f);
+    std::vector<float> x(kHop * kHops);
+    for (size_t i = 0; i < x.size(); ++i) {
+        float t = static_cast<float>(i) / 48000.f;
+        x[i] = 0.3f * std::sin(2.f * static_cast<float>(M_PI) * 440.f * t) +
+               0.1f * std::sin(2.f * static_cast<float>(M_PI) * 9000.f * t) + noise(rng);
+    }
+    return x;
+}
+
+struct Comparison {
+    float maxAbsError = 0.f;
+    double snrDb = INFINITY;
+};
+
+// 同一输入逐 hop 分别送给 DeepFilterSpectral (df_process_frame_raw) 和另一个 DFState 的 df_process_frame。
+// snrForHop 给出每个 hop 替身模型报告的 SNR，超过 30 dB 时 df_process_frame_raw 返回 NULL 增益
+template <typename SnrFn>
+Comparison compareWithProcessFrame(const std::vector<float>& input, SnrFn snrForHop,
+                                   DeepFilterSpectral::Stats* stats = nullptr) {
+    DFState* engineState = df_create("model.tar.gz", 100.f, "warn");
+    DFState* referenceState = df_create("model.tar.gz", 100.f, "warn");
+    Comparison result;
+    {
+        DeepFilterSpectral engine(engineState, DeepFilterSpectralConfig());
+        CHECK(engine.delaySamples() == kHop);
+        std::vector<float> in(kHop), out(kHop), reference(kHop);
+        double energy = 0.0, error = 0.0;
+        for (size_t h = 0; h < kHops; ++h) {
+            fake_device::deepFilter().snrDb = snrForHop(h);
+            std::copy(input.begin() + static_cast<std::ptrdiff_t>(h * kHop),
+                      input.begin() + static_cast<std::ptrdiff_t>((h + 1) * kHop), in.begin());
+            engine.process(in.data(), out.data());
+            df_process_frame(referenceState, in.data(), reference.data());
+            for (size_t i = 0; i < kHop; ++i) {
+                float diff = out[i] - reference[i];
+                result.maxAbsError = std::max(result.maxAbsError, std::fabs(diff));
+                energy += static_cast<double>(reference[i]) * reference[i];
+                error += static_cast<double>(diff) * diff;
+            }
+        }
+        if (error > 0) result.snrDb = 10.0 * std::log10(energy / error);
+        if (stats != nullptr) *stats = engine.stats();
+    }
+    df_free(engineState);
+    df_free(referenceState);
+    return result;
+}
+
+} // namespace
+
+RECORDER_TEST(DeepFilterSpectral, erbBandWidths) {
+    std::vector<size_t> widths = DeepFilterSpectral::erbBandWidths(48000, 960, 32, 2);
+    CHECK(widths.size() == 32);
+    CHECK(std::accumulate(widths.begin(), widths.end(), size_t(0)) == 481);
+    for (size_t w : widths) CHECK(w >= 2);
+    // 频带随频率变宽
+    CHECK(widths.front() <= widths.back());
+}
+
+// 替身模型给出恒定的 ERB 增益，df_process_frame 在时域输出延迟一个 hop 的 gain * 输入；
+// 本地 STFT (Vorbis 窗、重叠相加) 加上 ERB 增益展开应当得到同样的结果
+RECORDER_TEST(DeepFilterSpectral, gainsMatchProcessFrame) {
+    fake_device::resetAll();
+    DeepFilterSpectral::Stats stats{};
+    Comparison c = compareWithProcessFrame(testSignal(1), [](size_t) { return 10.f; }, &stats);
+    CHECK_MSG(c.maxAbsError < 1e-4f && c.snrDb > 80.0, "max |error| %.2e, SNR %.1f dB", c.maxAbsError, c.snrDb);
+    CHECK(stats.frames == kHops && stats.bypassFrames == 0 && stats.dfFrames == 0);
+}
+
+// 替身的 DF 系数只在当前帧上为 gain，低频的复数卷积必须取到正确的历史帧才能和 ERB 增益的结果一致
+RECORDER_TEST(DeepFilterSpectral, deepFilterMatchesProcessFrame) {
+    fake_device::resetAll();
+    fake_device::deepFilter().dfCoefs = true;
+    DeepFilterSpectral::Stats stats{};
+    Comparison c = compareWithProcessFrame(testSignal(6), [](size_t) { return 10.f; }, &stats);
+    CHECK_MSG(c.maxAbsError < 1e-4f && c.snrDb > 80.0, "max |error| %.2e, SNR %.1f dB", c.maxAbsError, c.snrDb);
+    CHECK(stats.frames == kHops && stats.dfFrames == kHops);
+}
+
+// 模型返回 NULL 增益时跳过逆 FFT，直接用 w² 加窗的输入重叠相加，结果应当和完整合成一样
+RECORDER_TEST(DeepFilterSpectral, nullGainsSkipSynthesis) {
+    fake_device::resetAll();
+    DeepFilterSpectral::Stats stats{};
+    Comparison c = compareWithProcessFrame(testSignal(2), [](size_t) { return 40.f; }, &stats);
+    CHECK_MSG(c.maxAbsError < 1e-4f && c.snrDb > 80.0, "max |error| %.2e, SNR %.1f dB", c.maxAbsError, c.snrDb);
+    CHECK(stats.frames == kHops && stats.bypassFrames == kHops);
+}
+
+// 两种路径逐段交替，重叠相加的状态在切换时保持连续
+RECORDER_TEST(DeepFilterSpectral, switchingPathsMatchProcessFrame) {
+    fake_device::resetAll();
+    fake_device::deepFilter().gain = 0.8f;
+    DeepFilterSpectral::Stats stats{};
+    Comparison c = compareWithProcessFrame(testSignal(3), [](size_t h) { return (h / 7) % 2 ? 40.f : 10.f; },
+                                           &stats);
+    CHECK_MSG(c.maxAbsError < 1e-4f && c.snrDb > 80.0, "max |error| %.2e, SNR %.1f dB", c.maxAbsError, c.snrDb);
+    CHECK(stats.bypassFrames > 0 && stats.bypassFrames < kHops);
+}
+
+// 带前瞻的模型：输出整体再滞后 convLookahead 个 hop，仍是 gain * 输入
+RECORDER_TEST(DeepFilterSpectral, convLookaheadDelaysOutput) {
+    fake_device::resetAll();
+    DeepFilterSpectralConfig config;
+    config.convLookahead = 2;
+    config.dfLookahead = 2;
+    DFState* state = df_create("model.tar.gz", 100.f, "warn");
+    std::vector<float> input = testSignal(4);
+    std::vector<float> output(input.size());
+    {
+        DeepFilterSpectral engine(state, config);
+        const size_t delay = engine.delaySamples();
+        CHECK(delay == 3 * kHop);
+        CHECK(engine.historyFrames() >= config.dfOrder);
+        for (size_t h = 0; h < kHops; ++h) {
+            engine.process(input.data() + h * kHop, output.data() + h * kHop);
+        }
+        const float gain = fake_device::deepFilter().gain;
+        float maxAbsError = 0.f;
+        for (size_t i = delay; i < output.size(); ++i) {
+            maxAbsError = std::max(maxAbsError, std::fabs(output[i] - gain * input[i - delay]));
+        }
+        CHECK_MSG(maxAbsError < 1e-4f, "max |error| %.2e", maxAbsError);
+    }
+    df_free(state);
+}
+
+// 每个 hop 的分析/合成开销，替身模型本身不耗时；NULL 增益时省掉的是逆 FFT 和合成窗
+RECORDER_BENCH(DeepFilterSpectral, cpuPerHop) {
+    std::vector<float> input = testSignal(5);
+    std::vector<float> output(kHop);
+    constexpr int kPasses = 20;
+    printf("  %-28s %10s\n", "path", "us/hop");
+    for (int path = 0; path < 3; ++path) {
+        const char* names[] = {"ERB gains + DF coefs", "ERB gains (full synthesis)", "NULL gains (w² overlap-add)"};
+        fake_device::resetAll();
+        fake_device::deepFilter().dfCoefs = path == 0;
+        fake_device::deepFilter().snrDb = path == 2 ? 40.f : 10.f;
+        DFState* state = df_create("model.tar.gz", 100.f, "warn");
+        int64_t elapsed;
+        {
+            DeepFilterSpectral engine(state, DeepFilterSpectralConfig());
+            int64_t begin = recorder_test::threadCpuNs();
+            for (int pass = 0; pass < kPasses; ++pass) {
+                for (size_t h = 0; h < kHops; ++h) {
+                    engine.process(input.data() + h * kHop, output.data());
+                    recorder_test::keep(output);
+                }
+            }
+            elapsed = recorder_test::threadCpuNs() - begin;
+        }
+        df_free(state);
+        printf("  %-28s %10.2f\n", names[path], elapsed / 1e3 / (kPasses * kHops));
+    }
+}
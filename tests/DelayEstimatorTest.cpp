@@ -0,0 +1,170 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "DelayEstimator.h"
+
+#include "TestHarness.h"
+
+/**
+ * 合成回声: 采集 = echoGain * 延迟 delayMs 的参考 + 白噪声。
+ * 数据按 4 倍实时送入 (每 62.5 ms 送 250 ms)，后台线程照常每 kIntervalMs 估计一次，
+ * 收敛时间按已经送入的音频时长计算
+ */
+namespace {
+
+constexpr int kSampleRate = 48000;
+constexpr size_t kFrame = 480;
+constexpr int kFramesPerBatch = 25;
+constexpr int kBatchSleepMs = 62;
+
+class EchoPath {
+public:
+    EchoPath(int delayMs, float echoGain, float snrDb, bool bursts, uint32_t seed)
+        : delay(static_cast<size_t>(delayMs) * kSampleRate / 1000),
+          echoGain(echoGain),
+          noiseLevel(echoGain * kRenderLevel * std::pow(10.f, -snrDb / 20.f)),
+          bursts(bursts),
+          rng(seed),
+          history(delay + kFrame, 0.f) {}
+
+    // 生成下一个 10 ms 帧的参考和采集
+    void next(std::vector<int16_t>& render, std::vector<int16_t>& capture) {
+        std::normal_distribution<float> normal(0.f, 1.f);
+        // 语音式的断续: 300 ms 有声、200 ms 静音
+        bool active = !bursts || (position % (kSampleRate / 2)) < static_cast<size_t>(kSampleRate * 3 / 10);
+        std::copy(history.begin() + kFrame, history.end(), history.begin());
+        for (size_t i = 0; i < kFrame; ++i, ++position) {
+            float r = active ? kRenderLevel * normal(rng) : 0.f;
+            history[delay + i] = r;
+            render[i] = clamp(r);
+            capture[i] = clamp(echoGain * history[i] + noiseLevel * normal(rng));
+        }
+    }
+
+private:
+    static constexpr float kRenderLevel = 4000.f;
+
+    static int16_t clamp(float v) {
+        return static_cast<int16_t>(std::max(-32768.f, std::min(32767.f, v)));
+    }
+
+    size_t delay;
+    float echoGain;
+    float noiseLevel;
+    bool bursts;
+    std::mt19937 rng;
+    std::vector<float> history;     // delay + kFrame 个参考样本，history[i] 是当前帧第 i 个采集样本对应的参考
+    size_t position = 0;
+};
+
+struct Convergence {
+    int delayMs;        // 最后发布的估计
+    double audioMs;     // 第一次在 ±1 ms 以内时已经送入的音频，没有收敛为 -1
+};
+
+// 最多送入 maxAudioMs，收敛之后再送 500 ms 确认估计稳定
+Convergence converge(int delayMs, float echoGain, float snrDb, bool bursts, int maxAudioMs) {
+    DelayEstimator estimator(kSampleRate);
+    estimator.start(nullptr);
+    EchoPath echo(delayMs, echoGain, snrDb, bursts, static_cast<uint32_t>(delayMs) + 1);
+    std::vector<int16_t> render(kFrame), capture(kFrame);
+
+    Convergence result{-1, -1.0};
+    int confirmMs = 0;
+    for (int audioMs = 0; audioMs < maxAudioMs && confirmMs < 500;) {
+        for (int i = 0; i < kFramesPerBatch; ++i, audioMs += 10) {
+            echo.next(render, capture);
+            estimator.pushRender(render.data(), kFrame, 1);
+            estimator.pushCapture(capture.data(), kFrame, 1);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(kBatchSleepMs));
+        int estimate = estimator.delayMs();
+        if (result.audioMs < 0 && estimate >= 0 && std::abs(estimate - delayMs) <= 1) {
+            result.audioMs = audioMs;
+        }
+        if (result.audioMs >= 0) confirmMs += kFramesPerBatch * 10;
+    }
+    result.delayMs = estimator.delayMs();
+    estimator.stop();
+    return result;
+}
+
+} // namespace
+
+RECORDER_TEST(DelayEstimator, findsSyntheticEchoDelay) {
+    for (int delayMs : {0, 37, 120, 230}) {
+        Convergence c = converge(delayMs, 0.5f, 20.f, false, 4000);
+        CHECK_MSG(c.audioMs >= 0, "delay %d ms: no estimate within 1 ms (last %d)", delayMs, c.delayMs);
+        CHECK_MSG(std::abs(c.delayMs - delayMs) <= 1, "delay %d ms: drifted to %d", delayMs, c.delayMs);
+    }
+}
+
+// 只有时间戳时直接发布它作为初值，之后由 GCC-PHAT 修正
+RECORDER_TEST(DelayEstimator, timestampSeedsUntilCorrelationConverges) {
+    DelayEstimator estimator(kSampleRate);
+    estimator.start(nullptr);
+    CHECK(estimator.delayMs() == -1);
+    estimator.pushTimestampDelay(kSampleRate);      // 超出 kMaxDelayMs，忽略
+    CHECK(estimator.delayMs() == -1);
+    estimator.pushTimestampDelay(80);
+    CHECK(estimator.delayMs() == 80);
+
+    EchoPath echo(100, 0.5f, 20.f, false, 3);
+    std::vector<int16_t> render(kFrame), capture(kFrame);
+    int64_t deadline = recorder_test::nowNs() + 5000000000LL;
+    while (std::abs(estimator.delayMs() - 100) > 2 && recorder_test::nowNs() < deadline) {
+        for (int i = 0; i < kFramesPerBatch; ++i) {
+            echo.next(render, capture);
+            estimator.pushRender(render.data(), kFrame, 1);
+            estimator.pushCapture(capture.data(), kFrame, 1);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(kBatchSleepMs));
+    }
+    CHECK_MSG(std::abs(estimator.delayMs() - 100) <= 2, "still at %d ms", estimator.delayMs());
+    estimator.stop();
+}
+
+// 没有参考信号 (对端静音) 时不能凭噪声给出估计
+RECORDER_TEST(DelayEstimator, silentRenderPublishesNothing) {
+    DelayEstimator estimator(kSampleRate);
+    estimator.start(nullptr);
+    std::mt19937 rng(5);
+    std::normal_distribution<float> normal(0.f, 300.f);
+    std::vector<int16_t> render(kFrame, 0), capture(kFrame);
+    for (int batch = 0; batch < 8; ++batch) {
+        for (int i = 0; i < kFramesPerBatch; ++i) {
+            for (auto& s : capture) s = static_cast<int16_t>(normal(rng));
+            estimator.pushRender(render.data(), kFrame, 1);
+            estimator.pushCapture(capture.data(), kFrame, 1);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(kBatchSleepMs));
+    }
+    CHECK(estimator.delayMs() == -1);
+    estimator.stop();
+}
+
+RECORDER_BENCH(DelayEstimator, accuracyAndConvergence) {
+    printf("  %-8s %-8s %-7s %10s %14s\n", "delay", "signal", "SNR", "estimate", "converged");
+    for (bool bursts : {false, true}) {
+        for (float snrDb : {20.f, 0.f}) {
+            for (int delayMs : {10, 120, 240}) {
+                Convergence c = converge(delayMs, 0.3f, snrDb, bursts, 6000);
+                char converged[32];
+                if (c.audioMs >= 0) {
+                    snprintf(converged, sizeof(converged), "%.0f ms audio", c.audioMs);
+                } else {
+                    snprintf(converged, sizeof(converged), "no");
+                }
+                printf("  %4d ms  %-8s %4.0f dB %7d ms %14s\n", delayMs, bursts ? "bursts" : "noise", snrDb,
+                       c.delayMs, converged);
+            }
+        }
+    }
+}
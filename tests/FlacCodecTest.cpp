@@ -0,0 +1,227 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "FlacCodec.h"
+
+#include "TestHarness.h"
+
+namespace {
+
+constexpr uint32_t kSampleRate = 48000;
+// 不是 kBlockSize 的倍数，最后一帧是短帧
+constexpr size_t kFrames = FlacEncoder::kBlockSize * 3 + 1234;
+
+// 逐段送入编码器，每段长度不同，跨越帧边界；返回带文件头的完整码流
+std::vector<uint8_t> encode(const WavFormat& format, const std::vector<int16_t>& pcm) {
+    FlacEncoder encoder(format);
+    std::vector<uint8_t> body;
+    const size_t frames = pcm.size() / format.channels;
+    const size_t steps[] = {480, 1, 4095, 192, 7000};
+    size_t offset = 0;
+    for (size_t i = 0; offset < frames; ++i) {
+        size_t n = std::min(steps[i % 5], frames - offset);
+        encoder.push(pcm.data() + offset * format.channels, n, body);
+        offset += n;
+    }
+    encoder.finish(body);
+    CHECK(encoder.totalFrames() == frames);
+    CHECK_MSG(encoder.verifyErrors() == 0, "%llu verify errors", (unsigned long long) encoder.verifyErrors());
+
+    std::vector<uint8_t> stream(FlacEncoder::kStreamHeaderBytes);
+    encoder.streamHeader(stream.data());
+    stream.insert(stream.end(), body.begin(), body.end());
+    return stream;
+}
+
+// 按 chunk 字节分段解码，检查格式和逐采样一致
+void expectRoundTrip(const WavFormat& format, const std::vector<int16_t>& pcm, size_t chunk) {
+    std::vector<uint8_t> stream = encode(format, pcm);
+    FlacDecoder decoder;
+    std::vector<int16_t> decoded;
+    for (size_t offset = 0; offset < stream.size(); offset += chunk) {
+        size_t n = std::min(chunk, stream.size() - offset);
+        CHECK_MSG(decoder.decode(stream.data() + offset, n, decoded), "decode failed at byte %zu", offset);
+    }
+    CHECK(decoder.hasFormat());
+    CHECK(decoder.streamFormat().sampleRate == format.sampleRate);
+    CHECK(decoder.streamFormat().channels == format.channels);
+    CHECK(decoder.streamFormat().bitsPerSample == 16);
+    CHECK_MSG(decoded.size() == pcm.size(), "decoded %zu samples, expected %zu", decoded.size(), pcm.size());
+    for (size_t i = 0; i < pcm.size(); ++i) {
+        CHECK_MSG(decoded[i] == pcm[i], "sample %zu: got %d, expected %d", i, decoded[i], pcm[i]);
+    }
+}
+
+// 白噪声叠加正弦，各声道内容不同
+std::vector<int16_t> noisySine(uint16_t channels, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.f, 800.f);
+    std::vector<int16_t> pcm(kFrames * channels);
+    for (size_t i = 0; i < kFrames; ++i) {
+        for (uint16_t c = 0; c < channels; ++c) {
+            float v = 12000.f * std::sin(2.f * static_cast<float>(M_PI) * (440.f + 110.f * c) * i / kSampleRate) +
+                      noise(rng);
+            pcm[i * channels + c] = static_cast<int16_t>(std::max(-32768.f, std::min(32767.f, v)));
+        }
+    }
+    return pcm;
+}
+
+// ±满幅交替，残差和 Rice 参数都在最大值附近
+std::vector<int16_t> fullScaleAlternating(uint16_t channels) {
+    std::vector<int16_t> pcm(kFrames * channels);
+    for (size_t i = 0; i < kFrames; ++i) {
+        for (uint16_t c = 0; c < channels; ++c) {
+            pcm[i * channels + c] = ((i + c) & 1) ? int16_t(-32768) : int16_t(32767);
+        }
+    }
+    return pcm;
+}
+
+} // namespace
+
+RECORDER_TEST(FlacCodec, monoNoisySine) {
+    expectRoundTrip({kSampleRate, 1, 16}, noisySine(1, 1), 4096);
+}
+
+RECORDER_TEST(FlacCodec, stereoNoisySine) {
+    expectRoundTrip({kSampleRate, 2, 16}, noisySine(2, 2), 4096);
+}
+
+RECORDER_TEST(FlacCodec, stereoCorrelated) {
+    // 左右声道相同或只差一点，会选中 left/right/mid-side 声道编码
+    std::vector<int16_t> pcm = noisySine(2, 3);
+    for (size_t i = 0; i < kFrames; ++i) {
+        pcm[i * 2 + 1] = static_cast<int16_t>(pcm[i * 2] / 2 + (i < kFrames / 2 ? 0 : pcm[i * 2 + 1] / 64));
+    }
+    expectRoundTrip({kSampleRate, 2, 16}, pcm, 4096);
+}
+
+RECORDER_TEST(FlacCodec, silenceIsConstant) {
+    for (uint16_t channels = 1; channels <= 2; ++channels) {
+        WavFormat format{kSampleRate, channels, 16};
+        std::vector<int16_t> zeros(kFrames * channels, 0);
+        expectRoundTrip(format, zeros, 4096);
+
+        // 静音帧编码为 CONSTANT 子帧，每帧只有十几个字节
+        std::vector<uint8_t> stream = encode(format, zeros);
+        size_t blocks = (kFrames + FlacEncoder::kBlockSize - 1) / FlacEncoder::kBlockSize;
+        CHECK_MSG(stream.size() < FlacEncoder::kStreamHeaderBytes + blocks * 32,
+                  "%zu bytes for %zu silent blocks", stream.size(), blocks);
+
+        // 非零常数同样是 CONSTANT
+        std::vector<int16_t> dc(kFrames * channels, -1234);
+        expectRoundTrip(format, dc, 4096);
+    }
+}
+
+RECORDER_TEST(FlacCodec, nullPushIsSilence) {
+    WavFormat format{kSampleRate, 2, 16};
+    std::vector<int16_t> tone = noisySine(2, 4);
+    FlacEncoder encoder(format);
+    std::vector<uint8_t> body;
+    encoder.push(tone.data(), 1000, body);
+    encoder.push(nullptr, 5000, body);
+    encoder.push(tone.data() + 1000 * 2, 777, body);
+    encoder.finish(body);
+    CHECK(encoder.totalFrames() == 6777);
+    CHECK(encoder.verifyErrors() == 0);
+
+    std::vector<uint8_t> stream(FlacEncoder::kStreamHeaderBytes);
+    encoder.streamHeader(stream.data());
+    stream.insert(stream.end(), body.begin(), body.end());
+    FlacDecoder decoder;
+    std::vector<int16_t> decoded;
+    CHECK(decoder.decode(stream.data(), stream.size(), decoded));
+    CHECK(decoded.size() == 6777 * 2);
+    for (size_t i = 0; i < decoded.size(); ++i) {
+        int16_t expected = i < 2000 ? tone[i] : i < 12000 ? int16_t(0) : tone[i - 10000];
+        CHECK_MSG(decoded[i] == expected, "sample %zu: got %d, expected %d", i, decoded[i], expected);
+    }
+}
+
+RECORDER_TEST(FlacCodec, fullScaleAlternating) {
+    expectRoundTrip({kSampleRate, 1, 16}, fullScaleAlternating(1), 4096);
+    expectRoundTrip({kSampleRate, 2, 16}, fullScaleAlternating(2), 4096);
+}
+
+RECORDER_TEST(FlacCodec, shortStreams) {
+    // 比一帧还短，只有 finish 时的短帧；包括只有 1 个采样
+    for (size_t frames : {size_t(1), size_t(15), size_t(480)}) {
+        std::vector<int16_t> pcm = noisySine(2, 5);
+        pcm.resize(frames * 2);
+        expectRoundTrip({kSampleRate, 2, 16}, pcm, 4096);
+    }
+}
+
+RECORDER_TEST(FlacCodec, byteByByteDecode) {
+    // 每次只送 1 / 7 字节，帧头、子帧和 CRC 都会被切开；每次送入都会从帧头重新尝试，所以输入取短一些
+    std::vector<int16_t> pcm = noisySine(2, 6);
+    pcm.resize(1000 * 2);
+    expectRoundTrip({kSampleRate, 2, 16}, pcm, 1);
+    pcm = noisySine(2, 7);
+    pcm.resize((FlacEncoder::kBlockSize + 100) * 2);
+    expectRoundTrip({kSampleRate, 2, 16}, pcm, 7);
+}
+
+RECORDER_BENCH(FlacCodec, ratioAndCpuPerFrame) {
+    using namespace recorder_test;
+    constexpr size_t kFrame = kSampleRate / 100;
+    constexpr size_t kSeconds = 20;
+    struct Input {
+        const char* name;
+        uint16_t channels;
+        std::vector<int16_t> pcm;
+    };
+    std::vector<Input> inputs;
+    for (uint16_t channels = 1; channels <= 2; ++channels) {
+        std::vector<int16_t> tone;
+        while (tone.size() < kSeconds * kSampleRate * channels) {
+            std::vector<int16_t> block = noisySine(channels, static_cast<uint32_t>(tone.size()));
+            tone.insert(tone.end(), block.begin(), block.end());
+        }
+        tone.resize(kSeconds * kSampleRate * channels);
+        inputs.push_back({channels == 1 ? "mono sine+noise" : "stereo sine+noise", channels, tone});
+        inputs.push_back({channels == 1 ? "mono silence" : "stereo silence", channels,
+                          std::vector<int16_t>(kSeconds * kSampleRate * channels, 0)});
+    }
+
+    std::printf("%-20s %10s %14s %14s\n", "input", "ratio", "encode us/10ms", "decode us/10ms");
+    for (const Input& input : inputs) {
+        WavFormat format{kSampleRate, input.channels, 16};
+        FlacEncoder encoder(format);
+        std::vector<uint8_t> body;
+        body.reserve(input.pcm.size() * 2);
+        const size_t frames = input.pcm.size() / input.channels;
+        int64_t begin = threadCpuNs();
+        for (size_t offset = 0; offset < frames; offset += kFrame) {
+            encoder.push(input.pcm.data() + offset * input.channels, kFrame, body);
+        }
+        encoder.finish(body);
+        int64_t encodeNs = threadCpuNs() - begin;
+
+        std::vector<uint8_t> stream(FlacEncoder::kStreamHeaderBytes);
+        encoder.streamHeader(stream.data());
+        stream.insert(stream.end(), body.begin(), body.end());
+        FlacDecoder decoder;
+        std::vector<int16_t> decoded;
+        decoded.reserve(input.pcm.size());
+        begin = threadCpuNs();
+        decoder.decode(stream.data(), stream.size(), decoded);
+        int64_t decodeNs = threadCpuNs() - begin;
+        keep(decoded);
+
+        double blocks = static_cast<double>(frames / kFrame);
+        std::printf("%-20s %9.1f%% %14.1f %14.1f%s\n", input.name,
+                    100.0 * static_cast<double>(stream.size()) / static_cast<double>(input.pcm.size() * 2),
+                    encodeNs / 1e3 / blocks, decodeNs / 1e3 / blocks,
+                    decoded == input.pcm ? "" : "  MISMATCH");
+    }
+    std::printf("(encoder cost includes the built-in decode-verify of every frame)\n");
+}
@@ -0,0 +1,187 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FrameSignal.h"
+#include "SpscFrameRing.h"
+#include "lwrb.h"
+
+#include "TestHarness.h"
+
+namespace {
+
+constexpr size_t kFrame = 480;
+constexpr int kWaitMs = 1000;
+
+} // namespace
+
+// 每次只发布一帧并等消费者取走；丢失一次唤醒就会等满 kWaitMs
+RECORDER_TEST(FrameSignal, noLostWakeups) {
+    constexpr int kRounds = 2000;
+    SpscFrameRing<int16_t, 1, 8192> ring;
+    FrameSignal signal;
+    std::atomic<int> consumed{0};
+    int timeouts = 0;
+
+    std::thread consumer([&] {
+        std::vector<int16_t> frame(kFrame);
+        while (consumed.load() < kRounds) {
+            bool ready = signal.wait([&] { return ring.availableFrames() >= kFrame; }, kWaitMs);
+            if (!ready) {
+                ++timeouts;
+                continue;
+            }
+            ring.read(frame.data(), kFrame);
+            consumed.fetch_add(1);
+        }
+    });
+
+    std::vector<int16_t> frame(kFrame, 1);
+    int64_t begin = recorder_test::nowNs();
+    for (int i = 0; i < kRounds; ++i) {
+        ring.write(frame.data(), kFrame);
+        signal.publish(ring.capacity() - ring.freeFrames(), kFrame);
+        while (consumed.load() <= i) std::this_thread::yield();
+    }
+    consumer.join();
+    int64_t elapsed = recorder_test::nowNs() - begin;
+
+    CHECK_MSG(timeouts == 0, "%d waits timed out", timeouts);
+    CHECK_MSG(elapsed < kWaitMs * 1000000LL, "handoff took %.1f ms", elapsed / 1e6);
+}
+
+RECORDER_TEST(FrameSignal, waitTimesOutWithoutPublish) {
+    FrameSignal signal;
+    int64_t begin = recorder_test::nowNs();
+    bool ready = signal.wait([] { return false; }, 20);
+    int64_t elapsed = recorder_test::nowNs() - begin;
+    CHECK(!ready);
+    CHECK_MSG(elapsed >= 15000000, "returned after %.1f ms", elapsed / 1e6);
+}
+
+// 可读量不到阈值时不唤醒，wakeAll 总是唤醒
+RECORDER_TEST(FrameSignal, publishBelowThresholdDoesNotWake) {
+    FrameSignal signal;
+    std::atomic<bool> stop{false};
+    std::atomic<int> wakeups{0};
+
+    std::thread consumer([&] {
+        while (!stop.load()) {
+            signal.wait([&] { return stop.load(); }, kWaitMs);
+            wakeups.fetch_add(1);
+        }
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    for (int i = 0; i < 100; ++i) signal.publish(kFrame - 1, kFrame);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    int beforeStop = wakeups.load();
+
+    int64_t begin = recorder_test::nowNs();
+    stop.store(true);
+    signal.wakeAll();
+    consumer.join();
+
+    CHECK_MSG(beforeStop == 0, "%d wakeups below threshold", beforeStop);
+    CHECK((recorder_test::nowNs() - begin) < kWaitMs * 1000000LL / 2);
+}
+
+namespace {
+
+struct CallbackStats {
+    int64_t p50;
+    int64_t p99;
+    int64_t max;
+};
+
+/**
+ * 模拟 dataCallback：每 1ms 写入一帧并唤醒消费者，统计回调本身的耗时。
+ * 消费者和改动前的 handlerLoop 一样，在锁内读取 ring
+ */
+template <typename Callback, typename Consumer>
+CallbackStats runCallbacks(Callback callback, Consumer consumer, std::atomic<bool>& stop) {
+    constexpr int kCallbacks = 2000;
+    std::thread worker(consumer);
+
+    std::vector<int16_t> frame(kFrame, 1);
+    std::vector<int64_t> durations;
+    durations.reserve(kCallbacks);
+    for (int i = 0; i < kCallbacks; ++i) {
+        int64_t begin = recorder_test::nowNs();
+        callback(frame.data());
+        durations.push_back(recorder_test::nowNs() - begin);
+        std::this_thread::sleep_for(std::chrono::microseconds(1000));
+    }
+    stop.store(true);
+    worker.join();
+
+    CallbackStats stats{};
+    stats.max = *std::max_element(durations.begin(), durations.end());
+    stats.p99 = recorder_test::percentile(durations, 99);
+    stats.p50 = recorder_test::percentile(durations, 50);
+    return stats;
+}
+
+} // namespace
+
+// 改动前: lwrb_write + condition_variable::notify_one，消费者持锁 lwrb_read
+// 改动后: SpscFrameRing::write + FrameSignal::publish，消费者不加锁
+RECORDER_BENCH(FrameSignal, callbackLatency) {
+    CallbackStats before{};
+    {
+        static uint8_t storage[8192 * sizeof(int16_t)];
+        lwrb_t rb;
+        lwrb_init(&rb, storage, sizeof(storage));
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::atomic<bool> stop{false};
+        before = runCallbacks(
+            [&](const int16_t* data) {
+                lwrb_write(&rb, data, kFrame * sizeof(int16_t));
+                cv.notify_one();
+            },
+            [&] {
+                std::vector<int16_t> frame(kFrame);
+                while (!stop.load()) {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait_for(lock, std::chrono::milliseconds(20), [&] {
+                        return stop.load() || lwrb_get_full(&rb) >= kFrame * sizeof(int16_t);
+                    });
+                    while (lwrb_get_full(&rb) >= kFrame * sizeof(int16_t)) {
+                        lwrb_read(&rb, frame.data(), kFrame * sizeof(int16_t));
+                    }
+                }
+            },
+            stop);
+    }
+
+    CallbackStats after{};
+    {
+        SpscFrameRing<int16_t, 1, 8192> ring;
+        FrameSignal signal;
+        std::atomic<bool> stop{false};
+        after = runCallbacks(
+            [&](const int16_t* data) {
+                ring.write(data, kFrame);
+                signal.publish(ring.capacity() - ring.freeFrames(), kFrame);
+            },
+            [&] {
+                std::vector<int16_t> frame(kFrame);
+                while (!stop.load()) {
+                    signal.wait([&] { return stop.load() || ring.availableFrames() >= kFrame; }, 20);
+                    while (ring.availableFrames() >= kFrame) ring.read(frame.data(), kFrame);
+                }
+            },
+            stop);
+    }
+
+    printf("  callback time      p50 us   p99 us   max us\n");
+    printf("  cv + lwrb        %8.2f %8.2f %8.2f\n", before.p50 / 1e3, before.p99 / 1e3, before.max / 1e3);
+    printf("  futex + spsc     %8.2f %8.2f %8.2f\n", after.p50 / 1e3, after.p99 / 1e3, after.max / 1e3);
+}
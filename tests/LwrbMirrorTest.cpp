@@ -0,0 +1,172 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+#include <unistd.h>
+
+#include "SpscFrameRing.h"
+#include "lwrb.h"
+
+#include "TestHarness.h"
+
+RECORDER_TEST(LwrbMirror, sizeRoundsUpToPages) {
+    const auto page = static_cast<lwrb_sz_t>(sysconf(_SC_PAGESIZE));
+    lwrb_sz_t size = page + 1;
+    void* base = lwrb_mirror_map(&size);
+    CHECK(base != nullptr);
+    CHECK(size == 2 * page);
+    lwrb_mirror_unmap(base, size);
+
+    lwrb_sz_t empty = 0;
+    CHECK(lwrb_mirror_map(&empty) == nullptr);
+}
+
+// 两份映射指向同一组页面，从任意位置开始 size 字节都是连续可读写的
+RECORDER_TEST(LwrbMirror, halvesAlias) {
+    lwrb_sz_t size = 16384;
+    auto* base = static_cast<uint8_t*>(lwrb_mirror_map(&size));
+    CHECK(base != nullptr);
+
+    for (lwrb_sz_t i = 0; i < size; ++i) base[i] = static_cast<uint8_t>(i * 7);
+    for (lwrb_sz_t i = 0; i < size; ++i) {
+        CHECK_MSG(base[i + size] == static_cast<uint8_t>(i * 7), "mirror differs at %lu", i);
+    }
+
+    // 跨过末尾写入，回绕部分出现在开头
+    const lwrb_sz_t offset = size - 100;
+    std::vector<uint8_t> pattern(300);
+    std::iota(pattern.begin(), pattern.end(), 1);
+    std::memcpy(base + offset, pattern.data(), pattern.size());
+    CHECK(std::memcmp(base + offset, pattern.data(), 100) == 0);
+    CHECK(std::memcmp(base, pattern.data() + 100, 200) == 0);
+
+    lwrb_mirror_unmap(base, size);
+}
+
+// 存储区恰好是整页时 SpscFrameRing 使用镜像映射，回绕的帧也只有一段
+RECORDER_TEST(LwrbMirror, ringViewNeverSplits) {
+    SpscFrameRing<int16_t, 1, 8192> ring;
+    CHECK(ring.isMirrored());
+
+    std::vector<int16_t> frame(480);
+    for (int round = 0; round < 100; ++round) {
+        std::iota(frame.begin(), frame.end(), static_cast<int16_t>(round));
+        CHECK(ring.write(frame.data(), frame.size()) == frame.size());
+        PcmFrameView view;
+        CHECK(ring.acquire(frame.size(), view));
+        CHECK(view.count == 1);
+        CHECK(std::memcmp(view.spans[0].data, frame.data(), frame.size() * sizeof(int16_t)) == 0);
+        ring.release(view);
+    }
+}
+
+// lwrb_init_mirrored 的 lwrb_t: 不论读写指针在哪里，可读和可写的数据都是一整段
+RECORDER_TEST(LwrbMirror, lwrbLinearBlocksCoverEverything) {
+    lwrb_t rb;
+    CHECK(lwrb_init_mirrored(&rb, 4000));
+    const lwrb_sz_t size = rb.size;
+    CHECK(size >= 4000 && size % static_cast<lwrb_sz_t>(sysconf(_SC_PAGESIZE)) == 0);
+
+    std::vector<uint8_t> pattern(size - 1), out(size - 1);
+    size_t splitReads = 0;
+    for (lwrb_sz_t start = 0; start < size; start += 397) {
+        // 把读写指针移到 start
+        lwrb_reset(&rb);
+        lwrb_advance(&rb, start);
+        lwrb_skip(&rb, start);
+        for (lwrb_sz_t n : {lwrb_sz_t(1), lwrb_sz_t(960), size / 2, size - 1}) {
+            for (lwrb_sz_t i = 0; i < n; ++i) pattern[i] = static_cast<uint8_t>(start + i * 13);
+            CHECK(lwrb_get_linear_block_write_length(&rb) == lwrb_get_free(&rb));
+            CHECK(lwrb_write(&rb, pattern.data(), n) == n);
+            CHECK_MSG(lwrb_get_linear_block_read_length(&rb) == n, "start %lu, %lu bytes: linear %lu",
+                      (unsigned long) start, (unsigned long) n,
+                      (unsigned long) lwrb_get_linear_block_read_length(&rb));
+            splitReads += start + n > size;
+            CHECK(std::memcmp(lwrb_get_linear_block_read_address(&rb), pattern.data(), n) == 0);
+            CHECK(lwrb_peek(&rb, 0, out.data(), n) == n && std::memcmp(out.data(), pattern.data(), n) == 0);
+            CHECK(lwrb_read(&rb, out.data(), n) == n && std::memcmp(out.data(), pattern.data(), n) == 0);
+            CHECK(lwrb_get_full(&rb) == 0);
+        }
+    }
+    // 确实覆盖到了跨过末尾的情况
+    CHECK(splitReads > 0);
+    lwrb_free_mirrored(&rb);
+    CHECK(!lwrb_is_ready(&rb));
+
+    // 普通存储在回绕时只给出到末尾的一段
+    static uint8_t storage[4096];
+    lwrb_init(&rb, storage, sizeof(storage));
+    lwrb_advance(&rb, 4000);
+    lwrb_skip(&rb, 4000);
+    lwrb_write(&rb, pattern.data(), 960);
+    CHECK(lwrb_get_linear_block_read_length(&rb) == 96);
+    lwrb_free_mirrored(&rb);
+}
+
+namespace {
+
+// 读出一帧之后的处理，模拟交给 APM / SIMD 转换
+int64_t consume(const int16_t* data, size_t samples) {
+    int64_t sum = 0;
+    for (size_t i = 0; i < samples; ++i) sum += data[i];
+    return sum;
+}
+
+} // namespace
+
+// 改动前每帧 lwrb_read 拷贝到临时缓冲 (回绕时两次 memcpy)；镜像存储的 lwrb_t 和 SpscFrameRing 直接在 ring 上处理
+RECORDER_BENCH(LwrbMirror, readPath) {
+    constexpr size_t kFrame = 480;
+    constexpr size_t kFrames = 8192;
+    constexpr int kRounds = 200000;
+    std::vector<int16_t> input(kFrame, 3);
+    std::vector<int16_t> scratch(kFrame);
+    int64_t sink = 0;
+
+    static uint8_t storage[kFrames * sizeof(int16_t)];
+    lwrb_t rb;
+    lwrb_init(&rb, storage, sizeof(storage));
+    int64_t begin = recorder_test::nowNs();
+    for (int i = 0; i < kRounds; ++i) {
+        lwrb_write(&rb, input.data(), kFrame * sizeof(int16_t));
+        lwrb_read(&rb, scratch.data(), kFrame * sizeof(int16_t));
+        sink += consume(scratch.data(), kFrame);
+    }
+    int64_t copyNs = recorder_test::nowNs() - begin;
+
+    lwrb_t mirrored;
+    int64_t mirroredNs = -1;
+    if (lwrb_init_mirrored(&mirrored, sizeof(storage))) {
+        begin = recorder_test::nowNs();
+        for (int i = 0; i < kRounds; ++i) {
+            lwrb_write(&mirrored, input.data(), kFrame * sizeof(int16_t));
+            if (lwrb_get_linear_block_read_length(&mirrored) < kFrame * sizeof(int16_t)) break;
+            sink += consume(static_cast<const int16_t*>(lwrb_get_linear_block_read_address(&mirrored)), kFrame);
+            lwrb_skip(&mirrored, kFrame * sizeof(int16_t));
+        }
+        mirroredNs = recorder_test::nowNs() - begin;
+        lwrb_free_mirrored(&mirrored);
+    }
+
+    SpscFrameRing<int16_t, 1, kFrames> ring;
+    begin = recorder_test::nowNs();
+    for (int i = 0; i < kRounds; ++i) {
+        ring.write(input.data(), kFrame);
+        PcmFrameView view{};
+        if (!ring.acquire(kFrame, view)) break;
+        sink += consume(view.spans[0].data, kFrame);
+        ring.release(view);
+    }
+    int64_t viewNs = recorder_test::nowNs() - begin;
+    recorder_test::keep(sink);
+
+    printf("  per frame (write + read + consume)\n");
+    printf("  lwrb_read copy      %7.1f ns\n", static_cast<double>(copyNs) / kRounds);
+    printf("  lwrb mirrored block %7.1f ns\n", static_cast<double>(mirroredNs) / kRounds);
+    printf("  SpscFrameRing view  %7.1f ns (%s)\n", static_cast<double>(viewNs) / kRounds,
+           ring.isMirrored() ? "mirrored" : "not mirrored");
+}
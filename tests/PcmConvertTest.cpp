@@ -0,0 +1,176 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "PcmConvert.h"
+
+#include "TestHarness.h"
+
+namespace {
+
+// 不是 8 / 16 的倍数，SIMD 主循环之后的尾部也会被覆盖
+constexpr size_t kLength = 4096 + 13;
+
+bool sameBits(float a, float b) {
+    uint32_t x, y;
+    std::memcpy(&x, &a, sizeof(x));
+    std::memcpy(&y, &b, sizeof(y));
+    return x == y;
+}
+
+// float -> int16 的边界输入：±0、±inf、饱和边界、每个整数之间的 .5 (缩放后的平局) 及其前后一个 ulp
+std::vector<float> edgeInputs() {
+    const float inf = std::numeric_limits<float>::infinity();
+    std::vector<float> values = {0.f, -0.f, inf, -inf, 1.f, -1.f, 2.f, -2.f, 1e30f, -1e30f,
+                                 std::numeric_limits<float>::denorm_min(), -std::numeric_limits<float>::denorm_min(),
+                                 32767.f / 32768.f, -32768.f / 32768.f, 32767.5f / 32768.f, -32768.5f / 32768.f,
+                                 32766.5f / 32768.f, -32767.5f / 32768.f};
+    for (int k = -32769; k <= 32768; ++k) {
+        float tie = (static_cast<float>(k) + 0.5f) / 32768.f;
+        values.push_back(tie);
+        values.push_back(std::nextafter(tie, inf));
+        values.push_back(std::nextafter(tie, -inf));
+    }
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> dist(-1.5f, 1.5f);
+    while (values.size() % kLength != 0) values.push_back(dist(rng));
+    return values;
+}
+
+std::vector<int16_t> allS16() {
+    std::vector<int16_t> values;
+    for (int v = -32768; v <= 32767; ++v) values.push_back(static_cast<int16_t>(v));
+    return values;
+}
+
+} // namespace
+
+RECORDER_TEST(PcmConvert, scalarIsLastKernel) {
+    const auto& kernels = pcmConvertKernels();
+    CHECK(!kernels.empty());
+    CHECK(std::strcmp(kernels.back().name, "scalar") == 0);
+    CHECK(std::strcmp(kernels.front().name, pcmConvertBackend()) == 0);
+}
+
+RECORDER_TEST(PcmConvert, scalarRounding) {
+    const float inf = std::numeric_limits<float>::infinity();
+    const float in[] = {0.f, -0.f, inf, -inf, 0.5f / 32768.f, -0.5f / 32768.f, 1.5f / 32768.f, -1.5f / 32768.f,
+                        32767.5f / 32768.f, -32768.5f / 32768.f, 0.49f / 32768.f};
+    const int16_t expected[] = {0, 0, 32767, -32768, 1, -1, 2, -2, 32767, -32768, 0};
+    int16_t out[sizeof(in) / sizeof(in[0])];
+    convertFloatToS16Scalar(in, out, sizeof(in) / sizeof(in[0]));
+    for (size_t i = 0; i < sizeof(in) / sizeof(in[0]); ++i) {
+        CHECK_MSG(out[i] == expected[i], "input %a: got %d, expected %d", in[i], out[i], expected[i]);
+    }
+}
+
+RECORDER_TEST(PcmConvert, floatToS16BitExact) {
+    std::vector<float> in = edgeInputs();
+    std::vector<int16_t> expected(in.size());
+    convertFloatToS16Scalar(in.data(), expected.data(), in.size());
+    for (const auto& kernel : pcmConvertKernels()) {
+        std::vector<int16_t> out(in.size());
+        // 每次 kLength 个，和实际调用一样从任意位置开始
+        for (size_t offset = 0; offset < in.size(); offset += kLength) {
+            kernel.floatToS16(in.data() + offset, out.data() + offset, kLength);
+        }
+        for (size_t i = 0; i < in.size(); ++i) {
+            CHECK_MSG(out[i] == expected[i], "%s: input %a got %d, scalar %d",
+                      kernel.name, in[i], out[i], expected[i]);
+        }
+    }
+}
+
+RECORDER_TEST(PcmConvert, s16ToFloatBitExact) {
+    std::vector<int16_t> in = allS16();
+    std::vector<float> expected(in.size());
+    convertS16ToFloatScalar(in.data(), expected.data(), in.size());
+    CHECK(sameBits(expected[32768], 0.f));
+    CHECK(expected.front() == -1.f);
+    for (const auto& kernel : pcmConvertKernels()) {
+        std::vector<float> out(in.size());
+        kernel.s16ToFloat(in.data(), out.data(), in.size() - 3);
+        kernel.s16ToFloat(in.data() + in.size() - 3, out.data() + in.size() - 3, 3);
+        for (size_t i = 0; i < in.size(); ++i) {
+            CHECK_MSG(sameBits(out[i], expected[i]), "%s: input %d got %a, scalar %a",
+                      kernel.name, in[i], out[i], expected[i]);
+        }
+    }
+}
+
+RECORDER_TEST(PcmConvert, deinterleave2BitExact) {
+    // 奇数帧，左右声道错开，所有 int16 值都出现在两个声道上
+    std::vector<int16_t> values = allS16();
+    const size_t frames = values.size() - 1;
+    std::vector<int16_t> in(2 * frames);
+    for (size_t i = 0; i < frames; ++i) {
+        in[2 * i] = values[i];
+        in[2 * i + 1] = values[values.size() - 1 - i];
+    }
+    std::vector<float> left(frames), right(frames);
+    float* planes[] = {left.data(), right.data()};
+    deinterleaveS16ToFloatScalar(in.data(), frames, 2, planes);
+    for (const auto& kernel : pcmConvertKernels()) {
+        std::vector<float> l(frames), r(frames);
+        kernel.deinterleave2(in.data(), frames, l.data(), r.data());
+        for (size_t i = 0; i < frames; ++i) {
+            CHECK_MSG(sameBits(l[i], left[i]) && sameBits(r[i], right[i]), "%s: frame %zu", kernel.name, i);
+        }
+    }
+}
+
+// 对称的缩放系数保证 int16 -> float -> int16 回到原值
+RECORDER_TEST(PcmConvert, roundTrip) {
+    std::vector<int16_t> in = allS16();
+    std::vector<float> f(in.size());
+    std::vector<int16_t> out(in.size());
+    convertS16ToFloat(in.data(), f.data(), in.size());
+    convertFloatToS16(f.data(), out.data(), in.size());
+    CHECK(std::memcmp(in.data(), out.data(), in.size() * sizeof(int16_t)) == 0);
+}
+
+RECORDER_BENCH(PcmConvert, kernels) {
+    // 10 ms 48 kHz 双声道的一帧
+    constexpr size_t kFrames = 480;
+    constexpr int kRounds = 200000;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> dist(-32768, 32767);
+    std::vector<int16_t> s16(2 * kFrames);
+    for (auto& v : s16) v = static_cast<int16_t>(dist(rng));
+    std::vector<float> f(2 * kFrames), left(kFrames), right(kFrames);
+    convertS16ToFloatScalar(s16.data(), f.data(), f.size());
+
+    printf("  per 480-frame stereo buffer (ns)\n");
+    printf("  %-8s %12s %12s %14s\n", "kernel", "s16ToFloat", "floatToS16", "deinterleave2");
+    for (const auto& kernel : pcmConvertKernels()) {
+        int64_t begin = recorder_test::nowNs();
+        for (int i = 0; i < kRounds; ++i) {
+            kernel.s16ToFloat(s16.data(), f.data(), f.size());
+            recorder_test::keep(f);
+        }
+        int64_t toFloatNs = recorder_test::nowNs() - begin;
+
+        begin = recorder_test::nowNs();
+        for (int i = 0; i < kRounds; ++i) {
+            kernel.floatToS16(f.data(), s16.data(), f.size());
+            recorder_test::keep(s16);
+        }
+        int64_t toS16Ns = recorder_test::nowNs() - begin;
+
+        begin = recorder_test::nowNs();
+        for (int i = 0; i < kRounds; ++i) {
+            kernel.deinterleave2(s16.data(), kFrames, left.data(), right.data());
+            recorder_test::keep(left);
+        }
+        int64_t deinterleaveNs = recorder_test::nowNs() - begin;
+
+        printf("  %-8s %12.1f %12.1f %14.1f\n", kernel.name, static_cast<double>(toFloatNs) / kRounds,
+               static_cast<double>(toS16Ns) / kRounds, static_cast<double>(deinterleaveNs) / kRounds);
+    }
+}
@@ -0,0 +1,212 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include <atomic>
+#include <cstring>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "SpscFrameRing.h"
+#include "lwrb.h"
+
+#include "TestHarness.h"
+
+RECORDER_TEST(SpscFrameRing, fullCapacityUsable) {
+    SpscFrameRing<int16_t, 1, 1024> ring;
+    std::vector<int16_t> data(1024, 7);
+    CHECK(ring.write(data.data(), 1000) == 1000);
+    CHECK(ring.freeFrames() == 24);
+    CHECK(ring.write(data.data(), 100) == 24);
+    CHECK(ring.write(data.data(), 1) == 0);
+    CHECK(ring.availableFrames() == 1024);
+    CHECK(ring.skip(2000) == 1024);
+    CHECK(ring.availableFrames() == 0);
+    CHECK(ring.readPosition() == 1024);
+    CHECK(ring.writePosition() == 1024);
+}
+
+// 读写都以整帧为单位，多声道时一帧是 Channels 个采样
+RECORDER_TEST(SpscFrameRing, wholeFrames) {
+    SpscFrameRing<int16_t, 2, 256> ring;
+    std::vector<int16_t> in(2 * 100);
+    std::iota(in.begin(), in.end(), 0);
+    CHECK(ring.write(in.data(), 100) == 100);
+
+    FrameView<int16_t> view{};
+    CHECK(!ring.acquire(101, view));
+    CHECK(ring.acquire(60, view));
+    CHECK(view.samples == 120);
+    ring.release(view);
+
+    std::vector<int16_t> out(2 * 40);
+    CHECK(ring.read(out.data(), 100) == 40);
+    CHECK(std::memcmp(out.data(), in.data() + 120, out.size() * sizeof(int16_t)) == 0);
+}
+
+// 128 字节的存储区不是整页，不使用镜像映射，回绕的视图分成两段
+RECORDER_TEST(SpscFrameRing, linearStorageSplitsAtWrap) {
+    SpscFrameRing<int16_t, 1, 64> ring;
+    CHECK(!ring.isMirrored());
+
+    std::vector<int16_t> in(40);
+    std::iota(in.begin(), in.end(), 100);
+    for (int round = 0; round < 10; ++round) {
+        CHECK(ring.write(in.data(), in.size()) == in.size());
+        FrameView<int16_t> view{};
+        CHECK(ring.acquire(in.size(), view));
+        size_t start = ring.readPosition() & 63;
+        CHECK(view.count == (start + in.size() > 64 ? 2u : 1u));
+
+        std::vector<int16_t> gathered(in.size());
+        view.forEach([&](const int16_t* data, size_t samples, size_t offset) {
+            std::memcpy(gathered.data() + offset, data, samples * sizeof(int16_t));
+        });
+        CHECK(gathered == in);
+        ring.release(view);
+    }
+}
+
+// 两个线程并发读写，序号必须连续
+RECORDER_TEST(SpscFrameRing, concurrentOrder) {
+    constexpr uint32_t kTotal = 1u << 20;
+    SpscFrameRing<uint32_t, 1, 4096> ring;
+    bool ordered = true;
+
+    std::thread consumer([&] {
+        uint32_t expected = 0;
+        std::vector<uint32_t> out(333);
+        while (expected < kTotal) {
+            size_t n = ring.read(out.data(), out.size());
+            if (n == 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            for (size_t i = 0; i < n; ++i) {
+                if (out[i] != expected++) ordered = false;
+            }
+        }
+    });
+
+    std::vector<uint32_t> in(480);
+    uint32_t next = 0;
+    while (next < kTotal) {
+        size_t n = std::min<size_t>(in.size(), kTotal - next);
+        for (size_t i = 0; i < n; ++i) in[i] = next + static_cast<uint32_t>(i);
+        size_t written = ring.write(in.data(), n);
+        next += static_cast<uint32_t>(written);
+        if (written < n) std::this_thread::yield();
+    }
+    consumer.join();
+    CHECK(ordered);
+}
+
+namespace {
+
+constexpr size_t kFrame = 480;
+constexpr size_t kBlocks = 200000;
+
+struct RingStats {
+    double mbPerSecond;
+    int64_t p50;
+    int64_t p99;
+    int64_t p999;
+    int64_t max;
+};
+
+// 有两个以上 CPU 时把生产者和消费者放在不同的核上
+void pin(int cpu) {
+    if (std::thread::hardware_concurrency() < 2) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/**
+ * 生产者逐块写入 kFrame 个采样，记录每次写入的耗时；消费者逐块读出。
+ * 写满 / 读空时让出 CPU，不做忙等
+ */
+template <typename Write, typename Read>
+RingStats contend(Write write, Read read) {
+    std::vector<int64_t> latencies;
+    latencies.reserve(kBlocks);
+
+    std::thread consumer([&] {
+        pin(1);
+        std::vector<int16_t> out(kFrame);
+        for (size_t done = 0; done < kBlocks;) {
+            if (read(out.data())) {
+                ++done;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    pin(0);
+    std::vector<int16_t> in(kFrame, 1);
+    int64_t begin = recorder_test::nowNs();
+    for (size_t sent = 0; sent < kBlocks;) {
+        int64_t start = recorder_test::nowNs();
+        bool ok = write(in.data());
+        int64_t elapsed = recorder_test::nowNs() - start;
+        if (ok) {
+            latencies.push_back(elapsed);
+            ++sent;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+    int64_t total = recorder_test::nowNs() - begin;
+
+    RingStats stats{};
+    stats.mbPerSecond = static_cast<double>(kBlocks * kFrame * sizeof(int16_t)) / (total / 1e9) / 1e6;
+    stats.max = *std::max_element(latencies.begin(), latencies.end());
+    stats.p999 = recorder_test::percentile(latencies, 99.9);
+    stats.p99 = recorder_test::percentile(latencies, 99);
+    stats.p50 = recorder_test::percentile(latencies, 50);
+    return stats;
+}
+
+void print(const char* name, const RingStats& stats) {
+    printf("  %-14s %9.0f %8lld %8lld %8lld %9lld\n", name, stats.mbPerSecond, (long long) stats.p50,
+           (long long) stats.p99, (long long) stats.p999, (long long) stats.max);
+}
+
+} // namespace
+
+RECORDER_BENCH(SpscFrameRing, versusLwrb) {
+    static uint8_t storage[8192 * sizeof(int16_t)];
+    lwrb_t rb;
+    lwrb_init(&rb, storage, sizeof(storage));
+    const lwrb_sz_t bytes = kFrame * sizeof(int16_t);
+    RingStats lwrb = contend(
+        [&](const int16_t* data) {
+            if (lwrb_get_free(&rb) < bytes) return false;
+            return lwrb_write(&rb, data, bytes) == bytes;
+        },
+        [&](int16_t* data) {
+            if (lwrb_get_full(&rb) < bytes) return false;
+            return lwrb_read(&rb, data, bytes) == bytes;
+        });
+
+    SpscFrameRing<int16_t, 1, 8192> ring;
+    RingStats spsc = contend(
+        [&](const int16_t* data) {
+            if (ring.freeFrames() < kFrame) return false;
+            return ring.write(data, kFrame) == kFrame;
+        },
+        [&](int16_t* data) { return ring.read(data, kFrame) == kFrame; });
+
+    printf("  %u CPU(s), %zu blocks of %zu samples, write latency in ns\n",
+           std::thread::hardware_concurrency(), kBlocks, kFrame);
+    printf("  ring                MB/s      p50      p99    p99.9       max\n");
+    print("lwrb", lwrb);
+    print("SpscFrameRing", spsc);
+}
@@ -0,0 +1,100 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_TESTS_TESTHARNESS_H
+#define AAUDIORECORDER_TESTS_TESTHARNESS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * 主机上的检查和基准，不依赖第三方测试框架
+ *
+ * - RECORDER_TEST(Suite, name) 注册一个检查，CHECK 失败时记录位置并结束这个检查
+ * - RECORDER_BENCH(Suite, name) 注册一个基准，只输出数字，不做判定
+ * - recorder_tests [--bench] [Suite[.name]]，不带参数时运行全部检查
+ */
+namespace recorder_test {
+
+using Fn = void (*)();
+
+struct Case {
+    const char* suite;
+    const char* name;
+    Fn fn;
+    bool bench;
+};
+
+std::vector<Case>& registry();
+
+struct Registrar {
+    Registrar(const char* suite, const char* name, Fn fn, bool bench) {
+        registry().push_back({suite, name, fn, bench});
+    }
+};
+
+struct Failure {
+    const char* file;
+    int line;
+    char message[256];
+};
+
+[[noreturn]] void fail(const char* file, int line, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+inline int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 排序后取第 p 百分位 (0-100)，samples 会被重新排列
+inline int64_t percentile(std::vector<int64_t>& samples, double p) {
+    if (samples.empty()) return 0;
+    auto index = static_cast<size_t>(p / 100.0 * static_cast<double>(samples.size() - 1) + 0.5);
+    std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(index), samples.end());
+    return samples[index];
+}
+
+// 本次运行的临时目录下的文件路径，目录在进程退出时连同内容删除
+std::string tempPath(const char* name);
+
+// 把交织 int16 写成裸 PCM 文件，失败时报错结束当前检查
+void writePcm(const std::string& path, const std::vector<int16_t>& samples);
+
+// 读取裸 PCM 文件，文件不存在时返回空
+std::vector<int16_t> readPcm(const std::string& path);
+
+// 当前线程消耗的 CPU 时间
+int64_t threadCpuNs();
+
+// 防止被测结果被优化掉
+template <typename T>
+inline void keep(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+} // namespace recorder_test
+
+#define RECORDER_CASE(suite, name, bench)                                                        \
+    static void suite##_##name();                                                                \
+    static ::recorder_test::Registrar suite##_##name##_registrar(#suite, #name, suite##_##name, bench); \
+    static void suite##_##name()
+
+#define RECORDER_TEST(suite, name) RECORDER_CASE(suite, name, false)
+#define RECORDER_BENCH(suite, name) RECORDER_CASE(suite, name, true)
+
+#define CHECK(expr)                                                                              \
+    do {                                                                                         \
+        if (!(expr)) ::recorder_test::fail(__FILE__, __LINE__, "%s", #expr);                     \
+    } while (0)
+
+#define CHECK_MSG(expr, ...)                                                                     \
+    do {                                                                                         \
+        if (!(expr)) ::recorder_test::fail(__FILE__, __LINE__, __VA_ARGS__);                     \
+    } while (0)
+
+#endif //AAUDIORECORDER_TESTS_TESTHARNESS_H
@@ -0,0 +1,135 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include "TestHarness.h"
+
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+#include <ftw.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace recorder_test {
+
+std::vector<Case>& registry() {
+    static std::vector<Case> cases;
+    return cases;
+}
+
+void fail(const char* file, int line, const char* format, ...) {
+    Failure failure{file, line, {}};
+    va_list args;
+    va_start(args, format);
+    vsnprintf(failure.message, sizeof(failure.message), format, args);
+    va_end(args);
+    throw failure;
+}
+
+namespace {
+
+int removeEntry(const char* path, const struct stat*, int, struct FTW*) {
+    return ::remove(path);
+}
+
+struct TempDir {
+    std::string path;
+
+    TempDir() {
+        const char* base = getenv("TMPDIR");
+        std::string pattern = std::string(base != nullptr ? base : "/tmp") + "/recorder_tests.XXXXXX";
+        if (mkdtemp(&pattern[0]) != nullptr) path = pattern;
+    }
+
+    ~TempDir() {
+        if (!path.empty()) nftw(path.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+    }
+};
+
+} // namespace
+
+std::string tempPath(const char* name) {
+    static TempDir dir;
+    if (dir.path.empty()) fail(__FILE__, __LINE__, "mkdtemp failed");
+    return dir.path + "/" + name;
+}
+
+void writePcm(const std::string& path, const std::vector<int16_t>& samples) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) fail(__FILE__, __LINE__, "cannot create %s", path.c_str());
+    size_t written = fwrite(samples.data(), sizeof(int16_t), samples.size(), file);
+    fclose(file);
+    if (written != samples.size()) fail(__FILE__, __LINE__, "short write to %s", path.c_str());
+}
+
+std::vector<int16_t> readPcm(const std::string& path) {
+    std::vector<int16_t> samples;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) return samples;
+    int16_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, sizeof(int16_t), 4096, file)) > 0) {
+        samples.insert(samples.end(), buffer, buffer + n);
+    }
+    fclose(file);
+    return samples;
+}
+
+int64_t threadCpuNs() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+} // namespace recorder_test
+
+namespace {
+
+// filter 为 "Suite" 或 "Suite.name"，空表示全部
+bool matches(const recorder_test::Case& c, const char* filter) {
+    if (filter == nullptr) return true;
+    size_t suiteLength = strlen(c.suite);
+    if (strncmp(filter, c.suite, suiteLength) != 0) return false;
+    if (filter[suiteLength] == '\0') return true;
+    return filter[suiteLength] == '.' && strcmp(filter + suiteLength + 1, c.name) == 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool bench = false;
+    const char* filter = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    int run = 0;
+    int failed = 0;
+    for (const auto& c : recorder_test::registry()) {
+        if (c.bench != bench || !matches(c, filter)) continue;
+        ++run;
+        printf("[ RUN      ] %s.%s\n", c.suite, c.name);
+        fflush(stdout);
+        int64_t begin = recorder_test::nowNs();
+        try {
+            c.fn();
+            printf("[       OK ] %s.%s (%.1f ms)\n", c.suite, c.name, (recorder_test::nowNs() - begin) / 1e6);
+        } catch (const recorder_test::Failure& failure) {
+            ++failed;
+            printf("%s:%d: %s\n[  FAILED  ] %s.%s\n", failure.file, failure.line, failure.message, c.suite, c.name);
+        }
+        fflush(stdout);
+    }
+
+    if (run == 0) {
+        printf("No %s matches %s\n", bench ? "benchmark" : "test", filter != nullptr ? filter : "(all)");
+        return 1;
+    }
+    printf("%d %s, %d failed\n", run, bench ? "benchmarks" : "tests", failed);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_TESTS_HOST_FAKEDEVICES_H
+#define AAUDIORECORDER_TESTS_HOST_FAKEDEVICES_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * host/ 里 AAudio、APM、DeepFilterNet 和存储替身的参数和观测点
+ *
+ * 替身只模拟时间行为：打开/创建的耗时、按实时节奏到来的回调、每帧的处理耗时、写盘停顿。
+ * APM 是直通的 (输出等于输入，可以打开一个模拟 AGC 收敛的自适应增益)；
+ * DF 的 hop 是 480，df_process_frame 输出延迟一个 hop 的 gain * 输入，
+ * 与 df_process_frame_raw 的恒定 ERB 增益 (以及可选的等效 DF 系数) 一致。数字只用来比较 recorder 自己的调度，
+ * 不代表真实 APM / 模型的开销。每个检查开始时调用 reset() 恢复默认值
+ */
+namespace fake_device {
+
+// 所有时间都是 steady_clock 纳秒，和 recorder_test::nowNs() 一致
+struct AAudio {
+    std::atomic<int64_t> openDelayNs{0};            // AAudioStreamBuilder_openStream 的耗时
+    std::atomic<int32_t> framesPerCallback{192};    // 每次回调的帧数，48 kHz 下 4 ms
+    std::atomic<bool> failStart{false};             // requestStart 返回错误
+
+    std::atomic<int64_t> openedNs{0};               // 最近一次 openStream 返回的时间
+    std::atomic<int64_t> requestStartNs{0};         // 最近一次 requestStart 的时间
+    std::atomic<int64_t> firstCallbackNs{0};        // requestStart 之后第一次回调的时间
+    std::atomic<uint64_t> framesDelivered{0};       // 所有回调送出的帧数
+    std::atomic<int> openStreams{0};
+
+    void reset();
+};
+
+struct Apm {
+    std::atomic<int64_t> createDelayNs{0};          // AudioProcessingBuilder::Create 的耗时
+    std::atomic<int64_t> frameCostNs{0};            // 每次 ProcessStream 的耗时 (sleep，不占 CPU)
+    std::atomic<int64_t> stallOnceNs{0};            // 下一次 ProcessStream 额外停顿这么久，之后清零
+    std::atomic<int> adaptFrames{0};                // 增益收敛的时间常数 (帧)，0 表示直通
+    std::atomic<float> targetGain{1.f};             // 增益从 1 收敛到的值
+
+    std::atomic<int64_t> createdNs{0};              // 最近一次 Create 返回的时间
+    std::atomic<uint64_t> created{0};
+    std::atomic<uint64_t> framesProcessed{0};       // ProcessStream 调用次数 (每次一个 10 ms 帧)
+    std::atomic<int64_t> lastProcessNs{0};          // 最近一次 ProcessStream 返回的时间
+    std::atomic<int> streamDelayMs{-1};             // 最近一次 set_stream_delay_ms
+
+    void reset();
+};
+
+struct DeepFilter {
+    std::atomic<int64_t> createDelayNs{0};          // df_create 的耗时 (解压、解析模型)
+    std::atomic<int64_t> frameCostNs{0};            // 每次 df_process_frame 的耗时
+    std::atomic<int64_t> coldFrameCostNs{0};        // 新状态第一帧额外的耗时
+    std::atomic<float> gain{0.5f};                  // 所有 ERB 频带的增益
+    std::atomic<float> snrDb{10.f};                 // 局部 SNR，超过 30 dB 时不输出增益 (和 libDF 一样)
+    std::atomic<bool> dfCoefs{false};               // SNR 不超过 20 dB 时输出等效于 gain 的 DF 系数
+
+    std::atomic<uint64_t> created{0};
+    std::atomic<uint64_t> framesProcessed{0};
+    std::atomic<float> attenLimDb{0.f};             // 最近一次 df_set_atten_lim，没有调用过时为 NAN
+    std::atomic<float> postFilterBeta{0.f};         // 最近一次 df_set_post_filter_beta，没有调用过时为 NAN
+
+    void reset();
+};
+
+// 测试进程里的 pwritev 先经过这里再交给 libc，模拟其他应用 fsync、eMMC 垃圾回收造成的停顿
+struct Storage {
+    std::atomic<int> stallEvery{0};                 // 每 stallEvery 次 pwritev 停顿一次，0 表示不停顿
+    std::atomic<int64_t> stallNs{0};
+
+    std::atomic<uint64_t> writes{0};
+    std::atomic<uint64_t> stalls{0};
+
+    void reset();
+};
+
+AAudio& aaudio();
+Apm& apm();
+DeepFilter& deepFilter();
+Storage& storage();
+
+inline void resetAll() {
+    aaudio().reset();
+    apm().reset();
+    deepFilter().reset();
+    storage().reset();
+}
+
+} // namespace fake_device
+
+#endif //AAUDIORECORDER_TESTS_HOST_FAKEDEVICES_H
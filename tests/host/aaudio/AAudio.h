@@ -0,0 +1,77 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_TESTS_HOST_AAUDIO_H
+#define AAUDIORECORDER_TESTS_HOST_AAUDIO_H
+
+#include <stdint.h>
+
+/**
+ * 主机上的 AAudio 替身，只有 recorder 用到的接口，名字和取值与 NDK 的 <aaudio/AAudio.h> 一致。
+ * 设备由 host/fake_aaudio.cpp 模拟，行为和参数见 FakeDevices.h
+ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct AAudioStreamStruct AAudioStream;
+typedef struct AAudioStreamBuilderStruct AAudioStreamBuilder;
+
+typedef int32_t aaudio_result_t;
+typedef int32_t aaudio_direction_t;
+typedef int32_t aaudio_format_t;
+typedef int32_t aaudio_sharing_mode_t;
+typedef int32_t aaudio_data_callback_result_t;
+
+enum {
+    AAUDIO_OK = 0,
+    AAUDIO_ERROR_INTERNAL = -896,
+};
+
+enum {
+    AAUDIO_DIRECTION_OUTPUT = 0,
+    AAUDIO_DIRECTION_INPUT = 1,
+};
+
+enum {
+    AAUDIO_FORMAT_PCM_I16 = 1,
+    AAUDIO_FORMAT_PCM_FLOAT = 2,
+};
+
+enum {
+    AAUDIO_SHARING_MODE_EXCLUSIVE = 0,
+    AAUDIO_SHARING_MODE_SHARED = 1,
+};
+
+enum {
+    AAUDIO_CALLBACK_RESULT_CONTINUE = 0,
+    AAUDIO_CALLBACK_RESULT_STOP = 1,
+};
+
+typedef aaudio_data_callback_result_t (*AAudioStream_dataCallback)(
+        AAudioStream* stream, void* userData, void* audioData, int32_t numFrames);
+typedef void (*AAudioStream_errorCallback)(AAudioStream* stream, void* userData, aaudio_result_t error);
+
+aaudio_result_t AAudio_createStreamBuilder(AAudioStreamBuilder** builder);
+void AAudioStreamBuilder_setDirection(AAudioStreamBuilder* builder, aaudio_direction_t direction);
+void AAudioStreamBuilder_setSampleRate(AAudioStreamBuilder* builder, int32_t sampleRate);
+void AAudioStreamBuilder_setChannelCount(AAudioStreamBuilder* builder, int32_t channelCount);
+void AAudioStreamBuilder_setFormat(AAudioStreamBuilder* builder, aaudio_format_t format);
+void AAudioStreamBuilder_setSharingMode(AAudioStreamBuilder* builder, aaudio_sharing_mode_t sharingMode);
+void AAudioStreamBuilder_setDataCallback(AAudioStreamBuilder* builder, AAudioStream_dataCallback callback,
+                                         void* userData);
+void AAudioStreamBuilder_setErrorCallback(AAudioStreamBuilder* builder, AAudioStream_errorCallback callback,
+                                          void* userData);
+aaudio_result_t AAudioStreamBuilder_openStream(AAudioStreamBuilder* builder, AAudioStream** stream);
+aaudio_result_t AAudioStreamBuilder_delete(AAudioStreamBuilder* builder);
+
+aaudio_result_t AAudioStream_requestStart(AAudioStream* stream);
+aaudio_result_t AAudioStream_requestStop(AAudioStream* stream);
+aaudio_result_t AAudioStream_close(AAudioStream* stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //AAUDIORECORDER_TESTS_HOST_AAUDIO_H
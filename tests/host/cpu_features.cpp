@@ -0,0 +1,38 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include "system_wrappers/include/cpu_features_wrapper.h"
+
+/**
+ * 主机上没有 webrtc 的库，这里按编译器内建的 CPU 检测实现 cpu_features_wrapper，
+ * 和 webrtc 自己的实现一样在运行时判断，不依赖编译选项
+ */
+namespace webrtc {
+
+int GetCPUInfo(CPUFeature feature) {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (feature) {
+        case kSSE2: return __builtin_cpu_supports("sse2");
+        case kSSE3: return __builtin_cpu_supports("sse3");
+        case kAVX2: return __builtin_cpu_supports("avx2");
+        case kFMA3: return __builtin_cpu_supports("fma");
+    }
+#endif
+    (void) feature;
+    return 0;
+}
+
+int GetCPUInfoNoASM(CPUFeature feature) {
+    return GetCPUInfo(feature);
+}
+
+uint64_t GetCPUFeaturesARM(void) {
+#if defined(__aarch64__)
+    return kCPUFeatureARMv7 | kCPUFeatureVFPv3 | kCPUFeatureNEON | kCPUFeatureLDREXSTREX;
+#else
+    return 0;
+#endif
+}
+
+} // namespace webrtc
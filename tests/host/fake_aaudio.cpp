@@ -0,0 +1,164 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include <aaudio/AAudio.h>
+
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "FakeDevices.h"
+
+/**
+ * 假的 AAudio 输入设备
+ * requestStart 之后在单独的线程上按 framesPerCallback / 采样率的节奏回调，数据是 -12 dBFS 的 1 kHz 正弦；
+ * 按绝对时间推进，回调线程被抢占之后下一次回调会补上，和真实设备一样不会变慢。requestStop 等回调线程退出
+ */
+namespace fake_device {
+
+namespace {
+
+int64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void sleepNs(int64_t ns) {
+    if (ns > 0) std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+}
+
+} // namespace
+
+void AAudio::reset() {
+    openDelayNs = 0;
+    framesPerCallback = 192;
+    failStart = false;
+    openedNs = 0;
+    requestStartNs = 0;
+    firstCallbackNs = 0;
+    framesDelivered = 0;
+}
+
+AAudio& aaudio() {
+    static AAudio device;
+    return device;
+}
+
+} // namespace fake_device
+
+struct AAudioStreamBuilderStruct {
+    int32_t sampleRate = 48000;
+    int32_t channelCount = 1;
+    AAudioStream_dataCallback dataCallback = nullptr;
+    AAudioStream_errorCallback errorCallback = nullptr;
+    void* userData = nullptr;
+};
+
+struct AAudioStreamStruct {
+    AAudioStreamBuilderStruct config;
+    std::thread thread;
+    std::atomic<bool> running{false};
+    uint64_t position = 0;      // 送出的帧数，决定正弦的相位
+
+    void run() {
+        auto& device = fake_device::aaudio();
+        const int32_t frames = device.framesPerCallback.load();
+        const int64_t periodNs = 1000000000LL * frames / config.sampleRate;
+        std::vector<int16_t> buffer(static_cast<size_t>(frames) * config.channelCount);
+
+        int64_t next = fake_device::steadyNs() + periodNs;
+        while (running.load(std::memory_order_relaxed)) {
+            fake_device::sleepNs(next - fake_device::steadyNs());
+            if (!running.load(std::memory_order_relaxed)) break;
+            next += periodNs;
+
+            for (int32_t i = 0; i < frames; ++i, ++position) {
+                auto value = static_cast<int16_t>(8192.0 * std::sin(2.0 * M_PI * 1000.0 * position / config.sampleRate));
+                for (int32_t ch = 0; ch < config.channelCount; ++ch) {
+                    buffer[static_cast<size_t>(i * config.channelCount + ch)] = value;
+                }
+            }
+            if (device.firstCallbackNs.load(std::memory_order_relaxed) == 0) {
+                device.firstCallbackNs.store(fake_device::steadyNs(), std::memory_order_relaxed);
+            }
+            config.dataCallback(this, config.userData, buffer.data(), frames);
+            device.framesDelivered.fetch_add(static_cast<uint64_t>(frames), std::memory_order_relaxed);
+        }
+    }
+};
+
+extern "C" {
+
+aaudio_result_t AAudio_createStreamBuilder(AAudioStreamBuilder** builder) {
+    *builder = new AAudioStreamBuilder();
+    return AAUDIO_OK;
+}
+
+void AAudioStreamBuilder_setDirection(AAudioStreamBuilder*, aaudio_direction_t) {}
+
+void AAudioStreamBuilder_setSampleRate(AAudioStreamBuilder* builder, int32_t sampleRate) {
+    builder->sampleRate = sampleRate;
+}
+
+void AAudioStreamBuilder_setChannelCount(AAudioStreamBuilder* builder, int32_t channelCount) {
+    builder->channelCount = channelCount;
+}
+
+void AAudioStreamBuilder_setFormat(AAudioStreamBuilder*, aaudio_format_t) {}
+
+void AAudioStreamBuilder_setSharingMode(AAudioStreamBuilder*, aaudio_sharing_mode_t) {}
+
+void AAudioStreamBuilder_setDataCallback(AAudioStreamBuilder* builder, AAudioStream_dataCallback callback,
+                                         void* userData) {
+    builder->dataCallback = callback;
+    builder->userData = userData;
+}
+
+void AAudioStreamBuilder_setErrorCallback(AAudioStreamBuilder* builder, AAudioStream_errorCallback callback,
+                                          void*) {
+    builder->errorCallback = callback;
+}
+
+aaudio_result_t AAudioStreamBuilder_openStream(AAudioStreamBuilder* builder, AAudioStream** stream) {
+    auto& device = fake_device::aaudio();
+    fake_device::sleepNs(device.openDelayNs.load());
+    auto* opened = new AAudioStream();
+    opened->config = *builder;
+    *stream = opened;
+    device.openStreams.fetch_add(1);
+    device.openedNs.store(fake_device::steadyNs());
+    return AAUDIO_OK;
+}
+
+aaudio_result_t AAudioStreamBuilder_delete(AAudioStreamBuilder* builder) {
+    delete builder;
+    return AAUDIO_OK;
+}
+
+aaudio_result_t AAudioStream_requestStart(AAudioStream* stream) {
+    auto& device = fake_device::aaudio();
+    if (device.failStart.load()) return AAUDIO_ERROR_INTERNAL;
+    if (stream->running.load()) return AAUDIO_OK;
+    device.requestStartNs.store(fake_device::steadyNs());
+    device.firstCallbackNs.store(0);
+    stream->running.store(true);
+    stream->thread = std::thread(&AAudioStream::run, stream);
+    return AAUDIO_OK;
+}
+
+aaudio_result_t AAudioStream_requestStop(AAudioStream* stream) {
+    stream->running.store(false);
+    if (stream->thread.joinable()) stream->thread.join();
+    return AAUDIO_OK;
+}
+
+aaudio_result_t AAudioStream_close(AAudioStream* stream) {
+    AAudioStream_requestStop(stream);
+    delete stream;
+    fake_device::aaudio().openStreams.fetch_sub(1);
+    return AAUDIO_OK;
+}
+
+} // extern "C"
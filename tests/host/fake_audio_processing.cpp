@@ -0,0 +1,245 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "modules/audio_processing/include/audio_processing.h"
+
+#include "FakeDevices.h"
+
+/**
+ * 主机上没有 webrtc-audio-processing，这里是直通的 AudioProcessing：
+ * 输出等于输入 (打开 adaptFrames 时乘上逐帧收敛的增益)，capture post processing (DeepFilterProcessing) 照常在采集链路最后运行，
+ * 耗时由 fake_device::apm() 控制。recorder 只用到 10 ms 帧、输入输出格式相同的情况
+ */
+namespace fake_device {
+
+namespace {
+
+int64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void sleepNs(int64_t ns) {
+    if (ns > 0) std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+}
+
+} // namespace
+
+void Apm::reset() {
+    createDelayNs = 0;
+    frameCostNs = 0;
+    stallOnceNs = 0;
+    adaptFrames = 0;
+    targetGain = 1.f;
+    createdNs = 0;
+    created = 0;
+    framesProcessed = 0;
+    lastProcessNs = 0;
+    streamDelayMs = -1;
+}
+
+Apm& apm() {
+    static Apm control;
+    return control;
+}
+
+} // namespace fake_device
+
+namespace webrtc {
+
+// DeepFilterProcessing 只用到这两个拷贝函数，这里是平面 float 的简单实现
+class AudioBuffer {
+public:
+    void CopyFrom(const float* const* data, const StreamConfig& stream_config);
+    void CopyTo(const StreamConfig& stream_config, float* const* data);
+
+    std::vector<std::vector<float>> channels;
+};
+
+void AudioBuffer::CopyFrom(const float* const* data, const StreamConfig& stream_config) {
+    for (size_t ch = 0; ch < stream_config.num_channels(); ++ch) {
+        std::copy(data[ch], data[ch] + stream_config.num_frames(), channels[ch].begin());
+    }
+}
+
+void AudioBuffer::CopyTo(const StreamConfig& stream_config, float* const* data) {
+    for (size_t ch = 0; ch < stream_config.num_channels(); ++ch) {
+        std::copy(channels[ch].begin(), channels[ch].begin() + stream_config.num_frames(), data[ch]);
+    }
+}
+
+namespace {
+
+class FakeAudioProcessing : public AudioProcessing {
+public:
+    FakeAudioProcessing(const Config& config, std::unique_ptr<CustomProcessing> postProcessing)
+        : config(config), postProcessing(std::move(postProcessing)) {}
+
+    // 安装的头文件里没有 RefCountedObject，引用计数在这里实现
+    void AddRef() const override { references.fetch_add(1, std::memory_order_relaxed); }
+
+    RefCountReleaseStatus Release() const override {
+        if (references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+            return RefCountReleaseStatus::kDroppedLastRef;
+        }
+        return RefCountReleaseStatus::kOtherRefsRemained;
+    }
+
+    int Initialize() override {
+        gain = 1.f;
+        return kNoError;
+    }
+    int Initialize(const ProcessingConfig&) override { return Initialize(); }
+    void ApplyConfig(const Config& newConfig) override { config = newConfig; }
+
+    int proc_sample_rate_hz() const override { return sampleRate; }
+    int proc_split_sample_rate_hz() const override { return std::min(sampleRate, 16000); }
+    size_t num_input_channels() const override { return channels; }
+    size_t num_proc_channels() const override { return channels; }
+    size_t num_output_channels() const override { return channels; }
+    size_t num_reverse_channels() const override { return channels; }
+
+    void set_output_will_be_muted(bool) override {}
+    void SetRuntimeSetting(RuntimeSetting) override {}
+    bool PostRuntimeSetting(RuntimeSetting) override { return true; }
+
+    int ProcessStream(const int16_t* const src, const StreamConfig& input, const StreamConfig&,
+                      int16_t* const dest) override {
+        // 和真实 APM 一样 int16 先转成 float 再处理
+        const size_t frames = input.num_frames();
+        const size_t count = input.num_channels();
+        prepare(input);
+        for (size_t ch = 0; ch < count; ++ch) {
+            for (size_t i = 0; i < frames; ++i) {
+                buffer.channels[ch][i] = src[i * count + ch] / 32768.f;
+            }
+        }
+        process(input);
+        for (size_t ch = 0; ch < count; ++ch) {
+            for (size_t i = 0; i < frames; ++i) {
+                float v = std::min(std::max(buffer.channels[ch][i] * 32768.f, -32768.f), 32767.f);
+                dest[i * count + ch] = static_cast<int16_t>(v + (v < 0.f ? -0.5f : 0.5f));
+            }
+        }
+        return kNoError;
+    }
+
+    int ProcessStream(const float* const* src, const StreamConfig& input, const StreamConfig&,
+                      float* const* dest) override {
+        prepare(input);
+        buffer.CopyFrom(src, input);
+        process(input);
+        buffer.CopyTo(input, dest);
+        return kNoError;
+    }
+
+    int ProcessReverseStream(const int16_t* const src, const StreamConfig& input, const StreamConfig&,
+                             int16_t* const dest) override {
+        std::copy(src, src + input.num_samples(), dest);
+        return kNoError;
+    }
+
+    int ProcessReverseStream(const float* const* src, const StreamConfig& input, const StreamConfig&,
+                             float* const* dest) override {
+        for (size_t ch = 0; ch < input.num_channels(); ++ch) {
+            std::copy(src[ch], src[ch] + input.num_frames(), dest[ch]);
+        }
+        return kNoError;
+    }
+
+    int AnalyzeReverseStream(const float* const*, const StreamConfig&) override { return kNoError; }
+    bool GetLinearAecOutput(rtc::ArrayView<std::array<float, 160>>) const override { return false; }
+
+    void set_stream_analog_level(int level) override { analogLevel = level; }
+    int recommended_stream_analog_level() const override { return analogLevel; }
+
+    int set_stream_delay_ms(int delay) override {
+        delayMs = delay;
+        fake_device::apm().streamDelayMs.store(delay, std::memory_order_relaxed);
+        return kNoError;
+    }
+    int stream_delay_ms() const override { return delayMs; }
+    void set_stream_key_pressed(bool) override {}
+
+    bool CreateAndAttachAecDump(absl::string_view, int64_t, absl::Nonnull<TaskQueueBase*>) override {
+        return false;
+    }
+    bool CreateAndAttachAecDump(absl::Nonnull<FILE*>, int64_t, absl::Nonnull<TaskQueueBase*>) override {
+        return false;
+    }
+    void AttachAecDump(std::unique_ptr<AecDump>) override {}
+    void DetachAecDump() override {}
+
+    AudioProcessingStats GetStatistics() override { return AudioProcessingStats(); }
+    AudioProcessingStats GetStatistics(bool) override { return AudioProcessingStats(); }
+    AudioProcessing::Config GetConfig() const override { return config; }
+
+private:
+    void prepare(const StreamConfig& input) {
+        if (sampleRate == input.sample_rate_hz() && channels == input.num_channels()) return;
+        sampleRate = input.sample_rate_hz();
+        channels = input.num_channels();
+        buffer.channels.assign(channels, std::vector<float>(input.num_frames()));
+        if (postProcessing) postProcessing->Initialize(sampleRate, static_cast<int>(channels));
+    }
+
+    void process(const StreamConfig&) {
+        auto& control = fake_device::apm();
+        fake_device::sleepNs(control.frameCostNs.load(std::memory_order_relaxed) +
+                             control.stallOnceNs.exchange(0, std::memory_order_relaxed));
+        adapt(control);
+        if (postProcessing) postProcessing->Process(&buffer);
+        control.framesProcessed.fetch_add(1, std::memory_order_relaxed);
+        control.lastProcessNs.store(fake_device::steadyNs(), std::memory_order_relaxed);
+    }
+
+    // 模拟 AGC 这类自适应状态：增益从 1 按一阶指数逼近 targetGain，Initialize() 后重新收敛
+    void adapt(const fake_device::Apm& control) {
+        int frames = control.adaptFrames.load(std::memory_order_relaxed);
+        if (frames <= 0) return;
+        for (auto& channel : buffer.channels) {
+            for (float& v : channel) v *= gain;
+        }
+        gain += (control.targetGain.load(std::memory_order_relaxed) - gain) / static_cast<float>(frames);
+    }
+
+    mutable std::atomic<int> references{0};
+    Config config;
+    std::unique_ptr<CustomProcessing> postProcessing;
+    AudioBuffer buffer;
+    int sampleRate = 0;
+    size_t channels = 0;
+    int analogLevel = 255;
+    int delayMs = 0;
+    float gain = 1.f;
+};
+
+} // namespace
+
+void CustomProcessing::SetRuntimeSetting(AudioProcessing::RuntimeSetting) {}
+
+AudioProcessingBuilder::AudioProcessingBuilder() = default;
+AudioProcessingBuilder::~AudioProcessingBuilder() = default;
+
+rtc::scoped_refptr<AudioProcessing> AudioProcessingBuilder::Create() {
+    auto& control = fake_device::apm();
+    fake_device::sleepNs(control.createDelayNs.load());
+    rtc::scoped_refptr<AudioProcessing> apm(new FakeAudioProcessing(config_, std::move(capture_post_processing_)));
+    control.created.fetch_add(1);
+    control.createdNs.store(fake_device::steadyNs());
+    return apm;
+}
+
+AudioProcessingStats::AudioProcessingStats() = default;
+AudioProcessingStats::AudioProcessingStats(const AudioProcessingStats&) = default;
+AudioProcessingStats::~AudioProcessingStats() = default;
+
+} // namespace webrtc
@@ -0,0 +1,153 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include <df.h>
+
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "FakeDevices.h"
+
+/**
+ * 假的 libdf：hop 480 (48 kHz 的 DeepFilterNet2/3)，模型只给出恒定的 ERB 增益，不输出 DF 系数。
+ * df_process_frame 按 libDF 的 STFT 延迟 (fft_size - hop = 一个 hop) 输出，增益变化时
+ * 和 STFT 合成一样按 Vorbis 窗的 w² 在相邻两帧的增益之间过渡，
+ * 所以它和 df_process_frame_raw + 本地的 STFT 合成应当得到相同的结果
+ */
+namespace fake_device {
+
+void DeepFilter::reset() {
+    createDelayNs = 0;
+    frameCostNs = 0;
+    coldFrameCostNs = 0;
+    gain = 0.5f;
+    snrDb = 10.f;
+    dfCoefs = false;
+    created = 0;
+    framesProcessed = 0;
+    attenLimDb = NAN;
+    postFilterBeta = NAN;
+}
+
+DeepFilter& deepFilter() {
+    static DeepFilter control;
+    return control;
+}
+
+} // namespace fake_device
+
+namespace {
+
+constexpr size_t kHop = 480;
+constexpr size_t kErbBands = 32;
+constexpr size_t kDfOrder = 5;
+constexpr size_t kDfBins = 96;
+
+void sleepNs(int64_t ns) {
+    if (ns > 0) std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+}
+
+// fft_size = 2 * hop 的 Vorbis 窗的平方，前后两半之和为 1
+const std::vector<float>& squaredWindow() {
+    static const std::vector<float> w2 = [] {
+        std::vector<float> w(2 * kHop);
+        for (size_t i = 0; i < w.size(); ++i) {
+            double s = std::sin(0.5 * M_PI * (static_cast<double>(i) + 0.5) / kHop);
+            double v = std::sin(0.5 * M_PI * s * s);
+            w[i] = static_cast<float>(v * v);
+        }
+        return w;
+    }();
+    return w2;
+}
+
+// 增益为 NULL 时相当于 1
+float effectiveGain() {
+    auto& control = fake_device::deepFilter();
+    return control.snrDb.load() > 30.f ? 1.f : control.gain.load();
+}
+
+} // namespace
+
+struct DFState {
+    std::vector<float> previous = std::vector<float>(kHop, 0.f);   // 延迟一个 hop
+    std::vector<float> gains = std::vector<float>(kErbBands, 1.f);
+    std::vector<float> coefs = std::vector<float>(kDfOrder * kDfBins * 2, 0.f);
+    float previousGain = 1.f;
+    uint64_t frames = 0;
+};
+
+namespace {
+
+// 模拟推理耗时，返回局部 SNR
+float frameCost(DFState* st) {
+    auto& control = fake_device::deepFilter();
+    sleepNs(control.frameCostNs.load() + (st->frames++ == 0 ? control.coldFrameCostNs.load() : 0));
+    control.framesProcessed.fetch_add(1);
+    return control.snrDb.load();
+}
+
+} // namespace
+
+extern "C" {
+
+DFState* df_create(const char*, float, const char*) {
+    auto& control = fake_device::deepFilter();
+    sleepNs(control.createDelayNs.load());
+    control.created.fetch_add(1);
+    return new DFState();
+}
+
+uintptr_t df_get_frame_length(DFState*) {
+    return kHop;
+}
+
+char* df_next_log_msg(DFState*) {
+    return nullptr;
+}
+
+void df_free_log_msg(char*) {}
+
+void df_set_atten_lim(DFState*, float lim_db) {
+    fake_device::deepFilter().attenLimDb.store(lim_db);
+}
+
+void df_set_post_filter_beta(DFState*, float beta) {
+    fake_device::deepFilter().postFilterBeta.store(beta);
+}
+
+float df_process_frame(DFState* st, float* input, float* output) {
+    float snr = frameCost(st);
+    float gain = effectiveGain();
+    // 上一个 hop 的输入同时落在上一帧的后半窗和这一帧的前半窗里
+    const std::vector<float>& w2 = squaredWindow();
+    for (size_t i = 0; i < kHop; ++i) {
+        output[i] = st->previous[i] * (st->previousGain * w2[i + kHop] + gain * w2[i]);
+        st->previous[i] = input[i];
+    }
+    st->previousGain = gain;
+    return snr;
+}
+
+float df_process_frame_raw(DFState* st, float*, float** out_gains_p, float** out_coefs_p) {
+    float snr = frameCost(st);
+    float gain = effectiveGain();
+    for (auto& g : st->gains) g = gain;
+    *out_gains_p = snr > 30.f ? nullptr : st->gains.data();
+    *out_coefs_p = nullptr;
+    if (fake_device::deepFilter().dfCoefs.load() && snr <= 20.f) {
+        // [df_order, nb_df, 2]，从旧到新；只有最新一帧 (没有 DF 前瞻) 的实部为 gain，卷积结果等于 gain * 当前频谱
+        for (size_t k = 0; k < kDfBins; ++k) st->coefs[((kDfOrder - 1) * kDfBins + k) * 2] = gain;
+        *out_coefs_p = st->coefs.data();
+    }
+    return snr;
+}
+
+void df_free(DFState* model) {
+    delete model;
+}
+
+} // extern "C"
@@ -0,0 +1,45 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#include <dlfcn.h>
+#include <sys/uio.h>
+
+#include <chrono>
+#include <thread>
+
+#include "FakeDevices.h"
+
+/**
+ * 可执行文件里定义的 pwritev 优先于 libc 的版本，AsyncFileWriter 的写入都会经过这里：
+ * 按 fake_device::storage() 的设置停顿之后，再调用 libc 真正写入
+ */
+namespace fake_device {
+
+void Storage::reset() {
+    stallEvery = 0;
+    stallNs = 0;
+    writes = 0;
+    stalls = 0;
+}
+
+Storage& storage() {
+    static Storage control;
+    return control;
+}
+
+} // namespace fake_device
+
+extern "C" ssize_t pwritev(int fd, const struct iovec* iov, int count, off_t offset) {
+    using Pwritev = ssize_t (*)(int, const struct iovec*, int, off_t);
+    static const auto next = reinterpret_cast<Pwritev>(dlsym(RTLD_NEXT, "pwritev"));
+
+    auto& control = fake_device::storage();
+    uint64_t writes = control.writes.fetch_add(1) + 1;
+    int every = control.stallEvery.load();
+    if (every > 0 && writes % static_cast<uint64_t>(every) == 0) {
+        control.stalls.fetch_add(1);
+        std::this_thread::sleep_for(std::chrono::nanoseconds(control.stallNs.load()));
+    }
+    return next(fd, iov, count, offset);
+}
@@ -0,0 +1,21 @@
+//
+// Created by kotlinx on 2026/10/17.
+//
+
+#ifndef AAUDIORECORDER_TESTS_HOST_STDATOMIC_H
+#define AAUDIORECORDER_TESTS_HOST_STDATOMIC_H
+
+/**
+ * lwrb.h 在 extern "C" 块里包含 <stdatomic.h>。bionic 的 stdatomic.h 在 C++ 下改用 <atomic>，
+ * 主机上的 libstdc++ 在 C++23 之前没有这个兼容层，这里按 bionic 的做法补上。C 代码照常用系统头文件
+ */
+#ifdef __cplusplus
+extern "C++" {
+#include <atomic>
+}
+using std::atomic_ulong;
+#else
+#include_next <stdatomic.h>
+#endif
+
+#endif //AAUDIORECORDER_TESTS_HOST_STDATOMIC_H